@@ -17,21 +17,28 @@
 #include <folly/Benchmark.h>
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
+#include <condition_variable>
 #include <cstring>
 #include <iostream>
 #include <limits>
 #include <map>
 #include <memory>
 #include <numeric>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include <folly/FileUtil.h>
 #include <folly/MapUtil.h>
 #include <folly/String.h>
+#include <folly/detail/PerfCounters.h>
 #include <folly/detail/PerfScoped.h>
 #include <folly/json/json.h>
+#include <folly/portability/PThread.h>
+#include <folly/portability/Sched.h>
+#include <folly/system/HardwareConcurrency.h>
 
 // This needs to be at the end because some versions end up including
 // Windows.h without defining NOMINMAX, which breaks uses
@@ -62,6 +69,13 @@ FOLLY_GFLAGS_DEFINE_string(
     " to be available on the system. Example: --bm_perf_args=\"record -g\"");
 #endif
 
+FOLLY_GFLAGS_DEFINE_bool(
+    bm_perf_counters,
+    false,
+    "Count the instructions, cycles, last-level cache misses and branch "
+    "misses of each benchmark with hardware performance counters, and "
+    "report them per iteration.");
+
 FOLLY_GFLAGS_DEFINE_bool(
     bm_profile, false, "Run benchmarks with constant number of iterations");
 
@@ -121,6 +135,35 @@ FOLLY_GFLAGS_DEFINE_bool(
     false,
     "Print out list of all benchmark test names without running them.");
 
+FOLLY_GFLAGS_DEFINE_bool(
+    bm_pin_threads,
+    false,
+    "Pin the threads of BENCHMARK_THREADS benchmarks to distinct CPUs.");
+
+FOLLY_GFLAGS_DEFINE_bool(
+    bm_latency,
+    false,
+    "Time each call of the benchmarks separately, and report percentiles "
+    "of the time per iteration.");
+
+FOLLY_GFLAGS_DEFINE_uint32(
+    bm_latency_batch,
+    1,
+    "Number of iterations of each timed call with --bm_latency.");
+
+FOLLY_GFLAGS_DEFINE_uint32(
+    bm_latency_samples,
+    100000,
+    "Maximum number of timed calls of each benchmark with --bm_latency.");
+
+FOLLY_GFLAGS_DEFINE_double(
+    bm_latency_rate,
+    0,
+    "With --bm_latency, start the calls at this fixed rate per second, and "
+    "time them from when they should have started, so that stalls count "
+    "for all the calls they delay. 0 starts each call when the previous one "
+    "is done.");
+
 namespace folly {
 namespace detail {
 
@@ -161,7 +204,24 @@ BENCHMARK(FB_FOLLY_GLOBAL_BENCHMARK_SUSPENDER_BASELINE) {
 #undef FB_STRINGIZE_X2
 #undef FB_FOLLY_GLOBAL_BENCHMARK_BASELINE
 
-static std::pair<double, UserCounters> runBenchmarkGetNSPerIteration(
+namespace {
+struct TrialResult {
+  double nsPerIter = 0;
+  UserCounters counters;
+  detail::PerfCounterValues perfCounters;
+  detail::LatencyDistribution latency;
+};
+
+TrialResult makeTrialResult(double nsPerIter, detail::TimeIterData& data) {
+  TrialResult res;
+  res.nsPerIter = nsPerIter;
+  res.counters = std::move(data.userCounters);
+  res.perfCounters = data.perfCounters;
+  return res;
+}
+} // namespace
+
+static TrialResult runBenchmarkGetNSPerIteration(
     const BenchmarkFun& fun, const double globalBaseline) {
   using std::chrono::duration_cast;
   using std::chrono::high_resolution_clock;
@@ -186,8 +246,7 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIteration(
   const auto timeBudget = seconds(FLAGS_bm_max_secs);
   auto global = high_resolution_clock::now();
 
-  std::vector<std::pair<double, UserCounters>> trialResults(
-      FLAGS_bm_max_trials);
+  std::vector<TrialResult> trialResults(FLAGS_bm_max_trials);
   size_t actualTrials = 0;
 
   // We do measurements in several trials (epochs) and take the minimum, to
@@ -202,9 +261,9 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIteration(
       // We got an accurate enough timing, done. But only save if
       // smaller than the current result.
       auto nsecs = duration_cast<nanoseconds>(timeIterData.duration);
-      trialResults[actualTrials] = std::make_pair(
+      trialResults[actualTrials] = makeTrialResult(
           max(0.0, double(nsecs.count()) / timeIterData.niter - globalBaseline),
-          std::move(timeIterData.userCounters));
+          timeIterData);
       // Done with the current trial, we got a meaningful timing.
       break;
     }
@@ -221,21 +280,22 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIteration(
   auto iter = min_element(
       trialResults.begin(),
       trialResults.begin() + actualTrials,
-      [](const auto& a, const auto& b) { return a.first < b.first; });
+      [](const auto& a, const auto& b) { return a.nsPerIter < b.nsPerIter; });
 
   // If the benchmark was basically drowned in baseline noise, it's
   // possible it became negative.
-  return std::make_pair(max(0.0, iter->first), iter->second);
+  TrialResult res = *iter;
+  res.nsPerIter = max(0.0, res.nsPerIter);
+  return res;
 }
 
-static std::pair<double, UserCounters> runBenchmarkGetNSPerIterationEstimate(
+static TrialResult runBenchmarkGetNSPerIterationEstimate(
     const BenchmarkFun& fun, const double globalBaseline) {
   using std::chrono::duration_cast;
   using std::chrono::high_resolution_clock;
   using std::chrono::microseconds;
   using std::chrono::nanoseconds;
   using std::chrono::seconds;
-  using TrialResultType = std::pair<double, UserCounters>;
 
   // They key here is accuracy; too low numbers means the accuracy was
   // coarse. We up the ante until we get to at least minNanoseconds
@@ -265,7 +325,7 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIterationEstimate(
   // We do measurements in several trials (epochs) to account for jitter.
   size_t actualTrials = 0;
   const unsigned int estimateCount = to_integral(max(1.0, 5e+7 / estPerIter));
-  std::vector<TrialResultType> trialResults(FLAGS_bm_max_trials);
+  std::vector<TrialResult> trialResults(FLAGS_bm_max_trials);
   const auto maxRunTime = seconds(max(5, FLAGS_bm_max_secs));
   auto globalStart = high_resolution_clock::now();
 
@@ -278,8 +338,7 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIterationEstimate(
     if (nsecs.count() > globalBaseline) {
       auto nsecIter =
           double(nsecs.count() - globalBaseline) / timeIterData.niter;
-      trialResults[actualTrials++] =
-          std::make_pair(nsecIter, std::move(timeIterData.userCounters));
+      trialResults[actualTrials++] = makeTrialResult(nsecIter, timeIterData);
     }
     // Check if we are out of time quota
     auto now = high_resolution_clock::now();
@@ -292,8 +351,8 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIterationEstimate(
   std::sort(
       trialResults.begin(),
       trialResults.begin() + actualTrials,
-      [](const TrialResultType& a, const TrialResultType& b) {
-        return a.first < b.first;
+      [](const TrialResult& a, const TrialResult& b) {
+        return a.nsPerIter < b.nsPerIter;
       });
 
   const auto getPercentile = [](size_t count, double p) -> size_t {
@@ -304,20 +363,21 @@ static std::pair<double, UserCounters> runBenchmarkGetNSPerIterationEstimate(
   const size_t trialP75 = getPercentile(actualTrials, 0.75);
   if (trialP75 - trialP25 == 0) {
     // Use first trial results if p75 == p25.
-    return std::make_pair(trialResults[0].first, trialResults[0].second);
+    return trialResults[0];
   }
 
   double geomeanNsec = 0.0;
   for (size_t tryId = trialP25; tryId < trialP75; tryId++) {
-    geomeanNsec += std::log(trialResults[tryId].first);
+    geomeanNsec += std::log(trialResults[tryId].nsPerIter);
   }
   geomeanNsec = std::exp(geomeanNsec / (1.0 * (trialP75 - trialP25)));
 
-  return std::make_pair(
-      geomeanNsec, trialResults[trialP25 + (trialP75 - trialP25) / 2].second);
+  TrialResult res = trialResults[trialP25 + (trialP75 - trialP25) / 2];
+  res.nsPerIter = geomeanNsec;
+  return res;
 }
 
-static std::pair<double, UserCounters> runProfilingGetNSPerIteration(
+static TrialResult runProfilingGetNSPerIteration(
     const BenchmarkFun& fun, const double globalBaseline) {
   using std::chrono::duration_cast;
   using std::chrono::high_resolution_clock;
@@ -336,7 +396,70 @@ static std::pair<double, UserCounters> runProfilingGetNSPerIteration(
 
   auto nsecs = duration_cast<nanoseconds>(timeIterData.duration);
   auto nsecIter = double(nsecs.count()) / timeIterData.niter - globalBaseline;
-  return std::make_pair(nsecIter, std::move(timeIterData.userCounters));
+  return makeTrialResult(nsecIter, timeIterData);
+}
+
+// Times many small calls of fun, for --bm_latency.  overheadNs, the time
+// per iteration of calling the global baseline the same way, is subtracted.
+static TrialResult runBenchmarkGetLatencies(
+    const BenchmarkFun& fun, const double overheadNs) {
+  using std::chrono::duration;
+  using std::chrono::duration_cast;
+  using std::chrono::high_resolution_clock;
+  using std::chrono::nanoseconds;
+  using std::chrono::seconds;
+
+  const auto batch = std::max<uint32_t>(1, FLAGS_bm_latency_batch);
+  const size_t maxSamples = std::max<uint32_t>(1, FLAGS_bm_latency_samples);
+  const auto timeBudget = seconds(FLAGS_bm_max_secs);
+  const bool openLoop = FLAGS_bm_latency_rate > 0;
+  const auto interval = openLoop
+      ? duration_cast<nanoseconds>(duration<double>(1 / FLAGS_bm_latency_rate))
+      : nanoseconds(0);
+
+  TrialResult res;
+  std::vector<double> samples;
+  samples.reserve(std::min<size_t>(maxSamples, 1 << 16));
+  double totalNs = 0;
+  size_t totalIters = 0;
+
+  const auto start = high_resolution_clock::now();
+  auto scheduled = start;
+  while (samples.size() < maxSamples) {
+    auto now = high_resolution_clock::now();
+    if (now - start >= timeBudget) {
+      break;
+    }
+    // In the open loop mode, a call that starts late because the previous
+    // ones took too long is timed from when it should have started.
+    nanoseconds delay{0};
+    if (openLoop) {
+      while (now < scheduled) {
+        now = high_resolution_clock::now();
+      }
+      delay = duration_cast<nanoseconds>(now - scheduled);
+      scheduled += interval;
+    }
+
+    detail::TimeIterData timeIterData = fun(batch);
+    const auto niter = std::max(1u, timeIterData.niter);
+    auto nsecs = duration_cast<nanoseconds>(timeIterData.duration + delay);
+    samples.push_back(max(0.0, double(nsecs.count()) / niter - overheadNs));
+    totalNs += double(nsecs.count());
+    totalIters += niter;
+
+    res.counters = std::move(timeIterData.userCounters);
+    if (samples.size() == 1) {
+      res.perfCounters = timeIterData.perfCounters;
+    } else {
+      res.perfCounters += timeIterData.perfCounters;
+    }
+  }
+
+  res.nsPerIter = max(0.0, totalNs / max<size_t>(1, totalIters) - overheadNs);
+  res.perfCounters = res.perfCounters / double(max<size_t>(1, samples.size()));
+  res.latency = detail::LatencyDistribution::fromSamples(std::move(samples));
+  return res;
 }
 
 struct ScaleInfo {
@@ -406,6 +529,115 @@ static string metricReadable(double n, unsigned int decimals) {
 
 namespace {
 
+// Whether --bm_perf_counters is set and the counters can be read.
+bool perfCountersEnabled() {
+  if (!FLAGS_bm_perf_counters) {
+    return false;
+  }
+  static const bool available = [] {
+    detail::PerfCounters perf;
+    if (!perf.available()) {
+      std::cerr << "WARNING: ignoring --bm_perf_counters: " << perf.error()
+                << std::endl;
+    }
+    return perf.available();
+  }();
+  return available;
+}
+
+struct PerfColumn {
+  const char* name;
+  int width;
+  double (*value)(const detail::PerfCounterValues&);
+};
+
+constexpr PerfColumn kPerfColumns[] = {
+    {"IPC",
+     7,
+     [](const detail::PerfCounterValues& v) {
+       return v.instructions / v.cycles;
+     }},
+    {"instrs/iter",
+     11,
+     [](const detail::PerfCounterValues& v) { return v.instructions; }},
+    {"LLC-miss/iter",
+     13,
+     [](const detail::PerfCounterValues& v) { return v.cacheMisses; }},
+    {"br-miss/iter",
+     12,
+     [](const detail::PerfCounterValues& v) { return v.branchMisses; }},
+};
+
+// The width of " (+12.3%)" after the values of a comparison.
+constexpr int kPerfDeltaWidth = 10;
+
+size_t perfColumnsLength(int extraWidth) {
+  size_t res = 0;
+  for (auto& column : kPerfColumns) {
+    res += 2 + column.width + extraWidth;
+  }
+  return res;
+}
+
+string perfReadable(double n) {
+  if (std::isnan(n)) {
+    return "NaN";
+  }
+  return n < 1000 ? stringPrintf("%.2f", n) : metricReadable(n, 2);
+}
+
+bool latencyModeEnabled() {
+  return FLAGS_bm_latency && !FLAGS_bm_profile;
+}
+
+struct LatencyColumn {
+  const char* name;
+  double detail::LatencyDistribution::*value;
+};
+
+constexpr LatencyColumn kLatencyColumns[] = {
+    {"p50", &detail::LatencyDistribution::p50},
+    {"p90", &detail::LatencyDistribution::p90},
+    {"p99", &detail::LatencyDistribution::p99},
+    {"p99.9", &detail::LatencyDistribution::p999},
+    {"max", &detail::LatencyDistribution::max},
+};
+
+constexpr int kLatencyColumnWidth = 9;
+
+size_t latencyColumnsLength() {
+  return std::size(kLatencyColumns) * (2 + kLatencyColumnWidth);
+}
+
+// The columns of latency percentiles in comparisons, followed by the change
+// of the median.
+constexpr LatencyColumn kLatencyComparisonColumns[] = {
+    {"p50", &detail::LatencyDistribution::p50},
+    {"p99", &detail::LatencyDistribution::p99},
+};
+
+constexpr std::string_view kLatencyChangeHeader = "p50 change";
+
+size_t latencyComparisonColumnsLength() {
+  return std::size(kLatencyComparisonColumns) * (2 + kLatencyColumnWidth) + 2 +
+      kLatencyChangeHeader.size();
+}
+
+// The relative change of the median latency from base to test if it is
+// significant, i.e. if the 95% confidence intervals of the medians don't
+// overlap, and "~" otherwise.
+string latencyChange(
+    const detail::LatencyDistribution& base,
+    const detail::LatencyDistribution& test) {
+  if (base.samples == 0 || test.samples == 0 || base.p50 == 0) {
+    return "";
+  }
+  if (test.p50Low > base.p50High || test.p50High < base.p50Low) {
+    return stringPrintf("%+.1f%%", (test.p50 / base.p50 - 1) * 100);
+  }
+  return "~";
+}
+
 constexpr std::string_view kUnitHeaders = "relative  time/iter   iters/s";
 constexpr std::string_view kUnitHeadersPadding = "     ";
 void printHeaderContents(std::string_view file) {
@@ -441,7 +673,10 @@ void printSeparator(char pad, unsigned int columns) {
 
 class BenchmarkResultsPrinter {
  public:
-  BenchmarkResultsPrinter() : columns_(FLAGS_bm_result_width_chars) {}
+  BenchmarkResultsPrinter()
+      : latencyColumns_(latencyModeEnabled()),
+        perfColumns_(perfCountersEnabled()),
+        columns_(FLAGS_bm_result_width_chars) {}
   explicit BenchmarkResultsPrinter(std::set<std::string> counterNames)
       : counterNames_(std::move(counterNames)),
         namesLength_{std::accumulate(
@@ -449,9 +684,16 @@ class BenchmarkResultsPrinter {
             counterNames_.end(),
             size_t{0},
             [](size_t acc, auto&& name) { return acc + 2 + name.length(); })},
+        latencyColumns_(latencyModeEnabled()),
+        perfColumns_(perfCountersEnabled()),
         columns_(FLAGS_bm_result_width_chars + namesLength_) {}
 
-  void separator(char pad) { printSeparator(pad, columns_); }
+  void separator(char pad) {
+    printSeparator(
+        pad,
+        columns_ + (latencyColumns_ ? latencyColumnsLength() : 0) +
+            (perfColumns_ ? perfColumnsLength(0) : 0));
+  }
 
   void header(std::string_view file) {
     separator('=');
@@ -459,6 +701,16 @@ class BenchmarkResultsPrinter {
     for (auto const& name : counterNames_) {
       printf("  %s", name.c_str());
     }
+    if (latencyColumns_) {
+      for (auto& column : kLatencyColumns) {
+        printf("  %*s", kLatencyColumnWidth, column.name);
+      }
+    }
+    if (perfColumns_) {
+      for (auto& column : kPerfColumns) {
+        printf("  %*s", column.width, column.name);
+      }
+    }
     printf("\n");
     separator('=');
   }
@@ -542,6 +794,22 @@ class BenchmarkResultsPrinter {
           printf("  %*s", int(name.length()), "NaN");
         }
       }
+      if (latencyColumns_) {
+        for (auto& column : kLatencyColumns) {
+          printf(
+              "  %*s",
+              kLatencyColumnWidth,
+              readableTime(datum.latency.*column.value / 1E9, 2).c_str());
+        }
+      }
+      if (perfColumns_) {
+        for (auto& column : kPerfColumns) {
+          printf(
+              "  %*s",
+              column.width,
+              perfReadable(column.value(datum.perfCounters)).c_str());
+        }
+      }
       printf("\n");
     }
   }
@@ -553,6 +821,8 @@ class BenchmarkResultsPrinter {
 
   std::set<std::string> counterNames_;
   size_t namesLength_{0};
+  bool latencyColumns_{false};
+  bool perfColumns_{false};
   size_t columns_{0};
   double baselineNsPerIter_{numeric_limits<double>::max()};
   string lastFile_;
@@ -569,34 +839,93 @@ static void printBenchmarkResultsAsJson(
   printf("%s\n", toPrettyJson(d).c_str());
 }
 
+// The names of the hardware performance counters in verbose JSON.
+constexpr std::pair<const char*, double detail::PerfCounterValues::*>
+    kPerfCounterNames[] = {
+        {"cycles", &detail::PerfCounterValues::cycles},
+        {"instructions", &detail::PerfCounterValues::instructions},
+        {"cache-misses", &detail::PerfCounterValues::cacheMisses},
+        {"branch-misses", &detail::PerfCounterValues::branchMisses},
+};
+
+// The names of the latency percentiles in verbose JSON, in nanoseconds.
+constexpr std::pair<const char*, double detail::LatencyDistribution::*>
+    kLatencyNames[] = {
+        {"p50", &detail::LatencyDistribution::p50},
+        {"p90", &detail::LatencyDistribution::p90},
+        {"p99", &detail::LatencyDistribution::p99},
+        {"p99.9", &detail::LatencyDistribution::p999},
+        {"max", &detail::LatencyDistribution::max},
+        {"p50_low", &detail::LatencyDistribution::p50Low},
+        {"p50_high", &detail::LatencyDistribution::p50High},
+};
+
+// Each result is [file, name, timeInNs], followed by objects of the user
+// counters, of the per-iteration hardware performance counters, and of the
+// latency distribution.  Trailing empty objects are left out.
 void benchmarkResultsToDynamic(
     const vector<detail::BenchmarkResult>& data, dynamic& out) {
   out = dynamic::array;
   for (auto& datum : data) {
-    if (!datum.counters.empty()) {
-      dynamic obj = dynamic::object;
-      for (auto& counter : datum.counters) {
-        dynamic counterInfo = dynamic::object;
-        counterInfo["value"] = counter.second.value;
-        counterInfo["type"] = static_cast<int>(counter.second.type);
-        obj[counter.first] = counterInfo;
+    dynamic counters = dynamic::object;
+    for (auto& counter : datum.counters) {
+      dynamic counterInfo = dynamic::object;
+      counterInfo["value"] = counter.second.value;
+      counterInfo["type"] = static_cast<int>(counter.second.type);
+      counters[counter.first] = counterInfo;
+    }
+    dynamic perfCounters = dynamic::object;
+    for (auto& [name, member] : kPerfCounterNames) {
+      if (!std::isnan(datum.perfCounters.*member)) {
+        perfCounters[name] = datum.perfCounters.*member;
       }
-      out.push_back(
-          dynamic::array(datum.file, datum.name, datum.timeInNs, obj));
-    } else {
-      out.push_back(dynamic::array(datum.file, datum.name, datum.timeInNs));
     }
+    dynamic latency = dynamic::object;
+    if (datum.latency.samples > 0) {
+      latency["samples"] = int64_t(datum.latency.samples);
+      for (auto& [name, member] : kLatencyNames) {
+        latency[name] = datum.latency.*member;
+      }
+    }
+
+    dynamic res = dynamic::array(datum.file, datum.name, datum.timeInNs);
+    dynamic extras = dynamic::array(
+        std::move(counters), std::move(perfCounters), std::move(latency));
+    while (!extras.empty() && extras[extras.size() - 1].empty()) {
+      extras.erase(extras.end() - 1);
+    }
+    for (auto& extra : extras) {
+      res.push_back(std::move(extra));
+    }
+    out.push_back(std::move(res));
   }
 }
 
 void benchmarkResultsFromDynamic(
     const dynamic& d, vector<detail::BenchmarkResult>& results) {
   for (auto& datum : d) {
+    detail::PerfCounterValues perfCounters;
+    if (datum.size() > 4) {
+      for (auto& [name, member] : kPerfCounterNames) {
+        if (auto value = datum[4].get_ptr(name)) {
+          perfCounters.*member = value->asDouble();
+        }
+      }
+    }
+    detail::LatencyDistribution latency;
+    if (datum.size() > 5 && !datum[5].empty()) {
+      latency.samples = size_t(datum[5]["samples"].asInt());
+      for (auto& [name, member] : kLatencyNames) {
+        latency.*member = datum[5][name].asDouble();
+      }
+    }
     results.push_back(
         {datum[0].asString(),
          datum[1].asString(),
          datum[2].asDouble(),
-         UserCounters{}});
+         UserCounters{},
+         perfCounters,
+         latency});
   }
 }
 
@@ -608,26 +937,53 @@ static pair<StringPiece, StringPiece> resultKey(
 void printResultComparison(
     const vector<detail::BenchmarkResult>& base,
     const vector<detail::BenchmarkResult>& test) {
-  map<pair<StringPiece, StringPiece>, double> baselines;
+  map<pair<StringPiece, StringPiece>, const detail::BenchmarkResult*>
+      baselines;
 
   for (auto& baseResult : base) {
-    baselines[resultKey(baseResult)] = baseResult.timeInNs;
+    baselines[resultKey(baseResult)] = &baseResult;
   }
 
+  const bool latencyColumns =
+      std::any_of(test.begin(), test.end(), [](const auto& result) {
+        return result.latency.samples > 0;
+      });
+  const bool perfColumns =
+      std::any_of(test.begin(), test.end(), [](const auto& result) {
+        return result.perfCounters.any();
+      });
+
   // Width available
   const size_t columns = FLAGS_bm_result_width_chars;
+  const size_t totalColumns = columns +
+      (latencyColumns ? latencyComparisonColumnsLength() : 0) +
+      (perfColumns ? perfColumnsLength(kPerfDeltaWidth) : 0);
 
   auto header = [&](const string_view& file) {
-    printSeparator('=', columns);
+    printSeparator('=', totalColumns);
     printDefaultHeaderContents(file, columns);
+    if (latencyColumns) {
+      for (auto& column : kLatencyComparisonColumns) {
+        printf("  %*s", kLatencyColumnWidth, column.name);
+      }
+      printf(
+          "  %.*s",
+          static_cast<int>(kLatencyChangeHeader.size()),
+          kLatencyChangeHeader.data());
+    }
+    if (perfColumns) {
+      for (auto& column : kPerfColumns) {
+        printf("  %*s", column.width + kPerfDeltaWidth, column.name);
+      }
+    }
     printf("\n");
-    printSeparator('=', columns);
+    printSeparator('=', totalColumns);
   };
 
   string lastFile;
 
   for (auto& datum : test) {
-    folly::Optional<double> baseline =
+    folly::Optional<const detail::BenchmarkResult*> baseline =
         folly::get_optional(baselines, resultKey(datum));
     auto file = datum.file;
     if (file != lastFile) {
@@ -638,7 +994,7 @@ void printResultComparison(
 
     string s = datum.name;
     if (s == "-") {
-      printSeparator('-', columns);
+      printSeparator('-', totalColumns);
       continue;
     }
     if (s[0] == '%') {
@@ -653,24 +1009,52 @@ void printResultComparison(
     if (!baseline) {
       // Print without baseline
       printf(
-          "%*s           %9s  %7s\n",
+          "%*s           %9s  %7s",
           static_cast<int>(s.size()),
           s.c_str(),
           readableTime(secPerIter, 2).c_str(),
           metricReadable(itersPerSec, 2).c_str());
     } else {
       // Print with baseline
-      auto rel = *baseline / nsPerIter * 100.0;
+      auto rel = (*baseline)->timeInNs / nsPerIter * 100.0;
       printf(
-          "%*s %7.2f%%  %9s  %7s\n",
+          "%*s %7.2f%%  %9s  %7s",
           static_cast<int>(s.size()),
           s.c_str(),
           rel,
           readableTime(secPerIter, 2).c_str(),
           metricReadable(itersPerSec, 2).c_str());
     }
+    if (latencyColumns) {
+      for (auto& column : kLatencyComparisonColumns) {
+        printf(
+            "  %*s",
+            kLatencyColumnWidth,
+            readableTime(datum.latency.*column.value / 1E9, 2).c_str());
+      }
+      printf(
+          "  %*s",
+          static_cast<int>(kLatencyChangeHeader.size()),
+          baseline ? latencyChange((*baseline)->latency, datum.latency).c_str()
+                   : "");
+    }
+    if (perfColumns) {
+      for (auto& column : kPerfColumns) {
+        auto value = column.value(datum.perfCounters);
+        auto cell = perfReadable(value);
+        if (baseline) {
+          auto baseValue = column.value((*baseline)->perfCounters);
+          if (std::isfinite(value) && std::isfinite(baseValue) &&
+              baseValue != 0) {
+            cell += stringPrintf(" (%+.1f%%)", (value / baseValue - 1) * 100);
+          }
+        }
+        printf("  %*s", column.width + kPerfDeltaWidth, cell.c_str());
+      }
+    }
+    printf("\n");
   }
-  printSeparator('=', columns);
+  printSeparator('=', totalColumns);
 }
 
 void checkRunMode() {
@@ -792,6 +1176,51 @@ class ShouldDrawLineTracker {
   std::size_t drawAfterI_ = 0;
 };
 
+// The counters of --bm_perf_counters, while the benchmarks run, and how
+// many BenchmarkSuspenders of the benchmarking thread are active.
+detail::PerfCounters* activePerfCounters = nullptr;
+std::thread::id perfCountersThread;
+size_t numPerfCountersSuspensions = 0;
+// Set by runBenchmarkThreads(), whose benchmarking thread only waits for the
+// threads that run the body.
+bool ranBenchmarkThreads = false;
+
+void suspendPerfCounters(bool suspended) {
+  // Suspenders of other threads don't stop the counters of this one.
+  if (std::this_thread::get_id() != perfCountersThread) {
+    return;
+  }
+  if (suspended) {
+    if (numPerfCountersSuspensions++ == 0) {
+      activePerfCounters->pause();
+    }
+  } else if (numPerfCountersSuspensions > 0) {
+    if (--numPerfCountersSuspensions == 0) {
+      activePerfCounters->resume();
+    }
+  }
+}
+
+// Counts the hardware events of each run of fun, in the thread that runs
+// it and only while it isn't suspended.  The counts of BENCHMARK_THREADS
+// benchmarks are left NaN, since they would only show that thread waiting.
+BenchmarkFun withPerfCounters(const BenchmarkFun& fun) {
+  if (!activePerfCounters) {
+    return fun;
+  }
+  return [fun](unsigned int n) {
+    numPerfCountersSuspensions = 0;
+    ranBenchmarkThreads = false;
+    activePerfCounters->start();
+    auto res = fun(n);
+    auto counts = activePerfCounters->stop();
+    if (res.niter > 0 && !ranBenchmarkThreads) {
+      res.perfCounters = counts / res.niter;
+    }
+    return res;
+  };
+}
+
 std::pair<std::set<std::string>, std::vector<detail::BenchmarkResult>>
 runBenchmarksWithPrinterImpl(
     BenchmarkResultsPrinter* FOLLY_NULLABLE printer,
@@ -799,46 +1228,80 @@ runBenchmarksWithPrinterImpl(
   vector<detail::BenchmarkResult> results;
   results.reserve(toRun.benchmarks.size());
 
+  // The baselines are measured with the counters too, so that the overhead
+  // of pausing them is part of the suspender overhead.
+  folly::Optional<detail::PerfCounters> perfCounters;
+  if (perfCountersEnabled()) {
+    perfCounters.emplace();
+    activePerfCounters = &*perfCounters;
+    perfCountersThread = std::this_thread::get_id();
+    BenchmarkSuspender::perfCountersHook = suspendPerfCounters;
+  }
+  SCOPE_EXIT {
+    BenchmarkSuspender::perfCountersHook = nullptr;
+    activePerfCounters = nullptr;
+  };
+
   // PLEASE KEEP QUIET. MEASUREMENTS IN PROGRESS.
 
-  auto const globalBaseline =
-      runBenchmarkGetNSPerIteration(toRun.baseline->func, 0);
+  auto const globalBaseline = runBenchmarkGetNSPerIteration(
+      withPerfCounters(toRun.baseline->func), 0);
 
-  auto const globalSuspenderBaseline =
-      runBenchmarkGetNSPerIteration(toRun.suspenderBaseline->func, 0);
+  auto const globalSuspenderBaseline = runBenchmarkGetNSPerIteration(
+      withPerfCounters(toRun.suspenderBaseline->func), 0);
 
   BenchmarkSuspender::suspenderOverhead =
       chrono::nanoseconds(static_cast<chrono::high_resolution_clock::rep>(
-          globalSuspenderBaseline.first));
+          globalSuspenderBaseline.nsPerIter));
+
+  // The cost of timing each call, which the global baseline doesn't have.
+  double latencyOverhead = 0;
+  if (latencyModeEnabled()) {
+    latencyOverhead =
+        runBenchmarkGetLatencies(withPerfCounters(toRun.baseline->func), 0)
+            .latency.p50;
+  }
 
   std::set<std::string> counterNames;
   ShouldDrawLineTracker shouldDrawLineTracker(toRun);
   for (std::size_t i = 0; i != toRun.benchmarks.size(); ++i) {
-    std::pair<double, UserCounters> elapsed;
+    TrialResult elapsed;
     const detail::BenchmarkRegistration& bm = *toRun.benchmarks[i];
     bool shoudDrawLineAfter = shouldDrawLineTracker();
+    auto func = withPerfCounters(bm.func);
 
     if (FLAGS_bm_profile) {
-      elapsed = runProfilingGetNSPerIteration(bm.func, globalBaseline.first);
+      elapsed = runProfilingGetNSPerIteration(func, globalBaseline.nsPerIter);
+    } else if (FLAGS_bm_latency) {
+      elapsed = runBenchmarkGetLatencies(func, latencyOverhead);
     } else {
       elapsed = FLAGS_bm_estimate_time
-          ? runBenchmarkGetNSPerIterationEstimate(bm.func, globalBaseline.first)
-          : runBenchmarkGetNSPerIteration(bm.func, globalBaseline.first);
+          ? runBenchmarkGetNSPerIterationEstimate(
+                func, globalBaseline.nsPerIter)
+          : runBenchmarkGetNSPerIteration(func, globalBaseline.nsPerIter);
     }
 
+    detail::BenchmarkResult result{
+        bm.file,
+        bm.name,
+        elapsed.nsPerIter,
+        elapsed.counters,
+        elapsed.perfCounters,
+        elapsed.latency};
+
     // if customized user counters is used, it cannot print the result in real
     // time as it needs to run all cases first to know the complete set of
     // counters have been used, then the header can be printed out properly
     if (printer != nullptr) {
-      printer->print({{bm.file, bm.name, elapsed.first, elapsed.second}});
+      printer->print({result});
       if (shoudDrawLineAfter) {
         printer->separator('-');
       }
     }
-    results.push_back({bm.file, bm.name, elapsed.first, elapsed.second});
+    results.push_back(std::move(result));
 
     // get all counter names
-    for (auto const& kv : elapsed.second) {
+    for (auto const& kv : elapsed.counters) {
       counterNames.insert(kv.first);
     }
   }
@@ -877,16 +1340,190 @@ std::ostream& operator<<(std::ostream& os, const BenchmarkResult& x) {
   return os << r[0];
 }
 
+LatencyDistribution LatencyDistribution::fromSamples(
+    std::vector<double> samples) {
+  LatencyDistribution res;
+  res.samples = samples.size();
+  if (samples.empty()) {
+    return res;
+  }
+  std::sort(samples.begin(), samples.end());
+
+  // The sample of the given 1-based rank, rounded up and clamped.
+  const double n = double(samples.size());
+  auto at = [&](double rank) {
+    return samples[size_t(std::clamp(std::ceil(rank), 1.0, n)) - 1];
+  };
+  res.p50 = at(0.5 * n);
+  res.p90 = at(0.9 * n);
+  res.p99 = at(0.99 * n);
+  res.p999 = at(0.999 * n);
+  res.max = samples.back();
+
+  // The number of samples below the median follows a binomial distribution,
+  // which is close to normal: these ranks bound the median with 95%
+  // confidence.
+  const double margin = 1.96 * std::sqrt(n) / 2;
+  res.p50Low = at(n / 2 - margin);
+  res.p50High = at(n / 2 + margin + 1);
+  return res;
+}
+
 bool operator==(const BenchmarkResult& x, const BenchmarkResult& y) {
   auto xtime = static_cast<std::uint64_t>(x.timeInNs * 1000);
   auto ytime = static_cast<std::uint64_t>(y.timeInNs * 1000);
   return x.name == y.name && x.file == y.file && xtime == ytime &&
-      x.counters == y.counters;
+      x.counters == y.counters && x.perfCounters == y.perfCounters &&
+      x.latency == y.latency;
+}
+
+namespace {
+
+// The CPUs this process may run on, or none if that can't be determined.
+std::vector<int> allowedCpus() {
+  std::vector<int> cpus;
+#if defined(__linux__) && !defined(__ANDROID__)
+  cpu_set_t cpuset;
+  if (sched_getaffinity(0, sizeof(cpuset), &cpuset) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &cpuset)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+#endif
+  return cpus;
+}
+
+void pinCurrentThread([[maybe_unused]] int cpu) {
+#if defined(__linux__) && !defined(__ANDROID__)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  CPU_SET(cpu, &cpuset);
+  pthread_setaffinity_np(pthread_self(), sizeof(cpuset), &cpuset);
+#endif
+}
+
+} // namespace
+
+std::vector<size_t> benchmarkThreadCounts(size_t maxThreads) {
+  if (maxThreads == 0) {
+    maxThreads = std::max(1u, hardware_concurrency());
+  }
+  std::vector<size_t> counts;
+  for (size_t n = 1; n < maxThreads; n *= 2) {
+    counts.push_back(n);
+  }
+  counts.push_back(maxThreads);
+  return counts;
+}
+
+std::vector<std::chrono::nanoseconds> runBenchmarkThreads(
+    size_t numThreads,
+    unsigned int iters,
+    const std::function<void(unsigned int, const BenchmarkThread&)>& body,
+    const std::function<void()>& onStart,
+    const std::function<void()>& onFinish) {
+  ranBenchmarkThreads = true;
+  const auto cpus = FLAGS_bm_pin_threads ? allowedCpus() : std::vector<int>{};
+  std::vector<std::chrono::nanoseconds> threadTimes(numThreads);
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> go{false};
+  size_t remaining = numThreads;
+  std::mutex mutex;
+  std::condition_variable done;
+
+  std::vector<std::thread> threads;
+  threads.reserve(numThreads);
+  for (size_t i = 0; i < numThreads; ++i) {
+    unsigned int threadIters =
+        unsigned(iters / numThreads + (i < iters % numThreads ? 1 : 0));
+    threads.emplace_back([&, i, threadIters] {
+      if (!cpus.empty()) {
+        pinCurrentThread(cpus[i % cpus.size()]);
+      }
+      ready.fetch_add(1, std::memory_order_release);
+      while (!go.load(std::memory_order_acquire)) {
+        std::this_thread::yield();
+      }
+      auto start = std::chrono::high_resolution_clock::now();
+      body(threadIters, BenchmarkThread{i, numThreads});
+      threadTimes[i] = std::chrono::high_resolution_clock::now() - start;
+      std::lock_guard lock(mutex);
+      if (--remaining == 0) {
+        // Stop the clock here rather than in the main thread, which may
+        // take a while to wake up.
+        onFinish();
+        done.notify_one();
+      }
+    });
+  }
+
+  while (ready.load(std::memory_order_acquire) < numThreads) {
+    std::this_thread::yield();
+  }
+  onStart();
+  go.store(true, std::memory_order_release);
+  {
+    std::unique_lock lock(mutex);
+    done.wait(lock, [&] { return remaining == 0; });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return threadTimes;
+}
+
+void setBenchmarkThreadsCounters(
+    UserCounters& counters,
+    BenchmarkThreadsGroup& group,
+    unsigned int iters,
+    std::chrono::nanoseconds elapsed,
+    const std::vector<std::chrono::nanoseconds>& threadTimes) {
+  const size_t numThreads = threadTimes.size();
+  counters["threads"] = int64_t(numThreads);
+
+  double opsPerSec = 0;
+  size_t busyThreads = 0;
+  for (size_t i = 0; i < numThreads; ++i) {
+    auto threadIters = iters / numThreads + (i < iters % numThreads ? 1 : 0);
+    if (threadIters > 0 && threadTimes[i].count() > 0) {
+      opsPerSec += threadIters * 1e9 / threadTimes[i].count();
+      ++busyThreads;
+    }
+  }
+  if (busyThreads > 0) {
+    counters["ops/s/thread"] = UserMetric(
+        int64_t(opsPerSec / busyThreads), UserMetric::Type::METRIC);
+  }
+
+  if (iters == 0 || elapsed.count() <= 0) {
+    return;
+  }
+  const double nsPerIter = double(elapsed.count()) / iters;
+  if (numThreads == 1) {
+    // Like runBenchmarkGetNSPerIteration(), only trust long enough runs,
+    // and keep the best one.
+    const auto minNanoseconds = std::max<std::chrono::nanoseconds>(
+        std::chrono::nanoseconds(100000),
+        std::chrono::microseconds(FLAGS_bm_min_usec));
+    if (elapsed >= minNanoseconds &&
+        (group.singleThreadNsPerIter == 0 ||
+         nsPerIter < group.singleThreadNsPerIter)) {
+      group.singleThreadNsPerIter = nsPerIter;
+    }
+  }
+  if (group.singleThreadNsPerIter > 0) {
+    counters["efficiency%"] = int64_t(std::lround(
+        100 * group.singleThreadNsPerIter / (numThreads * nsPerIter)));
+  }
 }
 
 std::chrono::high_resolution_clock::duration BenchmarkSuspenderBase::timeSpent;
 std::chrono::high_resolution_clock::duration
     BenchmarkSuspenderBase::suspenderOverhead;
+void (*BenchmarkSuspenderBase::perfCountersHook)(bool) = nullptr;
 
 void BenchmarkingStateBase::addBenchmarkImpl(
     const char* file, StringPiece name, BenchmarkFun fun, bool useCounter) {
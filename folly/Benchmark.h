@@ -22,6 +22,7 @@
 #include <folly/Range.h>
 #include <folly/ScopeGuard.h>
 #include <folly/Traits.h>
+#include <folly/detail/PerfCounters.h>
 #include <folly/functional/Invoke.h>
 #include <folly/lang/Hint.h>
 #include <folly/portability/GFlags.h>
@@ -31,10 +32,13 @@
 #include <functional>
 #include <iosfwd>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <set>
+#include <string>
 #include <type_traits>
 #include <unordered_map>
+#include <vector>
 
 #include <boost/function_types/function_arity.hpp>
 #include <glog/logging.h>
@@ -81,11 +85,22 @@ class UserMetric {
 
 using UserCounters = std::unordered_map<std::string, UserMetric>;
 
+/**
+ * Identifies the calling thread in the body of a BENCHMARK_THREADS benchmark.
+ */
+struct BenchmarkThread {
+  // In [0, numThreads).
+  size_t index;
+  size_t numThreads;
+};
+
 namespace detail {
 struct TimeIterData {
   std::chrono::high_resolution_clock::duration duration;
   unsigned int niter;
   UserCounters userCounters;
+  // Per iteration, when --bm_perf_counters is set.
+  PerfCounterValues perfCounters;
 };
 
 using BenchmarkFun = std::function<TimeIterData(unsigned int)>;
@@ -97,11 +112,43 @@ struct BenchmarkRegistration {
   bool useCounter = false;
 };
 
+/**
+ * The distribution of the time per iteration of the calls of a benchmark,
+ * with --bm_latency.  All times are in nanoseconds.
+ */
+struct LatencyDistribution {
+  size_t samples = 0;
+  double p50 = 0;
+  double p90 = 0;
+  double p99 = 0;
+  double p999 = 0;
+  double max = 0;
+  // The 95% confidence interval of p50.
+  double p50Low = 0;
+  double p50High = 0;
+
+  // From unsorted samples.
+  static LatencyDistribution fromSamples(std::vector<double> samples);
+
+  friend bool operator==(
+      const LatencyDistribution& x, const LatencyDistribution& y) {
+    return x.samples == y.samples && x.p50 == y.p50 && x.p90 == y.p90 &&
+        x.p99 == y.p99 && x.p999 == y.p999 && x.max == y.max &&
+        x.p50Low == y.p50Low && x.p50High == y.p50High;
+  }
+  friend bool operator!=(
+      const LatencyDistribution& x, const LatencyDistribution& y) {
+    return !(x == y);
+  }
+};
+
 struct BenchmarkResult {
   std::string file;
   std::string name;
   double timeInNs;
   UserCounters counters;
+  PerfCounterValues perfCounters;
+  LatencyDistribution latency;
 
   friend std::ostream& operator<<(std::ostream&, const BenchmarkResult&);
 
@@ -117,6 +164,19 @@ struct BenchmarkSuspenderBase {
    */
   static std::chrono::high_resolution_clock::duration timeSpent;
   static std::chrono::high_resolution_clock::duration suspenderOverhead;
+
+  /**
+   * Called with true when a suspension starts and false when it ends, to
+   * stop the hardware performance counters of --bm_perf_counters meanwhile.
+   */
+  static void (*perfCountersHook)(bool suspended);
+
+ protected:
+  static void notifyPerfCounters(bool suspended) {
+    if (perfCountersHook) {
+      perfCountersHook(suspended);
+    }
+  }
 };
 
 template <typename Clock>
@@ -127,7 +187,10 @@ struct BenchmarkSuspender : BenchmarkSuspenderBase {
   struct DismissedTag {};
   static inline constexpr DismissedTag Dismissed{};
 
-  BenchmarkSuspender() : start(Clock::now()) {}
+  BenchmarkSuspender() {
+    notifyPerfCounters(true);
+    start = Clock::now();
+  }
 
   explicit BenchmarkSuspender(DismissedTag) : start(TimePoint{}) {}
 
@@ -161,6 +224,7 @@ struct BenchmarkSuspender : BenchmarkSuspenderBase {
 
   void rehire() {
     assert(start == TimePoint{});
+    notifyPerfCounters(true);
     start = Clock::now();
   }
 
@@ -184,11 +248,50 @@ struct BenchmarkSuspender : BenchmarkSuspenderBase {
     auto end = Clock::now();
     timeSpent += (end - start) + suspenderOverhead;
     start = end;
+    notifyPerfCounters(false);
   }
 
   TimePoint start;
 };
 
+/**
+ * Shared by the benchmarks that BENCHMARK_THREADS registers for one body.
+ */
+struct BenchmarkThreadsGroup {
+  // The best time per iteration measured on a single thread, or 0.
+  double singleThreadNsPerIter = 0;
+};
+
+/**
+ * The thread counts to run a BENCHMARK_THREADS benchmark with: the powers of
+ * two below maxThreads, then maxThreads.  0 means hardware_concurrency().
+ */
+std::vector<size_t> benchmarkThreadCounts(size_t maxThreads);
+
+/**
+ * Starts numThreads threads and splits iters between them.  Once all threads
+ * are ready, calls onStart() and releases them at once to run body.  The last
+ * thread to finish calls onFinish() before the threads are joined.  Returns
+ * how long each thread spent in body.
+ */
+std::vector<std::chrono::nanoseconds> runBenchmarkThreads(
+    size_t numThreads,
+    unsigned int iters,
+    const std::function<void(unsigned int, const BenchmarkThread&)>& body,
+    const std::function<void()>& onStart,
+    const std::function<void()>& onFinish);
+
+/**
+ * Sets the counters reported by BENCHMARK_THREADS benchmarks from one run of
+ * runBenchmarkThreads(), which took elapsed from onStart() to onFinish().
+ */
+void setBenchmarkThreadsCounters(
+    UserCounters& counters,
+    BenchmarkThreadsGroup& group,
+    unsigned int iters,
+    std::chrono::nanoseconds elapsed,
+    const std::vector<std::chrono::nanoseconds>& threadTimes);
+
 class PerfScoped;
 
 class BenchmarkingStateBase {
@@ -241,7 +344,8 @@ class BenchmarkingState : public BenchmarkingStateBase {
       return detail::TimeIterData{
           (end - start) - BenchmarkSuspender<Clock>::timeSpent,
           niter,
-          UserCounters{}};
+          UserCounters{},
+          PerfCounterValues{}};
     };
 
     this->addBenchmarkImpl(file, name, detail::BenchmarkFun(execute), false);
@@ -268,15 +372,16 @@ class BenchmarkingState : public BenchmarkingStateBase {
       unsigned int niter;
 
       // CORE MEASUREMENT STARTS
-      auto start = std::chrono::high_resolution_clock::now();
+      auto start = Clock::now();
       UserCounters counters;
       niter = lambda(counters, times);
-      auto end = std::chrono::high_resolution_clock::now();
+      auto end = Clock::now();
       // CORE MEASUREMENT ENDS
       return detail::TimeIterData{
           (end - start) - BenchmarkSuspender<Clock>::timeSpent,
           niter,
-          counters};
+          counters,
+          PerfCounterValues{}};
     };
 
     this->addBenchmarkImpl(
@@ -297,6 +402,49 @@ class BenchmarkingState : public BenchmarkingStateBase {
       return niter;
     });
   }
+
+  template <typename Lambda>
+  void addBenchmarkThreads(
+      const char* file, StringPiece name, size_t maxThreads, Lambda&& lambda) {
+    auto group = std::make_shared<BenchmarkThreadsGroup>();
+    std::function<void(unsigned int, const BenchmarkThread&)> body(
+        std::forward<Lambda>(lambda));
+    for (auto numThreads : benchmarkThreadCounts(maxThreads)) {
+      // The single-threaded run is the baseline of the others.
+      auto label = (numThreads == 1 ? "" : "%") + name.str() + "(" +
+          std::to_string(numThreads) +
+          (numThreads == 1 ? "thread)" : "threads)");
+      addBenchmark(
+          file,
+          label,
+          [=](UserCounters& counters, unsigned int times) -> unsigned {
+            BenchmarkSuspender<Clock> suspender;
+            typename BenchmarkSuspender<Clock>::TimePoint start;
+            typename BenchmarkSuspender<Clock>::TimePoint end;
+            auto threadTimes = runBenchmarkThreads(
+                numThreads,
+                times,
+                body,
+                [&] {
+                  suspender.dismiss();
+                  start = Clock::now();
+                },
+                // Called on the last thread to finish.
+                [&] {
+                  end = Clock::now();
+                  suspender.rehire();
+                });
+            setBenchmarkThreadsCounters(
+                counters,
+                *group,
+                times,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    end - start),
+                threadTimes);
+            return times;
+          });
+    }
+  }
 };
 
 BenchmarkingState<std::chrono::high_resolution_clock>& globalBenchmarkState();
@@ -344,6 +492,18 @@ void addBenchmark(const char* file, StringPiece name, Lambda&& lambda) {
   detail::globalBenchmarkState().addBenchmark(file, name, lambda);
 }
 
+/**
+ * Adds a benchmark that runs a lambda taking (unsigned iters,
+ * const BenchmarkThread&) on several threads at once.  Usually not called
+ * directly but instead through the macro BENCHMARK_THREADS defined below.
+ */
+template <typename Lambda>
+void addBenchmarkThreads(
+    const char* file, StringPiece name, size_t maxThreads, Lambda&& lambda) {
+  detail::globalBenchmarkState().addBenchmarkThreads(
+      file, name, maxThreads, std::forward<Lambda>(lambda));
+}
+
 struct dynamic;
 
 void benchmarkResultsToDynamic(
@@ -647,6 +807,44 @@ void printResultComparison(
     return name(iters, ##__VA_ARGS__);                                     \
   }
 
+/**
+ * Introduces a benchmark that measures how a body scales with the number of
+ * threads running it.  The body is registered as one benchmark per thread
+ * count: 1, 2, 4, ... up to maxThreads, where 0 means the number of CPUs.
+ * Each run starts the threads, waits until all of them are ready, and then
+ * releases them at once; the time until the last thread is done is measured.
+ * The iterations are split evenly between the threads, so time/iter and
+ * iters/s are the aggregate cost and throughput.  The thread passed to the
+ * body identifies the calling thread, for example to select its share of some
+ * input.
+ *
+ * The multi-threaded benchmarks are reported relative to the single-threaded
+ * one, along with these counters:
+ *  * threads: the number of threads.
+ *  * ops/s/thread: the throughput of the threads, averaged.
+ *  * efficiency%: the aggregate throughput relative to that of the same
+ *    number of independent single-threaded runs; 100 means perfect scaling.
+ *
+ * Pass --bm_pin_threads to pin the threads to distinct CPUs (on Linux).
+ * BENCHMARK_SUSPEND may not be used in the body.  Example:
+ *
+ * std::atomic<uint64_t> counter;
+ *
+ * BENCHMARK_THREADS(atomicIncrement, 16, iters, thread) {
+ *   for (unsigned int i = 0; i < iters; ++i) {
+ *     counter.fetch_add(1);
+ *   }
+ * }
+ */
+#define BENCHMARK_THREADS(name, maxThreads, iters, thread)                   \
+  static void name(unsigned, const ::folly::BenchmarkThread&);               \
+  [[maybe_unused]] static bool FB_ANONYMOUS_VARIABLE(follyBenchmarkUnused) = \
+      (::folly::addBenchmarkThreads(                                         \
+           __FILE__, FOLLY_PP_STRINGIZE(name), maxThreads, &name),           \
+       true);                                                                \
+  static void name(                                                          \
+      unsigned iters, [[maybe_unused]] const ::folly::BenchmarkThread& thread)
+
 /**
  * Draws a line of dashes.
  */
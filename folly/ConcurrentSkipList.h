@@ -92,9 +92,23 @@ Sample usage:
        for (auto &elem : accessor) {
          // use elem to access data
        }
+       // Range scan over [10, 20]
+       for (auto it = accessor.lower_bound(10),
+                 end = accessor.upper_bound(20);
+            it != end;
+            ++it) {
+         ...
+       }
        ... ...
      }
 
+ Sorted batches should be loaded with insertSorted(), which resumes the
+ search for each key from the position of the previous one instead of
+ starting from the head:
+
+     std::vector<int> sortedKeys = ...;
+     accessor.insertSorted(sortedKeys.begin(), sortedKeys.end());
+
  Another useful type is the Skipper accessor.  This is useful if you
  want to skip to locations in the way std::lower_bound() works,
  i.e. it can be used for going through the list by skipping to the
@@ -357,6 +371,109 @@ class ConcurrentSkipList {
     return std::make_pair(newNode, newSize);
   }
 
+  // Inserts the elements of [first, last), which are expected to be sorted
+  // according to Comp.  The predecessors found while inserting one element
+  // are reused as the starting point of the search for the next one (a
+  // finger search), so a run of k adjacent keys costs O(k + log n) node
+  // visits instead of O(k log n).  Concurrent modifications and unsorted
+  // input are still handled correctly; they just fall back to a search
+  // from the head.  Returns the number of elements added.
+  template <typename InputIt>
+  size_t addSortedRange(InputIt first, InputIt last) {
+    NodeType *preds[MAX_HEIGHT], *succs[MAX_HEIGHT];
+    size_t added = 0;
+    int max_layer = -1; // no usable finger yet
+    for (; first != last; ++first) {
+      auto&& data = *first;
+      size_t newSize = 0;
+      while (true) {
+        int layer;
+        if (max_layer < 0 ||
+            !findInsertionPointFromFinger(
+                data, max_layer, preds, succs, &layer)) {
+          layer = findInsertionPointGetMaxLayer(data, preds, succs, &max_layer);
+        }
+
+        if (layer >= 0) {
+          NodeType* nodeFound = succs[layer];
+          DCHECK(nodeFound != nullptr);
+          if (nodeFound->markedForRemoval()) {
+            max_layer = -1;
+            continue; // if it's getting deleted retry finding node.
+          }
+          // wait until fully linked.
+          while (FOLLY_UNLIKELY(!nodeFound->fullyLinked())) {
+          }
+          break;
+        }
+
+        int nodeHeight =
+            detail::SkipListRandomHeight::instance()->getHeight(max_layer + 1);
+
+        ScopedLocker guards[MAX_HEIGHT];
+        if (!lockNodesForChange(nodeHeight, guards, preds, succs)) {
+          max_layer = -1;
+          continue; // give up the locks and retry from the head
+        }
+
+        NodeType* newNode = NodeType::create(
+            recycler_.alloc(), nodeHeight, std::forward<decltype(data)>(data));
+        for (int k = 0; k < nodeHeight; ++k) {
+          newNode->setSkip(k, succs[k]);
+          preds[k]->setSkip(k, newNode);
+          // the next (larger) key goes after the new node on these layers
+          preds[k] = newNode;
+        }
+
+        newNode->setFullyLinked();
+        newSize = incrementSize(1);
+        ++added;
+        break;
+      }
+
+      if (newSize > 0) {
+        int hgt = height();
+        size_t sizeLimit =
+            detail::SkipListRandomHeight::instance()->getSizeLimit(hgt);
+        if (hgt < MAX_HEIGHT && newSize > sizeLimit) {
+          growHeight(hgt + 1);
+          max_layer = -1; // the finger refers to the old head
+        }
+      }
+    }
+    return added;
+  }
+
+  // Resumes the search for data from the predecessors left in preds[] by a
+  // previous search for a smaller key.  Returns false if the finger can't
+  // be used (a predecessor is being removed, or data doesn't sort after
+  // it), in which case the caller has to search from the head.
+  static bool findInsertionPointFromFinger(
+      const value_type& data,
+      int max_layer,
+      NodeType* preds[],
+      NodeType* succs[],
+      int* foundLayer) {
+    NodeType* pred = preds[0];
+    if (!pred->isHeadNode() && !Comp()(pred->data(), data)) {
+      return false;
+    }
+    // Start from the highest layer whose successor still sorts before data;
+    // all layers above it already bracket data.
+    int lyr = 0;
+    for (int layer = max_layer; layer >= 0; --layer) {
+      if (preds[layer]->markedForRemoval()) {
+        return false;
+      }
+      succs[layer] = preds[layer]->skip(layer);
+      if (lyr == 0 && greater(data, succs[layer])) {
+        lyr = layer;
+      }
+    }
+    *foundLayer = findInsertionPoint(preds[lyr], lyr, data, preds, succs);
+    return true;
+  }
+
   bool remove(const value_type& data) {
     NodeType* nodeToDelete = nullptr;
     ScopedLocker nodeGuard;
@@ -501,6 +618,14 @@ class ConcurrentSkipList {
     return node;
   }
 
+  NodeType* upper_bound(const value_type& data) const {
+    auto node = lower_bound(data);
+    if (node != nullptr && !Comp()(data, node->data())) {
+      node = node->next();
+    }
+    return node;
+  }
+
   void growHeight(int height) {
     NodeType* oldHead = head_.load(std::memory_order_acquire);
     if (oldHead->height() >= height) { // someone else already did this
@@ -618,6 +743,19 @@ class ConcurrentSkipList<T, Comp, NodeAlloc, MAX_HEIGHT>::Accessor {
   iterator lower_bound(const key_type& data) const {
     return iterator(sl_->lower_bound(data));
   }
+  iterator upper_bound(const key_type& data) const {
+    return iterator(sl_->upper_bound(data));
+  }
+
+  // Inserts the elements of [first, last), which should be sorted according
+  // to Comp, and returns the number of elements added (elements whose keys
+  // are already present are skipped).  Much faster than calling insert() in
+  // a loop for sorted batches; unsorted input is still inserted correctly,
+  // just without the speedup.
+  template <typename InputIt>
+  size_t insertSorted(InputIt first, InputIt last) {
+    return sl_->addSortedRange(first, last);
+  }
 
   size_t height() const { return sl_->height(); }
 
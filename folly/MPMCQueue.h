@@ -69,6 +69,13 @@ class MPMCQueueBase;
 /// when the MPMCQueue's capacity is smaller than the number of enqueuers
 /// or dequeuers).
 ///
+/// The batch operations (blockingWriteBatch, tryWriteBatch,
+/// blockingReadBatch, tryReadBatch) obtain a contiguous range of tickets
+/// with a single atomic operation on the shared dispenser and then
+/// process each ticket's single-element queue as usual, so a batch of k
+/// elements pays for one contended RMW instead of k.  Elements of a batch
+/// occupy consecutive queue positions.
+///
 /// In benchmarks (contained in tao/queues/ConcurrentQueueTests)
 /// it handles 1 to 1, 1 to N, N to 1, and N to M thread counts better
 /// than any of the alternatives present in fbcode, for both small (~10)
@@ -1029,6 +1036,73 @@ class MPMCQueueBase<Derived<T, Atom, Dynamic, Allocator>> {
     }
   }
 
+  /// Enqueues n elements constructed from *first, *std::next(first), ...,
+  /// blocking until space is available for each of them.  All n push
+  /// tickets are obtained with a single fetch_add on the shared push
+  /// ticket, so the elements occupy consecutive positions in the queue.
+  /// Use std::make_move_iterator to enqueue by move.
+  ///
+  /// Batch operations are not supported by the dynamic version.
+  template <typename InputIt>
+  void blockingWriteBatch(InputIt first, size_t n) noexcept {
+    static_assert(!Dynamic, "Batch operations require a fixed-size MPMCQueue");
+    if (n == 0) {
+      return;
+    }
+    auto ticket = pushTicket_.fetch_add(n);
+    for (size_t i = 0; i < n; ++i, ++first) {
+      enqueueWithTicketBase(ticket + i, slots_, capacity_, stride_, *first);
+    }
+  }
+
+  /// Enqueues as many of the n elements starting at first as currently
+  /// fit in the queue, and returns the number enqueued.  The push tickets
+  /// for the whole batch are reserved with a single compare-and-swap.
+  ///
+  /// This has the semantics of writeIfNotFull rather than write: it may
+  /// wait for a read that has been assigned a ticket but has not yet
+  /// completed, and a nonzero return guarantees that the same number of
+  /// readIfNotEmpty (or tryReadBatch) calls can succeed.
+  template <typename InputIt>
+  size_t tryWriteBatch(InputIt first, size_t n) noexcept {
+    static_assert(!Dynamic, "Batch operations require a fixed-size MPMCQueue");
+    uint64_t ticket;
+    const size_t count = tryObtainPromisedPushTickets(ticket, n);
+    for (size_t i = 0; i < count; ++i, ++first) {
+      enqueueWithTicketBase(ticket + i, slots_, capacity_, stride_, *first);
+    }
+    return count;
+  }
+
+  /// Moves n dequeued elements onto elems[0], ..., elems[n - 1] in queue
+  /// order, blocking until each of them is available.  All n pop tickets
+  /// are obtained with a single fetch_add on the shared pop ticket.
+  void blockingReadBatch(T* elems, size_t n) noexcept {
+    static_assert(!Dynamic, "Batch operations require a fixed-size MPMCQueue");
+    if (n == 0) {
+      return;
+    }
+    auto ticket = popTicket_.fetch_add(n);
+    for (size_t i = 0; i < n; ++i) {
+      dequeueWithTicketBase(ticket + i, slots_, capacity_, stride_, elems[i]);
+    }
+  }
+
+  /// Dequeues up to n elements onto elems[0], ... in queue order and
+  /// returns the number dequeued, which is zero if the queue is empty.
+  /// The pop tickets for the whole batch are reserved with a single
+  /// compare-and-swap.  Like readIfNotEmpty, this may wait for a write
+  /// that has been assigned a ticket but has not yet completed.
+  size_t tryReadBatch(T* elems, size_t n) noexcept {
+    static_assert(!Dynamic, "Batch operations require a fixed-size MPMCQueue");
+    uint64_t ticket;
+    const size_t count = tryObtainPromisedPopTickets(ticket, n);
+    for (size_t i = 0; i < count; ++i) {
+      dequeueWithTicketBase(ticket + i, slots_, capacity_, stride_, elems[i]);
+    }
+    return count;
+  }
+
  protected:
   enum {
     /// Once every kAdaptationFreq we will spin longer, to try to estimate
@@ -1323,6 +1397,52 @@ class MPMCQueueBase<Derived<T, Atom, Dynamic, Allocator>> {
     }
   }
 
+  /// Batch version of tryObtainPromisedPushTicket.  Reserves the
+  /// consecutive push tickets [ticket, ticket + count) for the largest
+  /// count <= n that can be satisfied once all in-progress pops complete,
+  /// and returns count.  Only used by the non-dynamic version.
+  size_t tryObtainPromisedPushTickets(uint64_t& ticket, size_t n) noexcept {
+    auto numPushes = pushTicket_.load(std::memory_order_acquire); // A
+    while (n > 0) {
+      ticket = numPushes;
+      const auto numPops = popTicket_.load(std::memory_order_acquire); // B
+      // room can exceed capacity_ if pops are pending
+      const int64_t room =
+          static_cast<int64_t>(capacity_) - int64_t(numPushes - numPops);
+      if (room <= 0) {
+        // Full, linearize at B
+        return 0;
+      }
+      const size_t count = std::min(n, static_cast<size_t>(room));
+      if (pushTicket_.compare_exchange_strong(numPushes, numPushes + count)) {
+        return count;
+      }
+    }
+    return 0;
+  }
+
+  /// Batch version of tryObtainPromisedPopTicket.  Reserves the
+  /// consecutive pop tickets [ticket, ticket + count) for the largest
+  /// count <= n whose push tickets have already been handed out, and
+  /// returns count.  Only used by the non-dynamic version.
+  size_t tryObtainPromisedPopTickets(uint64_t& ticket, size_t n) noexcept {
+    auto numPops = popTicket_.load(std::memory_order_acquire); // A
+    while (n > 0) {
+      ticket = numPops;
+      const auto numPushes = pushTicket_.load(std::memory_order_acquire); // B
+      if (numPops >= numPushes) {
+        // Empty, or empty with pending pops.  Linearize at B
+        return 0;
+      }
+      const size_t count =
+          std::min(n, static_cast<size_t>(numPushes - numPops));
+      if (popTicket_.compare_exchange_strong(numPops, numPops + count)) {
+        return count;
+      }
+    }
+    return 0;
+  }
+
   // Given a ticket, constructs an enqueued item using args
   template <typename... Args>
   void enqueueWithTicketBase(
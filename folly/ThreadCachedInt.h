@@ -16,11 +16,15 @@
 
 /**
  * Higher performance (up to 10x) atomic increment using thread caching.
+ *
+ * Floating-point types are supported as well, e.g. for accumulating sums of
+ * latencies; see also folly/stats/ThreadCachedHistogram.h.
  */
 
 #pragma once
 
 #include <atomic>
+#include <type_traits>
 
 #include <folly/Likely.h>
 #include <folly/ThreadLocal.h>
@@ -163,7 +167,16 @@ class ThreadCachedInt {
     }
 
     void flush() const {
-      parent_->target_.fetch_add(val_, std::memory_order_release);
+      if constexpr (std::is_floating_point<IntT>::value) {
+        // std::atomic<floating-point>::fetch_add() requires C++20.
+        IntT val = val_.load(std::memory_order_relaxed);
+        IntT cur = parent_->target_.load(std::memory_order_relaxed);
+        while (!parent_->target_.compare_exchange_weak(
+            cur, cur + val, std::memory_order_release)) {
+        }
+      } else {
+        parent_->target_.fetch_add(val_, std::memory_order_release);
+      }
       val_.store(0, std::memory_order_release);
       numUpdates_ = 0;
     }
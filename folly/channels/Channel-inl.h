@@ -18,7 +18,9 @@
 
 #include <folly/CancellationToken.h>
 #include <folly/Synchronized.h>
+#include <folly/coro/Baton.h>
 #include <folly/coro/Coroutine.h>
+#include <folly/coro/Task.h>
 #include <folly/experimental/channels/detail/ChannelBridge.h>
 
 namespace folly {
@@ -64,8 +66,44 @@ receiverUnbuffer(Receiver<TValue>&& receiver) {
       std::move(receiver.bridge_), std::move(receiver.buffer_));
 }
 
+/**
+ * Waits until the given bounded channel has capacity again, or until its
+ * receiver is cancelled. Completes with OperationCancelled if cancellation is
+ * requested first.
+ */
+template <typename TValue>
+folly::coro::Task<void> senderWaitForCapacity(ChannelBridge<TValue>& bridge) {
+  folly::coro::Baton baton;
+  if (!bridge.senderWaitForCapacity([&baton] { baton.post(); })) {
+    co_return;
+  }
+  bool cancelled = false;
+  {
+    folly::CancellationCallback cancelCallback(
+        co_await folly::coro::co_current_cancellation_token, [&] {
+          // If the receiver already took the callback, it posts the baton.
+          if (bridge.senderCancelWaitForCapacity()) {
+            cancelled = true;
+            baton.post();
+          }
+        });
+    co_await baton;
+  }
+  if (cancelled) {
+    co_yield folly::coro::co_error(folly::OperationCancelled());
+  }
+}
+
 } // namespace detail
 
+template <typename TValue>
+folly::coro::Task<void> Sender<TValue>::co_write(TValue element) {
+  if (bridge_->senderShouldBlock()) {
+    co_await detail::senderWaitForCapacity(*bridge_);
+  }
+  write(std::move(element));
+}
+
 template <typename TValue>
 class Receiver<TValue>::Waiter : public detail::IChannelCallback {
  public:
@@ -17,6 +17,8 @@
 #pragma once
 
 #include <folly/channels/Channel-fwd.h>
+#include <folly/channels/ChannelBound.h>
+#include <folly/coro/Task.h>
 #include <folly/experimental/channels/detail/ChannelBridge.h>
 
 namespace folly {
@@ -33,6 +35,11 @@ namespace channels {
  *   auto [receiver, sender] = Channel<T>::create();
  *   sender.write(val1);
  *   auto val2 = co_await receiver.next();
+ *
+ * A channel may be bounded, so that a fast sender cannot make it grow without
+ * limit. See ChannelBound.h for the available overflow policies:
+ *   auto [receiver, sender] = Channel<T>::create(
+ *       ChannelBound{.capacity = 1024, .policy = OverflowPolicy::DropOldest});
  */
 template <typename TValue>
 class Channel {
@@ -49,6 +56,20 @@ class Channel {
         Receiver<TValue>(std::move(receiverBridge)),
         Sender<TValue>(std::move(senderBridge)));
   }
+
+  /**
+   * Creates a new bounded channel. Writes to a full channel are handled as
+   * described by bound.policy. transform, merge and fanout operators reading
+   * from a bounded channel produce output channels with the same bound.
+   */
+  static std::pair<Receiver<TValue>, Sender<TValue>> create(
+      ChannelBound bound) {
+    auto senderBridge = detail::ChannelBridge<TValue>::create(bound);
+    auto receiverBridge = senderBridge->copy();
+    return std::make_pair(
+        Receiver<TValue>(std::move(receiverBridge)),
+        Sender<TValue>(std::move(senderBridge)));
+  }
 };
 
 /**
@@ -96,6 +117,31 @@ class Sender {
     }
   }
 
+  /**
+   * Writes a value into the pipe. If the channel is bounded with
+   * OverflowPolicy::BlockProducer and full, this first waits until the
+   * receiver takes values from the channel (or is cancelled). If cancellation
+   * is requested while waiting, this completes with OperationCancelled and
+   * the value is not written. Otherwise, this is equivalent to write().
+   */
+  folly::coro::Task<void> co_write(TValue element);
+
+  /**
+   * Returns the bound of this channel, or std::nullopt if it is unbounded (or
+   * this instance is no longer valid).
+   */
+  std::optional<ChannelBound> getBound() const {
+    return bridge_ ? bridge_->getBound() : std::nullopt;
+  }
+
+  /**
+   * Returns queue depth statistics, or std::nullopt if the channel is
+   * unbounded.
+   */
+  std::optional<ChannelDepthStats> getDepthStats() const {
+    return bridge_ ? bridge_->getDepthStats() : std::nullopt;
+  }
+
   /**
    * Closes the pipe without an exception.
    */
@@ -263,6 +309,23 @@ class Receiver {
     buffer_.clear();
   }
 
+  /**
+   * Returns the bound of this channel, or std::nullopt if it is unbounded (or
+   * this instance is no longer valid).
+   */
+  std::optional<ChannelBound> getBound() const {
+    return bridge_ ? bridge_->getBound() : std::nullopt;
+  }
+
+  /**
+   * Returns queue depth statistics, or std::nullopt if the channel is
+   * unbounded. Values already taken into this receiver's buffer are not
+   * included in the depth.
+   */
+  std::optional<ChannelDepthStats> getDepthStats() const {
+    return bridge_ ? bridge_->getDepthStats() : std::nullopt;
+  }
+
  private:
   explicit Receiver(detail::ChannelBridgePtr<TValue> bridge)
       : bridge_(std::move(bridge)) {}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+
+namespace folly {
+namespace channels {
+
+/**
+ * What a bounded channel does with writes while it holds as many values as its
+ * capacity allows.
+ */
+enum class OverflowPolicy {
+  /**
+   * Values are never dropped. Sender::co_write() waits until the receiver has
+   * taken values from the channel, and operators writing into the channel
+   * (transform, merge, fanout) stop pulling from their inputs until then.
+   * Plain Sender::write() does not wait, and may exceed the capacity.
+   */
+  BlockProducer,
+
+  /**
+   * The oldest value is discarded by the sender to make room for the written
+   * value, so the channel never holds more than capacity values, even if the
+   * receiver stops reading.
+   */
+  DropOldest,
+
+  /**
+   * Values written while the channel is full are discarded.
+   */
+  DropNewest,
+};
+
+/**
+ * Bounds the number of values a channel holds that were written but not yet
+ * taken by the receiver.
+ */
+struct ChannelBound {
+  size_t capacity;
+  OverflowPolicy policy{OverflowPolicy::BlockProducer};
+};
+
+/**
+ * Queue depth statistics of a bounded channel.
+ */
+struct ChannelDepthStats {
+  /* Number of values written but not yet taken by the receiver. */
+  size_t depth{0};
+  /* Highest depth observed since the channel was created. */
+  size_t maxDepth{0};
+  /* Number of values discarded by OverflowPolicy::DropOldest/DropNewest. */
+  size_t numDropped{0};
+  size_t capacity{0};
+};
+
+} // namespace channels
+} // namespace folly
@@ -140,6 +140,7 @@ class FanoutChannelProcessor
     }
 
     ChannelBridgePtr<ValueType> receiver;
+    std::optional<ChannelBound> subscriberBound;
     FanoutSender<ValueType> fanoutSender;
     ContextType context;
     bool handleDeleted{false};
@@ -160,6 +161,7 @@ class FanoutChannelProcessor
    */
   void start(Receiver<ValueType> inputReceiver) {
     auto state = state_.wlock();
+    state->subscriberBound = inputReceiver.getBound();
     auto [unbufferedInputReceiver, buffer] =
         detail::receiverUnbuffer(std::move(inputReceiver));
     state->receiver = std::move(unbufferedInputReceiver);
@@ -181,15 +183,18 @@ class FanoutChannelProcessor
     auto initialValues = getInitialValues
         ? getInitialValues(state->context)
         : std::vector<ValueType>();
+    auto [receiver, sender] = state->subscriberBound.has_value()
+        ? Channel<ValueType>::create(*state->subscriberBound)
+        : Channel<ValueType>::create();
+    for (auto&& value : initialValues) {
+      sender.write(std::move(value));
+    }
     if (!state->receiver) {
-      auto [receiver, sender] = Channel<ValueType>::create();
-      for (auto&& value : initialValues) {
-        sender.write(std::move(value));
-      }
       std::move(sender).close();
-      return std::move(receiver);
+    } else {
+      state->fanoutSender.subscribe(std::move(sender));
     }
-    return state->fanoutSender.subscribe(std::move(initialValues));
+    return std::move(receiver);
   }
 
   /**
@@ -260,6 +265,11 @@ class FanoutChannelProcessor
         : (buffer.has_value() ? processValues(state, std::move(buffer.value()))
                               : std::nullopt);
     while (!closeResult.has_value()) {
+      if (pauseForSubscriberCapacity(state)) {
+        // A bounded output receiver is full. We will stop processing until it
+        // has capacity again.
+        break;
+      }
       if (state->receiver->receiverWait(this)) {
         // There are no more values available right now. We will stop processing
         // until the channel fires the consume() callback (indicating that more
@@ -277,6 +287,25 @@ class FanoutChannelProcessor
     }
   }
 
+  /**
+   * If an output receiver is bounded with OverflowPolicy::BlockProducer and
+   * full, stops pulling values from the input receiver until it has capacity
+   * again, and returns true.
+   *
+   * While paused, the input receiver is not waiting on its channel, so a
+   * cancellation triggered in the meantime is processed once we resume.
+   */
+  bool pauseForSubscriberCapacity(WLockedStatePtr& state) {
+    return state->fanoutSender.waitForSubscriberCapacity([this] {
+      executor_->add([this] {
+        auto state = state_.wlock();
+        if (state->receiver) {
+          processAllAvailableValues(state);
+        }
+      });
+    });
+  }
+
   /**
    * Processes the given set of values for the input receiver. Returns a
    * CloseResult if channel was closed, so the caller can stop attempting to
@@ -50,6 +50,11 @@ struct NoContext {
  * allowing for initial updates to depend on the context. This facilitates the
  * common pattern of letting new subscribers know where they are starting from.
  *
+ * If the input receiver is bounded (see ChannelBound.h), every output receiver
+ * gets the same bound. With OverflowPolicy::BlockProducer, the fanout channel
+ * stops reading from the input receiver while any output receiver is full, so
+ * the slowest subscriber determines the pace.
+ *
  * Example without context:
  *
  *   // Function that returns a receiver:
@@ -56,6 +56,21 @@ class FanoutSenderProcessor : public IChannelCallback {
     }
   }
 
+  /**
+   * Registers the given callback with the first output receiver that is
+   * bounded with OverflowPolicy::BlockProducer and full, if any.
+   */
+  bool waitForSubscriberCapacity(folly::Function<void()>&& callback) {
+    auto state = state_.wlock();
+    for (auto* sender : state->senders_) {
+      if (sender->senderShouldBlock() &&
+          sender->senderWaitForCapacity(std::move(callback))) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   /**
    * This is called when the user's FanoutSender object has been destroyed.
    */
@@ -281,6 +296,20 @@ void FanoutSender<ValueType>::write(U&& element) {
   }
 }
 
+template <typename ValueType>
+bool FanoutSender<ValueType>::waitForSubscriberCapacity(
+    folly::Function<void()>&& callback) {
+  clearSendersWithClosedReceivers();
+  if (!anySubscribersImpl()) {
+    return false;
+  } else if (!hasProcessor()) {
+    return getSingleSender()->senderShouldBlock() &&
+        getSingleSender()->senderWaitForCapacity(std::move(callback));
+  } else {
+    return getProcessor()->waitForSubscriberCapacity(std::move(callback));
+  }
+}
+
 template <typename ValueType>
 void FanoutSender<ValueType>::close(exception_wrapper ex) && {
   clearSendersWithClosedReceivers();
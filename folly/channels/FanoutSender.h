@@ -84,6 +84,14 @@ class FanoutSender {
   template <typename U = ValueType>
   void write(U&& element);
 
+  /**
+   * If an output receiver is bounded with OverflowPolicy::BlockProducer and
+   * full, registers the given callback to be invoked once that receiver has
+   * capacity again (or is cancelled), and returns true. Otherwise returns false
+   * and leaves the callback untouched.
+   */
+  bool waitForSubscriberCapacity(folly::Function<void()>&& callback);
+
   /**
    * Closes the fanout sender.
    */
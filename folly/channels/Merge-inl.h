@@ -166,6 +166,11 @@ class MergeProcessor : public IChannelCallback {
         ? processValues(std::move(buffer.value()))
         : std::nullopt;
     while (!closeResult.has_value()) {
+      if (pauseForOutputCapacity(receiver)) {
+        // The output receiver is bounded and full. We will stop processing
+        // this input until the output receiver has capacity again.
+        break;
+      }
       if (receiver->receiverWait(this)) {
         // There are no more values available right now. We will stop processing
         // until the channel fires the consume() callback (indicating that more
@@ -183,6 +188,41 @@ class MergeProcessor : public IChannelCallback {
     }
   }
 
+  /**
+   * If the output receiver is bounded with OverflowPolicy::BlockProducer and
+   * full, parks the given input receiver until the output receiver has
+   * capacity again, and returns true.
+   *
+   * A parked input receiver is not waiting on its channel, so it will not get
+   * consume() or canceled() callbacks. Both are handled when it is resumed.
+   */
+  bool pauseForOutputCapacity(ChannelBridge<TValue>* receiver) {
+    if (getSenderState() != ChannelState::Active ||
+        !sender_->senderShouldBlock()) {
+      return false;
+    }
+    if (!waitingForCapacity_) {
+      if (!sender_->senderWaitForCapacity([this] {
+            executor_->add([this] { resumePausedReceivers(); });
+          })) {
+        return false;
+      }
+      waitingForCapacity_ = true;
+    }
+    pausedReceivers_.push_back(receiver);
+    return true;
+  }
+
+  /**
+   * Called once the output receiver has capacity again (or was cancelled).
+   */
+  void resumePausedReceivers() {
+    waitingForCapacity_ = false;
+    for (auto* receiver : std::exchange(pausedReceivers_, {})) {
+      processAllAvailableValues(receiver);
+    }
+  }
+
   /**
    * Processes the given set of values for an input receiver. Returns a
    * CloseResult if the given channel was closed, so the caller can stop
@@ -278,6 +318,8 @@ class MergeProcessor : public IChannelCallback {
   folly::F14FastSet<ChannelBridge<TValue>*> receivers_;
   ChannelBridgePtr<TValue> sender_;
   folly::Executor::KeepAlive<folly::SequencedExecutor> executor_;
+  std::vector<ChannelBridge<TValue>*> pausedReceivers_;
+  bool waitingForCapacity_{false};
 };
 } // namespace detail
 
@@ -286,7 +328,15 @@ Receiver<TValue> merge(
     std::vector<TReceiver> inputReceivers,
     folly::Executor::KeepAlive<folly::SequencedExecutor> executor,
     bool waitForAllInputsToClose) {
-  auto [outputReceiver, outputSender] = Channel<TValue>::create();
+  std::optional<ChannelBound> bound;
+  for (auto& inputReceiver : inputReceivers) {
+    if (inputReceiver && (bound = inputReceiver.getBound())) {
+      break;
+    }
+  }
+  auto [outputReceiver, outputSender] = bound.has_value()
+      ? Channel<TValue>::create(*bound)
+      : Channel<TValue>::create();
   if (waitForAllInputsToClose) {
     auto* processor = new detail::MergeProcessor<TValue, true>(
         std::move(outputSender), std::move(executor));
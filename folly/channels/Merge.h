@@ -29,6 +29,11 @@ namespace channels {
  * input receiver closes without an exception, the channel continues to merge
  * values from the other input receivers until all input receivers are closed.
  *
+ * If any input receiver is bounded (see ChannelBound.h), the output receiver
+ * gets the bound of the first such input. With OverflowPolicy::BlockProducer,
+ * merging pauses while the output receiver is full, so that backpressure
+ * propagates to the input receivers.
+ *
  * @param inputReceivers: The collection of input receivers to merge.
  *
  * @param executor: A SequencedExecutor used to merge input values.
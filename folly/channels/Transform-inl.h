@@ -217,6 +217,11 @@ class TransformProcessorBase : public IChannelCallback {
           co_return CloseResult();
         }
         if (!outputResult.hasException()) {
+          if (sender_->senderShouldBlock()) {
+            // The output receiver is bounded and full. Wait for it to catch
+            // up, which also stops us from pulling more input values.
+            co_await senderWaitForCapacity(*sender_);
+          }
           sender_->senderPush(std::move(outputResult->value()));
         } else {
           // The transform coroutine threw an exception. We will close the
@@ -577,7 +582,15 @@ template <
     typename OutputValueType>
 Receiver<OutputValueType> transform(
     ReceiverType inputReceiver, TransformerType transformer) {
-  auto [outputReceiver, outputSender] = Channel<OutputValueType>::create();
+  std::optional<ChannelBound> bound;
+  if constexpr (std::is_same_v<ReceiverType, Receiver<InputValueType>>) {
+    if (inputReceiver) {
+      bound = inputReceiver.getBound();
+    }
+  }
+  auto [outputReceiver, outputSender] = bound.has_value()
+      ? Channel<OutputValueType>::create(*bound)
+      : Channel<OutputValueType>::create();
   using TProcessor = detail::
       TransformProcessor<InputValueType, OutputValueType, TransformerType>;
   auto* processor =
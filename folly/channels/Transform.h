@@ -48,6 +48,11 @@ namespace channels {
  * (potentially after receiving the last output values the TransformValue
  * function returned, if any).
  *
+ * If the input receiver is bounded (see ChannelBound.h), the output receiver
+ * gets the same bound. With OverflowPolicy::BlockProducer, transformation
+ * pauses while the output receiver is full, so that backpressure propagates to
+ * the input receiver.
+ *
  * @param inputReceiver: The input receiver.
  *
  * @param executor: A folly::SequencedExecutor used to transform the values.
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+
+#include <glog/logging.h>
+
+#include <folly/ExceptionWrapper.h>
+#include <folly/Function.h>
+#include <folly/Try.h>
+#include <folly/channels/ChannelBound.h>
+#include <folly/channels/detail/AtomicQueue.h>
+
+namespace folly {
+namespace channels {
+namespace detail {
+
+/**
+ * Tracks the depth of a bounded channel and applies its overflow policy. The
+ * depth is incremented by the sender when it pushes a value, and decremented
+ * by the receiver when it takes values from the channel.
+ *
+ * A sender that has to wait for capacity registers a callback, which is
+ * invoked by the receiver once the depth drops below the capacity, or once
+ * the receiver is cancelled.
+ *
+ * Under OverflowPolicy::DropOldest, the values themselves are held by a
+ * DropOldestQueue, which updates the depth under its own lock.
+ */
+class BoundedChannelState {
+ public:
+  explicit BoundedChannelState(ChannelBound bound) : bound_(bound) {
+    CHECK_GT(bound_.capacity, 0) << "Bounded channels need a capacity";
+  }
+
+  const ChannelBound& bound() const { return bound_; }
+
+  // These should only be called from the sender thread
+
+  /**
+   * Accounts for a value about to be pushed. Returns false if the value should
+   * be dropped instead.
+   */
+  bool onPush() {
+    auto depth = depth_.fetch_add(1) + 1;
+    if (depth > bound_.capacity &&
+        bound_.policy == OverflowPolicy::DropNewest) {
+      depth_.fetch_sub(1);
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    auto maxDepth = maxDepth_.load(std::memory_order_relaxed);
+    while (depth > maxDepth &&
+           !maxDepth_.compare_exchange_weak(
+               maxDepth, depth, std::memory_order_relaxed)) {
+    }
+    return true;
+  }
+
+  bool hasCapacity() const { return depth_.load() < bound_.capacity; }
+
+  bool shouldBlock() const {
+    return bound_.policy == OverflowPolicy::BlockProducer && !hasCapacity();
+  }
+
+  /**
+   * Registers a callback to be invoked once the channel has capacity again (or
+   * the receiver is cancelled). Returns false, leaving the callback untouched,
+   * if there is no need to wait.
+   */
+  bool waitForCapacity(folly::Function<void()>&& callback) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (cancelled_) {
+      return false;
+    }
+    // Publish the waiter before re-checking the depth. Together with the
+    // receiver decrementing the depth before checking for a waiter, this
+    // ensures that at least one side sees the other.
+    waiting_.store(true);
+    if (hasCapacity()) {
+      waiting_.store(false, std::memory_order_relaxed);
+      return false;
+    }
+    callback_ = std::move(callback);
+    return true;
+  }
+
+  /**
+   * Unregisters the callback passed to waitForCapacity(). Returns false if it
+   * was already invoked (or is about to be).
+   */
+  bool cancelWaitForCapacity() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!callback_) {
+      return false;
+    }
+    waiting_.store(false, std::memory_order_relaxed);
+    callback_ = nullptr;
+    return true;
+  }
+
+  /**
+   * Accounts for a value evicted by the sender of a DropOldest channel to make
+   * room for a new one.
+   */
+  void onEvict() { dropped_.fetch_add(1, std::memory_order_relaxed); }
+
+  // These should only be called from the receiver thread
+
+  /**
+   * Accounts for values taken from the channel.
+   */
+  template <typename TValue>
+  void onTake(const Queue<Try<TValue>>& values) {
+    size_t count = 0;
+    for (auto* node = values.head_; node; node = node->next) {
+      count += node->value.hasValue() ? 1 : 0;
+    }
+    onTake(count);
+  }
+
+  void onTake(size_t count) {
+    if (count == 0) {
+      return;
+    }
+    depth_.fetch_sub(count);
+    if (waiting_.load()) {
+      notify();
+    }
+  }
+
+  void cancel() {
+    folly::Function<void()> callback;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      cancelled_ = true;
+      waiting_.store(false, std::memory_order_relaxed);
+      callback = std::move(callback_);
+    }
+    if (callback) {
+      callback();
+    }
+  }
+
+  ChannelDepthStats stats() const {
+    ChannelDepthStats stats;
+    stats.depth = depth_.load(std::memory_order_relaxed);
+    stats.maxDepth = maxDepth_.load(std::memory_order_relaxed);
+    stats.numDropped = dropped_.load(std::memory_order_relaxed);
+    stats.capacity = bound_.capacity;
+    return stats;
+  }
+
+ private:
+  void notify() {
+    folly::Function<void()> callback;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!callback_ || !hasCapacity()) {
+        return;
+      }
+      waiting_.store(false, std::memory_order_relaxed);
+      callback = std::move(callback_);
+    }
+    callback();
+  }
+
+  const ChannelBound bound_;
+  std::atomic<size_t> depth_{0};
+  std::atomic<size_t> maxDepth_{0};
+  std::atomic<size_t> dropped_{0};
+  std::atomic<bool> waiting_{false};
+  std::mutex mutex_;
+  folly::Function<void()> callback_;
+  bool cancelled_{false};
+};
+
+/**
+ * Holds the values of an OverflowPolicy::DropOldest channel. Values are kept
+ * here rather than in the receiver queue, so that the sender can evict the
+ * oldest one when the queue is full, even if the receiver is not reading.
+ *
+ * The receiver queue then only carries wakeups (one whenever this queue
+ * becomes non-empty) and the closing Try. The receiver takes all the values
+ * here whenever it takes messages from the receiver queue.
+ */
+template <typename TValue>
+class DropOldestQueue {
+ public:
+  using Node = typename Queue<Try<TValue>>::Node;
+
+  explicit DropOldestQueue(BoundedChannelState& state) : state_(state) {}
+
+  DropOldestQueue(const DropOldestQueue&) = delete;
+  DropOldestQueue& operator=(const DropOldestQueue&) = delete;
+
+  ~DropOldestQueue() {
+    // Frees the values that were never taken.
+    Queue<Try<TValue>> values(head_);
+  }
+
+  /**
+   * The message pushed into the receiver queue when this queue becomes
+   * non-empty.
+   */
+  static Try<TValue> wakeup() {
+    static const exception_wrapper kWakeup{Wakeup()};
+    return Try<TValue>(kWakeup);
+  }
+
+  /**
+   * Appends a value, evicting the oldest value if the queue is full. Returns
+   * true if the queue was empty, in which case the caller must push a
+   * wakeup() into the receiver queue.
+   */
+  bool push(Try<TValue>&& value) {
+    auto node = std::make_unique<Node>(std::move(value));
+    std::unique_ptr<Node> evicted;
+    std::lock_guard<std::mutex> lock(mutex_);
+    bool wasEmpty = !head_;
+    if (size_ == state_.bound().capacity) {
+      evicted.reset(std::exchange(head_, head_->next));
+      state_.onEvict();
+    } else {
+      ++size_;
+      state_.onPush();
+    }
+    auto* tail = node.release();
+    if (head_) {
+      tail_->next = tail;
+    } else {
+      head_ = tail;
+    }
+    tail_ = tail;
+    return wasEmpty;
+  }
+
+  /**
+   * Takes all values, followed by the given messages from the receiver queue
+   * other than wakeups.
+   */
+  Queue<Try<TValue>> takeAll(Queue<Try<TValue>> messages) {
+    Node* head;
+    Node* tail;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      head = std::exchange(head_, nullptr);
+      tail = std::exchange(tail_, nullptr);
+      state_.onTake(std::exchange(size_, 0));
+    }
+    while (!messages.empty()) {
+      auto* node = std::exchange(messages.head_, messages.head_->next);
+      if (node->value.template hasException<Wakeup>()) {
+        delete node;
+        continue;
+      }
+      node->next = nullptr;
+      if (tail) {
+        tail->next = node;
+      } else {
+        head = node;
+      }
+      tail = node;
+    }
+    return Queue<Try<TValue>>(head);
+  }
+
+ private:
+  struct Wakeup : std::exception {};
+
+  BoundedChannelState& state_;
+  std::mutex mutex_;
+  Node* head_{nullptr};
+  Node* tail_{nullptr};
+  size_t size_{0};
+};
+
+} // namespace detail
+} // namespace channels
+} // namespace folly
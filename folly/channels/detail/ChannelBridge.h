@@ -16,7 +16,13 @@
 
 #pragma once
 
+#include <memory>
+#include <optional>
+
+#include <folly/Function.h>
 #include <folly/Try.h>
+#include <folly/channels/ChannelBound.h>
+#include <folly/channels/detail/BoundedChannelState.h>
 #include <folly/experimental/channels/detail/AtomicQueue.h>
 
 namespace folly {
@@ -49,6 +55,18 @@ class ChannelBridge : public ChannelBridgeBase {
 
   static Ptr create() { return Ptr(new ChannelBridge<TValue>()); }
 
+  static Ptr create(std::optional<ChannelBound> bound) {
+    auto bridge = Ptr(new ChannelBridge<TValue>());
+    if (bound.has_value()) {
+      bridge->bound_ = std::make_unique<BoundedChannelState>(*bound);
+      if (bound->policy == OverflowPolicy::DropOldest) {
+        bridge->dropOldest_ =
+            std::make_unique<DropOldestQueue<TValue>>(*bridge->bound_);
+      }
+    }
+    return bridge;
+  }
+
   Ptr copy() {
     auto refCount = refCount_.fetch_add(1, std::memory_order_relaxed);
     DCHECK(refCount > 0);
@@ -59,6 +77,18 @@ class ChannelBridge : public ChannelBridgeBase {
 
   template <typename U = TValue>
   void senderPush(U&& value) {
+    if (dropOldest_) {
+      if (!isReceiverCancelled() &&
+          dropOldest_->push(Try<TValue>(std::forward<U>(value)))) {
+        receiverQueue_.push(
+            DropOldestQueue<TValue>::wakeup(),
+            static_cast<ChannelBridgeBase*>(this));
+      }
+      return;
+    }
+    if (bound_ && (isReceiverCancelled() || !bound_->onPush())) {
+      return;
+    }
     receiverQueue_.push(
         Try<TValue>(std::forward<U>(value)),
         static_cast<ChannelBridgeBase*>(this));
@@ -91,10 +121,36 @@ class ChannelBridge : public ChannelBridgeBase {
     return senderQueue_.getMessages(static_cast<ChannelBridgeBase*>(this));
   }
 
+  /**
+   * Returns whether the channel is bounded with OverflowPolicy::BlockProducer
+   * and full, so that the sender should wait before pushing more values.
+   */
+  bool senderShouldBlock() const { return bound_ && bound_->shouldBlock(); }
+
+  /**
+   * Registers a callback to be invoked (on the receiver thread) once the
+   * channel has capacity again, or once the receiver is cancelled. Returns
+   * false, leaving the callback untouched, if there is no need to wait.
+   */
+  bool senderWaitForCapacity(folly::Function<void()>&& callback) {
+    return bound_ && bound_->waitForCapacity(std::move(callback));
+  }
+
+  /**
+   * Unregisters the callback passed to senderWaitForCapacity(). Returns false
+   * if it was already invoked (or is about to be).
+   */
+  bool senderCancelWaitForCapacity() {
+    return bound_ && bound_->cancelWaitForCapacity();
+  }
+
   // These should only be called from the receiver thread
 
   void receiverCancel() {
     if (!isReceiverCancelled()) {
+      if (bound_) {
+        bound_->cancel();
+      }
       senderQueue_.push(Unit(), static_cast<ChannelBridgeBase*>(this));
       receiverQueue_.close(static_cast<ChannelBridgeBase*>(this));
     }
@@ -111,7 +167,25 @@ class ChannelBridge : public ChannelBridgeBase {
   }
 
   ReceiverQueue<TValue> receiverGetValues() {
-    return receiverQueue_.getMessages(static_cast<ChannelBridgeBase*>(this));
+    auto values =
+        receiverQueue_.getMessages(static_cast<ChannelBridgeBase*>(this));
+    if (dropOldest_) {
+      return dropOldest_->takeAll(std::move(values));
+    }
+    if (bound_) {
+      bound_->onTake(values);
+    }
+    return values;
+  }
+
+  // These may be called from any thread
+
+  std::optional<ChannelBound> getBound() const {
+    return bound_ ? std::make_optional(bound_->bound()) : std::nullopt;
+  }
+
+  std::optional<ChannelDepthStats> getDepthStats() const {
+    return bound_ ? std::make_optional(bound_->stats()) : std::nullopt;
   }
 
  private:
@@ -130,6 +204,8 @@ class ChannelBridge : public ChannelBridgeBase {
   ReceiverAtomicQueue receiverQueue_;
   SenderAtomicQueue senderQueue_;
   std::atomic<int8_t> refCount_{1};
+  std::unique_ptr<BoundedChannelState> bound_;
+  std::unique_ptr<DropOldestQueue<TValue>> dropOldest_;
 };
 
 template <typename TValue>
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <limits>
+#include <thread>
+
+#include <folly/Benchmark.h>
+#include <folly/channels/Channel.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/init/Init.h>
+
+using namespace folly;
+using namespace folly::channels;
+
+// A producer thread writes kNumValues values as fast as it can, while a
+// consumer thread spends some time on every value it receives. Besides the time
+// to get all values through the channel, this reports the peak number of values
+// queued in the channel (and the memory they take), and how many values were
+// dropped.
+
+namespace {
+
+constexpr int kNumValues = 100000;
+constexpr int kConsumerSpins = 200;
+
+void runSpeedMismatch(
+    UserCounters& counters, size_t iters, ChannelBound bound) {
+  ChannelDepthStats stats;
+  size_t numReceived = 0;
+  for (size_t iter = 0; iter < iters; ++iter) {
+    auto [receiver, sender] = Channel<int>::create(bound);
+    std::thread producer([&, sender = std::move(sender)]() mutable {
+      folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+        for (int i = 0; i < kNumValues; ++i) {
+          co_await sender.co_write(i);
+        }
+      }());
+      std::move(sender).close();
+    });
+    folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+      while (auto value = co_await receiver.next()) {
+        for (int i = 0; i < kConsumerSpins; ++i) {
+          folly::doNotOptimizeAway(*value + i);
+        }
+        ++numReceived;
+        // The receiver is released once the channel is closed, so keep the
+        // latest stats around.
+        stats = *receiver.getDepthStats();
+      }
+    }());
+    producer.join();
+  }
+  using Node = channels::detail::Queue<Try<int>>::Node;
+  counters["max_depth"] = stats.maxDepth;
+  counters["peak_kb"] = stats.maxDepth * sizeof(Node) / 1024;
+  counters["dropped"] = stats.numDropped;
+  counters["received"] = numReceived / iters;
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(Unbounded, counters, iters) {
+  // A bound that is never reached, to get depth stats for comparison.
+  runSpeedMismatch(
+      counters, iters, ChannelBound{std::numeric_limits<size_t>::max()});
+}
+
+BENCHMARK_COUNTERS_RELATIVE(BlockProducer, counters, iters) {
+  runSpeedMismatch(
+      counters, iters, ChannelBound{1024, OverflowPolicy::BlockProducer});
+}
+
+BENCHMARK_COUNTERS_RELATIVE(DropOldest, counters, iters) {
+  runSpeedMismatch(
+      counters, iters, ChannelBound{1024, OverflowPolicy::DropOldest});
+}
+
+BENCHMARK_COUNTERS_RELATIVE(DropNewest, counters, iters) {
+  runSpeedMismatch(
+      counters, iters, ChannelBound{1024, OverflowPolicy::DropNewest});
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv, true);
+
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/channels/Channel.h>
+#include <folly/channels/FanoutChannel.h>
+#include <folly/channels/Merge.h>
+#include <folly/channels/Transform.h>
+#include <folly/channels/test/ChannelTestUtil.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/portability/GTest.h>
+
+namespace folly {
+namespace channels {
+
+using namespace testing;
+
+class BoundedChannelFixture : public Test {
+ protected:
+  ~BoundedChannelFixture() override { executor_.drain(); }
+
+  template <typename TValue>
+  static std::optional<TValue> next(Receiver<TValue>& receiver) {
+    return folly::coro::blockingWait(receiver.next());
+  }
+
+  template <typename TValue>
+  static size_t depth(const Receiver<TValue>& receiver) {
+    return receiver.getDepthStats().value().depth;
+  }
+
+  folly::coro::Task<void> writeAll(Sender<int>& sender, int from, int to) {
+    for (int i = from; i <= to; ++i) {
+      co_await sender.co_write(i);
+      ++numWritten_;
+    }
+  }
+
+  folly::ManualExecutor executor_;
+  int numWritten_{0};
+};
+
+TEST_F(BoundedChannelFixture, UnboundedChannelHasNoStats) {
+  auto [receiver, sender] = Channel<int>::create();
+  EXPECT_FALSE(receiver.getBound().has_value());
+  EXPECT_FALSE(sender.getDepthStats().has_value());
+}
+
+TEST_F(BoundedChannelFixture, DropNewest_DropsWritesWhileFull) {
+  auto [receiver, sender] = Channel<int>::create(
+      ChannelBound{.capacity = 2, .policy = OverflowPolicy::DropNewest});
+  for (int i = 1; i <= 4; ++i) {
+    sender.write(i);
+  }
+
+  auto stats = sender.getDepthStats().value();
+  EXPECT_EQ(stats.depth, 2);
+  EXPECT_EQ(stats.maxDepth, 2);
+  EXPECT_EQ(stats.numDropped, 2);
+  EXPECT_EQ(stats.capacity, 2);
+
+  EXPECT_EQ(next(receiver), 1);
+  EXPECT_EQ(next(receiver), 2);
+  sender.write(5);
+  EXPECT_EQ(next(receiver), 5);
+  EXPECT_EQ(depth(receiver), 0);
+}
+
+TEST_F(BoundedChannelFixture, DropOldest_DeliversNewestValues) {
+  auto [receiver, sender] = Channel<int>::create(
+      ChannelBound{.capacity = 2, .policy = OverflowPolicy::DropOldest});
+  for (int i = 1; i <= 4; ++i) {
+    sender.write(i);
+  }
+
+  // The values were evicted by the sender, before the receiver read any.
+  auto stats = sender.getDepthStats().value();
+  EXPECT_EQ(stats.depth, 2);
+  EXPECT_EQ(stats.maxDepth, 2);
+  EXPECT_EQ(stats.numDropped, 2);
+
+  EXPECT_EQ(next(receiver), 3);
+  EXPECT_EQ(depth(receiver), 0);
+  sender.write(5);
+  sender.write(6);
+  sender.write(7);
+  EXPECT_EQ(sender.getDepthStats()->numDropped, 3);
+  std::move(sender).close();
+  EXPECT_EQ(next(receiver), 4);
+  EXPECT_EQ(next(receiver), 6);
+  EXPECT_EQ(next(receiver), 7);
+  EXPECT_EQ(next(receiver), std::nullopt);
+}
+
+TEST_F(BoundedChannelFixture, BlockProducer_CoWriteWaitsForCapacity) {
+  auto [receiver, sender] = Channel<int>::create(ChannelBound{.capacity = 2});
+  co_withExecutor(&executor_, writeAll(sender, 1, 5)).start();
+  executor_.drain();
+  EXPECT_EQ(numWritten_, 2);
+  EXPECT_EQ(depth(receiver), 2);
+
+  EXPECT_EQ(next(receiver), 1);
+  executor_.drain();
+  EXPECT_EQ(numWritten_, 4);
+  EXPECT_EQ(next(receiver), 2);
+  EXPECT_EQ(next(receiver), 3);
+  EXPECT_EQ(next(receiver), 4);
+  executor_.drain();
+  EXPECT_EQ(numWritten_, 5);
+  EXPECT_EQ(next(receiver), 5);
+  EXPECT_EQ(receiver.getDepthStats()->maxDepth, 2);
+}
+
+TEST_F(BoundedChannelFixture, BlockProducer_CancelUnblocksProducer) {
+  auto [receiver, sender] = Channel<int>::create(ChannelBound{.capacity = 1});
+  co_withExecutor(&executor_, writeAll(sender, 1, 3)).start();
+  executor_.drain();
+  EXPECT_EQ(numWritten_, 1);
+
+  std::move(receiver).cancel();
+  executor_.drain();
+  EXPECT_EQ(numWritten_, 3);
+  EXPECT_TRUE(sender.isReceiverCancelled());
+}
+
+TEST_F(BoundedChannelFixture, BlockProducer_CoWriteIsCancellable) {
+  auto [receiver, sender] = Channel<int>::create(ChannelBound{.capacity = 1});
+  sender.write(1);
+  folly::CancellationSource cancelSource;
+  auto write = co_withExecutor(
+                   &executor_,
+                   folly::coro::co_withCancellation(
+                       cancelSource.getToken(), sender.co_write(2)))
+                   .start();
+  executor_.drain();
+  EXPECT_FALSE(write.isReady());
+
+  cancelSource.requestCancellation();
+  executor_.drain();
+  EXPECT_TRUE(write.isReady());
+  EXPECT_TRUE(write.result().hasException<folly::OperationCancelled>());
+  EXPECT_EQ(depth(receiver), 1);
+
+  EXPECT_EQ(next(receiver), 1);
+  sender.write(3);
+  EXPECT_EQ(next(receiver), 3);
+}
+
+TEST_F(BoundedChannelFixture, Transform_PropagatesBackpressure) {
+  auto [inputReceiver, inputSender] =
+      Channel<int>::create(ChannelBound{.capacity = 2});
+  auto outputReceiver = transform(
+      std::move(inputReceiver),
+      &executor_,
+      [](Try<int> value) -> folly::coro::AsyncGenerator<int> {
+        co_yield value.value() * 10;
+      });
+  EXPECT_EQ(outputReceiver.getBound()->capacity, 2);
+
+  for (int i = 1; i <= 4; ++i) {
+    inputSender.write(i);
+  }
+  executor_.drain();
+  EXPECT_EQ(depth(outputReceiver), 2);
+  EXPECT_EQ(inputSender.getDepthStats()->depth, 0);
+
+  // The transform is waiting for the output receiver, so new input values
+  // are not taken.
+  inputSender.write(5);
+  executor_.drain();
+  EXPECT_EQ(inputSender.getDepthStats()->depth, 1);
+
+  for (int i = 1; i <= 5; ++i) {
+    EXPECT_EQ(next(outputReceiver), i * 10);
+    executor_.drain();
+  }
+  EXPECT_EQ(outputReceiver.getDepthStats()->maxDepth, 2);
+}
+
+TEST_F(BoundedChannelFixture, Merge_PausesInputsWhileOutputFull) {
+  auto [receiver1, sender1] = Channel<int>::create(ChannelBound{.capacity = 2});
+  auto [receiver2, sender2] = Channel<int>::create();
+  auto mergedReceiver = merge(
+      toVector(std::move(receiver1), std::move(receiver2)), &executor_);
+  EXPECT_EQ(mergedReceiver.getBound()->capacity, 2);
+
+  sender1.write(1);
+  sender1.write(2);
+  executor_.drain();
+  EXPECT_EQ(depth(mergedReceiver), 2);
+
+  sender1.write(3);
+  sender2.write(4);
+  executor_.drain();
+  EXPECT_EQ(depth(mergedReceiver), 2);
+  EXPECT_EQ(sender1.getDepthStats()->depth, 1);
+
+  std::vector<int> values;
+  std::move(sender1).close();
+  std::move(sender2).close();
+  while (auto value = next(mergedReceiver)) {
+    values.push_back(*value);
+    executor_.drain();
+  }
+  EXPECT_THAT(values, UnorderedElementsAre(1, 2, 3, 4));
+  EXPECT_FALSE(mergedReceiver.getDepthStats().has_value());
+}
+
+TEST_F(BoundedChannelFixture, Fanout_SlowestSubscriberPacesInput) {
+  auto [inputReceiver, sender] =
+      Channel<int>::create(ChannelBound{.capacity = 2});
+  auto fanoutChannel =
+      createFanoutChannel(std::move(inputReceiver), &executor_);
+  auto fastReceiver = fanoutChannel.subscribe();
+  auto slowReceiver = fanoutChannel.subscribe();
+  EXPECT_EQ(slowReceiver.getBound()->capacity, 2);
+
+  sender.write(1);
+  sender.write(2);
+  executor_.drain();
+  sender.write(3);
+  executor_.drain();
+  EXPECT_EQ(sender.getDepthStats()->depth, 1);
+
+  EXPECT_EQ(next(fastReceiver), 1);
+  EXPECT_EQ(next(fastReceiver), 2);
+  executor_.drain();
+  EXPECT_EQ(sender.getDepthStats()->depth, 1);
+
+  EXPECT_EQ(next(slowReceiver), 1);
+  executor_.drain();
+  EXPECT_EQ(sender.getDepthStats()->depth, 0);
+  EXPECT_EQ(next(fastReceiver), 3);
+  EXPECT_EQ(next(slowReceiver), 2);
+  EXPECT_EQ(next(slowReceiver), 3);
+}
+
+} // namespace channels
+} // namespace folly
@@ -0,0 +1,673 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+
+#include <folly/CppAttributes.h>
+#include <folly/Optional.h>
+#include <folly/Portability.h>
+#include <folly/lang/Align.h>
+#include <folly/synchronization/Rcu.h>
+
+namespace folly {
+
+/**
+ * ConcurrentBTree is a concurrent ordered map implemented as a B+-tree
+ * with optimistic lock coupling (Leis et al., "The ART of Practical
+ * Synchronization", DaMoN 2016).
+ *
+ * Every node carries a version word.  Readers never write shared memory:
+ * they record a node's version, read the node, and validate that the
+ * version did not change, restarting the operation from the root if it
+ * did.  Writers descend the same way and only lock (by upgrading the
+ * version they read) the one or two nodes they modify.  Full nodes are
+ * split eagerly on the way down, so a split never propagates upwards.
+ *
+ * Compared to ConcurrentSkipList, lookups touch O(log_B n) nodes of a few
+ * cache lines each instead of O(log n) individually allocated towers, and
+ * readers do not update a reference count, so read-mostly workloads scale
+ * with the number of cores.
+ *
+ * Restrictions and differences from std::map:
+ *
+ * * Keys and values are stored in std::atomic slots and read
+ *   optimistically, so both must be trivially copyable and lock-free
+ *   atomic (integers, pointers, small PODs).  Store larger values
+ *   indirectly.
+ *
+ * * There are no iterators.  find() returns a copy of the value, and
+ *   scan() copies each leaf before invoking the callback on it, so the
+ *   callback runs without any lock or RCU read lock held.
+ *
+ * * scan() is weakly consistent: each leaf is observed atomically, but
+ *   entries inserted or erased concurrently in leaves that the scan has
+ *   not reached yet may or may not be visited.
+ *
+ * * Erasing the last key of a leaf unlinks the leaf from its parent and
+ *   hands it to folly::rcu_retire(); every operation runs inside an RCU
+ *   read-side critical section, so optimistic readers never touch freed
+ *   memory.  Inner nodes are never merged; the tree does not shrink in
+ *   height.
+ *
+ * NodeBytes is the target size of a node; the default of 256 bytes gives
+ * 15 entries per leaf and 14 separator keys per inner node for 8-byte
+ * keys and values.
+ *
+ * Usage:
+ *
+ *   folly::ConcurrentBTree<int64_t, int64_t> tree;
+ *   tree.insert(1, 10);
+ *   tree.insert_or_assign(1, 11);
+ *   if (auto v = tree.find(1)) {
+ *     ...
+ *   }
+ *   tree.scan(0, 100, [](int64_t key, int64_t value) { ... });
+ *   tree.erase(1);
+ */
+template <
+    typename Key,
+    typename Value,
+    typename Compare = std::less<Key>,
+    size_t NodeBytes = 256>
+class ConcurrentBTree {
+  static_assert(
+      std::is_trivially_copyable_v<Key> && std::is_trivially_copyable_v<Value>,
+      "ConcurrentBTree requires trivially copyable keys and values");
+  static_assert(
+      std::atomic<Key>::is_always_lock_free &&
+          std::atomic<Value>::is_always_lock_free,
+      "ConcurrentBTree requires lock-free atomic keys and values");
+
+  // Version lock used for optimistic lock coupling.  Bit 0 marks a node
+  // that has been unlinked from the tree, bit 1 is the write lock and the
+  // remaining bits are a version counter.  Unlocking adds kLocked again,
+  // which clears the lock bit and carries into the version.
+  class VersionLock {
+   public:
+    using Version = uint64_t;
+
+    // Waits for a concurrent writer to finish and returns false if the
+    // node has been unlinked.
+    bool readLock(Version& v) const noexcept {
+      v = word_.load(std::memory_order_acquire);
+      while (v & kLocked) {
+        asm_volatile_pause();
+        v = word_.load(std::memory_order_acquire);
+      }
+      return !(v & kObsolete);
+    }
+
+    // True if no writer locked the node since readLock() returned v.
+    bool validate(Version v) const noexcept {
+      std::atomic_thread_fence(std::memory_order_acquire);
+      return word_.load(std::memory_order_relaxed) == v;
+    }
+
+    bool tryUpgrade(Version v) noexcept {
+      if (!word_.compare_exchange_strong(
+              v,
+              v + kLocked,
+              std::memory_order_acquire,
+              std::memory_order_relaxed)) {
+        return false;
+      }
+      // Order the lock word store before the writes to the node, so that a
+      // reader that sees any of them fails validation.
+      std::atomic_thread_fence(std::memory_order_release);
+      return true;
+    }
+
+    void unlock() noexcept {
+      word_.fetch_add(kLocked, std::memory_order_release);
+    }
+
+    void unlockObsolete() noexcept {
+      word_.fetch_add(kLocked | kObsolete, std::memory_order_release);
+    }
+
+   private:
+    static constexpr Version kObsolete = 1;
+    static constexpr Version kLocked = 2;
+
+    std::atomic<Version> word_{0};
+  };
+
+  using Version = typename VersionLock::Version;
+
+  struct NodeBase {
+    explicit NodeBase(bool leaf) noexcept : isLeaf(leaf) {}
+
+    VersionLock lock;
+    std::atomic<uint16_t> count{0};
+    const bool isLeaf;
+  };
+
+  static constexpr size_t kLeafSlots =
+      (NodeBytes - sizeof(NodeBase)) / (sizeof(Key) + sizeof(Value));
+  static constexpr size_t kInnerSlots =
+      (NodeBytes - sizeof(NodeBase) - sizeof(NodeBase*)) /
+      (sizeof(Key) + sizeof(NodeBase*));
+  static_assert(
+      kLeafSlots >= 4 && kInnerSlots >= 4,
+      "NodeBytes is too small for this key and value type");
+  static_assert(kLeafSlots <= UINT16_MAX && kInnerSlots <= UINT16_MAX);
+
+  struct alignas(cacheline_align_v) Leaf : NodeBase {
+    Leaf() noexcept : NodeBase(true) {}
+
+    std::atomic<Key> keys[kLeafSlots];
+    std::atomic<Value> values[kLeafSlots];
+  };
+
+  // children[i] holds the keys k with keys[i - 1] <= k < keys[i].
+  struct alignas(cacheline_align_v) Inner : NodeBase {
+    Inner() noexcept : NodeBase(false) {}
+
+    std::atomic<Key> keys[kInnerSlots];
+    std::atomic<NodeBase*> children[kInnerSlots + 1];
+  };
+
+ public:
+  using key_type = Key;
+  using mapped_type = Value;
+  using key_compare = Compare;
+
+  static constexpr size_t kEntriesPerLeaf = kLeafSlots;
+  static constexpr size_t kKeysPerInnerNode = kInnerSlots;
+
+  explicit ConcurrentBTree(const Compare& comp = Compare())
+      : comp_(comp), root_(new Leaf()) {}
+
+  ConcurrentBTree(const ConcurrentBTree&) = delete;
+  ConcurrentBTree& operator=(const ConcurrentBTree&) = delete;
+
+  ~ConcurrentBTree() { destroy(root_.load(std::memory_order_relaxed)); }
+
+  /**
+   * Returns a copy of the value stored for key, or none.
+   */
+  Optional<Value> find(const Key& key) const {
+    std::scoped_lock<rcu_domain> guard(rcu_default_domain());
+    Optional<Value> result;
+    while (!tryFind(key, result)) {
+      result.reset();
+    }
+    return result;
+  }
+
+  bool contains(const Key& key) const { return find(key).has_value(); }
+
+  /**
+   * Inserts (key, value) if key is not present.  Returns true if the
+   * element was inserted.
+   */
+  bool insert(const Key& key, const Value& value) {
+    return upsert(key, value, false);
+  }
+
+  /**
+   * Inserts (key, value), overwriting the value if key is present.
+   * Returns true if the element was inserted rather than assigned.
+   */
+  bool insert_or_assign(const Key& key, const Value& value) {
+    return upsert(key, value, true);
+  }
+
+  /**
+   * Removes key.  Returns true if it was present.
+   */
+  bool erase(const Key& key) {
+    bool erased = false;
+    Leaf* retired = nullptr;
+    {
+      std::scoped_lock<rcu_domain> guard(rcu_default_domain());
+      while (!tryErase(key, erased, retired)) {
+      }
+    }
+    // rcu_retire() may wait for a grace period, which must not happen
+    // inside a read-side critical section.
+    if (retired) {
+      rcu_retire(retired);
+    }
+    return erased;
+  }
+
+  /**
+   * Calls fn(key, value) in ascending key order for every entry with
+   * lo <= key <= hi and returns the number of entries visited.  fn is
+   * invoked on copies and may itself modify the tree.
+   */
+  template <typename Fn>
+  size_t scan(const Key& lo, const Key& hi, Fn fn) const {
+    size_t visited = 0;
+    Key from = lo;
+    Key keys[kLeafSlots];
+    Value values[kLeafSlots];
+    while (true) {
+      size_t n = 0;
+      bool more = false;
+      Key next = from;
+      {
+        std::scoped_lock<rcu_domain> guard(rcu_default_domain());
+        while (!tryCollect(from, keys, values, n, more, next)) {
+        }
+      }
+      for (size_t i = 0; i < n; ++i) {
+        if (comp_(hi, keys[i])) {
+          return visited;
+        }
+        fn(keys[i], values[i]);
+        ++visited;
+      }
+      if (!more || comp_(hi, next)) {
+        return visited;
+      }
+      from = next;
+    }
+  }
+
+ private:
+  template <typename Node>
+  static size_t slotCount(const Node* node, size_t slots) noexcept {
+    // An optimistic read may observe a count from the middle of an update;
+    // clamp it so that the read stays in bounds until validation fails.
+    return std::min<size_t>(
+        node->count.load(std::memory_order_relaxed), slots);
+  }
+
+  // Index of the first key in node that is not less than key.
+  template <typename Node>
+  size_t lowerBound(const Node* node, size_t n, const Key& key) const {
+    size_t lo = 0;
+    while (lo < n) {
+      size_t mid = lo + (n - lo) / 2;
+      if (comp_(node->keys[mid].load(std::memory_order_relaxed), key)) {
+        lo = mid + 1;
+      } else {
+        n = mid;
+      }
+    }
+    return lo;
+  }
+
+  // Index of the first key in node that is greater than key, which is also
+  // the index of the child of an inner node that covers key.
+  template <typename Node>
+  size_t upperBound(const Node* node, size_t n, const Key& key) const {
+    size_t lo = 0;
+    while (lo < n) {
+      size_t mid = lo + (n - lo) / 2;
+      if (!comp_(key, node->keys[mid].load(std::memory_order_relaxed))) {
+        lo = mid + 1;
+      } else {
+        n = mid;
+      }
+    }
+    return lo;
+  }
+
+  // Reads the root and its version.  Fails if the root was replaced in
+  // between, since the old root then only covers part of the key space.
+  bool readRoot(NodeBase*& node, Version& v) const {
+    node = root_.load(std::memory_order_acquire);
+    return node->lock.readLock(v) &&
+        node == root_.load(std::memory_order_acquire);
+  }
+
+  // Moves from inner (read at version v) to its child that covers key.  On
+  // success node and v refer to the child.
+  bool descend(Inner* inner, const Key& key, NodeBase*& node, Version& v)
+      const {
+    size_t pos = upperBound(inner, slotCount(inner, kInnerSlots), key);
+    NodeBase* child = inner->children[pos].load(std::memory_order_acquire);
+    Version childVersion;
+    // inner is validated after reading the child's version as well: if the
+    // child was split in between, the key may have moved to its sibling.
+    if (!inner->lock.validate(v) || !child->lock.readLock(childVersion) ||
+        !inner->lock.validate(v)) {
+      return false;
+    }
+    node = child;
+    v = childVersion;
+    return true;
+  }
+
+  bool tryFind(const Key& key, Optional<Value>& result) const {
+    NodeBase* node;
+    Version v;
+    if (!readRoot(node, v)) {
+      return false;
+    }
+    while (!node->isLeaf) {
+      if (!descend(static_cast<Inner*>(node), key, node, v)) {
+        return false;
+      }
+    }
+    auto leaf = static_cast<Leaf*>(node);
+    size_t n = slotCount(leaf, kLeafSlots);
+    size_t i = lowerBound(leaf, n, key);
+    if (i < n && !comp_(key, leaf->keys[i].load(std::memory_order_relaxed))) {
+      result = leaf->values[i].load(std::memory_order_relaxed);
+    }
+    return leaf->lock.validate(v);
+  }
+
+  bool tryCollect(
+      const Key& from,
+      Key* keys,
+      Value* values,
+      size_t& n,
+      bool& more,
+      Key& next) const {
+    NodeBase* node;
+    Version v;
+    if (!readRoot(node, v)) {
+      return false;
+    }
+    more = false;
+    while (!node->isLeaf) {
+      auto inner = static_cast<Inner*>(node);
+      size_t count = slotCount(inner, kInnerSlots);
+      size_t pos = upperBound(inner, count, from);
+      // The lowest key of the next subtree; the separator found deepest in
+      // the tree is the tightest bound.
+      if (pos < count) {
+        next = inner->keys[pos].load(std::memory_order_relaxed);
+        more = true;
+      }
+      if (!descend(inner, from, node, v)) {
+        return false;
+      }
+    }
+    auto leaf = static_cast<Leaf*>(node);
+    size_t count = slotCount(leaf, kLeafSlots);
+    n = 0;
+    for (size_t i = lowerBound(leaf, count, from); i < count; ++i, ++n) {
+      keys[n] = leaf->keys[i].load(std::memory_order_relaxed);
+      values[n] = leaf->values[i].load(std::memory_order_relaxed);
+    }
+    return leaf->lock.validate(v);
+  }
+
+  bool upsert(const Key& key, const Value& value, bool assign) {
+    std::scoped_lock<rcu_domain> guard(rcu_default_domain());
+    bool inserted = false;
+    while (!tryUpsert(key, value, assign, inserted)) {
+    }
+    return inserted;
+  }
+
+  // Write-locks node (read at version v) and its parent (read at version
+  // pv), as needed to split or unlink node.  parent is null if node was
+  // the root.
+  bool lockWithParent(NodeBase* node, Version v, Inner* parent, Version pv) {
+    if (parent && !parent->lock.tryUpgrade(pv)) {
+      return false;
+    }
+    if (!node->lock.tryUpgrade(v)) {
+      if (parent) {
+        parent->lock.unlock();
+      }
+      return false;
+    }
+    if (!parent && node != root_.load(std::memory_order_relaxed)) {
+      node->lock.unlock();
+      return false;
+    }
+    return true;
+  }
+
+  bool tryUpsert(const Key& key, const Value& value, bool assign, bool& ins) {
+    NodeBase* node;
+    Version v;
+    if (!readRoot(node, v)) {
+      return false;
+    }
+    Inner* parent = nullptr;
+    Version parentVersion = 0;
+
+    while (!node->isLeaf) {
+      auto inner = static_cast<Inner*>(node);
+      if (slotCount(inner, kInnerSlots) == kInnerSlots) {
+        if (lockWithParent(inner, v, parent, parentVersion)) {
+          splitInner(inner, parent);
+          inner->lock.unlock();
+          if (parent) {
+            parent->lock.unlock();
+          }
+        }
+        return false; // retry with room in the path
+      }
+      if (parent && !parent->lock.validate(parentVersion)) {
+        return false;
+      }
+      parent = inner;
+      parentVersion = v;
+      if (!descend(inner, key, node, v)) {
+        return false;
+      }
+    }
+
+    auto leaf = static_cast<Leaf*>(node);
+    size_t n = slotCount(leaf, kLeafSlots);
+    if (n == kLeafSlots) {
+      if (lockWithParent(leaf, v, parent, parentVersion)) {
+        splitLeaf(leaf, parent);
+        leaf->lock.unlock();
+        if (parent) {
+          parent->lock.unlock();
+        }
+      }
+      return false;
+    }
+    if (!leaf->lock.tryUpgrade(v)) {
+      return false;
+    }
+    if (parent && !parent->lock.validate(parentVersion)) {
+      leaf->lock.unlock();
+      return false;
+    }
+
+    size_t i = lowerBound(leaf, n, key);
+    if (i < n && !comp_(key, leaf->keys[i].load(std::memory_order_relaxed))) {
+      if (assign) {
+        leaf->values[i].store(value, std::memory_order_relaxed);
+      }
+      ins = false;
+    } else {
+      for (size_t j = n; j > i; --j) {
+        move(leaf->keys[j], leaf->keys[j - 1]);
+        move(leaf->values[j], leaf->values[j - 1]);
+      }
+      leaf->keys[i].store(key, std::memory_order_relaxed);
+      leaf->values[i].store(value, std::memory_order_relaxed);
+      leaf->count.store(n + 1, std::memory_order_relaxed);
+      ins = true;
+    }
+    leaf->lock.unlock();
+    return true;
+  }
+
+  bool tryErase(const Key& key, bool& erased, Leaf*& retired) {
+    NodeBase* node;
+    Version v;
+    if (!readRoot(node, v)) {
+      return false;
+    }
+    Inner* parent = nullptr;
+    Version parentVersion = 0;
+    while (!node->isLeaf) {
+      if (parent && !parent->lock.validate(parentVersion)) {
+        return false;
+      }
+      parent = static_cast<Inner*>(node);
+      parentVersion = v;
+      if (!descend(parent, key, node, v)) {
+        return false;
+      }
+    }
+
+    auto leaf = static_cast<Leaf*>(node);
+    size_t n = slotCount(leaf, kLeafSlots);
+    size_t i = lowerBound(leaf, n, key);
+    if (i == n || comp_(key, leaf->keys[i].load(std::memory_order_relaxed))) {
+      erased = false;
+      return leaf->lock.validate(v);
+    }
+
+    if (n == 1 && parent && slotCount(parent, kInnerSlots) > 0) {
+      // Removing the last key: unlink the now empty leaf from its parent
+      // instead of leaving it behind.
+      if (!lockWithParent(leaf, v, parent, parentVersion)) {
+        return false;
+      }
+      removeChild(
+          parent,
+          upperBound(
+              parent, parent->count.load(std::memory_order_relaxed), key));
+      leaf->count.store(0, std::memory_order_relaxed);
+      leaf->lock.unlockObsolete();
+      parent->lock.unlock();
+      retired = leaf;
+      erased = true;
+      return true;
+    }
+
+    if (!leaf->lock.tryUpgrade(v)) {
+      return false;
+    }
+    if (parent && !parent->lock.validate(parentVersion)) {
+      leaf->lock.unlock();
+      return false;
+    }
+    for (size_t j = i + 1; j < n; ++j) {
+      move(leaf->keys[j - 1], leaf->keys[j]);
+      move(leaf->values[j - 1], leaf->values[j]);
+    }
+    leaf->count.store(n - 1, std::memory_order_relaxed);
+    leaf->lock.unlock();
+    erased = true;
+    return true;
+  }
+
+  template <typename T>
+  static void move(std::atomic<T>& dst, const std::atomic<T>& src) noexcept {
+    dst.store(
+        src.load(std::memory_order_relaxed), std::memory_order_relaxed);
+  }
+
+  // Inserts separator key sep with right as the child to its right.  The
+  // caller holds the write lock of inner, which has room for one more key.
+  void insertChild(Inner* inner, const Key& sep, NodeBase* right) {
+    size_t n = inner->count.load(std::memory_order_relaxed);
+    size_t pos = upperBound(inner, n, sep);
+    for (size_t j = n; j > pos; --j) {
+      move(inner->keys[j], inner->keys[j - 1]);
+      move(inner->children[j + 1], inner->children[j]);
+    }
+    inner->keys[pos].store(sep, std::memory_order_relaxed);
+    inner->children[pos + 1].store(right, std::memory_order_release);
+    inner->count.store(n + 1, std::memory_order_relaxed);
+  }
+
+  // Removes the child at index pos together with one adjacent separator;
+  // the neighbouring child takes over the (empty) key range.
+  void removeChild(Inner* inner, size_t pos) {
+    size_t n = inner->count.load(std::memory_order_relaxed);
+    size_t key = pos > 0 ? pos - 1 : 0;
+    for (size_t j = key + 1; j < n; ++j) {
+      move(inner->keys[j - 1], inner->keys[j]);
+    }
+    for (size_t j = pos + 1; j <= n; ++j) {
+      move(inner->children[j - 1], inner->children[j]);
+    }
+    inner->count.store(n - 1, std::memory_order_relaxed);
+  }
+
+  // Publishes a new root above left and right.  The caller holds the write
+  // lock of left, the current root.
+  void growRoot(const Key& sep, NodeBase* left, NodeBase* right) {
+    auto root = new Inner();
+    root->keys[0].store(sep, std::memory_order_relaxed);
+    root->children[0].store(left, std::memory_order_relaxed);
+    root->children[1].store(right, std::memory_order_relaxed);
+    root->count.store(1, std::memory_order_relaxed);
+    root_.store(root, std::memory_order_release);
+  }
+
+  void splitLeaf(Leaf* leaf, Inner* parent) {
+    auto right = new Leaf();
+    size_t n = leaf->count.load(std::memory_order_relaxed);
+    size_t half = n / 2;
+    for (size_t i = half; i < n; ++i) {
+      move(right->keys[i - half], leaf->keys[i]);
+      move(right->values[i - half], leaf->values[i]);
+    }
+    right->count.store(n - half, std::memory_order_relaxed);
+    leaf->count.store(half, std::memory_order_relaxed);
+    Key sep = right->keys[0].load(std::memory_order_relaxed);
+    if (parent) {
+      insertChild(parent, sep, right);
+    } else {
+      growRoot(sep, leaf, right);
+    }
+  }
+
+  void splitInner(Inner* inner, Inner* parent) {
+    auto right = new Inner();
+    size_t n = inner->count.load(std::memory_order_relaxed);
+    size_t mid = n / 2;
+    Key sep = inner->keys[mid].load(std::memory_order_relaxed);
+    for (size_t i = mid + 1; i < n; ++i) {
+      move(right->keys[i - mid - 1], inner->keys[i]);
+    }
+    for (size_t i = mid + 1; i <= n; ++i) {
+      move(right->children[i - mid - 1], inner->children[i]);
+    }
+    right->count.store(n - mid - 1, std::memory_order_relaxed);
+    inner->count.store(mid, std::memory_order_relaxed);
+    if (parent) {
+      insertChild(parent, sep, right);
+    } else {
+      growRoot(sep, inner, right);
+    }
+  }
+
+  static void destroy(NodeBase* node) {
+    if (node->isLeaf) {
+      delete static_cast<Leaf*>(node);
+      return;
+    }
+    auto inner = static_cast<Inner*>(node);
+    size_t n = inner->count.load(std::memory_order_relaxed);
+    for (size_t i = 0; i <= n; ++i) {
+      destroy(inner->children[i].load(std::memory_order_relaxed));
+    }
+    delete inner;
+  }
+
+  [[FOLLY_ATTR_NO_UNIQUE_ADDRESS]] Compare comp_;
+  std::atomic<NodeBase*> root_;
+};
+
+} // namespace folly
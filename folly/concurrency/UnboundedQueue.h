@@ -79,6 +79,10 @@ namespace folly {
 ///     void enqueue(const T&);
 ///     void enqueue(T&&);
 ///         Adds an element to the end of the queue.
+///     void enqueue_batch(InputIt first, size_t n);
+///         Adds the n elements *first, *next(first), ... to the end of
+///         the queue in order, reserving all of their tickets with a
+///         single atomic operation.
 ///
 ///   Consumer operations:
 ///     void dequeue(T&);
@@ -97,6 +101,12 @@ namespace folly {
 ///     folly::Optional<T> try_dequeue_for(duration&);
 ///         Tries to extract an element from the front of the queue if
 ///         available until the expiration of the specified duration.
+///     size_t try_dequeue_batch(T* items, size_t n);
+///         Extracts up to n elements from the front of the queue into
+///         items[0], ..., reserving all of their tickets with a single
+///         atomic operation, and returns the number extracted. Does not
+///         wait for elements that have not yet been claimed by a
+///         producer, but may wait for claimed ones to be written.
 ///     const T* try_peek();
 ///         Returns pointer to the element at the front of the queue
 ///         if available, or nullptr if the queue is empty. Only for
@@ -344,6 +354,37 @@ class UnboundedQueue {
     return tryDequeueUntil(std::chrono::steady_clock::now() + duration);
   }
 
+  /** enqueue_batch */
+  template <typename InputIt>
+  void enqueue_batch(InputIt first, size_t n) {
+    if (n == 0) {
+      return;
+    }
+    if (SPSC) {
+      Segment* s = tail();
+      enqueueBatchCommon(s, first, n);
+    } else {
+      hazptr_holder<Atom> hptr = make_hazard_pointer<Atom>();
+      Segment* s = hptr.protect(p_.tail);
+      enqueueBatchCommon(s, first, n);
+    }
+  }
+
+  /** try_dequeue_batch */
+  size_t try_dequeue_batch(T* items, size_t n) noexcept {
+    if (n == 0) {
+      return 0;
+    }
+    if (SPSC) {
+      Segment* s = head();
+      return dequeueBatchCommon(s, items, n);
+    } else {
+      hazptr_holder<Atom> hptr = make_hazard_pointer<Atom>();
+      Segment* s = hptr.protect(c_.head);
+      return dequeueBatchCommon(s, items, n);
+    }
+  }
+
   /** try_peek */
   FOLLY_ALWAYS_INLINE const T* try_peek() noexcept {
     static_assert(SingleConsumer, "not single-consumer");
@@ -400,6 +441,31 @@ class UnboundedQueue {
     }
   }
 
+  /** enqueueBatchCommon */
+  template <typename InputIt>
+  void enqueueBatchCommon(Segment* s, InputIt first, size_t n) {
+    Ticket t = fetchAddProducerTicket(n);
+    for (size_t i = 0; i < n; ++i, ++t, ++first) {
+      s = findSegment(s, t);
+      DCHECK_GE(t, s->minTicket());
+      DCHECK_LT(t, s->minTicket() + SegmentSize);
+      size_t idx = index(t);
+      Entry& e = s->entry(idx);
+      e.putItem(*first);
+      if (responsibleForAlloc(t)) {
+        allocNextSegment(s);
+      }
+      if (responsibleForAdvance(t)) {
+        advanceTail(s);
+        if (SPSC) {
+          /* Without hazard pointers s may be reclaimed by the consumer
+             as soon as the tail moves past it. */
+          s = tail();
+        }
+      }
+    }
+  }
+
   /** dequeueImpl */
   FOLLY_ALWAYS_INLINE T dequeueImpl() noexcept {
     if (SPSC) {
@@ -430,6 +496,26 @@ class UnboundedQueue {
     return res;
   }
 
+  /** dequeueBatchCommon */
+  size_t dequeueBatchCommon(Segment* s, T* items, size_t n) noexcept {
+    Ticket t;
+    const size_t count = tryFetchAddConsumerTicket(t, n);
+    for (size_t i = 0; i < count; ++i, ++t) {
+      s = findSegment(s, t);
+      size_t idx = index(t);
+      Entry& e = s->entry(idx);
+      items[i] = e.takeItem();
+      if (responsibleForAdvance(t)) {
+        advanceHead(s);
+        if (SingleConsumer) {
+          /* s has been reclaimed. */
+          s = head();
+        }
+      }
+    }
+    return count;
+  }
+
   /** tryDequeueUntil */
   template <typename Clock, typename Duration>
   FOLLY_ALWAYS_INLINE folly::Optional<T> tryDequeueUntil(
@@ -747,6 +833,40 @@ class UnboundedQueue {
     }
   }
 
+  FOLLY_ALWAYS_INLINE Ticket fetchAddProducerTicket(size_t n) noexcept {
+    if (SingleProducer) {
+      Ticket oldval = producerTicket();
+      setProducerTicket(oldval + n);
+      return oldval;
+    } else { // MP
+      return p_.ticket.fetch_add(n, std::memory_order_acq_rel);
+    }
+  }
+
+  /** Claims up to n consumer tickets that have already been claimed by
+      producers. Returns the number claimed, starting at t. */
+  FOLLY_ALWAYS_INLINE size_t
+  tryFetchAddConsumerTicket(Ticket& t, size_t n) noexcept {
+    t = consumerTicket();
+    while (true) {
+      Ticket p = producerTicket();
+      if (t >= p) {
+        return 0;
+      }
+      size_t count = std::min<size_t>(n, p - t);
+      if (SingleConsumer) {
+        setConsumerTicket(t + count);
+        return count;
+      } else if (c_.ticket.compare_exchange_weak(
+                     t,
+                     t + count,
+                     std::memory_order_acq_rel,
+                     std::memory_order_acquire)) {
+        return count;
+      }
+    }
+  }
+
   FOLLY_ALWAYS_INLINE Ticket fetchIncrementProducerTicket() noexcept {
     if (SingleProducer) {
       Ticket oldval = producerTicket();
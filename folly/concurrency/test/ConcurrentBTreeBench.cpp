@@ -0,0 +1,268 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/ConcurrentBTree.h>
+
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+
+#include <folly/BenchmarkUtil.h>
+#include <folly/ConcurrentSkipList.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/test/Barrier.h>
+
+DEFINE_int32(reps, 10, "number of reps");
+DEFINE_int32(ops, 1000 * 1000, "number of operations per thread per rep");
+DEFINE_int64(size, 1000 * 1000, "number of keys in the container");
+DEFINE_int32(scan_len, 100, "number of keys visited per scan");
+
+using BTree = folly::ConcurrentBTree<int64_t, int64_t>;
+using SkipList = folly::ConcurrentSkipList<int64_t>;
+
+template <typename Func>
+inline uint64_t run_once(int nthr, const Func& fn) {
+  folly::test::Barrier b(nthr + 1);
+  std::vector<std::thread> thr(nthr);
+  for (int tid = 0; tid < nthr; ++tid) {
+    thr[tid] = std::thread([&, tid] {
+      b.wait();
+      b.wait();
+      fn(tid);
+    });
+  }
+  b.wait();
+  // begin time measurement
+  auto tbegin = std::chrono::steady_clock::now();
+  b.wait();
+  /* wait for completion */
+  for (int i = 0; i < nthr; ++i) {
+    thr[i].join();
+  }
+  /* end time measurement */
+  auto tend = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(tend - tbegin)
+      .count();
+}
+
+template <typename RepFunc>
+uint64_t runBench(const std::string& name, int ops, const RepFunc& repFn) {
+  int reps = FLAGS_reps;
+  uint64_t min = UINTMAX_MAX;
+  uint64_t max = 0;
+  uint64_t sum = 0;
+
+  repFn(); // sometimes first run is outlier
+  for (int r = 0; r < reps; ++r) {
+    uint64_t dur = repFn();
+    sum += dur;
+    min = std::min(min, dur);
+    max = std::max(max, dur);
+    // if each rep takes too long run at least 3 reps
+    const uint64_t minute = 60000000000UL;
+    if (sum > minute && r >= 2) {
+      reps = r + 1;
+      break;
+    }
+  }
+
+  const std::string unit = " ns";
+  uint64_t avg = sum / reps;
+  uint64_t res = min;
+  std::cout << name;
+  std::cout << "   " << std::setw(4) << (max + ops / 2) / ops << unit;
+  std::cout << "   " << std::setw(4) << (avg + ops / 2) / ops << unit;
+  std::cout << "   " << std::setw(4) << (min + ops / 2) / ops << unit;
+  std::cout << std::endl;
+  return res;
+}
+
+// Keys are the even numbers in [0, 2 * size), so that half of the random
+// lookups miss.
+void fill(BTree& tree) {
+  for (int64_t i = 0; i < FLAGS_size; ++i) {
+    tree.insert(2 * i, i);
+  }
+}
+
+void fill(const std::shared_ptr<SkipList>& sl) {
+  SkipList::Accessor accessor(sl);
+  for (int64_t i = 0; i < FLAGS_size; ++i) {
+    accessor.insert(2 * i);
+  }
+}
+
+uint64_t bench_btree_find(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops;
+  BTree tree;
+  fill(tree);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      for (int i = 0; i < ops; ++i) {
+        folly::doNotOptimizeAway(tree.find(rng() % (2 * FLAGS_size)));
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+uint64_t bench_skiplist_find(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops;
+  auto sl = SkipList::createInstance();
+  fill(sl);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      SkipList::Accessor accessor(sl);
+      for (int i = 0; i < ops; ++i) {
+        folly::doNotOptimizeAway(
+            accessor.contains(rng() % (2 * FLAGS_size)));
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+uint64_t bench_btree_scan(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops / FLAGS_scan_len;
+  BTree tree;
+  fill(tree);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      for (int i = 0; i < ops; ++i) {
+        int64_t lo = rng() % (2 * FLAGS_size);
+        int64_t sum = 0;
+        tree.scan(lo, lo + 2 * FLAGS_scan_len, [&](int64_t, int64_t v) {
+          sum += v;
+        });
+        folly::doNotOptimizeAway(sum);
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+uint64_t bench_skiplist_scan(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops / FLAGS_scan_len;
+  auto sl = SkipList::createInstance();
+  fill(sl);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      SkipList::Accessor accessor(sl);
+      for (int i = 0; i < ops; ++i) {
+        int64_t lo = rng() % (2 * FLAGS_size);
+        int64_t hi = lo + 2 * FLAGS_scan_len;
+        int64_t sum = 0;
+        for (auto it = accessor.lower_bound(lo);
+             it != accessor.end() && *it <= hi;
+             ++it) {
+          sum += *it;
+        }
+        folly::doNotOptimizeAway(sum);
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+// 90% lookups, 5% inserts and 5% erases of the odd keys.
+uint64_t bench_btree_mixed(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops;
+  BTree tree;
+  fill(tree);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      for (int i = 0; i < ops; ++i) {
+        int64_t key = rng() % (2 * FLAGS_size);
+        auto op = rng() % 20;
+        if (op == 0) {
+          tree.insert(key | 1, key);
+        } else if (op == 1) {
+          tree.erase(key | 1);
+        } else {
+          folly::doNotOptimizeAway(tree.find(key));
+        }
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+uint64_t bench_skiplist_mixed(const int nthr, const std::string& name) {
+  int ops = FLAGS_ops;
+  auto sl = SkipList::createInstance();
+  fill(sl);
+  auto repFn = [&] {
+    auto fn = [&](int tid) {
+      std::minstd_rand rng(tid);
+      SkipList::Accessor accessor(sl);
+      for (int i = 0; i < ops; ++i) {
+        int64_t key = rng() % (2 * FLAGS_size);
+        auto op = rng() % 20;
+        if (op == 0) {
+          accessor.insert(key | 1);
+        } else if (op == 1) {
+          accessor.erase(key | 1);
+        } else {
+          folly::doNotOptimizeAway(accessor.contains(key));
+        }
+      }
+    };
+    return run_once(nthr, fn);
+  };
+  return runBench(name, ops, repFn);
+}
+
+void dottedLine() {
+  std::cout << ".............................................................."
+            << std::endl;
+}
+
+void benches() {
+  std::cout << "=============================================================="
+            << std::endl;
+  std::cout << "Test name                         Max time  Avg time  Min time"
+            << std::endl;
+  for (int nthr : {1, 8, 32, 128}) {
+    std::cout << "========================= " << std::setw(3) << nthr
+              << " threads" << " ========================" << std::endl;
+    bench_btree_find(nthr, "BTree find()                    ");
+    bench_skiplist_find(nthr, "SkipList contains()             ");
+    dottedLine();
+    bench_btree_scan(nthr, "BTree scan() -- per scan        ");
+    bench_skiplist_scan(nthr, "SkipList lower_bound -- per scan");
+    dottedLine();
+    bench_btree_mixed(nthr, "BTree 90% find                  ");
+    bench_skiplist_mixed(nthr, "SkipList 90% contains           ");
+  }
+  std::cout << "=============================================================="
+            << std::endl;
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  benches();
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/concurrency/ConcurrentBTree.h>
+
+#include <atomic>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::ConcurrentBTree;
+
+namespace {
+
+// Small nodes, so that a few hundred keys already build a deep tree.
+using SmallTree = ConcurrentBTree<int64_t, int64_t, std::less<int64_t>, 96>;
+
+template <typename Tree>
+std::vector<std::pair<int64_t, int64_t>> collect(
+    const Tree& tree, int64_t lo, int64_t hi) {
+  std::vector<std::pair<int64_t, int64_t>> out;
+  tree.scan(lo, hi, [&](int64_t k, int64_t v) { out.emplace_back(k, v); });
+  return out;
+}
+
+} // namespace
+
+TEST(ConcurrentBTree, Basic) {
+  ConcurrentBTree<int64_t, int64_t> tree;
+  EXPECT_FALSE(tree.find(1).has_value());
+  EXPECT_TRUE(tree.insert(1, 10));
+  EXPECT_FALSE(tree.insert(1, 20));
+  EXPECT_EQ(10, *tree.find(1));
+  EXPECT_FALSE(tree.insert_or_assign(1, 30));
+  EXPECT_EQ(30, *tree.find(1));
+  EXPECT_TRUE(tree.insert_or_assign(2, 40));
+  EXPECT_TRUE(tree.contains(2));
+  EXPECT_TRUE(tree.erase(1));
+  EXPECT_FALSE(tree.erase(1));
+  EXPECT_FALSE(tree.contains(1));
+  EXPECT_EQ(40, *tree.find(2));
+}
+
+TEST(ConcurrentBTree, MatchesStdMap) {
+  SmallTree tree;
+  std::map<int64_t, int64_t> ref;
+  std::mt19937 rng(1);
+  for (int i = 0; i < 20000; ++i) {
+    int64_t key = rng() % 2000;
+    switch (rng() % 3) {
+      case 0:
+        EXPECT_EQ(ref.emplace(key, i).second, tree.insert(key, i));
+        break;
+      case 1:
+        EXPECT_EQ(ref.count(key) == 0, tree.insert_or_assign(key, i));
+        ref[key] = i;
+        break;
+      case 2:
+        EXPECT_EQ(ref.erase(key) == 1, tree.erase(key));
+        break;
+    }
+  }
+  for (int64_t key = -1; key <= 2000; ++key) {
+    auto it = ref.find(key);
+    auto found = tree.find(key);
+    ASSERT_EQ(it != ref.end(), found.has_value()) << key;
+    if (found) {
+      EXPECT_EQ(it->second, *found);
+    }
+  }
+  std::vector<std::pair<int64_t, int64_t>> expected(ref.begin(), ref.end());
+  EXPECT_EQ(expected, collect(tree, INT64_MIN, INT64_MAX));
+}
+
+TEST(ConcurrentBTree, Scan) {
+  SmallTree tree;
+  for (int64_t i = 0; i < 1000; i += 2) {
+    tree.insert(i, -i);
+  }
+  auto range = collect(tree, 101, 201);
+  ASSERT_EQ(50u, range.size());
+  EXPECT_EQ(102, range.front().first);
+  EXPECT_EQ(-102, range.front().second);
+  EXPECT_EQ(200, range.back().first);
+
+  EXPECT_EQ(1u, collect(tree, 500, 500).size());
+  EXPECT_EQ(0u, collect(tree, 501, 501).size());
+  EXPECT_EQ(0u, collect(tree, 2000, 3000).size());
+  EXPECT_EQ(500u, collect(tree, -5, 5000).size());
+  EXPECT_EQ(3u, tree.scan(0, 4, [](int64_t, int64_t) {}));
+}
+
+TEST(ConcurrentBTree, EraseAllAndReinsert) {
+  SmallTree tree;
+  for (int round = 0; round < 3; ++round) {
+    for (int64_t i = 0; i < 5000; ++i) {
+      EXPECT_TRUE(tree.insert(i, round));
+    }
+    // Erasing in order empties and unlinks leaves one by one.
+    for (int64_t i = 0; i < 5000; ++i) {
+      EXPECT_TRUE(tree.erase(i));
+    }
+    EXPECT_TRUE(collect(tree, INT64_MIN, INT64_MAX).empty());
+  }
+}
+
+TEST(ConcurrentBTree, Comparator) {
+  ConcurrentBTree<int64_t, int64_t, std::greater<int64_t>, 96> tree;
+  for (int64_t i = 0; i < 100; ++i) {
+    tree.insert(i, i);
+  }
+  auto range = collect(tree, 60, 50);
+  ASSERT_EQ(11u, range.size());
+  EXPECT_EQ(60, range.front().first);
+  EXPECT_EQ(50, range.back().first);
+}
+
+TEST(ConcurrentBTree, ConcurrentInsert) {
+  SmallTree tree;
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      // Interleave the key ranges so that threads contend on the same leaves.
+      for (int64_t i = 0; i < kPerThread; ++i) {
+        EXPECT_TRUE(tree.insert(i * kThreads + t, t));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto all = collect(tree, INT64_MIN, INT64_MAX);
+  ASSERT_EQ(size_t(kThreads * kPerThread), all.size());
+  for (int64_t i = 0; i < kThreads * kPerThread; ++i) {
+    EXPECT_EQ(i, all[i].first);
+    EXPECT_EQ(i % kThreads, all[i].second);
+  }
+}
+
+TEST(ConcurrentBTree, ConcurrentReadersAndWriters) {
+  SmallTree tree;
+  constexpr int64_t kKeys = 4096;
+  // Even keys are permanent; odd keys are inserted and erased concurrently.
+  for (int64_t i = 0; i < kKeys; i += 2) {
+    tree.insert(i, i);
+  }
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> writers;
+  for (int t = 0; t < 4; ++t) {
+    writers.emplace_back([&, t] {
+      std::mt19937 rng(t);
+      while (!stop.load()) {
+        int64_t key = (rng() % (kKeys / 2)) * 2 + 1;
+        if (rng() % 2) {
+          tree.insert(key, key);
+        } else {
+          tree.erase(key);
+        }
+      }
+    });
+  }
+  std::vector<std::thread> readers;
+  for (int t = 0; t < 4; ++t) {
+    readers.emplace_back([&, t] {
+      std::mt19937 rng(t + 100);
+      for (int i = 0; i < 20000; ++i) {
+        int64_t key = (rng() % (kKeys / 2)) * 2;
+        auto v = tree.find(key);
+        ASSERT_TRUE(v.has_value()) << key;
+        EXPECT_EQ(key, *v);
+        if (i % 100 == 0) {
+          int64_t prev = -1;
+          size_t evens = 0;
+          tree.scan(0, kKeys, [&](int64_t k, int64_t value) {
+            EXPECT_LT(prev, k);
+            EXPECT_EQ(k, value);
+            prev = k;
+            evens += k % 2 == 0;
+          });
+          EXPECT_EQ(size_t(kKeys / 2), evens);
+        }
+      }
+    });
+  }
+  for (auto& thread : readers) {
+    thread.join();
+  }
+  stop.store(true);
+  for (auto& thread : writers) {
+    thread.join();
+  }
+}
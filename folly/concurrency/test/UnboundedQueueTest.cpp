@@ -27,6 +27,7 @@
 
 #include <atomic>
 #include <iomanip>
+#include <numeric>
 #include <thread>
 
 DEFINE_bool(bench, false, "run benchmark");
@@ -396,6 +397,107 @@ TEST(UnboundedQueue, enqDeq) {
   enq_deq_test<false, false, true>(10, 10);
 }
 
+template <template <typename, bool> class Q, bool MayBlock>
+void batch_test() {
+  Q<int, MayBlock> q;
+  int dest[10];
+  ASSERT_EQ(q.try_dequeue_batch(dest, 10), 0);
+
+  /* Cross several segments with a single batch */
+  std::vector<int> src(1000);
+  std::iota(src.begin(), src.end(), 0);
+  q.enqueue_batch(src.begin(), 0);
+  ASSERT_TRUE(q.empty());
+  q.enqueue_batch(src.begin(), 1000);
+  ASSERT_EQ(q.size(), 1000);
+  q.enqueue(1000);
+
+  std::vector<int> out(2000, -1);
+  ASSERT_EQ(q.try_dequeue_batch(out.data(), 300), 300);
+  int v = -1;
+  ASSERT_TRUE(q.try_dequeue(v));
+  out[300] = v;
+  ASSERT_EQ(q.try_dequeue_batch(out.data() + 301, 1699), 700);
+  for (int i = 0; i <= 1000; ++i) {
+    ASSERT_EQ(out[i], i);
+  }
+  ASSERT_TRUE(q.empty());
+  ASSERT_EQ(q.try_dequeue_batch(dest, 10), 0);
+}
+
+TEST(UnboundedQueue, batch) {
+  batch_test<USPSC, false>();
+  batch_test<UMPSC, false>();
+  batch_test<USPMC, false>();
+  batch_test<UMPMC, false>();
+  batch_test<USPSC, true>();
+  batch_test<UMPSC, true>();
+  batch_test<USPMC, true>();
+  batch_test<UMPMC, true>();
+}
+
+template <bool SingleProducer, bool SingleConsumer, bool MayBlock>
+void batch_enq_deq_test(const int nprod, const int ncons, const int batch) {
+  int ops = 10000;
+  folly::UnboundedQueue<int, SingleProducer, SingleConsumer, MayBlock, 4> q;
+  std::atomic<uint64_t> sum(0);
+  std::atomic<int> received(0);
+
+  auto prod = [&](int tid) {
+    std::vector<int> src;
+    for (int i = tid; i < ops; i += nprod) {
+      src.push_back(i);
+      if (int(src.size()) == batch) {
+        q.enqueue_batch(src.begin(), src.size());
+        src.clear();
+      }
+    }
+    q.enqueue_batch(src.begin(), src.size());
+  };
+
+  auto cons = [&](int) {
+    uint64_t mysum = 0;
+    std::vector<int> dst(batch);
+    int last = -1;
+    while (received.load() < ops) {
+      size_t k = q.try_dequeue_batch(dst.data(), batch);
+      for (size_t i = 0; i < k; ++i) {
+        if (nprod == 1 && ncons == 1) {
+          ASSERT_EQ(dst[i], last + 1);
+          last = dst[i];
+        }
+        mysum += dst[i];
+      }
+      received.fetch_add(int(k));
+    }
+    sum.fetch_add(mysum);
+  };
+
+  auto endfn = [&] {
+    uint64_t expected = (ops) * (ops - 1) / 2;
+    ASSERT_EQ(expected, sum.load());
+    ASSERT_TRUE(q.empty());
+  };
+  run_once(nprod, ncons, prod, cons, endfn);
+}
+
+TEST(UnboundedQueue, batchEnqDeq) {
+  for (int batch : {1, 5, 64}) {
+    /* SPSC */
+    batch_enq_deq_test<true, true, false>(1, 1, batch);
+    batch_enq_deq_test<true, true, true>(1, 1, batch);
+    /* MPSC */
+    batch_enq_deq_test<false, true, false>(4, 1, batch);
+    batch_enq_deq_test<false, true, true>(4, 1, batch);
+    /* SPMC */
+    batch_enq_deq_test<true, false, false>(1, 4, batch);
+    batch_enq_deq_test<true, false, true>(1, 4, batch);
+    /* MPMC */
+    batch_enq_deq_test<false, false, false>(4, 4, batch);
+    batch_enq_deq_test<false, false, true>(4, 4, batch);
+  }
+}
+
 template <typename RepFunc>
 uint64_t runBench(const std::string& name, uint64_t ops, const RepFunc& repFn) {
   uint64_t reps = FLAGS_reps;
@@ -0,0 +1,495 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/CancellationToken.h>
+#include <folly/ExceptionWrapper.h>
+#include <folly/Executor.h>
+#include <folly/Try.h>
+#include <folly/container/Access.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/Coroutine.h>
+#include <folly/coro/CurrentExecutor.h>
+#include <folly/coro/Task.h>
+#include <folly/coro/ViaIfAsync.h>
+#include <folly/coro/WithAsyncStack.h>
+#include <folly/coro/WithCancellation.h>
+#include <folly/coro/detail/Barrier.h>
+#include <folly/coro/detail/Malloc.h>
+#include <folly/io/async/Request.h>
+#include <folly/lang/Align.h>
+#include <folly/portability/Asm.h>
+#include <folly/tracing/AsyncStack.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES
+
+namespace folly {
+namespace coro {
+namespace detail {
+
+// Hands out the frames of the coroutines that wrap the children of a
+// fan-out, which all have the same size, from a single allocation.
+class FanOutFrameArena {
+ public:
+  explicit FanOutFrameArena(std::size_t numFrames) noexcept
+      : numFrames_(numFrames) {}
+
+  FanOutFrameArena(const FanOutFrameArena&) = delete;
+  FanOutFrameArena& operator=(const FanOutFrameArena&) = delete;
+
+  ~FanOutFrameArena() {
+    if (block_ != nullptr) {
+      ::folly_coro_async_free(block_, frameSize_ * numFrames_);
+    }
+  }
+
+  void* allocate(std::size_t size) {
+    if (block_ == nullptr) {
+      frameSize_ = align_ceil(size, alignof(std::max_align_t));
+      block_ = ::folly_coro_async_malloc(frameSize_ * numFrames_);
+    }
+    assert(size <= frameSize_);
+    assert(numAllocated_ < numFrames_);
+    return static_cast<char*>(block_) + frameSize_ * numAllocated_++;
+  }
+
+ private:
+  const std::size_t numFrames_;
+  std::size_t frameSize_ = 0;
+  std::size_t numAllocated_ = 0;
+  void* block_ = nullptr;
+};
+
+// Like BarrierTask, but its frame is allocated from a FanOutFrameArena, which
+// must be the first argument of the coroutine and outlive it.
+class FanOutTask {
+ public:
+  class promise_type {
+    struct FinalAwaiter {
+      bool await_ready() noexcept { return false; }
+
+      coroutine_handle<> await_suspend(
+          coroutine_handle<promise_type> h) noexcept {
+        auto& promise = h.promise();
+        assert(promise.barrier_ != nullptr);
+        return promise.barrier_->arrive(promise.asyncFrame_);
+      }
+
+      void await_resume() noexcept {}
+    };
+
+   public:
+    template <typename... Args>
+    static void* operator new(
+        std::size_t size, FanOutFrameArena& arena, Args&&...) {
+      return arena.allocate(size);
+    }
+
+    static void operator delete(void*, std::size_t) noexcept {}
+
+    FanOutTask get_return_object() noexcept {
+      return FanOutTask{coroutine_handle<promise_type>::from_promise(*this)};
+    }
+
+    suspend_always initial_suspend() noexcept { return {}; }
+
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    template <typename Awaitable>
+    auto await_transform(Awaitable&& awaitable) {
+      return folly::coro::co_withAsyncStack(
+          static_cast<Awaitable&&>(awaitable));
+    }
+
+    void return_void() noexcept {}
+
+    [[noreturn]] void unhandled_exception() noexcept { std::terminate(); }
+
+    void setBarrier(Barrier* barrier) noexcept {
+      assert(barrier_ == nullptr);
+      barrier_ = barrier;
+    }
+
+    folly::AsyncStackFrame& getAsyncFrame() noexcept { return asyncFrame_; }
+
+   private:
+    folly::AsyncStackFrame asyncFrame_;
+    Barrier* barrier_ = nullptr;
+  };
+
+ private:
+  using handle_t = coroutine_handle<promise_type>;
+
+  explicit FanOutTask(handle_t coro) noexcept : coro_(coro) {}
+
+ public:
+  FanOutTask(FanOutTask&& other) noexcept
+      : coro_(std::exchange(other.coro_, {})) {}
+
+  FanOutTask& operator=(FanOutTask&&) = delete;
+
+  ~FanOutTask() {
+    if (coro_) {
+      coro_.destroy();
+    }
+  }
+
+  FOLLY_NOINLINE void start(
+      Barrier* barrier, folly::AsyncStackFrame& parentFrame) noexcept {
+    assert(coro_);
+    auto& calleeFrame = coro_.promise().getAsyncFrame();
+    calleeFrame.setParentFrame(parentFrame);
+    calleeFrame.setReturnAddress();
+    coro_.promise().setBarrier(barrier);
+
+    folly::resumeCoroutineWithNewAsyncStackRoot(coro_);
+  }
+
+ private:
+  handle_t coro_;
+};
+
+// The state shared by the children of a collectEachRange() call.
+//
+// Children store their results in their slots and push the slots onto a
+// lock-free stack. The child that finds no delivery in progress delivers
+// the results, including those pushed while it does so, which serializes
+// the calls to the callback without blocking any child.
+template <typename Result, typename OnResult>
+class FanOutState {
+ public:
+  struct Slot {
+    Result result;
+    Slot* next = nullptr;
+  };
+
+  FanOutState(
+      std::size_t numChildren,
+      OnResult& onResult,
+      Executor::KeepAlive<> executor,
+      const CancellationToken& parentToken)
+      : slots_(numChildren),
+        onResult_(onResult),
+        executor_(std::move(executor)),
+        cancelToken_(CancellationToken::merge(
+            parentToken, cancelSource_.getToken())) {}
+
+  Result& result(std::size_t index) noexcept { return slots_[index].result; }
+
+  Executor::KeepAlive<> executor() const noexcept {
+    return executor_.get_alias();
+  }
+
+  const CancellationToken& cancelToken() const noexcept {
+    return cancelToken_;
+  }
+
+  exception_wrapper& callbackException() noexcept {
+    return callbackException_;
+  }
+
+  void complete(std::size_t index) noexcept {
+    auto& slot = slots_[index];
+    if (numUndelivered_.fetch_add(1, std::memory_order_acq_rel) == 0) {
+      // No delivery in progress: deliver this result right away, then any
+      // results that other children completed in the meantime.
+      deliver(slot);
+      deliverCompleted(1);
+      return;
+    }
+    // The count is incremented before the slot is published, so that it
+    // never falls below the number of slots the delivering child popped.
+    auto* head = completed_.load(std::memory_order_relaxed);
+    do {
+      slot.next = head;
+    } while (!completed_.compare_exchange_weak(
+        head, &slot, std::memory_order_release, std::memory_order_relaxed));
+  }
+
+ private:
+  void deliverCompleted(std::size_t numDelivered) noexcept {
+    while (numUndelivered_.fetch_sub(
+               numDelivered, std::memory_order_acq_rel) != numDelivered) {
+      // Reverse the popped slots, to deliver them in completion order.
+      Slot* fifo = nullptr;
+      numDelivered = 0;
+      for (auto* slot = completed_.exchange(nullptr, std::memory_order_acquire);
+           slot != nullptr;
+           ++numDelivered) {
+        auto* next = slot->next;
+        slot->next = fifo;
+        fifo = slot;
+        slot = next;
+      }
+      if (numDelivered == 0) {
+        // A child has counted itself but not pushed its slot yet; it will
+        // shortly.
+        asm_volatile_pause();
+        continue;
+      }
+      for (; fifo != nullptr; fifo = fifo->next) {
+        deliver(*fifo);
+      }
+    }
+  }
+
+  void deliver(Slot& slot) noexcept {
+    if (stopped_) {
+      return;
+    }
+    const auto index = static_cast<std::size_t>(&slot - slots_.data());
+    try {
+      using callback_result =
+          invoke_result_t<OnResult&, std::size_t, Result&&>;
+      if constexpr (std::is_void_v<callback_result>) {
+        onResult_(index, std::move(slot.result));
+      } else if (!onResult_(index, std::move(slot.result))) {
+        stop();
+      }
+    } catch (...) {
+      callbackException_ = exception_wrapper{current_exception()};
+      stop();
+    }
+  }
+
+  void stop() noexcept {
+    stopped_ = true;
+    cancelSource_.requestCancellation();
+  }
+
+  std::vector<Slot> slots_;
+  std::atomic<Slot*> completed_{nullptr};
+  std::atomic<std::size_t> numUndelivered_{0};
+
+  // Only accessed by the child that delivers results.
+  OnResult& onResult_;
+  bool stopped_ = false;
+  exception_wrapper callbackException_;
+
+  const Executor::KeepAlive<> executor_;
+  const CancellationSource cancelSource_;
+  const CancellationToken cancelToken_;
+};
+
+template <typename State, typename SemiAwaitable>
+FanOutTask makeFanOutTask(
+    FanOutFrameArena&,
+    State& state,
+    SemiAwaitable awaitable,
+    std::size_t index) {
+  auto& result = state.result(index);
+  try {
+    if constexpr (std::is_void_v<semi_await_result_t<SemiAwaitable>>) {
+      co_await co_viaIfAsync(
+          state.executor(),
+          co_withCancellation(state.cancelToken(), std::move(awaitable)));
+      result.emplace();
+    } else {
+      result.emplace(co_await co_viaIfAsync(
+          state.executor(),
+          co_withCancellation(state.cancelToken(), std::move(awaitable))));
+    }
+  } catch (...) {
+    result.emplaceException(current_exception());
+  }
+  state.complete(index);
+}
+
+template <typename InputRange, typename OnResult>
+Task<void> collectEachRangeImpl(InputRange& awaitables, OnResult& onResult) {
+  using awaitable_type = remove_cvref_t<range_reference_t<InputRange>>;
+  using result_type =
+      collect_all_try_range_component_t<range_reference_t<InputRange>>;
+
+  const auto numChildren = static_cast<std::size_t>(
+      std::distance(access::begin(awaitables), access::end(awaitables)));
+  if (numChildren == 0) {
+    co_return;
+  }
+
+  FanOutState<result_type, OnResult> state(
+      numChildren,
+      onResult,
+      co_await co_current_executor,
+      co_await co_current_cancellation_token);
+
+  // The arena must outlive the tasks whose frames it holds.
+  FanOutFrameArena arena(numChildren);
+  std::vector<FanOutTask> tasks;
+  tasks.reserve(numChildren);
+  std::size_t index = 0;
+  for (auto&& awaitable : awaitables) {
+    tasks.push_back(makeFanOutTask(
+        arena, state, awaitable_type(std::move(awaitable)), index++));
+  }
+
+  // Restore the initial context after starting each task, see
+  // collectAllRange().
+  const auto context = RequestContext::saveContext();
+
+  auto& asyncFrame = co_await co_current_async_stack_frame;
+
+  {
+    Barrier barrier{tasks.size() + 1};
+    for (auto& task : tasks) {
+      task.start(&barrier, asyncFrame);
+      RequestContext::setContext(context);
+    }
+    co_await UnsafeResumeInlineSemiAwaitable{barrier.arriveAndWait()};
+  }
+
+  if (auto& ew = state.callbackException()) {
+    co_yield co_error(std::move(ew));
+  }
+}
+
+} // namespace detail
+
+///////////////////////////////////////////////////////////////////////////
+// collectEachRange(RangeOf<SemiAwaitable<T>>&&, OnResult)
+//   -> SemiAwaitable<void>
+//
+// The collectEachRange() function concurrently co_awaits all the
+// SemiAwaitables of a range, like collectAllRange(), and streams their
+// results: onResult(index, Try<T>&&) is called with the index and the
+// result of each one as it completes.
+//
+// onResult is never called concurrently with itself, though it may be called
+// on any of the threads that run the SemiAwaitables, and results are
+// delivered roughly in completion order. If onResult returns a bool, false
+// stops the delivery of results and requests cancellation of the
+// SemiAwaitables that haven't completed. If it throws, the exception is
+// rethrown by collectEachRange() once all SemiAwaitables complete.
+//
+// collectEachRange() completes once all SemiAwaitables complete. Unlike
+// collectAllRange(), it allocates the frames of the coroutines that await
+// the SemiAwaitables in a single block, and stores the results in a single
+// vector, so it does a fixed number of allocations regardless of the
+// fan-out, on top of those of the SemiAwaitables themselves.
+//
+// Example:
+//   std::vector<Task<Reply>> requests = makeRequests(shards);
+//   co_await folly::coro::collectEachRange(
+//       std::move(requests), [&](std::size_t shard, Try<Reply>&& reply) {
+//         merge(shard, std::move(reply));
+//       });
+//
+template <typename InputRange, typename OnResult>
+Task<void> collectEachRange(InputRange awaitables, OnResult onResult) {
+  if constexpr (std::is_base_of_v<
+                    std::forward_iterator_tag,
+                    typename std::iterator_traits<
+                        detail::range_iterator_t<InputRange>>::
+                        iterator_category>) {
+    co_await detail::collectEachRangeImpl(awaitables, onResult);
+  } else {
+    // Single-pass ranges are buffered, so that the number of frames to
+    // allocate is known upfront.
+    std::vector<remove_cvref_t<detail::range_reference_t<InputRange>>>
+        buffered;
+    for (auto&& awaitable : awaitables) {
+      buffered.push_back(std::move(awaitable));
+    }
+    detail::MoveRange range(buffered);
+    co_await detail::collectEachRangeImpl(range, onResult);
+  }
+}
+
+// Overload for the common case where an rvalue std::vector<SemiAwaitable> is
+// passed, see collectAllRange().
+template <typename SemiAwaitable, typename OnResult>
+Task<void> collectEachRange(
+    std::vector<SemiAwaitable> awaitables, OnResult onResult) {
+  co_await collectEachRange(
+      detail::MoveRange(awaitables), std::move(onResult));
+}
+
+///////////////////////////////////////////////////////////////////////////
+// collectFirstNRange(RangeOf<SemiAwaitable<T>>&&, std::size_t n)
+//   -> SemiAwaitable<std::vector<std::pair<std::size_t, T>>>
+//
+// The collectFirstNRange() function concurrently co_awaits all the
+// SemiAwaitables of a range and returns the indices and values of the first
+// n of them to succeed, in completion order. Once n have succeeded, the
+// others are cancelled, and their results are discarded.
+//
+// If fewer than n succeed, the first exception is rethrown.
+//
+// collectFirstNRange() is built on top of collectEachRange(), and completes
+// once all SemiAwaitables complete.
+//
+// Example:
+//   // Read from any 2 of 3 replicas.
+//   auto replies = co_await folly::coro::collectFirstNRange(
+//       std::move(reads), 2);
+//
+template <typename InputRange>
+auto collectFirstNRange(InputRange awaitables, std::size_t n)
+    -> Task<std::vector<std::pair<
+        std::size_t,
+        detail::collect_all_range_component_t<
+            detail::range_reference_t<InputRange>>>>> {
+  using result_type = detail::collect_all_range_component_t<
+      detail::range_reference_t<InputRange>>;
+  std::vector<std::pair<std::size_t, result_type>> results;
+  if (n == 0) {
+    co_return results;
+  }
+  results.reserve(n);
+
+  exception_wrapper firstException;
+  co_await collectEachRange(
+      std::move(awaitables), [&](std::size_t index, auto&& result) {
+        if (result.hasException()) {
+          if (!firstException) {
+            firstException = std::move(result.exception());
+          }
+          return true;
+        }
+        if constexpr (std::is_void_v<semi_await_result_t<
+                          detail::range_reference_t<InputRange>>>) {
+          results.emplace_back(index, unit);
+        } else {
+          results.emplace_back(index, std::move(result).value());
+        }
+        return results.size() < n;
+      });
+
+  if (results.size() < n && firstException) {
+    co_yield co_error(std::move(firstException));
+  }
+  co_return results;
+}
+
+template <typename SemiAwaitable>
+auto collectFirstNRange(std::vector<SemiAwaitable> awaitables, std::size_t n)
+    -> decltype(collectFirstNRange(detail::MoveRange(awaitables), n)) {
+  co_return co_await collectFirstNRange(detail::MoveRange(awaitables), n);
+}
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES
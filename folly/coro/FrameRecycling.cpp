@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/coro/FrameRecycling.h>
+
+#include <algorithm>
+#include <atomic>
+
+#include <folly/Likely.h>
+#include <folly/lang/Align.h>
+#include <folly/lang/New.h>
+
+namespace folly::coro {
+
+namespace {
+
+constexpr std::size_t kSizeClassStep = 16;
+constexpr std::size_t kNumSizeClasses = kMaxRecycledFrameSize / kSizeClassStep;
+
+struct FreeFrame {
+  FreeFrame* next;
+};
+
+// Trivially destructible, so that it stays usable while other thread_local
+// objects, which may own coroutine frames, are destroyed at thread exit.
+struct FrameCache {
+  bool enabled;
+  std::size_t maxCachedBytes;
+  FrameRecyclingStats stats;
+  FreeFrame* freeLists[kNumSizeClasses];
+
+  void releaseAll() {
+    for (std::size_t i = 0; i < kNumSizeClasses; ++i) {
+      while (auto frame = freeLists[i]) {
+        freeLists[i] = frame->next;
+        folly::operator_delete(frame, (i + 1) * kSizeClassStep);
+      }
+    }
+    stats.cachedBytes = 0;
+  }
+};
+
+thread_local FrameCache tlCache{};
+
+// Releases the cache of a thread that enabled recycling when it exits.
+// Frames freed after this runs go straight to the heap.
+struct FrameCacheReleaser {
+  ~FrameCacheReleaser() {
+    tlCache.enabled = false;
+    tlCache.releaseAll();
+  }
+};
+
+std::atomic<const FrameAllocationHooks*> gHooks{nullptr};
+
+// Frames are always allocated in multiples of kSizeClassStep, whether or
+// not recycling is enabled, so that any frame can be cached by any thread.
+// Allocators don't hand out smaller blocks anyway.
+std::size_t roundedSize(std::size_t size) {
+  return align_ceil(std::max(size, std::size_t(1)), kSizeClassStep);
+}
+
+} // namespace
+
+void enableFrameRecyclingForThisThread(std::size_t maxCachedBytes) {
+  static thread_local FrameCacheReleaser releaser;
+  (void)releaser;
+  tlCache.maxCachedBytes = maxCachedBytes;
+  tlCache.enabled = true;
+}
+
+void disableFrameRecyclingForThisThread() {
+  tlCache.enabled = false;
+  tlCache.releaseAll();
+}
+
+FrameRecyclingStats getFrameRecyclingStatsForThisThread() {
+  return tlCache.stats;
+}
+
+const FrameAllocationHooks* setFrameAllocationHooks(
+    const FrameAllocationHooks* hooks) {
+  return gHooks.exchange(hooks, std::memory_order_acq_rel);
+}
+
+namespace detail {
+
+void* allocateFrame(std::size_t size, const void* callsite) {
+  const auto rounded = roundedSize(size);
+  void* frame = nullptr;
+  auto& cache = tlCache;
+  if (cache.enabled && rounded <= kMaxRecycledFrameSize) {
+    ++cache.stats.allocations;
+    auto& freeList = cache.freeLists[rounded / kSizeClassStep - 1];
+    if (auto cached = freeList) {
+      freeList = cached->next;
+      cache.stats.cachedBytes -= rounded;
+      ++cache.stats.recycled;
+      frame = cached;
+    }
+  }
+  if (frame == nullptr) {
+    frame = folly::operator_new(rounded);
+  }
+  if (auto hooks = gHooks.load(std::memory_order_acquire);
+      FOLLY_UNLIKELY(hooks != nullptr) && hooks->onAllocate) {
+    hooks->onAllocate(frame, size, callsite);
+  }
+  return frame;
+}
+
+void deallocateFrame(void* ptr, std::size_t size, const void* callsite) {
+  if (auto hooks = gHooks.load(std::memory_order_acquire);
+      FOLLY_UNLIKELY(hooks != nullptr) && hooks->onDeallocate) {
+    hooks->onDeallocate(ptr, size, callsite);
+  }
+  const auto rounded = roundedSize(size);
+  auto& cache = tlCache;
+  if (cache.enabled && rounded <= kMaxRecycledFrameSize) {
+    ++cache.stats.deallocations;
+    if (cache.stats.cachedBytes + rounded <= cache.maxCachedBytes) {
+      auto& freeList = cache.freeLists[rounded / kSizeClassStep - 1];
+      auto frame = static_cast<FreeFrame*>(ptr);
+      frame->next = freeList;
+      freeList = frame;
+      cache.stats.cachedBytes += rounded;
+      return;
+    }
+    ++cache.stats.released;
+  }
+  folly::operator_delete(ptr, rounded);
+}
+
+} // namespace detail
+
+} // namespace folly::coro
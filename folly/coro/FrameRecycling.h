@@ -0,0 +1,103 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace folly::coro {
+
+/// Coroutine frame recycling
+///
+/// All coroutine frames of Task, AsyncGenerator, etc. are allocated through
+/// folly_coro_async_malloc() (see detail/Malloc.h). Code that creates many
+/// short-lived coroutines, e.g. a request handler that awaits dozens of
+/// nested Tasks, spends a noticeable share of its time in malloc/free for
+/// these frames.
+///
+/// Threads can opt in to keeping freed frames in a per-thread cache,
+/// bucketed by size in 16-byte steps, and reusing them for later frames of
+/// the same size class instead of going to malloc. Frames are plain heap
+/// blocks, so a frame allocated on one thread may be freed on another: it
+/// goes to the freeing thread's cache if that has recycling enabled and
+/// room left, and back to the heap otherwise. The cache of each thread is
+/// capped at maxCachedBytes and is released when the thread exits or
+/// disables recycling.
+///
+/// Recycling is typically enabled at the start of each executor thread:
+///
+///   folly::coro::enableFrameRecyclingForThisThread();
+///
+/// Frames larger than kMaxRecycledFrameSize are never cached.
+
+constexpr std::size_t kMaxRecycledFrameSize = 4096;
+constexpr std::size_t kDefaultFrameCacheBytes = 256 * 1024;
+
+void enableFrameRecyclingForThisThread(
+    std::size_t maxCachedBytes = kDefaultFrameCacheBytes);
+
+/// Releases all frames cached by this thread.
+void disableFrameRecyclingForThisThread();
+
+struct FrameRecyclingStats {
+  // Frames allocated by this thread while recycling was enabled, and how
+  // many of them reused a cached frame.
+  uint64_t allocations = 0;
+  uint64_t recycled = 0;
+  // Frames freed by this thread while recycling was enabled, and how many
+  // of them went to the heap because the cache was full.
+  uint64_t deallocations = 0;
+  uint64_t released = 0;
+  // Bytes currently held by this thread's cache.
+  std::size_t cachedBytes = 0;
+};
+
+FrameRecyclingStats getFrameRecyclingStatsForThisThread();
+
+/// Allocation accounting
+///
+/// If set, the hooks are called for every coroutine frame allocation and
+/// deallocation, with the size requested by the compiler and the return
+/// address of the allocation function. Since the promise's operator new and
+/// delete are inlined into the coroutine, the return address normally lies
+/// in the coroutine function itself (its ramp function for allocations, its
+/// destroy function for deallocations), so symbolizing it attributes frame
+/// bytes to individual coroutines.
+///
+/// Hooks may be called concurrently from any thread, and must not allocate
+/// coroutine frames themselves. The hooks object must outlive its
+/// installation.
+struct FrameAllocationHooks {
+  void (*onAllocate)(void* frame, std::size_t size, const void* callsite) =
+      nullptr;
+  void (*onDeallocate)(void* frame, std::size_t size, const void* callsite) =
+      nullptr;
+};
+
+/// Installs hooks, or removes them if hooks is nullptr. Returns the
+/// previously installed hooks.
+const FrameAllocationHooks* setFrameAllocationHooks(
+    const FrameAllocationHooks* hooks);
+
+namespace detail {
+
+void* allocateFrame(std::size_t size, const void* callsite);
+void deallocateFrame(void* ptr, std::size_t size, const void* callsite);
+
+} // namespace detail
+
+} // namespace folly::coro
@@ -0,0 +1,37 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/coro/SmallUnboundedQueue.h>
+
+#if FOLLY_HAS_COROUTINES
+
+namespace folly {
+namespace coro {
+
+// Unbounded multi-producer, single-consumer queue.
+//
+// Unlike coro::UnboundedQueue, there is no semaphore: see SmallUnboundedQueue.
+// dequeue(), dequeueBatch() and try_dequeue() must not be called
+// concurrently, and the queue must outlive any pending dequeue.
+template <typename T>
+using MpscQueue = SmallUnboundedQueue<T, /* SingleProducer */ false, true>;
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES
@@ -16,6 +16,16 @@
 
 #pragma once
 
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/CancellationToken.h>
+#include <folly/ScopeGuard.h>
 #include <folly/coro/Baton.h>
 #include <folly/coro/Coroutine.h>
 #include <folly/coro/Mutex.h>
@@ -30,10 +40,14 @@ namespace detail {
 template <bool UseMutex>
 struct SmallUnboundedQueueBase {
   auto co_scoped_lock() { return ready_awaitable(true); }
+  bool try_lock() { return true; }
+  void unlock() {}
 };
 template <>
 struct SmallUnboundedQueueBase<true> {
   auto co_scoped_lock() { return mutex_.co_scoped_lock(); }
+  bool try_lock() { return mutex_.try_lock(); }
+  void unlock() { mutex_.unlock(); }
   folly::coro::Mutex mutex_;
 };
 } // namespace detail
@@ -41,7 +55,13 @@ struct SmallUnboundedQueueBase<true> {
 // Alternative to coro::UnboundedQueue with much smaller memory size when empty
 // but lower throughput.
 // Substantially worse in multi-consumer case.
-// Only supports enqueue(T) and dequeue().
+// Supports enqueue(T), dequeue(), dequeueBatch() and try_dequeue(); size() is
+// not available, since producers don't maintain a shared counter.
+//
+// Producers push onto a lock-free list with a single CAS, and only wake the
+// consumer if it is parked waiting for values. The consumer takes everything
+// that was pushed with a single atomic exchange, and serves later dequeues
+// from that batch without touching shared state.
 
 template <typename T, bool SingleProducer = false, bool SingleConsumer = false>
 class SmallUnboundedQueue : detail::SmallUnboundedQueueBase<!SingleConsumer> {
@@ -59,12 +79,63 @@ class SmallUnboundedQueue : detail::SmallUnboundedQueueBase<!SingleConsumer> {
     queue_.push(T(std::forward<U>(val)));
   }
 
+  // Dequeue a value from the queue.
+  // Note that this operation can be safely cancelled by requesting cancellation
+  // on the awaiting coroutine's associated CancellationToken.
+  // If the operation is successfully cancelled then it will complete with
+  // an error of type folly::OperationCancelled.
   folly::coro::Task<T> dequeue() {
     [[maybe_unused]] auto maybeLock = co_await this->co_scoped_lock();
     if (buffer_.empty()) {
-      Consumer c;
-      if (queue_.wait(&c)) {
-        bool cancelled = false;
+      co_await waitForValues();
+    }
+    co_return popFront();
+  }
+
+  // Dequeue between 1 and maxItems values, waiting only if the queue is
+  // empty. Cancellation behaves as for dequeue().
+  folly::coro::Task<std::vector<T>> dequeueBatch(size_t maxItems) {
+    [[maybe_unused]] auto maybeLock = co_await this->co_scoped_lock();
+    if (buffer_.empty()) {
+      co_await waitForValues();
+    }
+    std::vector<T> items;
+    while (items.size() < maxItems) {
+      if (buffer_.empty()) {
+        buffer_ = queue_.getMessages();
+        if (buffer_.empty()) {
+          break;
+        }
+      }
+      items.push_back(popFront());
+    }
+    co_return items;
+  }
+
+  // Dequeue a value without waiting. With several consumers, this also fails
+  // if another consumer is dequeuing at the same time.
+  std::optional<T> try_dequeue() {
+    if (!this->try_lock()) {
+      return std::nullopt;
+    }
+    SCOPE_EXIT {
+      this->unlock();
+    };
+    if (buffer_.empty()) {
+      buffer_ = queue_.getMessages();
+      if (buffer_.empty()) {
+        return std::nullopt;
+      }
+    }
+    return popFront();
+  }
+
+ private:
+  folly::coro::Task<void> waitForValues() {
+    Consumer c;
+    if (queue_.wait(&c)) {
+      bool cancelled = false;
+      {
         CancellationCallback cb(co_await co_current_cancellation_token, [&] {
           if (queue_.cancelCallback()) {
             cancelled = true;
@@ -72,20 +143,21 @@ class SmallUnboundedQueue : detail::SmallUnboundedQueueBase<!SingleConsumer> {
           }
         });
         co_await c.baton;
-        if (cancelled) {
-          co_yield co_cancelled;
-        }
       }
-      buffer_ = queue_.getMessages();
-      DCHECK(!buffer_.empty());
+      if (cancelled) {
+        co_yield co_cancelled;
+      }
     }
-    SCOPE_EXIT {
-      buffer_.pop();
-    };
-    co_return std::move(buffer_.front());
+    buffer_ = queue_.getMessages();
+    DCHECK(!buffer_.empty());
+  }
+
+  T popFront() {
+    T item = std::move(buffer_.front());
+    buffer_.pop();
+    return item;
   }
 
- private:
   folly::channels::detail::AtomicQueue<Consumer, T> queue_;
   folly::channels::detail::Queue<T> buffer_;
 };
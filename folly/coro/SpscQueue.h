@@ -0,0 +1,198 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <folly/CancellationToken.h>
+#include <folly/ProducerConsumerQueue.h>
+#include <folly/coro/Baton.h>
+#include <folly/coro/Coroutine.h>
+#include <folly/coro/Task.h>
+
+#if FOLLY_HAS_COROUTINES
+
+namespace folly {
+namespace coro {
+
+// Bounded single-producer, single-consumer queue.
+//
+// Unlike coro::BoundedQueue<T, true, true>, which pairs a
+// ProducerConsumerQueue with two semaphores, each side here only signals the
+// other if it is actually parked: a side that finds the queue full (or empty)
+// publishes a Baton and re-checks the queue, and the other side posts that
+// Baton after its next write (or read). While both coroutines keep up, no
+// waiting or signaling takes place at all.
+//
+// Only one coroutine may enqueue and one coroutine may dequeue at a time, and
+// the queue must outlive any pending operation.
+
+template <typename T>
+class SpscQueue {
+ public:
+  explicit SpscQueue(uint32_t capacity) : queue_(queueSize(capacity)) {}
+
+  SpscQueue(const SpscQueue&) = delete;
+  SpscQueue& operator=(const SpscQueue&) = delete;
+
+  // Enqueue a value, waiting for space if the queue is full. Cancellation
+  // behaves as for dequeue().
+  template <typename U = T>
+  folly::coro::Task<void> enqueue(U&& item) {
+    if (queue_.isFull()) {
+      co_await waitUntil(producerWaiter_, [&] { return !queue_.isFull(); });
+    }
+    CHECK(queue_.write(std::forward<U>(item)));
+    notify(consumerWaiter_);
+  }
+
+  template <typename U = T>
+  bool try_enqueue(U&& item) {
+    if (!queue_.write(std::forward<U>(item))) {
+      return false;
+    }
+    notify(consumerWaiter_);
+    return true;
+  }
+
+  // Dequeue a value from the queue.
+  // Note that this operation can be safely cancelled by requesting cancellation
+  // on the awaiting coroutine's associated CancellationToken.
+  // If the operation is successfully cancelled then it will complete with
+  // an error of type folly::OperationCancelled.
+  folly::coro::Task<T> dequeue() {
+    if (queue_.isEmpty()) {
+      co_await waitUntil(consumerWaiter_, [&] { return !queue_.isEmpty(); });
+    }
+    co_return popFront();
+  }
+
+  // Dequeue between 1 and maxItems values, waiting only if the queue is
+  // empty. The producer is signaled at most once per batch. Cancellation
+  // behaves as for dequeue().
+  folly::coro::Task<std::vector<T>> dequeueBatch(size_t maxItems) {
+    if (queue_.isEmpty()) {
+      co_await waitUntil(consumerWaiter_, [&] { return !queue_.isEmpty(); });
+    }
+    std::vector<T> items;
+    items.reserve(std::min(maxItems, queue_.sizeGuess()));
+    while (items.size() < maxItems) {
+      auto* item = queue_.frontPtr();
+      if (!item) {
+        break;
+      }
+      items.push_back(std::move(*item));
+      queue_.popFront();
+    }
+    notify(producerWaiter_);
+    co_return items;
+  }
+
+  std::optional<T> try_dequeue() {
+    if (queue_.isEmpty()) {
+      return std::nullopt;
+    }
+    return popFront();
+  }
+
+  bool empty() const { return queue_.isEmpty(); }
+
+  size_t size() const { return queue_.sizeGuess(); }
+
+ private:
+  static uint32_t queueSize(uint32_t capacity) {
+    CHECK_GT(capacity, 0u) << "SpscQueue capacity must be positive";
+    CHECK_LT(capacity, std::numeric_limits<uint32_t>::max())
+        << "SpscQueue capacity is too large";
+    // One more slot, since the usable space of ProducerConsumerQueue is
+    // (size - 1).
+    return capacity + 1;
+  }
+
+  using Waiter = std::atomic<folly::coro::Baton*>;
+
+  T popFront() {
+    T item = std::move(*queue_.frontPtr());
+    queue_.popFront();
+    notify(producerWaiter_);
+    return item;
+  }
+
+  // Parks until ready() holds. The fence pairs with the one in notify(): either
+  // we see the other side's update to the queue, or it sees our Baton. A
+  // notify() that raced with an earlier wait may post a later Baton without
+  // there being anything new to see, so re-check after every wakeup.
+  template <typename Ready>
+  folly::coro::Task<void> waitUntil(Waiter& waiter, Ready ready) {
+    while (true) {
+      folly::coro::Baton baton;
+      waiter.store(&baton, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (ready()) {
+        if (waiter.exchange(nullptr, std::memory_order_acq_rel) != &baton) {
+          // The other side took the Baton and is about to post it.
+          co_await baton;
+        }
+        co_return;
+      }
+      bool cancelled = false;
+      {
+        CancellationCallback cb(co_await co_current_cancellation_token, [&] {
+          if (waiter.exchange(nullptr, std::memory_order_acq_rel) == &baton) {
+            cancelled = true;
+            baton.post();
+          }
+        });
+        co_await baton;
+      }
+      if (cancelled) {
+        co_yield co_cancelled;
+      }
+      if (ready()) {
+        co_return;
+      }
+    }
+  }
+
+  static void notify(Waiter& waiter) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiter.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+    if (auto* baton = waiter.exchange(nullptr, std::memory_order_acq_rel)) {
+      baton->post();
+    }
+  }
+
+  ProducerConsumerQueue<T> queue_;
+  Waiter producerWaiter_{nullptr};
+  Waiter consumerWaiter_{nullptr};
+};
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES
@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <folly/CancellationToken.h>
+#include <folly/SpinLock.h>
+#include <folly/coro/AsyncScope.h>
+#include <folly/coro/Coroutine.h>
+#include <folly/coro/CurrentExecutor.h>
+#include <folly/coro/Task.h>
+#include <folly/stats/StreamingStats.h>
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+#if FOLLY_HAS_COROUTINES
+
+namespace folly {
+namespace coro {
+
+/**
+ * TaskGroup is a CancellableAsyncScope that runs at most maxConcurrency of its
+ * tasks at a time.
+ *
+ * Tasks added while the limit is reached are queued without being started, so
+ * a waiting task costs a queue entry rather than a suspended coroutine blocked
+ * on a semaphore. Whenever a task completes, the oldest queued task is started
+ * in its place.
+ *
+ * The group also keeps statistics about its tasks: how many are running and
+ * queued, and the time completed tasks spent queued and running.
+ *
+ * Cancellation is cooperative, as for CancellableAsyncScope: running tasks are
+ * provided a cancellation token, and queued tasks are discarded without ever
+ * being started once cancellation is requested.
+ *
+ * @class folly::coro::TaskGroup
+ */
+//
+// Example:
+//    folly::coro::TaskGroup group(16);
+//    for (auto& request : requests) {
+//      group.add(handle(request).scheduleOn(folly::getGlobalCPUExecutor()));
+//    }
+//    co_await group.joinAsync();
+//    LOG(INFO) << "mean queueing delay: "
+//              << group.getStats().queueDelayUs.mean() << "us";
+//
+class TaskGroup {
+ public:
+  struct Stats {
+    // Tasks started and not yet completed.
+    size_t running{0};
+    // Tasks waiting for one of the running tasks to complete.
+    size_t queued{0};
+    // Largest number of tasks that were queued at the same time.
+    size_t maxQueued{0};
+    size_t completed{0};
+    // Queued tasks discarded because cancellation was requested.
+    size_t dropped{0};
+    // Time completed tasks spent queued and running, in microseconds.
+    StreamingStats<int64_t> queueDelayUs;
+    StreamingStats<int64_t> runTimeUs;
+
+    size_t outstanding() const noexcept { return running + queued; }
+  };
+
+  explicit TaskGroup(size_t maxConcurrency, bool throwOnJoin = false) noexcept
+      : maxConcurrency_(maxConcurrency), scope_(throwOnJoin) {
+    CHECK_GT(maxConcurrency_, 0u);
+  }
+
+  TaskGroup(
+      size_t maxConcurrency,
+      CancellationToken&& token,
+      bool throwOnJoin = false)
+      : maxConcurrency_(maxConcurrency), scope_(std::move(token), throwOnJoin) {
+    CHECK_GT(maxConcurrency_, 0u);
+  }
+
+  TaskGroup(const TaskGroup&) = delete;
+  TaskGroup& operator=(const TaskGroup&) = delete;
+
+  size_t maxConcurrency() const noexcept { return maxConcurrency_; }
+
+  /**
+   * Start the task on its executor if fewer than maxConcurrency tasks are
+   * running, and queue it otherwise.
+   *
+   * The rules of AsyncScope::add() apply: the task must handle its errors, and
+   * no tasks may be added once joinAsync() or cancelAndJoinAsync() completed.
+   */
+  void add(TaskWithExecutor<void>&& task) {
+    auto queuedAt = Clock::now();
+    {
+      std::lock_guard<SpinLock> g(mutex_);
+      if (stats_.running == maxConcurrency_) {
+        queue_.push_back(Queued{std::move(task), queuedAt});
+        stats_.queued = queue_.size();
+        stats_.maxQueued = std::max(stats_.maxQueued, stats_.queued);
+        return;
+      }
+      ++stats_.running;
+    }
+    start(std::move(task), queuedAt);
+  }
+
+  /**
+   * Schedules the given task on the current executor and adds it to the group.
+   */
+  Task<void> co_schedule(Task<void>&& task) {
+    add(std::move(task).scheduleOn(co_await co_current_executor));
+  }
+
+  /**
+   * Request cancellation for all running tasks, and discard all queued ones.
+   */
+  void requestCancellation() noexcept {
+    scope_.requestCancellation();
+    dropQueued();
+  }
+
+  bool isCancellationRequested() const noexcept {
+    return scope_.isScopeCancellationRequested();
+  }
+
+  /**
+   * Asynchronously wait for all running and queued tasks to complete.
+   *
+   * Either call this method _or_ cancelAndJoinAsync() to join the work. It is
+   * invalid to call both of them.
+   */
+  Task<void> joinAsync() noexcept { return scope_.joinAsync(); }
+
+  /**
+   * Request cancellation and asynchronously wait for all running tasks to
+   * complete.
+   */
+  Task<void> cancelAndJoinAsync() noexcept {
+    requestCancellation();
+    return scope_.joinAsync();
+  }
+
+  Stats getStats() const {
+    std::lock_guard<SpinLock> g(mutex_);
+    return stats_;
+  }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  // A task waiting to be started. It is only wrapped by run() once started,
+  // so that it doesn't hold an extra coroutine frame while queued.
+  struct Queued {
+    TaskWithExecutor<void> task;
+    Clock::time_point queuedAt;
+  };
+
+  static int64_t toMicros(Clock::duration d) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+  }
+
+  void start(TaskWithExecutor<void>&& task, Clock::time_point queuedAt) {
+    auto [inner, executor] = std::move(task).unwrap();
+    scope_.add(run(std::move(inner), queuedAt).scheduleOn(std::move(executor)));
+  }
+
+  Task<void> run(Task<void> task, Clock::time_point queuedAt) {
+    auto startedAt = Clock::now();
+    auto result = co_await co_awaitTry(std::move(task));
+    onTaskDone(queuedAt, startedAt, Clock::now());
+    if (result.hasException()) {
+      co_yield co_error(std::move(result).exception());
+    }
+  }
+
+  void onTaskDone(
+      Clock::time_point queuedAt,
+      Clock::time_point startedAt,
+      Clock::time_point finishedAt) {
+    if (isCancellationRequested()) {
+      // The scope may have been cancelled through the token passed in.
+      dropQueued();
+    }
+    std::optional<Queued> next;
+    {
+      std::lock_guard<SpinLock> g(mutex_);
+      ++stats_.completed;
+      stats_.queueDelayUs.add(toMicros(startedAt - queuedAt));
+      stats_.runTimeUs.add(toMicros(finishedAt - startedAt));
+      if (queue_.empty()) {
+        --stats_.running;
+      } else {
+        next.emplace(std::move(queue_.front()));
+        queue_.pop_front();
+        stats_.queued = queue_.size();
+      }
+    }
+    if (next) {
+      // Started before this task completes, so that the scope can't be joined
+      // in between.
+      start(std::move(next->task), next->queuedAt);
+    }
+  }
+
+  void dropQueued() noexcept {
+    std::deque<Queued> dropped;
+    {
+      std::lock_guard<SpinLock> g(mutex_);
+      dropped.swap(queue_);
+      stats_.dropped += dropped.size();
+      stats_.queued = 0;
+    }
+  }
+
+  const size_t maxConcurrency_;
+  CancellableAsyncScope scope_;
+  mutable SpinLock mutex_;
+  std::deque<Queued> queue_;
+  Stats stats_;
+};
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES
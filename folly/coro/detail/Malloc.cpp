@@ -16,17 +16,19 @@
 
 #include <folly/coro/detail/Malloc.h>
 
+#include <folly/coro/FrameRecycling.h>
 #include <folly/lang/Hint.h>
-#include <folly/lang/New.h>
+#include <folly/portability/Builtins.h>
 
 extern "C" {
 
 FOLLY_NOINLINE
 void* folly_coro_async_malloc(std::size_t size) {
-  auto p = folly::operator_new(size);
+  auto p = folly::coro::detail::allocateFrame(
+      size, __builtin_return_address(0));
 
   // Add this after the call to prevent the compiler from
-  // turning the call to operator new() into a tailcall.
+  // turning the call to allocateFrame() into a tailcall.
   folly::compiler_must_not_elide(p);
 
   return p;
@@ -34,10 +36,11 @@ void* folly_coro_async_malloc(std::size_t size) {
 
 FOLLY_NOINLINE
 void folly_coro_async_free(void* ptr, std::size_t size) {
-  folly::operator_delete(ptr, size);
+  folly::coro::detail::deallocateFrame(
+      ptr, size, __builtin_return_address(0));
 
   // Add this after the call to prevent the compiler from
-  // turning the call to operator delete() into a tailcall.
+  // turning the call to deallocateFrame() into a tailcall.
   folly::compiler_must_not_elide(size);
 }
 } // extern "C"
@@ -25,6 +25,8 @@ extern "C" {
 // Heap allocations for coroutine-frames for all async coroutines
 // (Task, AsyncGenerator, etc.) should be funneled through these
 // functions to allow better tracing/profiling of coroutine allocations.
+// They implement the optional frame recycling and allocation hooks of
+// folly/coro/FrameRecycling.h.
 FOLLY_NOINLINE
 void* folly_coro_async_malloc(std::size_t size);
 
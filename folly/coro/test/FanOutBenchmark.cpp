@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Portability.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/FanOut.h>
+#include <folly/coro/Task.h>
+#include <folly/portability/GFlags.h>
+
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly;
+
+namespace {
+
+coro::Task<int> child(int i) {
+  co_return i;
+}
+
+std::vector<coro::Task<int>> makeChildren(size_t fanOut) {
+  std::vector<coro::Task<int>> children;
+  children.reserve(fanOut);
+  for (size_t i = 0; i < fanOut; ++i) {
+    children.push_back(child(static_cast<int>(i)));
+  }
+  return children;
+}
+
+} // namespace
+
+void collectAll(size_t iters, size_t fanOut) {
+  while (iters--) {
+    coro::blockingWait([&]() -> coro::Task<void> {
+      auto results = co_await coro::collectAllRange(makeChildren(fanOut));
+      doNotOptimizeAway(results);
+    }());
+  }
+}
+
+void collectEach(size_t iters, size_t fanOut) {
+  while (iters--) {
+    coro::blockingWait([&]() -> coro::Task<void> {
+      int64_t sum = 0;
+      co_await coro::collectEachRange(
+          makeChildren(fanOut),
+          [&](size_t, Try<int>&& result) { sum += *result; });
+      doNotOptimizeAway(sum);
+    }());
+  }
+}
+
+void collectAny(size_t iters, size_t fanOut) {
+  while (iters--) {
+    coro::blockingWait([&]() -> coro::Task<void> {
+      auto result = co_await coro::collectAnyRange(makeChildren(fanOut));
+      doNotOptimizeAway(result);
+    }());
+  }
+}
+
+void collectFirstOne(size_t iters, size_t fanOut) {
+  while (iters--) {
+    coro::blockingWait([&]() -> coro::Task<void> {
+      auto results =
+          co_await coro::collectFirstNRange(makeChildren(fanOut), 1);
+      doNotOptimizeAway(results);
+    }());
+  }
+}
+
+BENCHMARK_NAMED_PARAM(collectAll, 10, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectEach, 10, 10)
+BENCHMARK_NAMED_PARAM(collectAll, 100, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectEach, 100, 100)
+BENCHMARK_NAMED_PARAM(collectAll, 10k, 10000)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectEach, 10k, 10000)
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_NAMED_PARAM(collectAny, 10, 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectFirstOne, 10, 10)
+BENCHMARK_NAMED_PARAM(collectAny, 100, 100)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectFirstOne, 100, 100)
+BENCHMARK_NAMED_PARAM(collectAny, 10k, 10000)
+BENCHMARK_RELATIVE_NAMED_PARAM(collectFirstOne, 10k, 10000)
+
+#endif
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
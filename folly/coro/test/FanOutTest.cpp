@@ -0,0 +1,252 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/FanOut.h>
+#include <folly/coro/Generator.h>
+#include <folly/coro/GtestHelpers.h>
+#include <folly/coro/Invoke.h>
+#include <folly/coro/Sleep.h>
+#include <folly/coro/Task.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/portability/GTest.h>
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct ErrorA : std::exception {};
+
+coro::Task<int> rescheduleThenReturn(int numReschedules, int value) {
+  for (int i = 0; i < numReschedules; ++i) {
+    co_await coro::co_reschedule_on_current_executor;
+  }
+  co_return value;
+}
+
+coro::Task<int> throwAfterReschedule() {
+  co_await coro::co_reschedule_on_current_executor;
+  throw ErrorA{};
+}
+
+coro::Task<int> sleepThenReturn(int value) {
+  co_await coro::sleep(10s);
+  co_return value;
+}
+
+} // namespace
+
+CO_TEST(CollectEachRangeTest, EmptyRange) {
+  std::vector<coro::Task<int>> tasks;
+  size_t count = 0;
+  co_await coro::collectEachRange(
+      std::move(tasks), [&](size_t, Try<int>&&) { ++count; });
+  EXPECT_EQ(0, count);
+}
+
+CO_TEST(CollectEachRangeTest, DeliversEachResult) {
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 100; ++i) {
+    tasks.push_back(rescheduleThenReturn(i % 3, i * 10));
+  }
+  std::vector<int> results(100, -1);
+  co_await coro::collectEachRange(
+      std::move(tasks), [&](size_t index, Try<int>&& result) {
+        results[index] = result.value();
+      });
+  for (int i = 0; i < 100; ++i) {
+    EXPECT_EQ(i * 10, results[i]);
+  }
+}
+
+CO_TEST(CollectEachRangeTest, DeliversInCompletionOrder) {
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 5; ++i) {
+    tasks.push_back(rescheduleThenReturn(5 - i, i));
+  }
+  std::vector<size_t> order;
+  co_await coro::collectEachRange(
+      std::move(tasks),
+      [&](size_t index, Try<int>&&) { order.push_back(index); });
+  EXPECT_EQ((std::vector<size_t>{4, 3, 2, 1, 0}), order);
+}
+
+CO_TEST(CollectEachRangeTest, DeliversExceptions) {
+  std::vector<coro::Task<int>> tasks;
+  tasks.push_back(rescheduleThenReturn(1, 1));
+  tasks.push_back(throwAfterReschedule());
+  size_t numValues = 0;
+  size_t numExceptions = 0;
+  co_await coro::collectEachRange(
+      std::move(tasks), [&](size_t index, Try<int>&& result) {
+        if (index == 1) {
+          EXPECT_TRUE(result.hasException<ErrorA>());
+          ++numExceptions;
+        } else {
+          EXPECT_EQ(1, result.value());
+          ++numValues;
+        }
+      });
+  EXPECT_EQ(1, numValues);
+  EXPECT_EQ(1, numExceptions);
+}
+
+CO_TEST(CollectEachRangeTest, StopCancelsRemaining) {
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 10; ++i) {
+    tasks.push_back(sleepThenReturn(i));
+  }
+  tasks.push_back(rescheduleThenReturn(1, 42));
+  size_t count = 0;
+  auto start = std::chrono::steady_clock::now();
+  co_await coro::collectEachRange(
+      std::move(tasks), [&](size_t, Try<int>&& result) {
+        ++count;
+        EXPECT_EQ(42, result.value());
+        return false;
+      });
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  EXPECT_EQ(1, count);
+}
+
+CO_TEST(CollectEachRangeTest, RethrowsCallbackException) {
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 10; ++i) {
+    tasks.push_back(sleepThenReturn(i));
+  }
+  tasks.push_back(rescheduleThenReturn(1, 42));
+  size_t count = 0;
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_THROW(
+      co_await coro::collectEachRange(
+          std::move(tasks),
+          [&](size_t, Try<int>&&) {
+            ++count;
+            throw ErrorA{};
+          }),
+      ErrorA);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  EXPECT_EQ(1, count);
+}
+
+CO_TEST(CollectEachRangeTest, SinglePassRange) {
+  auto generateTasks = []() -> coro::Generator<coro::Task<void>&&> {
+    for (int i = 0; i < 10; ++i) {
+      co_yield []() -> coro::Task<void> {
+        co_await coro::co_reschedule_on_current_executor;
+      }();
+    }
+  };
+  size_t count = 0;
+  co_await coro::collectEachRange(
+      generateTasks(), [&](size_t index, Try<void>&& result) {
+        EXPECT_LT(index, 10);
+        EXPECT_TRUE(result.hasValue());
+        ++count;
+      });
+  EXPECT_EQ(10, count);
+}
+
+CO_TEST(CollectEachRangeTest, SubtasksCancelledWhenParentTaskCancelled) {
+  CancellationSource cancelSource;
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 10; ++i) {
+    tasks.push_back(sleepThenReturn(i));
+  }
+  tasks.push_back(coro::co_invoke([&]() -> coro::Task<int> {
+    co_await coro::co_reschedule_on_current_executor;
+    cancelSource.requestCancellation();
+    co_return 0;
+  }));
+  size_t numCancelled = 0;
+  auto start = std::chrono::steady_clock::now();
+  co_await coro::co_withCancellation(
+      cancelSource.getToken(),
+      coro::collectEachRange(std::move(tasks), [&](size_t, Try<int>&& result) {
+        numCancelled += result.hasException<OperationCancelled>();
+      }));
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  EXPECT_EQ(10, numCancelled);
+}
+
+TEST(CollectEachRangeTest, CallbackNotCalledConcurrently) {
+  CPUThreadPoolExecutor executor(4);
+  std::vector<coro::Task<int>> tasks;
+  for (int i = 0; i < 1000; ++i) {
+    tasks.push_back(rescheduleThenReturn(i % 4, i));
+  }
+  std::atomic<bool> inCallback{false};
+  size_t count = 0;
+  int64_t sum = 0;
+  coro::blockingWait(co_withExecutor(
+      &executor,
+      coro::collectEachRange(std::move(tasks), [&](size_t, Try<int>&& result) {
+        EXPECT_FALSE(inCallback.exchange(true));
+        ++count;
+        sum += result.value();
+        inCallback = false;
+      })));
+  EXPECT_EQ(1000, count);
+  EXPECT_EQ(999 * 1000 / 2, sum);
+}
+
+CO_TEST(CollectFirstNRangeTest, ReturnsFirstNSuccesses) {
+  std::vector<coro::Task<int>> tasks;
+  tasks.push_back(sleepThenReturn(0));
+  tasks.push_back(rescheduleThenReturn(2, 1));
+  tasks.push_back(throwAfterReschedule());
+  tasks.push_back(sleepThenReturn(3));
+  tasks.push_back(rescheduleThenReturn(1, 4));
+  auto start = std::chrono::steady_clock::now();
+  auto results = co_await coro::collectFirstNRange(std::move(tasks), 2);
+  EXPECT_LT(std::chrono::steady_clock::now() - start, 1s);
+  CO_ASSERT_EQ(2, results.size());
+  EXPECT_EQ(4, results[0].first);
+  EXPECT_EQ(4, results[0].second);
+  EXPECT_EQ(1, results[1].first);
+  EXPECT_EQ(1, results[1].second);
+}
+
+CO_TEST(CollectFirstNRangeTest, ThrowsIfTooFewSucceed) {
+  std::vector<coro::Task<int>> tasks;
+  tasks.push_back(rescheduleThenReturn(1, 0));
+  tasks.push_back(throwAfterReschedule());
+  EXPECT_THROW(
+      co_await coro::collectFirstNRange(std::move(tasks), 2), ErrorA);
+}
+
+CO_TEST(CollectFirstNRangeTest, VoidTasks) {
+  std::vector<coro::Task<void>> tasks;
+  for (int i = 0; i < 3; ++i) {
+    tasks.push_back([]() -> coro::Task<void> {
+      co_await coro::co_reschedule_on_current_executor;
+    }());
+  }
+  auto results = co_await coro::collectFirstNRange(std::move(tasks), 2);
+  EXPECT_EQ(2, results.size());
+}
+
+#endif
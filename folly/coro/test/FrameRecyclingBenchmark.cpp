@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Portability.h>
+
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/FrameRecycling.h>
+#include <folly/coro/Task.h>
+
+#if FOLLY_HAS_COROUTINES
+
+static folly::coro::Task<size_t> nestedCalls(size_t depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await nestedCalls(depth - 1);
+}
+
+static void benchNestedCalls(size_t depth, size_t iters, bool recycle) {
+  folly::BenchmarkSuspender suspender;
+  if (recycle) {
+    folly::coro::enableFrameRecyclingForThisThread();
+  }
+  suspender.dismissing([&] {
+    folly::coro::blockingWait([depth, iters]() -> folly::coro::Task<void> {
+      for (size_t i = 0; i < iters; ++i) {
+        folly::doNotOptimizeAway(co_await nestedCalls(depth));
+      }
+    }());
+  });
+  folly::coro::disableFrameRecyclingForThisThread();
+}
+
+BENCHMARK(NestedCalls3, iters) {
+  benchNestedCalls(3, iters / 3, false);
+}
+
+BENCHMARK_RELATIVE(NestedCalls3Recycled, iters) {
+  benchNestedCalls(3, iters / 3, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(NestedCalls10, iters) {
+  benchNestedCalls(10, iters / 10, false);
+}
+
+BENCHMARK_RELATIVE(NestedCalls10Recycled, iters) {
+  benchNestedCalls(10, iters / 10, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(NestedCalls50, iters) {
+  benchNestedCalls(50, iters / 50, false);
+}
+
+BENCHMARK_RELATIVE(NestedCalls50Recycled, iters) {
+  benchNestedCalls(50, iters / 50, true);
+}
+
+#endif // FOLLY_HAS_COROUTINES
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/FrameRecycling.h>
+#include <folly/coro/Task.h>
+#include <folly/portability/GTest.h>
+
+#include <atomic>
+#include <optional>
+#include <thread>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly::coro;
+
+namespace {
+
+Task<int> nested(int depth) {
+  if (depth == 0) {
+    co_return 0;
+  }
+  co_return 1 + co_await nested(depth - 1);
+}
+
+std::atomic<size_t> gAllocated{0};
+std::atomic<size_t> gDeallocated{0};
+std::atomic<size_t> gLiveBytes{0};
+
+void onAllocate(void*, std::size_t size, const void* callsite) {
+  EXPECT_NE(nullptr, callsite);
+  gAllocated.fetch_add(1);
+  gLiveBytes.fetch_add(size);
+}
+
+void onDeallocate(void*, std::size_t size, const void*) {
+  gDeallocated.fetch_add(1);
+  gLiveBytes.fetch_sub(size);
+}
+
+class FrameRecyclingTest : public testing::Test {
+ protected:
+  void TearDown() override { disableFrameRecyclingForThisThread(); }
+};
+
+} // namespace
+
+TEST_F(FrameRecyclingTest, DisabledByDefault) {
+  EXPECT_EQ(5, blockingWait(nested(5)));
+  auto stats = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(0u, stats.allocations);
+  EXPECT_EQ(0u, stats.cachedBytes);
+}
+
+TEST_F(FrameRecyclingTest, Recycles) {
+  enableFrameRecyclingForThisThread();
+  auto before = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(10, blockingWait(nested(10)));
+  auto first = getFrameRecyclingStatsForThisThread();
+  EXPECT_LE(11u, first.allocations - before.allocations);
+  EXPECT_LT(0u, first.cachedBytes);
+
+  // The second run reuses the frames of the first.
+  EXPECT_EQ(10, blockingWait(nested(10)));
+  auto second = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(
+      first.allocations - before.allocations,
+      second.allocations - first.allocations);
+  EXPECT_EQ(
+      second.allocations - first.allocations,
+      second.recycled - first.recycled);
+  EXPECT_EQ(first.cachedBytes, second.cachedBytes);
+
+  disableFrameRecyclingForThisThread();
+  EXPECT_EQ(0u, getFrameRecyclingStatsForThisThread().cachedBytes);
+}
+
+TEST_F(FrameRecyclingTest, CacheIsCapped) {
+  enableFrameRecyclingForThisThread(1);
+  auto before = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(10, blockingWait(nested(10)));
+  auto after = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(0u, after.cachedBytes);
+  EXPECT_EQ(0u, after.recycled - before.recycled);
+  EXPECT_EQ(
+      after.deallocations - before.deallocations,
+      after.released - before.released);
+}
+
+TEST_F(FrameRecyclingTest, CrossThreadFree) {
+  std::optional<Task<int>> task;
+  // A frame allocated by a thread without recycling ...
+  std::thread([&] { task.emplace(nested(0)); }).join();
+
+  // ... can be cached by a thread with recycling enabled ...
+  enableFrameRecyclingForThisThread();
+  auto before = getFrameRecyclingStatsForThisThread();
+  task.reset();
+  auto after = getFrameRecyclingStatsForThisThread();
+  EXPECT_EQ(1u, after.deallocations - before.deallocations);
+  EXPECT_LT(before.cachedBytes, after.cachedBytes);
+
+  // ... and reused for another frame of the same size.
+  task.emplace(nested(0));
+  EXPECT_EQ(
+      1u, getFrameRecyclingStatsForThisThread().recycled - after.recycled);
+
+  // A frame allocated by a recycling thread can be freed by any thread.
+  std::thread([&] { task.reset(); }).join();
+  EXPECT_EQ(0, blockingWait(nested(0)));
+}
+
+TEST_F(FrameRecyclingTest, Hooks) {
+  FrameAllocationHooks hooks;
+  hooks.onAllocate = onAllocate;
+  hooks.onDeallocate = onDeallocate;
+  EXPECT_EQ(nullptr, setFrameAllocationHooks(&hooks));
+  EXPECT_EQ(4, blockingWait(nested(4)));
+  EXPECT_EQ(&hooks, setFrameAllocationHooks(nullptr));
+
+  EXPECT_LE(5u, gAllocated.load());
+  EXPECT_EQ(gAllocated.load(), gDeallocated.load());
+  EXPECT_EQ(0u, gLiveBytes.load());
+}
+
+#endif
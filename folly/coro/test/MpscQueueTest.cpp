@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/CancellationToken.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/MpscQueue.h>
+#include <folly/executors/ManualExecutor.h>
+
+#include <folly/portability/GTest.h>
+
+#include <string>
+#include <thread>
+
+#if FOLLY_HAS_COROUTINES
+
+TEST(MpscQueueTest, EnqueueDeque) {
+  folly::coro::MpscQueue<std::string> queue;
+  constexpr auto val = "a string";
+  std::string val1 = val;
+  queue.enqueue(val1);
+  queue.enqueue(std::move(val1));
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    for (int i = 0; i < 2; ++i) {
+      auto val2 = co_await queue.dequeue();
+      EXPECT_EQ(val2, val);
+    }
+  }());
+  EXPECT_EQ(queue.try_dequeue(), std::nullopt);
+}
+
+TEST(MpscQueueTest, DequeueWhileBlocking) {
+  folly::coro::MpscQueue<int> queue;
+  folly::ManualExecutor ex;
+
+  auto fut = queue.dequeue().scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(fut.isReady());
+
+  queue.enqueue(0);
+  ex.drain();
+  EXPECT_TRUE(fut.isReady());
+  EXPECT_EQ(std::move(fut).get(), 0);
+}
+
+TEST(MpscQueueTest, DequeueBatch) {
+  folly::coro::MpscQueue<int> queue;
+  for (int i = 0; i < 10; ++i) {
+    queue.enqueue(i);
+  }
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    std::vector<int> expected{0, 1, 2, 3};
+    EXPECT_EQ(co_await queue.dequeueBatch(4), expected);
+    EXPECT_EQ(co_await queue.dequeue(), 4);
+    queue.enqueue(10);
+    expected = {5, 6, 7, 8, 9, 10};
+    EXPECT_EQ(co_await queue.dequeueBatch(100), expected);
+  }());
+
+  folly::ManualExecutor ex;
+  auto fut = queue.dequeueBatch(4).scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(fut.isReady());
+  queue.enqueue(11);
+  ex.drain();
+  EXPECT_EQ(std::move(fut).get(), std::vector<int>({11}));
+}
+
+TEST(MpscQueueTest, EnqueueDequeMultiProducer) {
+  folly::coro::MpscQueue<int> queue;
+  std::atomic<int> i = 0;
+
+  std::vector<std::thread> enqueuers;
+  for (int n = 0; n < 5; ++n) {
+    enqueuers.emplace_back([&] {
+      while (true) {
+        int next = i++;
+        if (next >= 10000) {
+          break;
+        }
+        queue.enqueue(next);
+      }
+    });
+  }
+
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    std::vector<bool> seen(10000);
+    for (int n = 0; n < 10000;) {
+      for (auto value : co_await queue.dequeueBatch(64)) {
+        EXPECT_FALSE(seen[value]);
+        seen[value] = true;
+        ++n;
+      }
+    }
+  }());
+
+  for (int n = 0; n < 5; ++n) {
+    enqueuers[n].join();
+  }
+}
+
+TEST(MpscQueueTest, CancelledDequeueThrowsOperationCancelled) {
+  folly::coro::blockingWait([]() -> folly::coro::Task<void> {
+    folly::coro::MpscQueue<int> queue;
+    folly::CancellationSource cancelSource;
+
+    co_await folly::coro::collectAll(
+        [&]() -> folly::coro::Task<void> {
+          EXPECT_THROW(
+              (co_await folly::coro::co_withCancellation(
+                  cancelSource.getToken(), queue.dequeueBatch(10))),
+              folly::OperationCancelled);
+        }(),
+        [&]() -> folly::coro::Task<void> {
+          co_await folly::coro::co_reschedule_on_current_executor;
+          co_await folly::coro::co_reschedule_on_current_executor;
+          cancelSource.requestCancellation();
+        }());
+
+    // The queue is still usable after a cancelled dequeue.
+    queue.enqueue(1);
+    EXPECT_EQ(co_await queue.dequeue(), 1);
+  }());
+}
+
+TEST(MpscQueueTest, CancelledDequeueCompletesNormallyIfAnItemIsAvailable) {
+  folly::coro::blockingWait([]() -> folly::coro::Task<void> {
+    folly::coro::MpscQueue<int> queue;
+    folly::CancellationSource cancelSource;
+    cancelSource.requestCancellation();
+
+    queue.enqueue(123);
+
+    int result = co_await folly::coro::co_withCancellation(
+        cancelSource.getToken(), queue.dequeue());
+    EXPECT_EQ(123, result);
+  }());
+}
+#endif
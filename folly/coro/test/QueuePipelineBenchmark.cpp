@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Portability.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/BoundedQueue.h>
+#include <folly/coro/MpscQueue.h>
+#include <folly/coro/SpscQueue.h>
+#include <folly/coro/Task.h>
+#include <folly/coro/UnboundedQueue.h>
+#include <folly/portability/GFlags.h>
+
+#include <thread>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly;
+
+// Two-stage pipeline: a producer thread pushes `iters` ints, which a consumer
+// coroutine on the benchmark thread sums up.
+
+namespace {
+
+constexpr uint32_t kCapacity = 1024;
+constexpr size_t kBatchSize = 64;
+
+template <typename Queue, typename Produce, typename Consume>
+void pipeline(size_t iters, Queue& queue, Produce produce, Consume consume) {
+  std::thread producer([&] {
+    coro::blockingWait([&]() -> coro::Task<void> {
+      for (size_t i = 0; i < iters; ++i) {
+        co_await produce(queue, static_cast<int>(i));
+      }
+    }());
+  });
+  coro::blockingWait([&]() -> coro::Task<void> {
+    int64_t sum = 0;
+    for (size_t received = 0; received < iters;) {
+      received += co_await consume(queue, sum);
+    }
+    doNotOptimizeAway(sum);
+  }());
+  producer.join();
+}
+
+template <typename Queue>
+coro::Task<void> enqueueSync(Queue& queue, int value) {
+  queue.enqueue(value);
+  co_return;
+}
+
+template <typename Queue>
+coro::Task<void> enqueueAsync(Queue& queue, int value) {
+  co_await queue.enqueue(value);
+}
+
+template <typename Queue>
+coro::Task<size_t> dequeueOne(Queue& queue, int64_t& sum) {
+  sum += co_await queue.dequeue();
+  co_return 1;
+}
+
+template <typename Queue>
+coro::Task<size_t> dequeueBatch(Queue& queue, int64_t& sum) {
+  auto values = co_await queue.dequeueBatch(kBatchSize);
+  for (auto value : values) {
+    sum += value;
+  }
+  co_return values.size();
+}
+
+} // namespace
+
+BENCHMARK(UnboundedQueueSpsc, iters) {
+  coro::UnboundedQueue<int, true, true> queue;
+  pipeline(
+      iters, queue, enqueueSync<decltype(queue)>, dequeueOne<decltype(queue)>);
+}
+
+BENCHMARK_RELATIVE(MpscQueue, iters) {
+  coro::MpscQueue<int> queue;
+  pipeline(
+      iters, queue, enqueueSync<decltype(queue)>, dequeueOne<decltype(queue)>);
+}
+
+BENCHMARK_RELATIVE(MpscQueueBatch, iters) {
+  coro::MpscQueue<int> queue;
+  pipeline(
+      iters,
+      queue,
+      enqueueSync<decltype(queue)>,
+      dequeueBatch<decltype(queue)>);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(BoundedQueueSpsc, iters) {
+  coro::BoundedQueue<int, true, true> queue(kCapacity);
+  pipeline(
+      iters, queue, enqueueAsync<decltype(queue)>, dequeueOne<decltype(queue)>);
+}
+
+BENCHMARK_RELATIVE(SpscQueue, iters) {
+  coro::SpscQueue<int> queue(kCapacity);
+  pipeline(
+      iters, queue, enqueueAsync<decltype(queue)>, dequeueOne<decltype(queue)>);
+}
+
+BENCHMARK_RELATIVE(SpscQueueBatch, iters) {
+  coro::SpscQueue<int> queue(kCapacity);
+  pipeline(
+      iters,
+      queue,
+      enqueueAsync<decltype(queue)>,
+      dequeueBatch<decltype(queue)>);
+}
+
+#endif
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -23,8 +23,10 @@
 
 #include <folly/portability/GTest.h>
 
+#include <optional>
 #include <string>
 #include <thread>
+#include <vector>
 
 #if FOLLY_HAS_COROUTINES
 
@@ -178,4 +180,18 @@ TEST(
     EXPECT_EQ(123, result);
   }());
 }
+
+TEST(SmallUnboundedQueueTest, DequeueBatchMultiConsumer) {
+  folly::coro::SmallUnboundedQueue<int> queue;
+  EXPECT_EQ(queue.try_dequeue(), std::nullopt);
+  for (int i = 0; i < 5; ++i) {
+    queue.enqueue(i);
+  }
+  EXPECT_EQ(queue.try_dequeue(), 0);
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    EXPECT_EQ(co_await queue.dequeueBatch(3), (std::vector<int>{1, 2, 3}));
+    EXPECT_EQ(co_await queue.dequeueBatch(3), (std::vector<int>{4}));
+  }());
+  EXPECT_EQ(queue.try_dequeue(), std::nullopt);
+}
 #endif
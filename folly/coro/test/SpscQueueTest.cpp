@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/CancellationToken.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/SpscQueue.h>
+#include <folly/executors/ManualExecutor.h>
+
+#include <folly/portability/GTest.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <thread>
+
+#if FOLLY_HAS_COROUTINES
+
+TEST(SpscQueueTest, EnqueueDeque) {
+  folly::coro::SpscQueue<std::string> queue(10);
+  constexpr auto val = "a string";
+  std::string val1 = val;
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.size(), 0);
+
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    co_await queue.enqueue(val1);
+    EXPECT_FALSE(queue.empty());
+    co_await queue.enqueue(std::move(val1));
+    EXPECT_EQ(queue.size(), 2);
+
+    for (int i = 0; i < 2; ++i) {
+      auto val2 = co_await queue.dequeue();
+      EXPECT_EQ(val2, val);
+    }
+  }());
+  EXPECT_TRUE(queue.empty());
+  EXPECT_EQ(queue.try_dequeue(), std::nullopt);
+}
+
+TEST(SpscQueueTest, InvalidCapacity) {
+  EXPECT_DEATH(folly::coro::SpscQueue<int>(0), "capacity must be positive");
+  EXPECT_DEATH(
+      folly::coro::SpscQueue<int>(std::numeric_limits<uint32_t>::max()),
+      "capacity is too large");
+  folly::coro::SpscQueue<int> queue(1);
+  EXPECT_TRUE(queue.try_enqueue(1));
+  EXPECT_FALSE(queue.try_enqueue(2));
+}
+
+TEST(SpscQueueTest, DequeueWhileBlocking) {
+  folly::coro::SpscQueue<int> queue(5);
+  folly::ManualExecutor ex;
+
+  auto fut = queue.dequeue().scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(fut.isReady());
+
+  EXPECT_TRUE(queue.try_enqueue(0));
+  ex.drain();
+  EXPECT_TRUE(fut.isReady());
+  EXPECT_EQ(std::move(fut).get(), 0);
+}
+
+TEST(SpscQueueTest, EnqueueWhileFull) {
+  folly::coro::SpscQueue<int> queue(2);
+  folly::ManualExecutor ex;
+
+  EXPECT_TRUE(queue.try_enqueue(0));
+  EXPECT_TRUE(queue.try_enqueue(1));
+  EXPECT_FALSE(queue.try_enqueue(2));
+
+  auto fut = queue.enqueue(2).scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(fut.isReady());
+
+  EXPECT_EQ(queue.try_dequeue(), 0);
+  ex.drain();
+  EXPECT_TRUE(fut.isReady());
+  EXPECT_EQ(queue.size(), 2);
+}
+
+TEST(SpscQueueTest, DequeueBatch) {
+  folly::coro::SpscQueue<int> queue(8);
+  folly::ManualExecutor ex;
+
+  for (int i = 0; i < 8; ++i) {
+    EXPECT_TRUE(queue.try_enqueue(i));
+  }
+  auto fut = queue.enqueue(8).scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(fut.isReady());
+
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    std::vector<int> expected{0, 1, 2};
+    EXPECT_EQ(co_await queue.dequeueBatch(3), expected);
+    ex.drain();
+    EXPECT_TRUE(fut.isReady());
+    expected = {3, 4, 5, 6, 7, 8};
+    EXPECT_EQ(co_await queue.dequeueBatch(100), expected);
+  }());
+}
+
+TEST(SpscQueueTest, EnqueueDequeOnDifferentThreads) {
+  folly::coro::SpscQueue<int> queue(16);
+  constexpr int kNumValues = 100000;
+
+  std::thread producer([&] {
+    folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+      for (int i = 0; i < kNumValues; ++i) {
+        co_await queue.enqueue(i);
+      }
+    }());
+  });
+
+  folly::coro::blockingWait([&]() -> folly::coro::Task<void> {
+    int expected = 0;
+    while (expected < kNumValues) {
+      if (expected % 2) {
+        EXPECT_EQ(co_await queue.dequeue(), expected++);
+      } else {
+        for (auto value : co_await queue.dequeueBatch(7)) {
+          EXPECT_EQ(value, expected++);
+        }
+      }
+    }
+  }());
+  producer.join();
+  EXPECT_TRUE(queue.empty());
+}
+
+TEST(SpscQueueTest, CancelledDequeueThrowsOperationCancelled) {
+  folly::coro::blockingWait([]() -> folly::coro::Task<void> {
+    folly::coro::SpscQueue<int> queue(1);
+    folly::CancellationSource cancelSource;
+
+    co_await folly::coro::collectAll(
+        [&]() -> folly::coro::Task<void> {
+          EXPECT_THROW(
+              (co_await folly::coro::co_withCancellation(
+                  cancelSource.getToken(), queue.dequeue())),
+              folly::OperationCancelled);
+        }(),
+        [&]() -> folly::coro::Task<void> {
+          co_await folly::coro::co_reschedule_on_current_executor;
+          co_await folly::coro::co_reschedule_on_current_executor;
+          cancelSource.requestCancellation();
+        }());
+
+    // The queue is still usable after a cancelled dequeue.
+    co_await queue.enqueue(1);
+    EXPECT_EQ(co_await queue.dequeue(), 1);
+  }());
+}
+
+TEST(SpscQueueTest, CancelledEnqueueThrowsOperationCancelled) {
+  folly::coro::blockingWait([]() -> folly::coro::Task<void> {
+    folly::coro::SpscQueue<int> queue(1);
+    folly::CancellationSource cancelSource;
+    cancelSource.requestCancellation();
+
+    // Completes normally while there is space.
+    co_await folly::coro::co_withCancellation(
+        cancelSource.getToken(), queue.enqueue(1));
+    EXPECT_THROW(
+        (co_await folly::coro::co_withCancellation(
+            cancelSource.getToken(), queue.enqueue(2))),
+        folly::OperationCancelled);
+    EXPECT_EQ(queue.size(), 1);
+  }());
+}
+#endif
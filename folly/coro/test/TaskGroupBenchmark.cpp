@@ -0,0 +1,88 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Portability.h>
+#include <folly/coro/AsyncScope.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Invoke.h>
+#include <folly/coro/Task.h>
+#include <folly/coro/TaskGroup.h>
+#include <folly/executors/ManualExecutor.h>
+#include <folly/fibers/Semaphore.h>
+#include <folly/portability/GFlags.h>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly;
+
+// Runs numTasks tasks, at most kMaxConcurrency at a time, on a ManualExecutor.
+// Every task yields once, so that tasks actually overlap and the concurrency
+// limit is reached.
+
+namespace {
+
+constexpr size_t kMaxConcurrency = 16;
+
+coro::Task<void> work() {
+  co_await coro::co_reschedule_on_current_executor;
+}
+
+} // namespace
+
+void asyncScopeSemaphore(size_t iters, size_t numTasks) {
+  while (iters--) {
+    ManualExecutor ex;
+    coro::AsyncScope scope;
+    fibers::Semaphore sem(kMaxConcurrency);
+    for (size_t i = 0; i < numTasks; ++i) {
+      scope.add(coro::co_invoke([&]() -> coro::Task<void> {
+                  co_await sem.co_wait();
+                  co_await work();
+                  sem.signal();
+                }).scheduleOn(&ex));
+    }
+    ex.drain();
+    coro::blockingWait(scope.joinAsync());
+  }
+}
+
+void taskGroup(size_t iters, size_t numTasks) {
+  while (iters--) {
+    ManualExecutor ex;
+    coro::TaskGroup group(kMaxConcurrency);
+    for (size_t i = 0; i < numTasks; ++i) {
+      group.add(work().scheduleOn(&ex));
+    }
+    ex.drain();
+    coro::blockingWait(group.joinAsync());
+  }
+}
+
+BENCHMARK_NAMED_PARAM(asyncScopeSemaphore, 16, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(taskGroup, 16, 16)
+BENCHMARK_NAMED_PARAM(asyncScopeSemaphore, 1k, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(taskGroup, 1k, 1000)
+BENCHMARK_NAMED_PARAM(asyncScopeSemaphore, 100k, 100000)
+BENCHMARK_RELATIVE_NAMED_PARAM(taskGroup, 100k, 100000)
+
+#endif
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/coro/TaskGroup.h>
+
+#include <folly/coro/Baton.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/GtestHelpers.h>
+#include <folly/coro/Invoke.h>
+#include <folly/coro/Task.h>
+#include <folly/executors/GlobalExecutor.h>
+#include <folly/executors/ManualExecutor.h>
+
+#include <folly/portability/GTest.h>
+
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES
+
+struct TaskGroupTest : public testing::Test {};
+
+TEST_F(TaskGroupTest, ConstructDestruct) {
+  folly::coro::TaskGroup group(4);
+  EXPECT_EQ(group.maxConcurrency(), 4);
+}
+
+CO_TEST_F(TaskGroupTest, AddAndJoin) {
+  std::atomic<int> count = 0;
+  std::atomic<int> running = 0;
+  std::atomic<int> maxRunning = 0;
+  auto makeTask = [&]() -> folly::coro::Task<> {
+    auto now = ++running;
+    auto prev = maxRunning.load();
+    while (prev < now && !maxRunning.compare_exchange_weak(prev, now)) {
+    }
+    co_await folly::coro::co_reschedule_on_current_executor;
+    --running;
+    ++count;
+  };
+
+  folly::coro::TaskGroup group(3);
+  for (int i = 0; i < 100; ++i) {
+    group.add(makeTask().scheduleOn(folly::getGlobalCPUExecutor()));
+  }
+
+  co_await group.joinAsync();
+
+  EXPECT_EQ(count, 100);
+  EXPECT_LE(maxRunning, 3);
+
+  auto stats = group.getStats();
+  EXPECT_EQ(stats.completed, 100);
+  EXPECT_EQ(stats.outstanding(), 0);
+  EXPECT_EQ(stats.queueDelayUs.count(), 100);
+  EXPECT_EQ(stats.runTimeUs.count(), 100);
+}
+
+TEST_F(TaskGroupTest, QueuedTasksStartInOrder) {
+  folly::ManualExecutor ex;
+  folly::coro::TaskGroup group(2);
+  std::vector<folly::coro::Baton> batons(5);
+  std::vector<int> started;
+  auto makeTask = [&](int i) -> folly::coro::Task<> {
+    started.push_back(i);
+    co_await batons[i];
+  };
+
+  for (int i = 0; i < 5; ++i) {
+    group.add(makeTask(i).scheduleOn(&ex));
+  }
+  ex.drain();
+  EXPECT_EQ(started, std::vector<int>({0, 1}));
+  auto stats = group.getStats();
+  EXPECT_EQ(stats.running, 2);
+  EXPECT_EQ(stats.queued, 3);
+  EXPECT_EQ(stats.maxQueued, 3);
+
+  batons[1].post();
+  ex.drain();
+  EXPECT_EQ(started, std::vector<int>({0, 1, 2}));
+
+  batons[0].post();
+  batons[2].post();
+  ex.drain();
+  EXPECT_EQ(started, std::vector<int>({0, 1, 2, 3, 4}));
+  stats = group.getStats();
+  EXPECT_EQ(stats.completed, 3);
+  EXPECT_EQ(stats.running, 2);
+  EXPECT_EQ(stats.queued, 0);
+
+  auto join = group.joinAsync().scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_FALSE(join.isReady());
+  batons[3].post();
+  batons[4].post();
+  ex.drain();
+  EXPECT_TRUE(join.isReady());
+  EXPECT_EQ(group.getStats().completed, 5);
+}
+
+TEST_F(TaskGroupTest, CancelDropsQueuedTasks) {
+  folly::ManualExecutor ex;
+  folly::coro::TaskGroup group(1);
+  folly::coro::Baton baton;
+  bool cancelled = false;
+  int started = 0;
+
+  group.add(folly::coro::co_invoke([&]() -> folly::coro::Task<> {
+              ++started;
+              co_await baton;
+              cancelled = (co_await folly::coro::co_current_cancellation_token)
+                              .isCancellationRequested();
+            }).scheduleOn(&ex));
+  for (int i = 0; i < 3; ++i) {
+    group.add(folly::coro::co_invoke([&]() -> folly::coro::Task<> {
+                ++started;
+                co_return;
+              }).scheduleOn(&ex));
+  }
+  ex.drain();
+  EXPECT_EQ(group.getStats().queued, 3);
+
+  auto join = group.cancelAndJoinAsync().scheduleOn(&ex).start();
+  ex.drain();
+  EXPECT_TRUE(group.isCancellationRequested());
+  EXPECT_FALSE(join.isReady());
+  auto stats = group.getStats();
+  EXPECT_EQ(stats.queued, 0);
+  EXPECT_EQ(stats.dropped, 3);
+
+  baton.post();
+  ex.drain();
+  EXPECT_TRUE(join.isReady());
+  EXPECT_TRUE(cancelled);
+  EXPECT_EQ(started, 1);
+  EXPECT_EQ(group.getStats().completed, 1);
+}
+
+TEST_F(TaskGroupTest, ExternalCancellation) {
+  folly::ManualExecutor ex;
+  folly::CancellationSource source;
+  folly::coro::TaskGroup group(1, source.getToken());
+  folly::coro::Baton baton;
+  int started = 0;
+
+  for (int i = 0; i < 3; ++i) {
+    group.add(folly::coro::co_invoke([&]() -> folly::coro::Task<> {
+                ++started;
+                co_await baton;
+              }).scheduleOn(&ex));
+  }
+  ex.drain();
+  source.requestCancellation();
+  EXPECT_TRUE(group.isCancellationRequested());
+
+  // Queued tasks are dropped once the running one completes.
+  auto join = group.joinAsync().scheduleOn(&ex).start();
+  baton.post();
+  ex.drain();
+  EXPECT_TRUE(join.isReady());
+  EXPECT_EQ(started, 1);
+  EXPECT_EQ(group.getStats().dropped, 2);
+}
+
+CO_TEST_F(TaskGroupTest, CoSchedule) {
+  folly::coro::TaskGroup group(1);
+  int count = 0;
+  for (int i = 0; i < 10; ++i) {
+    co_await group.co_schedule(
+        folly::coro::co_invoke([&]() -> folly::coro::Task<> {
+          ++count;
+          co_return;
+        }));
+  }
+  co_await group.joinAsync();
+  EXPECT_EQ(count, 10);
+}
+
+TEST_F(TaskGroupTest, ThrowOnJoin) {
+  folly::coro::TaskGroup group(1, true);
+  group.add(folly::coro::co_invoke([]() -> folly::coro::Task<> {
+              co_yield folly::coro::co_error(std::runtime_error("error"));
+            }).scheduleOn(folly::getGlobalCPUExecutor()));
+  group.add(folly::coro::co_invoke([]() -> folly::coro::Task<> {
+              co_return;
+            }).scheduleOn(folly::getGlobalCPUExecutor()));
+  EXPECT_THROW(
+      folly::coro::blockingWait(group.joinAsync()), std::runtime_error);
+  EXPECT_EQ(group.getStats().completed, 2);
+}
+
+#endif
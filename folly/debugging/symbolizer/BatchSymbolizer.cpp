@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/debugging/symbolizer/BatchSymbolizer.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <iterator>
+#include <thread>
+#include <tuple>
+
+#include <folly/debugging/symbolizer/DwarfLineNumberVM.h>
+#include <folly/debugging/symbolizer/detail/Debug.h>
+#include <folly/portability/Unistd.h>
+#include <folly/synchronization/CallOnce.h>
+
+#if FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+namespace folly {
+namespace symbolizer {
+
+namespace {
+
+ElfCache* defaultElfCache() {
+  static auto cache = new ElfCache();
+  return cache;
+}
+
+} // namespace
+
+struct BatchSymbolizer::ElfState {
+  explicit ElfState(std::shared_ptr<ElfFile> f) : file(std::move(f)) {}
+
+  const std::shared_ptr<ElfFile> file;
+  folly::once_flag rangesOnce;
+  std::vector<Dwarf::CompilationUnitRange> ranges;
+  // Rows of the line number program of each compilation unit, by offset of
+  // the unit (not of its line number program) in .debug_info.
+  folly::Synchronized<
+      folly::F14FastMap<uint64_t, std::shared_ptr<const DwarfLineTable>>>
+      lineTables;
+  // By adjusted address.
+  folly::Synchronized<
+      folly::F14FastMap<uintptr_t, std::shared_ptr<const Frames>>>
+      frames;
+};
+
+struct BatchSymbolizer::Lookup {
+  uintptr_t address = 0;
+  // Unrelocated, ELF-relative address; only set if elf is set.
+  uintptr_t adjusted = 0;
+  ElfState* elf = nullptr;
+  // Whether the address is in .debug_aranges, and the offset of its
+  // compilation unit in .debug_info if so.
+  bool hasUnit = false;
+  uint64_t unitOffset = 0;
+  std::shared_ptr<const Frames> frames;
+};
+
+BatchSymbolizer::BatchSymbolizer(
+    ElfCacheBase* cache,
+    LocationInfoMode mode,
+    size_t numThreads,
+    std::string exePath)
+    : cache_(cache ? cache : defaultElfCache()),
+      mode_(mode),
+      numThreads_(std::max<size_t>(1, numThreads)),
+      exePath_(std::move(exePath)) {}
+
+// Needs complete type for ElfState
+BatchSymbolizer::~BatchSymbolizer() {}
+
+BatchSymbolizer::ElfState& BatchSymbolizer::getElfState(
+    std::shared_ptr<ElfFile> file) {
+  auto const key = file.get();
+  return *elfs_.withWLock([&](auto& elfs) {
+    auto& state = elfs[key];
+    if (!state) {
+      state = std::make_unique<ElfState>(std::move(file));
+    }
+    return state.get();
+  });
+}
+
+std::vector<std::shared_ptr<const BatchSymbolizer::Frames>>
+BatchSymbolizer::symbolize(folly::Range<const uintptr_t*> addresses) {
+  std::vector<uintptr_t> unique(addresses.begin(), addresses.end());
+  std::sort(unique.begin(), unique.end());
+  unique.erase(std::unique(unique.begin(), unique.end()), unique.end());
+  std::vector<Lookup> lookups(unique.size());
+  for (size_t i = 0; i < unique.size(); ++i) {
+    lookups[i].address = unique[i];
+  }
+
+  // Find the ELF file of each address, as Symbolizer::symbolize() does.
+  auto const dbg = detail::get_r_debug();
+  char selfPath[PATH_MAX + 8];
+  ssize_t selfSize = -1;
+  if (dbg != nullptr && dbg->r_version == 1) {
+    selfSize = readlink(exePath_.c_str(), selfPath, PATH_MAX + 1);
+  }
+  if (selfSize != -1) {
+    selfPath[selfSize] = '\0';
+    size_t remaining = lookups.size();
+    for (auto lmap = dbg->r_map; lmap != nullptr && remaining != 0;
+         lmap = lmap->l_next) {
+      auto const objPath = lmap->l_name[0] != '\0' ? lmap->l_name : selfPath;
+      auto const elfFile = cache_->getFile(objPath);
+      if (!elfFile) {
+        continue;
+      }
+      ElfState* elf = nullptr;
+      for (auto& lookup : lookups) {
+        if (lookup.elf) {
+          continue;
+        }
+        auto const adjusted =
+            lookup.address - reinterpret_cast<uintptr_t>(lmap->l_addr);
+        if (!elfFile->getSectionContainingAddress(adjusted)) {
+          continue;
+        }
+        if (!elf) {
+          elf = &getElfState(elfFile);
+        }
+        lookup.elf = elf;
+        lookup.adjusted = adjusted;
+        --remaining;
+      }
+    }
+  }
+
+  // Take what we can from the cache, and find the compilation unit of the
+  // rest in the sorted ranges of .debug_aranges.
+  for (auto& lookup : lookups) {
+    if (!lookup.elf) {
+      SymbolizedFrame frame;
+      frame.addr = lookup.address;
+      lookup.frames = std::make_shared<const Frames>(1, std::move(frame));
+      continue;
+    }
+    auto& elf = *lookup.elf;
+    elf.frames.withRLock([&](auto& cache) {
+      auto it = cache.find(lookup.adjusted);
+      if (it != cache.end()) {
+        lookup.frames = it->second;
+      }
+    });
+    if (lookup.frames || mode_ == LocationInfoMode::DISABLED) {
+      continue;
+    }
+    folly::call_once(elf.rangesOnce, [&] {
+      elf.ranges = Dwarf(cache_, elf.file.get()).getCompilationUnitRanges();
+    });
+    auto it = std::upper_bound(
+        elf.ranges.begin(),
+        elf.ranges.end(),
+        lookup.adjusted,
+        [](uintptr_t address, const auto& range) {
+          return address < range.begin;
+        });
+    if (it != elf.ranges.begin() && lookup.adjusted < std::prev(it)->end) {
+      lookup.hasUnit = true;
+      lookup.unitOffset = std::prev(it)->offset;
+    }
+  }
+
+  // Group the remaining addresses by file and compilation unit; each group is
+  // one task.  Addresses without a unit are grouped by file.
+  auto pending = std::partition(lookups.begin(), lookups.end(), [](auto& l) {
+    return l.frames != nullptr;
+  });
+  auto key = [](const Lookup& l) {
+    return std::make_tuple(l.elf, l.hasUnit, l.unitOffset);
+  };
+  std::sort(pending, lookups.end(), [&](const Lookup& a, const Lookup& b) {
+    return std::make_tuple(a.elf, a.hasUnit, a.unitOffset, a.adjusted) <
+        std::make_tuple(b.elf, b.hasUnit, b.unitOffset, b.adjusted);
+  });
+  std::vector<folly::Range<Lookup*>> tasks;
+  for (auto begin = pending; begin != lookups.end();) {
+    auto end = std::find_if(
+        begin, lookups.end(), [&](auto& l) { return key(l) != key(*begin); });
+    tasks.emplace_back(&*begin, &*begin + (end - begin));
+    begin = end;
+  }
+
+  std::atomic<size_t> nextTask{0};
+  auto work = [&] {
+    for (size_t i; (i = nextTask++) < tasks.size();) {
+      symbolizeLookups(tasks[i]);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(numThreads_, tasks.size()); ++i) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  std::sort(lookups.begin(), lookups.end(), [](auto& a, auto& b) {
+    return a.address < b.address;
+  });
+  std::vector<std::shared_ptr<const Frames>> result;
+  result.reserve(addresses.size());
+  for (auto address : addresses) {
+    auto it = std::lower_bound(
+        lookups.begin(), lookups.end(), address, [](auto& l, uintptr_t a) {
+          return l.address < a;
+        });
+    result.push_back(it->frames);
+  }
+  return result;
+}
+
+void BatchSymbolizer::symbolizeLookups(folly::Range<Lookup*> lookups) const {
+  auto& elf = *lookups.front().elf;
+  auto const& file = elf.file;
+  auto const withInline = mode_ == LocationInfoMode::FULL_WITH_INLINE;
+  std::vector<uintptr_t> addresses(lookups.size());
+  std::vector<SymbolizedFrame> frames(lookups.size());
+  std::vector<SymbolizedFrame> inlineFrames(
+      withInline ? lookups.size() * kMaxInlineLocationInfoPerFrame : 0);
+  auto inlineFramesOf = [&](size_t i) {
+    return withInline ? folly::range(inlineFrames)
+                            .subpiece(
+                                i * kMaxInlineLocationInfoPerFrame,
+                                kMaxInlineLocationInfoPerFrame)
+                      : folly::Range<SymbolizedFrame*>();
+  };
+
+  for (size_t i = 0; i < lookups.size(); ++i) {
+    auto const address = lookups[i].adjusted;
+    addresses[i] = address;
+    auto& frame = frames[i];
+    frame.found = true;
+    frame.addr = address;
+    frame.file = file;
+    frame.name = file->getSymbolName(file->getDefinitionByAddress(address));
+  }
+
+  Dwarf dwarf(cache_, file.get());
+  if (lookups.front().hasUnit) {
+    auto const unitOffset = lookups.front().unitOffset;
+    auto lineTable = elf.lineTables.withRLock([&](auto& tables) {
+      auto it = tables.find(unitOffset);
+      return it != tables.end() ? it->second : nullptr;
+    });
+    if (!lineTable) {
+      auto table = std::make_shared<DwarfLineTable>();
+      dwarf.getLineTable(unitOffset, *table);
+      // Another thread may have read the same table concurrently.
+      lineTable = elf.lineTables.withWLock([&](auto& tables) {
+        return tables.emplace(unitOffset, std::move(table)).first->second;
+      });
+    }
+    dwarf.findAddressesInCompilationUnit(
+        unitOffset,
+        folly::range(addresses),
+        mode_,
+        folly::range(frames),
+        folly::range(inlineFrames),
+        lineTable.get());
+  } else {
+    for (size_t i = 0; i < lookups.size(); ++i) {
+      dwarf.findAddress(addresses[i], mode_, frames[i], inlineFramesOf(i));
+    }
+  }
+
+  for (size_t i = 0; i < lookups.size(); ++i) {
+    auto result = std::make_shared<Frames>();
+    auto inlined = inlineFramesOf(i);
+    auto numInlined = std::find_if(
+                          inlined.begin(),
+                          inlined.end(),
+                          [](auto& frame) { return !frame.found; }) -
+        inlined.begin();
+    result->reserve(numInlined + 1);
+    result->insert(
+        result->end(), inlined.begin(), inlined.begin() + numInlined);
+    result->push_back(std::move(frames[i]));
+    lookups[i].frames = std::move(result);
+  }
+
+  elf.frames.withWLock([&](auto& cache) {
+    for (auto& lookup : lookups) {
+      // Another thread may have symbolized the same address concurrently.
+      lookup.frames =
+          cache.emplace(lookup.adjusted, lookup.frames).first->second;
+    }
+  });
+}
+
+} // namespace symbolizer
+} // namespace folly
+
+#endif // FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/debugging/symbolizer/Dwarf.h>
+#include <folly/debugging/symbolizer/ElfCache.h>
+#include <folly/debugging/symbolizer/SymbolizedFrame.h>
+#include <folly/portability/Config.h>
+
+namespace folly {
+namespace symbolizer {
+
+#if FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+/**
+ * Symbolizer for many addresses at once, such as all frames of a large number
+ * of sampled stack traces.
+ *
+ * Symbolizer looks up every address on its own: it scans .debug_aranges
+ * linearly to find the compilation unit, then parses the unit and runs its
+ * line number program.  Instead, BatchSymbolizer builds a sorted index of the
+ * address ranges of each ELF file the first time the file is needed,
+ * deduplicates the addresses, sorts them by compilation unit and parses each
+ * unit once per batch.  The line number program of a unit is run once, and
+ * its rows are kept as a table in which the file and line of an address are
+ * found by binary search.  The compilation units can be processed by several
+ * threads in parallel.
+ *
+ * The line tables and the frames of each address are cached per ELF file for
+ * the lifetime of the BatchSymbolizer, so symbolizing the same addresses
+ * again is a lookup.  The cache is unbounded; use a new BatchSymbolizer to
+ * drop it.
+ *
+ * symbolize() may be called concurrently.  With more than one thread, @cache
+ * must be thread-safe (ElfCache is, SignalSafeElfCache is not).
+ */
+class BatchSymbolizer {
+ public:
+  /**
+   * The frames of one address: the inlined functions (only in
+   * FULL_WITH_INLINE mode) followed by the function that contains the
+   * address, in the same order as written by Symbolizer.  Never empty; if the
+   * address could not be symbolized, the only frame has found == false.
+   */
+  using Frames = std::vector<SymbolizedFrame>;
+
+  explicit BatchSymbolizer(
+      ElfCacheBase* cache = nullptr,
+      LocationInfoMode mode = LocationInfoMode::FULL,
+      size_t numThreads = 1,
+      std::string exePath = "/proc/self/exe");
+
+  ~BatchSymbolizer();
+
+  /**
+   * Symbolize @addresses, which are absolute addresses in the current
+   * process.  Returns the frames of each address, in the same order.
+   * Duplicate addresses share their frames.
+   */
+  std::vector<std::shared_ptr<const Frames>> symbolize(
+      folly::Range<const uintptr_t*> addresses);
+
+ private:
+  struct ElfState;
+  struct Lookup;
+  // Keyed by the file, whose shared_ptr is held by the state.
+  using ElfStateMap =
+      folly::F14FastMap<const ElfFile*, std::unique_ptr<ElfState>>;
+
+  ElfState& getElfState(std::shared_ptr<ElfFile> file);
+  // Symbolize @lookups, which are in the same ELF file and compilation unit.
+  void symbolizeLookups(folly::Range<Lookup*> lookups) const;
+
+  ElfCacheBase* const cache_;
+  const LocationInfoMode mode_;
+  const size_t numThreads_;
+  const std::string exePath_;
+  folly::Synchronized<ElfStateMap> elfs_;
+};
+
+#endif // FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+} // namespace symbolizer
+} // namespace folly
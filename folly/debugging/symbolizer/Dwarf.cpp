@@ -16,6 +16,7 @@
 
 #include <folly/debugging/symbolizer/Dwarf.h>
 
+#include <algorithm>
 #include <array>
 #include <type_traits>
 
@@ -66,11 +67,13 @@ Dwarf::Dwarf(ElfCacheBase* elfCache, const ElfFile* elf)
 namespace {
 
 /**
- * Find @address in .debug_aranges and return the offset in
- * .debug_info for compilation unit to which this address belongs.
+ * Call @fn(start, length, offset) for each address range in .debug_aranges,
+ * where @offset is the offset in .debug_info of the compilation unit to which
+ * the range belongs, until it returns true.  Returns whether it did.
  */
-bool findDebugInfoOffset(
-    uintptr_t address, StringPiece aranges, uint64_t& offset) {
+bool forEachAddressRange(
+    StringPiece aranges,
+    folly::FunctionRef<bool(uintptr_t, uintptr_t, uint64_t)> fn) {
   DwarfSection section(aranges);
   folly::StringPiece chunk;
   while (section.next(chunk)) {
@@ -80,7 +83,7 @@ bool findDebugInfoOffset(
       return false;
     }
 
-    offset = readOffset(chunk, section.is64Bit());
+    auto offset = readOffset(chunk, section.is64Bit());
     auto addressSize = read<uint8_t>(chunk);
     if (addressSize != sizeof(uintptr_t)) {
       FOLLY_SAFE_DFATAL("invalid address size: ", addressSize);
@@ -121,8 +124,7 @@ bool findDebugInfoOffset(
         break;
       }
 
-      // Is our address in this range?
-      if (address >= start && address < start + length) {
+      if (fn(start, length, offset)) {
         return true;
       }
     }
@@ -130,6 +132,23 @@ bool findDebugInfoOffset(
   return false;
 }
 
+/**
+ * Find @address in .debug_aranges and return the offset in
+ * .debug_info for compilation unit to which this address belongs.
+ */
+bool findDebugInfoOffset(
+    uintptr_t address, StringPiece aranges, uint64_t& offset) {
+  return forEachAddressRange(
+      aranges, [&](uintptr_t start, uintptr_t length, uint64_t unitOffset) {
+        // Is our address in this range?
+        if (address >= start && address < start + length) {
+          offset = unitOffset;
+          return true;
+        }
+        return false;
+      });
+}
+
 } // namespace
 
 bool Dwarf::findAddress(
@@ -212,6 +231,95 @@ bool Dwarf::findAddress(
   return false;
 }
 
+std::vector<Dwarf::CompilationUnitRange> Dwarf::getCompilationUnitRanges()
+    const {
+  std::vector<CompilationUnitRange> ranges;
+  if (!defaultDebugSections_.elf) {
+    return ranges;
+  }
+  forEachAddressRange(
+      defaultDebugSections_.debugAranges,
+      [&](uintptr_t start, uintptr_t length, uint64_t offset) {
+        if (length != 0) {
+          ranges.push_back({start, start + length, offset});
+        }
+        return false;
+      });
+  std::sort(ranges.begin(), ranges.end(), [](const auto& a, const auto& b) {
+    return a.begin < b.begin;
+  });
+  return ranges;
+}
+
+bool Dwarf::getLineTable(uint64_t offset, DwarfLineTable& table) const {
+  if (!defaultDebugSections_.elf) {
+    return false;
+  }
+  auto unit = getCompilationUnits(
+      elfCache_, defaultDebugSections_, offset, false /*requireSplitDwarf*/);
+  if (unit.mainCompilationUnit.unitType != DW_UT_compile &&
+      unit.mainCompilationUnit.unitType != DW_UT_skeleton) {
+    return false;
+  }
+  return DwarfImpl(elfCache_, unit, LocationInfoMode::FULL)
+      .readLineTable(table);
+}
+
+size_t Dwarf::findAddressesInCompilationUnit(
+    uint64_t offset,
+    folly::Range<const uintptr_t*> addresses,
+    LocationInfoMode mode,
+    folly::Range<SymbolizedFrame*> frames,
+    folly::Range<SymbolizedFrame*> inlineFrames,
+    const DwarfLineTable* lineTable) const {
+  FOLLY_SAFE_CHECK(frames.size() >= addresses.size(), "not enough frames");
+  if (mode == LocationInfoMode::DISABLED || !defaultDebugSections_.elf) {
+    return 0;
+  }
+  bool withInline = mode == LocationInfoMode::FULL_WITH_INLINE &&
+      !inlineFrames.empty();
+  if (withInline) {
+    FOLLY_SAFE_CHECK(
+        inlineFrames.size() >=
+            addresses.size() * kMaxInlineLocationInfoPerFrame,
+        "not enough inline frames");
+  }
+
+  auto unit = getCompilationUnits(
+      elfCache_,
+      defaultDebugSections_,
+      offset,
+      mode == LocationInfoMode::FULL_WITH_INLINE);
+  if (unit.mainCompilationUnit.unitType != DW_UT_compile &&
+      unit.mainCompilationUnit.unitType != DW_UT_skeleton) {
+    return 0;
+  }
+  DwarfImpl impl(elfCache_, unit, mode);
+  DwarfLineTable localLineTable;
+  if (!lineTable) {
+    impl.readLineTable(localLineTable);
+    lineTable = &localLineTable;
+  }
+  size_t found = 0;
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    folly::Range<SymbolizedFrame*> inlineRange;
+    if (withInline) {
+      inlineRange = inlineFrames.subpiece(
+          i * kMaxInlineLocationInfoPerFrame, kMaxInlineLocationInfoPerFrame);
+    }
+    if (impl.findLocation(
+            addresses[i],
+            frames[i],
+            inlineRange,
+            {},
+            false /*checkAddress*/,
+            lineTable)) {
+      ++found;
+    }
+  }
+  return found;
+}
+
 } // namespace symbolizer
 } // namespace folly
 
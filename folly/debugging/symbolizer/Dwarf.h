@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include <folly/Function.h>
 #include <folly/Range.h>
 #include <folly/debugging/symbolizer/DwarfUtil.h>
@@ -30,6 +32,8 @@ namespace symbolizer {
 
 #if FOLLY_HAVE_DWARF && FOLLY_HAVE_ELF
 
+struct DwarfLineTable;
+
 /**
  * DWARF record parser.
  *
@@ -76,6 +80,52 @@ class Dwarf {
       folly::FunctionRef<void(const folly::StringPiece name)>
           eachParameterName = {}) const;
 
+  /** An address range covered by a compilation unit. */
+  struct CompilationUnitRange {
+    uintptr_t begin;
+    uintptr_t end;
+    // Offset of the compilation unit in .debug_info.
+    uint64_t offset;
+  };
+
+  /**
+   * Return all address ranges listed in .debug_aranges, sorted by begin
+   * address, so that the compilation unit of many addresses can be found by
+   * binary search instead of scanning .debug_aranges for each one.
+   *
+   * Unlike the rest of this class, this allocates memory.
+   */
+  std::vector<CompilationUnitRange> getCompilationUnitRanges() const;
+
+  /**
+   * Execute the line number program of the compilation unit at @offset in
+   * .debug_info once, and store its rows in @table, so that they can be
+   * reused by findAddressesInCompilationUnit().  Like
+   * getCompilationUnitRanges(), this allocates memory.
+   */
+  bool getLineTable(uint64_t offset, DwarfLineTable& table) const;
+
+  /**
+   * Like findAddress, for several addresses that all belong to the
+   * compilation unit at @offset in .debug_info (as returned by
+   * getCompilationUnitRanges()), so that the unit is only parsed once.
+   * The file and line of the addresses are looked up in @lineTable, as
+   * returned by getLineTable() for the same unit; if it is null, the line
+   * number program is executed once for all addresses.
+   *
+   * @frames must have one entry per address.  In FULL_WITH_INLINE mode,
+   * @inlineFrames must either be empty or have
+   * kMaxInlineLocationInfoPerFrame entries per address, filled the same way
+   * as by findAddress.  Returns the number of addresses found.
+   */
+  size_t findAddressesInCompilationUnit(
+      uint64_t offset,
+      folly::Range<const uintptr_t*> addresses,
+      LocationInfoMode mode,
+      folly::Range<SymbolizedFrame*> frames,
+      folly::Range<SymbolizedFrame*> inlineFrames = {},
+      const DwarfLineTable* lineTable = nullptr) const;
+
  private:
   ElfCacheBase* elfCache_;
   DebugSections defaultDebugSections_;
@@ -64,7 +64,8 @@ bool DwarfImpl::findLocation(
     SymbolizedFrame& frame,
     folly::Range<SymbolizedFrame*> inlineFrames,
     folly::FunctionRef<void(folly::StringPiece)> eachParameterName,
-    bool checkAddress) const {
+    bool checkAddress,
+    const DwarfLineTable* lineTable) const {
   auto mainCu = cu_.mainCompilationUnit;
   Die die = getDieAtOffset(mainCu, mainCu.firstDie);
   // Partial compilation unit (DW_TAG_partial_unit) is not supported.
@@ -186,8 +187,10 @@ bool DwarfImpl::findLocation(
       lineSection, compilationDirectory, mainCu.debugSections);
 
   // Execute line number VM program to find file and line
-  frame.location.hasFileAndLine =
-      lineVM.findAddress(address, frame.location.file, frame.location.line);
+  frame.location.hasFileAndLine = lineTable
+      ? lineTable->findAddress(
+            address, frame.location.file, frame.location.line)
+      : lineVM.findAddress(address, frame.location.file, frame.location.line);
   if (!frame.location.hasFileAndLine) {
     return false;
   }
@@ -280,6 +283,45 @@ bool DwarfImpl::findLocation(
   return true;
 }
 
+bool DwarfImpl::readLineTable(DwarfLineTable& table) const {
+  auto mainCu = cu_.mainCompilationUnit;
+  Die die = getDieAtOffset(mainCu, mainCu.firstDie);
+  if (die.abbr.tag != DW_TAG_compile_unit &&
+      die.abbr.tag != DW_TAG_skeleton_unit) {
+    return false;
+  }
+
+  folly::Optional<uint64_t> lineOffset;
+  folly::StringPiece compilationDirectory;
+  enum : unsigned {
+    kStmtList = 1U << 0,
+    kCompDir = 1U << 1,
+  };
+  unsigned expectedAttributes = kStmtList | kCompDir;
+  forEachAttribute(mainCu, die, [&](const Attribute& attr) {
+    switch (attr.spec.name) {
+      case DW_AT_stmt_list:
+        expectedAttributes &= ~kStmtList;
+        lineOffset = std::get<uint64_t>(attr.attrValue);
+        break;
+      case DW_AT_comp_dir:
+        expectedAttributes &= ~kCompDir;
+        compilationDirectory = std::get<folly::StringPiece>(attr.attrValue);
+        break;
+    }
+    return (expectedAttributes != 0); // continue forEachAttribute
+  });
+  if (!lineOffset) {
+    return false;
+  }
+
+  folly::StringPiece lineSection(mainCu.debugSections.debugLine);
+  lineSection.advance(*lineOffset);
+  DwarfLineNumberVM lineVM(
+      lineSection, compilationDirectory, mainCu.debugSections);
+  return lineVM.readTable(table);
+}
+
 void DwarfImpl::fillInlineFrames(
     uintptr_t address,
     SymbolizedFrame& frame,
@@ -50,13 +50,23 @@ class DwarfImpl {
    *
    * if @checkAddress is true, we verify that the address is mapped to
    * a range in this CU before running the line number VM
+   *
+   * If @lineTable is set, it must hold the rows of the line number program of
+   * this CU (see readLineTable()), and is used instead of running the VM.
    */
   bool findLocation(
       uintptr_t address,
       SymbolizedFrame& frame,
       folly::Range<SymbolizedFrame*> inlineFrames,
       folly::FunctionRef<void(folly::StringPiece)> eachParameterName,
-      bool checkAddress = true) const;
+      bool checkAddress = true,
+      const DwarfLineTable* lineTable = nullptr) const;
+
+  /**
+   * Execute the line number program of the compilation unit @cu once and
+   * store its rows in @table.
+   */
+  bool readLineTable(DwarfLineTable& table) const;
 
  private:
   using AttributeValue = std::variant<uint64_t, folly::StringPiece>;
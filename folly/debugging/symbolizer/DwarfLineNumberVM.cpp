@@ -16,6 +16,11 @@
 
 #include <folly/debugging/symbolizer/DwarfLineNumberVM.h>
 
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+
 #include <folly/Optional.h>
 #include <folly/debugging/symbolizer/DwarfSection.h>
 
@@ -706,6 +711,117 @@ bool DwarfLineNumberVM::findAddress(
   return false;
 }
 
+bool DwarfLineNumberVM::readTable(DwarfLineTable& table) {
+  table.rows.clear();
+  table.files.clear();
+  if (!initializationSuccess_) {
+    return false;
+  }
+  folly::StringPiece program = data_;
+
+  std::unordered_map<uint64_t, size_t> fileIndices;
+  auto fileIndex = [&](uint64_t file) {
+    // See findAddress() for why file 0 is invalid in DWARF <= 4.
+    if (version_ <= 4 && file == 0) {
+      return DwarfLineTable::kNoFile;
+    }
+    auto [it, inserted] = fileIndices.emplace(file, table.files.size());
+    if (inserted) {
+      table.files.push_back(getFullFileName(file));
+    }
+    return it->second;
+  };
+
+  // The address ranges of the sequences executed so far, merged.  The rows
+  // of later sequences are clipped to what they don't cover.
+  std::map<uintptr_t, uintptr_t> covered;
+  auto addRow = [&](DwarfLineTable::Row row) {
+    auto it = covered.upper_bound(row.begin);
+    if (it != covered.begin() && std::prev(it)->second > row.begin) {
+      row.begin = std::prev(it)->second;
+    }
+    while (row.begin < row.end) {
+      if (it == covered.end() || it->first >= row.end) {
+        table.rows.push_back(row);
+        return;
+      }
+      if (it->first > row.begin) {
+        table.rows.push_back({row.begin, it->first, row.line, row.file});
+      }
+      row.begin = std::max(row.begin, it->second);
+      ++it;
+    }
+  };
+  auto addCovered = [&](uintptr_t begin, uintptr_t end) {
+    auto it = covered.upper_bound(begin);
+    if (it != covered.begin() && std::prev(it)->second >= begin) {
+      --it;
+      begin = it->first;
+    }
+    while (it != covered.end() && it->first <= end) {
+      end = std::max(end, it->second);
+      it = covered.erase(it);
+    }
+    covered.emplace(begin, end);
+  };
+
+  // As in findAddress(), each row covers the addresses up to the next row of
+  // the same sequence.
+  reset();
+  bool inSequence = false;
+  uint64_t sequenceBegin = 0;
+  uint64_t prevAddress = 0;
+  uint64_t prevFile = 0;
+  uint64_t prevLine = 0;
+  while (!program.empty()) {
+    bool seqEnd = !next(program);
+
+    if (!inSequence) {
+      inSequence = true;
+      sequenceBegin = address_;
+    } else if (address_ > prevAddress) {
+      addRow({prevAddress, address_, prevLine, fileIndex(prevFile)});
+    }
+    prevAddress = address_;
+    prevFile = file_;
+    prevLine = line_;
+
+    if (seqEnd) {
+      if (address_ > sequenceBegin) {
+        addCovered(sequenceBegin, address_);
+      }
+      inSequence = false;
+      reset();
+    }
+  }
+
+  std::sort(
+      table.rows.begin(),
+      table.rows.end(),
+      [](const DwarfLineTable::Row& a, const DwarfLineTable::Row& b) {
+        return a.begin < b.begin;
+      });
+  return true;
+}
+
+bool DwarfLineTable::findAddress(
+    uintptr_t target, Path& file, uint64_t& line) const {
+  auto it = std::upper_bound(
+      rows.begin(), rows.end(), target, [](uintptr_t address, const Row& row) {
+        return address < row.begin;
+      });
+  if (it == rows.begin()) {
+    return false;
+  }
+  --it;
+  if (target >= it->end || it->file == kNoFile) {
+    return false;
+  }
+  file = files[it->file];
+  line = it->line;
+  return true;
+}
+
 } // namespace symbolizer
 } // namespace folly
 
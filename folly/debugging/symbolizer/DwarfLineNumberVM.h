@@ -16,6 +16,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include <vector>
+
 #include <folly/Range.h>
 #include <folly/debugging/symbolizer/DwarfUtil.h>
 #include <folly/experimental/symbolizer/SymbolizedFrame.h>
@@ -25,6 +28,29 @@ namespace symbolizer {
 
 #if FOLLY_HAVE_DWARF && FOLLY_HAVE_ELF
 
+/**
+ * The rows of a line number program, as address ranges sorted by address and
+ * without overlaps, so that many addresses can be looked up by binary search
+ * instead of executing the program for each one.
+ */
+struct DwarfLineTable {
+  static constexpr size_t kNoFile = static_cast<size_t>(-1);
+
+  struct Row {
+    uintptr_t begin;
+    uintptr_t end;
+    uint64_t line;
+    // Index in files, or kNoFile if the row has no valid file.
+    size_t file;
+  };
+
+  /** Same as DwarfLineNumberVM::findAddress() on the program of the table. */
+  bool findAddress(uintptr_t target, Path& file, uint64_t& line) const;
+
+  std::vector<Row> rows;
+  std::vector<Path> files;
+};
+
 class DwarfLineNumberVM {
  public:
   DwarfLineNumberVM(
@@ -34,6 +60,14 @@ class DwarfLineNumberVM {
 
   bool findAddress(uintptr_t target, Path& file, uint64_t& line);
 
+  /**
+   * Execute the whole program once and store its rows in @table.  Where
+   * sequences overlap, the rows of the earlier one are kept, as findAddress()
+   * finds the address in the earlier one.  Allocates memory, unlike
+   * findAddress().
+   */
+  bool readTable(DwarfLineTable& table);
+
   /** Gets full file name at given index including directory. */
   Path getFullFileName(uint64_t index) const;
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/debugging/symbolizer/BatchSymbolizer.h>
+#include <folly/debugging/symbolizer/Symbolizer.h>
+#include <folly/debugging/symbolizer/detail/Debug.h>
+#include <folly/init/Init.h>
+#include <folly/portability/GFlags.h>
+
+// Symbolizes addresses in many functions of this binary, which spread over
+// many compilation units, the way a profiler symbolizes a large number of
+// sampled stack traces.  Each benchmark iteration symbolizes all addresses;
+// the reported time is per address.  BatchSymbolizer starts with an empty
+// cache in every iteration, except in the *_cached variant.
+
+DEFINE_uint32(num_addresses, 10000, "number of distinct addresses");
+DEFINE_uint32(num_threads, 8, "threads of the parallel BatchSymbolizer");
+
+#if FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+using namespace folly;
+using namespace folly::symbolizer;
+
+namespace {
+
+const std::vector<uintptr_t>& addresses() {
+  static const auto result = [] {
+    std::vector<uintptr_t> ret;
+    ElfFile elf("/proc/self/exe");
+    // The running executable is the first entry of the link map.
+    auto const lmap = symbolizer::detail::get_r_debug()->r_map;
+    auto const bias = reinterpret_cast<uintptr_t>(lmap->l_addr);
+    elf.iterateSectionsWithType(SHT_SYMTAB, [&](const ElfShdr& section) {
+      elf.iterateSymbolsWithType(section, STT_FUNC, [&](const ElfSym& sym) {
+        if (sym.st_value != 0 && sym.st_size != 0) {
+          ret.push_back(bias + sym.st_value + sym.st_size / 2);
+        }
+        return false;
+      });
+      return false;
+    });
+    // Spread the sample over the whole binary.
+    auto const n = std::min<size_t>(ret.size(), FLAGS_num_addresses);
+    std::vector<uintptr_t> sample;
+    for (size_t i = 0; i < n; ++i) {
+      sample.push_back(ret[i * ret.size() / n]);
+    }
+    return sample;
+  }();
+  return result;
+}
+
+size_t runSymbolizer(LocationInfoMode mode) {
+  BenchmarkSuspender suspender;
+  auto const& addrs = addresses();
+  Symbolizer symbolizer(nullptr, mode);
+  suspender.dismissing([&] {
+    // One address at a time, with room for its inline frames.
+    for (auto const& addr : addrs) {
+      std::array<SymbolizedFrame, 1 + kMaxInlineLocationInfoPerFrame> frames;
+      symbolizer.symbolize(
+          folly::range(&addr, &addr + 1), folly::range(frames));
+    }
+  });
+  return addrs.size();
+}
+
+size_t runBatchSymbolizer(LocationInfoMode mode, size_t numThreads) {
+  BenchmarkSuspender suspender;
+  auto const& addrs = addresses();
+  BatchSymbolizer symbolizer(nullptr, mode, numThreads);
+  suspender.dismissing([&] {
+    doNotOptimizeAway(symbolizer.symbolize(folly::range(addrs)));
+  });
+  return addrs.size();
+}
+
+} // namespace
+
+BENCHMARK_MULTI(symbolizer_fast) {
+  return runSymbolizer(LocationInfoMode::FAST);
+}
+
+BENCHMARK_RELATIVE_MULTI(batch_symbolizer_fast) {
+  return runBatchSymbolizer(LocationInfoMode::FAST, 1);
+}
+
+BENCHMARK_RELATIVE_MULTI(batch_symbolizer_fast_threads) {
+  return runBatchSymbolizer(LocationInfoMode::FAST, FLAGS_num_threads);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_MULTI(symbolizer_full_with_inline) {
+  return runSymbolizer(LocationInfoMode::FULL_WITH_INLINE);
+}
+
+BENCHMARK_RELATIVE_MULTI(batch_symbolizer_full_with_inline) {
+  return runBatchSymbolizer(LocationInfoMode::FULL_WITH_INLINE, 1);
+}
+
+BENCHMARK_RELATIVE_MULTI(batch_symbolizer_full_with_inline_threads) {
+  return runBatchSymbolizer(
+      LocationInfoMode::FULL_WITH_INLINE, FLAGS_num_threads);
+}
+
+BENCHMARK_RELATIVE_MULTI(batch_symbolizer_full_with_inline_cached) {
+  BenchmarkSuspender suspender;
+  auto const& addrs = addresses();
+  static BatchSymbolizer symbolizer(
+      nullptr, LocationInfoMode::FULL_WITH_INLINE);
+  symbolizer.symbolize(folly::range(addrs));
+  suspender.dismissing([&] {
+    doNotOptimizeAway(symbolizer.symbolize(folly::range(addrs)));
+  });
+  return addrs.size();
+}
+
+#endif // FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+int main(int argc, char* argv[]) {
+  folly::Init init(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
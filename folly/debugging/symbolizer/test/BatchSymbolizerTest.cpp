@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/debugging/symbolizer/BatchSymbolizer.h>
+
+#include <search.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <folly/Demangle.h>
+#include <folly/debugging/symbolizer/Symbolizer.h>
+#include <folly/portability/GTest.h>
+#include <folly/test/TestUtils.h>
+
+#if FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
+
+namespace folly {
+namespace symbolizer {
+namespace test {
+
+FOLLY_NOINLINE void foo() {}
+
+FOLLY_NOINLINE int bar(int x) {
+  return x * 3 + 1;
+}
+
+namespace {
+
+std::vector<uintptr_t> testAddresses() {
+  std::vector<uintptr_t> addresses;
+  for (auto fn :
+       {reinterpret_cast<uintptr_t>(foo),
+        reinterpret_cast<uintptr_t>(bar),
+        reinterpret_cast<uintptr_t>(lfind),
+        reinterpret_cast<uintptr_t>(Symbolizer::isAvailable)}) {
+    for (uintptr_t offset = 0; offset < 16; offset += 4) {
+      addresses.push_back(fn + offset);
+    }
+  }
+  // Not in any loaded object.
+  addresses.push_back(1);
+  return addresses;
+}
+
+void expectSameAsSymbolizer(
+    LocationInfoMode mode,
+    size_t numThreads,
+    const std::vector<uintptr_t>& addresses) {
+  BatchSymbolizer batch(nullptr, mode, numThreads);
+  auto results = batch.symbolize(folly::range(addresses));
+  ASSERT_EQ(addresses.size(), results.size());
+
+  Symbolizer symbolizer(nullptr, mode);
+  for (size_t i = 0; i < addresses.size(); ++i) {
+    SCOPED_TRACE(i);
+    std::array<SymbolizedFrame, 1 + kMaxInlineLocationInfoPerFrame> expected;
+    auto numExpected = symbolizer.symbolize(
+        folly::range(&addresses[i], &addresses[i] + 1),
+        folly::range(expected));
+    auto& frames = *results[i];
+    if (numExpected == 0 || !expected[0].found) {
+      ASSERT_EQ(1, frames.size());
+      EXPECT_FALSE(frames[0].found);
+      EXPECT_EQ(addresses[i], frames[0].addr);
+      continue;
+    }
+    ASSERT_EQ(numExpected, frames.size());
+    for (size_t j = 0; j < numExpected; ++j) {
+      EXPECT_TRUE(frames[j].found);
+      EXPECT_EQ(expected[j].addr, frames[j].addr);
+      EXPECT_EQ(
+          folly::demangle(expected[j].name), folly::demangle(frames[j].name));
+      EXPECT_EQ(
+          expected[j].location.hasFileAndLine,
+          frames[j].location.hasFileAndLine);
+      EXPECT_EQ(
+          expected[j].location.file.toString(),
+          frames[j].location.file.toString());
+      EXPECT_EQ(expected[j].location.line, frames[j].location.line);
+    }
+  }
+}
+
+} // namespace
+
+TEST(BatchSymbolizer, Single) {
+  SKIP_IF(!Symbolizer::isAvailable());
+
+  BatchSymbolizer symbolizer;
+  uintptr_t address = reinterpret_cast<uintptr_t>(foo);
+  auto results = symbolizer.symbolize(folly::range(&address, &address + 1));
+  ASSERT_EQ(1, results.size());
+  auto& frame = results[0]->back();
+  ASSERT_TRUE(frame.found);
+  EXPECT_EQ("folly::symbolizer::test::foo()", folly::demangle(frame.name));
+  EXPECT_TRUE(frame.location.hasFileAndLine);
+  EXPECT_NE(
+      std::string::npos,
+      frame.location.file.toString().find("BatchSymbolizerTest.cpp"));
+}
+
+TEST(BatchSymbolizer, SameAsSymbolizer) {
+  SKIP_IF(!Symbolizer::isAvailable());
+
+  auto addresses = testAddresses();
+  for (auto mode :
+       {LocationInfoMode::DISABLED,
+        LocationInfoMode::FAST,
+        LocationInfoMode::FULL,
+        LocationInfoMode::FULL_WITH_INLINE}) {
+    SCOPED_TRACE(static_cast<int>(mode));
+    expectSameAsSymbolizer(mode, 1, addresses);
+    expectSameAsSymbolizer(mode, 4, addresses);
+  }
+}
+
+TEST(BatchSymbolizer, DuplicatesAndCache) {
+  SKIP_IF(!Symbolizer::isAvailable());
+
+  auto addresses = testAddresses();
+  auto shuffled = addresses;
+  std::reverse(shuffled.begin(), shuffled.end());
+  shuffled.insert(shuffled.end(), addresses.begin(), addresses.end());
+
+  BatchSymbolizer symbolizer(nullptr, LocationInfoMode::FULL, 2);
+  auto results = symbolizer.symbolize(folly::range(shuffled));
+  ASSERT_EQ(shuffled.size(), results.size());
+  auto n = addresses.size();
+  for (size_t i = 0; i < n; ++i) {
+    // The same address shares its frames, within and across batches.
+    EXPECT_EQ(results[n - 1 - i], results[n + i]);
+  }
+  auto again = symbolizer.symbolize(folly::range(addresses));
+  for (size_t i = 0; i < n; ++i) {
+    if (again[i]->back().found) {
+      EXPECT_EQ(results[n + i], again[i]);
+    }
+  }
+}
+
+} // namespace test
+} // namespace symbolizer
+} // namespace folly
+
+#endif // FOLLY_HAVE_ELF && FOLLY_HAVE_DWARF
@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/PerfCounters.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include <folly/Conv.h>
+#include <folly/portability/Unistd.h>
+
+#if FOLLY_PERF_IS_SUPPORTED
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+namespace folly {
+namespace detail {
+
+bool PerfCounterValues::any() const {
+  return !std::isnan(cycles) || !std::isnan(instructions) ||
+      !std::isnan(cacheMisses) || !std::isnan(branchMisses);
+}
+
+PerfCounterValues& PerfCounterValues::operator+=(
+    const PerfCounterValues& other) {
+  cycles += other.cycles;
+  instructions += other.instructions;
+  cacheMisses += other.cacheMisses;
+  branchMisses += other.branchMisses;
+  return *this;
+}
+
+PerfCounterValues PerfCounterValues::operator/(double divisor) const {
+  PerfCounterValues res;
+  res.cycles = cycles / divisor;
+  res.instructions = instructions / divisor;
+  res.cacheMisses = cacheMisses / divisor;
+  res.branchMisses = branchMisses / divisor;
+  return res;
+}
+
+namespace {
+bool sameCount(double x, double y) {
+  return x == y || (std::isnan(x) && std::isnan(y));
+}
+} // namespace
+
+bool operator==(const PerfCounterValues& x, const PerfCounterValues& y) {
+  return sameCount(x.cycles, y.cycles) &&
+      sameCount(x.instructions, y.instructions) &&
+      sameCount(x.cacheMisses, y.cacheMisses) &&
+      sameCount(x.branchMisses, y.branchMisses);
+}
+
+#if FOLLY_PERF_IS_SUPPORTED
+
+namespace {
+
+// In the order of the members of PerfCounterValues.
+constexpr uint64_t kEvents[] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+int perfEventOpen(uint64_t config, int groupFd) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_HARDWARE;
+  attr.config = config;
+  attr.disabled = groupFd == -1 ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+      PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return int(syscall(
+      SYS_perf_event_open, &attr, 0 /* this thread */, -1, groupFd, 0));
+}
+
+} // namespace
+
+PerfCounters::PerfCounters() {
+  static_assert(std::size(kEvents) == kNumEvents);
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    fds_[i] = perfEventOpen(kEvents[i], leader_);
+    if (fds_[i] == -1) {
+      if (leader_ == -1 && error_.empty()) {
+        error_ = folly::to<std::string>(
+            "perf_event_open() failed: ", std::strerror(errno));
+      }
+    } else if (leader_ == -1) {
+      leader_ = fds_[i];
+    }
+  }
+  if (leader_ != -1) {
+    error_.clear();
+  }
+}
+
+PerfCounters::~PerfCounters() {
+  for (auto fd : fds_) {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
+}
+
+void PerfCounters::start() {
+  if (leader_ != -1) {
+    ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::pause() {
+  if (leader_ != -1) {
+    ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+void PerfCounters::resume() {
+  if (leader_ != -1) {
+    ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+  }
+}
+
+PerfCounterValues PerfCounters::stop() {
+  PerfCounterValues res;
+  if (leader_ == -1) {
+    return res;
+  }
+  pause();
+
+  // The layout of a PERF_FORMAT_GROUP read: the number of events, the times
+  // the group was enabled and running, then the count of each event in the
+  // order they were added to the group.
+  uint64_t data[3 + kNumEvents];
+  auto bytes = read(leader_, data, sizeof(data));
+  if (bytes < ssize_t(3 * sizeof(uint64_t)) || data[2] == 0) {
+    return res;
+  }
+  const double scale = double(data[1]) / double(data[2]);
+  double* counts[] = {
+      &res.cycles, &res.instructions, &res.cacheMisses, &res.branchMisses};
+  size_t next = 3;
+  for (size_t i = 0; i < kNumEvents && next < 3 + data[0]; ++i) {
+    if (fds_[i] != -1) {
+      *counts[i] = double(data[next++]) * scale;
+    }
+  }
+  return res;
+}
+
+#else // FOLLY_PERF_IS_SUPPORTED
+
+PerfCounters::PerfCounters()
+    : error_("hardware performance counters are only supported on linux") {
+  fds_.fill(-1);
+}
+
+PerfCounters::~PerfCounters() = default;
+
+void PerfCounters::start() {}
+
+void PerfCounters::pause() {}
+
+void PerfCounters::resume() {}
+
+PerfCounterValues PerfCounters::stop() {
+  return {};
+}
+
+#endif
+
+} // namespace detail
+} // namespace folly
@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <array>
+#include <limits>
+#include <string>
+
+#include <folly/detail/PerfScoped.h>
+
+namespace folly {
+namespace detail {
+
+/*
+ * Counts of hardware events, scaled up if the kernel had to multiplex the
+ * counters.  A count is NaN if the event could not be counted.
+ */
+struct PerfCounterValues {
+  double cycles = std::numeric_limits<double>::quiet_NaN();
+  double instructions = std::numeric_limits<double>::quiet_NaN();
+  double cacheMisses = std::numeric_limits<double>::quiet_NaN();
+  double branchMisses = std::numeric_limits<double>::quiet_NaN();
+
+  // Whether any event was counted.
+  bool any() const;
+
+  PerfCounterValues& operator+=(const PerfCounterValues& other);
+  PerfCounterValues operator/(double divisor) const;
+
+  // Counts that are both NaN compare equal.
+  friend bool operator==(const PerfCounterValues&, const PerfCounterValues&);
+  friend bool operator!=(
+      const PerfCounterValues& x, const PerfCounterValues& y) {
+    return !(x == y);
+  }
+};
+
+/*
+ * A folly::benchmark helper that counts the cycles, instructions,
+ * last-level cache misses and branch misses of the calling thread in user
+ * space, with perf_event_open().
+ *
+ * Only available on linux, when the kernel and the perf_event_paranoid
+ * setting allow it; otherwise available() is false, error() says why, and
+ * all counts are NaN.  Events that the CPU doesn't support are skipped.
+ */
+class PerfCounters {
+ public:
+  PerfCounters();
+  ~PerfCounters();
+
+  PerfCounters(const PerfCounters&) = delete;
+  PerfCounters& operator=(const PerfCounters&) = delete;
+
+  bool available() const { return leader_ != -1; }
+  const std::string& error() const { return error_; }
+
+  // Resets the counts and starts counting.
+  void start();
+
+  // Stops counting temporarily, without resetting the counts.
+  void pause();
+  void resume();
+
+  // Stops counting and returns the counts since start().
+  PerfCounterValues stop();
+
+ private:
+  static constexpr size_t kNumEvents = 4;
+
+  // The file descriptor of each event, or -1.  The first one that could be
+  // opened leads the group, so that all events are counted together.
+  std::array<int, kNumEvents> fds_;
+  int leader_ = -1;
+  std::string error_;
+};
+
+} // namespace detail
+} // namespace folly
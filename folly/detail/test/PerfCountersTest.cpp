@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/detail/PerfCounters.h>
+
+#include <cmath>
+
+#include <folly/lang/Hint.h>
+#include <folly/portability/GTest.h>
+#include <folly/test/TestUtils.h>
+
+namespace folly {
+namespace detail {
+namespace {
+
+FOLLY_NOINLINE uint64_t work(uint64_t n) {
+  uint64_t x = 0;
+  for (uint64_t i = 0; i < n; ++i) {
+    folly::compiler_must_not_predict(x);
+    x = x * 31 + i;
+  }
+  return x;
+}
+
+} // namespace
+
+TEST(PerfCounterValuesTest, Basic) {
+  PerfCounterValues values;
+  EXPECT_FALSE(values.any());
+  EXPECT_EQ(values, PerfCounterValues{});
+
+  values.instructions = 1000;
+  values.cycles = 500;
+  EXPECT_TRUE(values.any());
+  EXPECT_NE(values, PerfCounterValues{});
+
+  auto perIter = values / 10;
+  EXPECT_EQ(100, perIter.instructions);
+  EXPECT_EQ(50, perIter.cycles);
+  EXPECT_TRUE(std::isnan(perIter.cacheMisses));
+  EXPECT_TRUE(std::isnan(perIter.branchMisses));
+
+  auto sum = values;
+  sum += perIter;
+  EXPECT_EQ(1100, sum.instructions);
+  EXPECT_EQ(550, sum.cycles);
+  EXPECT_TRUE(std::isnan(sum.cacheMisses));
+}
+
+TEST(PerfCountersTest, Unavailable) {
+  PerfCounters perf;
+  SKIP_IF(perf.available()) << "Hardware performance counters available";
+  EXPECT_FALSE(perf.error().empty());
+  perf.start();
+  EXPECT_FALSE(perf.stop().any());
+}
+
+TEST(PerfCountersTest, Count) {
+  PerfCounters perf;
+  SKIP_IF(!perf.available()) << perf.error();
+
+  perf.start();
+  auto x = work(1000000);
+  auto values = perf.stop();
+  folly::compiler_must_not_elide(x);
+
+  ASSERT_TRUE(values.any());
+  if (!std::isnan(values.instructions)) {
+    EXPECT_GT(values.instructions, 1000000);
+  }
+  if (!std::isnan(values.cycles)) {
+    EXPECT_GT(values.cycles, 0);
+  }
+
+  // start() resets the counts.
+  perf.start();
+  auto again = perf.stop();
+  if (!std::isnan(values.instructions)) {
+    EXPECT_LT(again.instructions, values.instructions / 10);
+  }
+}
+
+TEST(PerfCountersTest, Pause) {
+  PerfCounters perf;
+  SKIP_IF(!perf.available()) << perf.error();
+
+  perf.start();
+  perf.pause();
+  auto x = work(10000000);
+  perf.resume();
+  auto values = perf.stop();
+  folly::compiler_must_not_elide(x);
+
+  SKIP_IF(std::isnan(values.instructions)) << "Can't count instructions";
+  EXPECT_LT(values.instructions, 1000000);
+}
+
+} // namespace detail
+} // namespace folly
@@ -23,6 +23,7 @@
 #include <folly/portability/PThread.h>
 #include <folly/synchronization/AsymmetricThreadFence.h>
 #include <folly/tracing/StaticTracepoint.h>
+#include <folly/tracing/TraceRingBuffer.h>
 
 namespace folly {
 
@@ -128,6 +129,7 @@ void ThreadPoolExecutor::runTask(const ThreadPtr& thread, Task&& task) {
   forEachTaskObserver([&](auto& observer) { observer.taskDequeued(taskInfo); });
 
   {
+    TraceRingBufferScope traceScope("ThreadPoolExecutor::runTask");
     folly::RequestContextScopeGuard rctx(task.context_);
     if (task.expiration_ != nullptr &&
         taskInfo.waitTime >= task.expiration_->expiration) {
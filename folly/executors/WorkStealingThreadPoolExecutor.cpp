@@ -0,0 +1,349 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <utility>
+
+#include <folly/Likely.h>
+#include <folly/ScopeGuard.h>
+#include <folly/portability/Asm.h>
+#include <folly/small_vector.h>
+
+namespace folly {
+
+namespace {
+
+// A worker polls the shared queue at least once every this many tasks, so
+// that tasks added from outside the pool are not starved by the ones that
+// workers keep adding to their own queues.
+constexpr uint32_t kSharedQueueInterval = 61;
+
+// A worker takes at most this many tasks in a row from the back of its own
+// queue before it takes the oldest one, so that a task that keeps
+// rescheduling itself can't starve the others.
+constexpr uint32_t kMaxLifoRuns = 16;
+
+// Upper bound on the number of tasks taken from a victim in one steal.
+constexpr size_t kMaxStealBatch = 32;
+
+// An idle worker that sees a pending task it can't find spins this many
+// times before it starts yielding between attempts.
+constexpr uint32_t kMaxSpins = 64;
+
+} // namespace
+
+struct WorkStealingThreadPoolExecutor::WorkerThread : public Thread {
+  explicit WorkerThread(WorkStealingThreadPoolExecutor* ex)
+      : executor(ex), rng(static_cast<uint32_t>(id)) {}
+
+  WorkStealingThreadPoolExecutor* const executor;
+
+  // Tasks are pushed to and popped from the back by the owner, and stolen
+  // from the front by other workers.
+  std::mutex mutex;
+  std::deque<Task> queue;
+  // Mirrors queue.size(), so that thieves can skip empty queues without
+  // taking the lock.
+  std::atomic<size_t> size{0};
+
+  // Only accessed by the owner.
+  uint32_t ticks = 0;
+  uint32_t numLifoRuns = 0;
+  std::minstd_rand rng;
+};
+
+WorkStealingThreadPoolExecutor::WorkStealingThreadPoolExecutor(
+    size_t numThreads, std::shared_ptr<ThreadFactory> threadFactory)
+    : ThreadPoolExecutor(numThreads, numThreads, std::move(threadFactory)) {
+  setNumThreads(numThreads);
+  registerThreadPoolExecutor(this);
+}
+
+WorkStealingThreadPoolExecutor::~WorkStealingThreadPoolExecutor() {
+  deregisterThreadPoolExecutor(this);
+  stop();
+}
+
+void WorkStealingThreadPoolExecutor::add(Func func) {
+  add(std::move(func), std::chrono::milliseconds(0));
+}
+
+void WorkStealingThreadPoolExecutor::add(
+    Func func, std::chrono::milliseconds expiration, Func expireCallback) {
+  Task task(std::move(func), expiration, std::move(expireCallback));
+  registerTaskEnqueue(task);
+
+  // See CPUThreadPoolExecutor::addImpl().
+  bool mayNeedToAddThreads = minThreads_.load(std::memory_order_relaxed) == 0 ||
+      activeThreads_.load(std::memory_order_relaxed) <
+          maxThreads_.load(std::memory_order_relaxed);
+  Executor::KeepAlive<> ka = mayNeedToAddThreads
+      ? getKeepAliveToken(this)
+      : Executor::KeepAlive<>{};
+
+  auto* worker = currentWorker();
+  if (worker != nullptr && worker->executor == this) {
+    std::lock_guard g(worker->mutex);
+    worker->queue.push_back(std::move(task));
+    worker->size.store(worker->queue.size(), std::memory_order_relaxed);
+  } else {
+    globalQueue_.enqueue(std::move(task));
+  }
+
+  numPending_.fetch_add(1, std::memory_order_seq_cst);
+  if (numIdleThreads_.load(std::memory_order_seq_cst) > 0) {
+    // An idle worker either takes this task, or steals it if it was added
+    // to the queue of a busy worker.
+    sem_.post();
+  }
+
+  if (mayNeedToAddThreads) {
+    ensureActiveThreads();
+  }
+}
+
+ThreadPoolExecutor::ThreadPtr WorkStealingThreadPoolExecutor::makeThread() {
+  return std::make_shared<WorkerThread>(this);
+}
+
+WorkStealingThreadPoolExecutor::WorkerThread*&
+WorkStealingThreadPoolExecutor::currentWorker() {
+  static thread_local WorkerThread* worker = nullptr;
+  return worker;
+}
+
+void WorkStealingThreadPoolExecutor::threadRun(ThreadPtr thread) {
+  this->threadPoolHook_.registerThread();
+  ExecutorBlockingGuard guard{
+      ExecutorBlockingGuard::TrackTag{}, this, getName()};
+
+  auto& worker = static_cast<WorkerThread&>(*thread);
+  currentWorker() = &worker;
+  SCOPE_EXIT {
+    currentWorker() = nullptr;
+  };
+
+  thread->startupBaton.post();
+  while (auto task = take(worker)) {
+    runTask(thread, std::move(*task));
+  }
+
+  // Actually remove the thread from the list.
+  std::unique_lock w{threadListLock_};
+  for (auto& o : observers_) {
+    o->threadStopped(thread.get());
+  }
+  // If the thread is stopped rather than joined, it may still have tasks in
+  // its queue. Hand them over to the remaining threads.
+  size_t numHandedOver = 0;
+  {
+    std::lock_guard g(worker.mutex);
+    numHandedOver = worker.queue.size();
+    for (auto& task : worker.queue) {
+      globalQueue_.enqueue(std::move(task));
+    }
+    worker.queue.clear();
+    worker.size.store(0, std::memory_order_relaxed);
+  }
+  if (numHandedOver > 0 &&
+      numIdleThreads_.load(std::memory_order_seq_cst) > 0) {
+    sem_.post(static_cast<uint32_t>(numHandedOver));
+  }
+  threadList_.remove(thread);
+  stoppedThreads_.add(thread);
+}
+
+void WorkStealingThreadPoolExecutor::stopThreads(size_t numThreads) {
+  threadsToStop_.fetch_add(numThreads, std::memory_order_relaxed);
+  sem_.post(static_cast<uint32_t>(numThreads));
+}
+
+// threadListLock_ is read (or write) locked.
+size_t WorkStealingThreadPoolExecutor::getPendingTaskCountImpl() const {
+  auto pending = numPending_.load(std::memory_order_relaxed);
+  return pending > 0 ? static_cast<size_t>(pending) : 0;
+}
+
+bool WorkStealingThreadPoolExecutor::shouldStop() {
+  // See EDFThreadPoolExecutor::shouldStop().
+  if (threadsToStop_.load(std::memory_order_relaxed) <= 0 ||
+      isJoin_.load(std::memory_order_relaxed)) {
+    return false;
+  }
+  if (threadsToStop_.fetch_sub(1, std::memory_order_relaxed) > 0) {
+    return true;
+  } else {
+    threadsToStop_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+}
+
+Optional<ThreadPoolExecutor::Task> WorkStealingThreadPoolExecutor::take(
+    WorkerThread& worker) {
+  if (FOLLY_UNLIKELY(shouldStop())) {
+    return none;
+  }
+
+  if (auto task = findTask(worker)) {
+    return task;
+  }
+
+  if (FOLLY_UNLIKELY(isJoin_.load(std::memory_order_acquire))) {
+    // Tasks added before join() was called may have been missed above.
+    return findTask(worker);
+  }
+
+  numIdleThreads_.fetch_add(1, std::memory_order_seq_cst);
+  SCOPE_EXIT {
+    numIdleThreads_.fetch_sub(1, std::memory_order_seq_cst);
+  };
+
+  uint32_t numSpins = 0;
+  for (;;) {
+    if (FOLLY_UNLIKELY(shouldStop())) {
+      return none;
+    }
+
+    if (auto task = findTask(worker)) {
+      return task;
+    }
+
+    if (FOLLY_UNLIKELY(isJoin_.load(std::memory_order_acquire))) {
+      return findTask(worker);
+    }
+
+    // The scan above reads the queue sizes with relaxed loads, so it can miss
+    // a task added to the queue of a busy worker by an add() that also missed
+    // our numIdleThreads_ increment and did not post. Both counters are
+    // updated with seq_cst RMWs, so either add() sees this worker as idle, or
+    // this load sees the task as pending and the scan is retried.
+    if (numPending_.load(std::memory_order_seq_cst) > 0) {
+      // The task may be in transit between queues while being stolen, in
+      // which case the thief may need our CPU to finish moving it.
+      if (++numSpins < kMaxSpins) {
+        asm_volatile_pause();
+      } else {
+        std::this_thread::yield();
+      }
+      continue;
+    }
+
+    numSpins = 0;
+    sem_.wait();
+  }
+}
+
+Optional<ThreadPoolExecutor::Task> WorkStealingThreadPoolExecutor::findTask(
+    WorkerThread& worker) {
+  Optional<Task> task;
+  if (++worker.ticks % kSharedQueueInterval == 0) {
+    task = globalQueue_.try_dequeue();
+  }
+  if (!task) {
+    task = popLocal(worker);
+  }
+  if (!task) {
+    task = globalQueue_.try_dequeue();
+  }
+  if (!task) {
+    task = steal(worker);
+  }
+  if (task) {
+    numPending_.fetch_sub(1, std::memory_order_relaxed);
+  }
+  return task;
+}
+
+Optional<ThreadPoolExecutor::Task> WorkStealingThreadPoolExecutor::popLocal(
+    WorkerThread& worker) {
+  if (worker.size.load(std::memory_order_relaxed) == 0) {
+    // Only the owner adds to its queue, so this can't miss a task.
+    worker.numLifoRuns = 0;
+    return none;
+  }
+
+  std::lock_guard g(worker.mutex);
+  auto& queue = worker.queue;
+  if (queue.empty()) {
+    worker.numLifoRuns = 0;
+    return none;
+  }
+  Optional<Task> task;
+  if (worker.numLifoRuns < kMaxLifoRuns) {
+    ++worker.numLifoRuns;
+    task.emplace(std::move(queue.back()));
+    queue.pop_back();
+  } else {
+    worker.numLifoRuns = 0;
+    task.emplace(std::move(queue.front()));
+    queue.pop_front();
+  }
+  worker.size.store(queue.size(), std::memory_order_relaxed);
+  return task;
+}
+
+Optional<ThreadPoolExecutor::Task> WorkStealingThreadPoolExecutor::steal(
+    WorkerThread& worker) {
+  small_vector<Task, kMaxStealBatch> stolen;
+  {
+    std::shared_lock r{threadListLock_};
+    const auto& threads = threadList_.get();
+    const size_t numThreads = threads.size();
+    if (numThreads <= 1) {
+      return none;
+    }
+    const size_t start = worker.rng() % numThreads;
+    for (size_t i = 0; i < numThreads && stolen.empty(); ++i) {
+      auto& victim =
+          static_cast<WorkerThread&>(*threads[(start + i) % numThreads]);
+      if (&victim == &worker ||
+          victim.size.load(std::memory_order_relaxed) == 0) {
+        continue;
+      }
+      std::lock_guard g(victim.mutex);
+      auto& queue = victim.queue;
+      const size_t n = std::min((queue.size() + 1) / 2, kMaxStealBatch);
+      for (size_t j = 0; j < n; ++j) {
+        stolen.push_back(std::move(queue.front()));
+        queue.pop_front();
+      }
+      victim.size.store(queue.size(), std::memory_order_relaxed);
+    }
+  }
+  if (stolen.empty()) {
+    return none;
+  }
+
+  numStolenTasks_.fetch_add(stolen.size(), std::memory_order_relaxed);
+  // Run the oldest stolen task now, and keep the rest, which can in turn be
+  // stolen by other idle workers.
+  Optional<Task> task(std::move(stolen.front()));
+  if (stolen.size() > 1) {
+    std::lock_guard g(worker.mutex);
+    for (size_t j = 1; j < stolen.size(); ++j) {
+      worker.queue.push_back(std::move(stolen[j]));
+    }
+    worker.size.store(worker.queue.size(), std::memory_order_relaxed);
+  }
+  return task;
+}
+
+} // namespace folly
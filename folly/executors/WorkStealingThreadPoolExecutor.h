@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <folly/Optional.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/executors/ThreadPoolExecutor.h>
+#include <folly/synchronization/ThrottledLifoSem.h>
+
+namespace folly {
+
+/**
+ * WorkStealingThreadPoolExecutor is a thread pool in which every worker
+ * thread owns a task queue, designed for fork-join workloads such as
+ * folly::coro Tasks that fan out into many small child tasks.
+ *
+ * Tasks added from a worker thread of the pool, e.g. the continuation of a
+ * coroutine that is resumed by a completing child, or the children started
+ * by collectAll(co_withExecutor(ex, ...)...), go to that worker's own queue
+ * and the worker runs the most recently added one next, while its caches
+ * are still warm. Tasks added from any other thread go to a shared queue.
+ * A worker that runs out of tasks takes from the shared queue, and then
+ * steals the oldest half of the tasks of another worker, so the largest
+ * pieces of unstarted work migrate between threads. Only idle workers
+ * sleep, and they are woken when tasks are added.
+ *
+ * When a coroutine awaits another Task on the same executor, folly::coro
+ * already transfers control between them without going through the
+ * executor at all; this pool only affects the resumptions that do.
+ *
+ * To keep LIFO scheduling from starving older tasks, a worker takes the
+ * oldest task of its own queue after a bounded number of newest ones, and
+ * regularly polls the shared queue even while its own queue is non-empty.
+ * Note that this makes the pool a poor fit for tasks that must run in
+ * submission order; use CPUThreadPoolExecutor for those.
+ *
+ * Like other ThreadPoolExecutors, stop() lets running tasks finish and
+ * drops pending ones, and join() runs all pending tasks, including any that
+ * they add, before returning. Coroutines that are still pending on a
+ * stopped executor are never resumed, so code that uses AsyncScope or
+ * CancellationToken with this pool should join its scopes (after
+ * requesting cancellation, if needed) before stopping the executor.
+ */
+class WorkStealingThreadPoolExecutor : public ThreadPoolExecutor {
+ public:
+  explicit WorkStealingThreadPoolExecutor(
+      size_t numThreads,
+      std::shared_ptr<ThreadFactory> threadFactory =
+          std::make_shared<NamedThreadFactory>("WorkStealingThreadPool"));
+
+  ~WorkStealingThreadPoolExecutor() override;
+
+  void add(Func func) override;
+  void add(
+      Func func,
+      std::chrono::milliseconds expiration,
+      Func expireCallback = nullptr) override;
+
+  /**
+   * Returns the number of tasks that workers have taken from the queues of
+   * other workers.
+   */
+  uint64_t getNumStolenTasks() const {
+    return numStolenTasks_.load(std::memory_order_relaxed);
+  }
+
+ protected:
+  ThreadPtr makeThread() override;
+  void threadRun(ThreadPtr thread) override;
+  void stopThreads(size_t numThreads) override;
+  size_t getPendingTaskCountImpl() const override final;
+
+ private:
+  struct WorkerThread;
+
+  static WorkerThread*& currentWorker();
+
+  bool shouldStop();
+  Optional<Task> take(WorkerThread& worker);
+  Optional<Task> findTask(WorkerThread& worker);
+  Optional<Task> popLocal(WorkerThread& worker);
+  Optional<Task> steal(WorkerThread& worker);
+
+  UMPMCQueue<Task, /* MayBlock */ false, 6> globalQueue_;
+  ThrottledLifoSem sem_;
+  std::atomic<int> threadsToStop_{0};
+  std::atomic<uint64_t> numStolenTasks_{0};
+
+  // Incremented after a task is queued and decremented after it is taken,
+  // so it may be transiently negative. Together with numIdleThreads_, it
+  // forms a Dekker-style handshake between add() and workers that are about
+  // to sleep on sem_, hence the sequentially consistent accesses.
+  std::atomic<int64_t> numPending_{0};
+  std::atomic<size_t> numIdleThreads_{0};
+};
+
+} // namespace folly
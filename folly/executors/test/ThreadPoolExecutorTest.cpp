@@ -33,6 +33,7 @@
 #include <folly/executors/FutureExecutor.h>
 #include <folly/executors/IOThreadPoolExecutor.h>
 #include <folly/executors/VirtualExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
 #include <folly/executors/task_queue/LifoSemMPMCQueue.h>
 #include <folly/executors/task_queue/UnboundedBlockingQueue.h>
 #include <folly/executors/thread_factory/InitThreadFactory.h>
@@ -103,8 +104,11 @@ FOLLY_KEEP std::unique_ptr<QueueObserverFactory> make_queue_observer_factory(
 template <typename T>
 class ThreadPoolExecutorTypedTest : public ::testing::Test {};
 
-using ValueTypes = ::testing::
-    Types<CPUThreadPoolExecutor, IOThreadPoolExecutor, EDFThreadPoolExecutor>;
+using ValueTypes = ::testing::Types<
+    CPUThreadPoolExecutor,
+    IOThreadPoolExecutor,
+    EDFThreadPoolExecutor,
+    WorkStealingThreadPoolExecutor>;
 
 TYPED_TEST_SUITE(ThreadPoolExecutorTypedTest, ValueTypes);
 
@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <memory>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/Task.h>
+#include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+#include <folly/portability/GFlags.h>
+
+#if FOLLY_HAS_COROUTINES
+
+using namespace folly;
+
+static constexpr size_t kNumThreads = 8;
+
+namespace {
+
+coro::Task<uint64_t> fib(Executor::KeepAlive<> ex, int n) {
+  if (n < 2) {
+    co_return n;
+  }
+  auto [a, b] = co_await coro::collectAll(
+      co_withExecutor(ex, fib(ex, n - 1)), co_withExecutor(ex, fib(ex, n - 2)));
+  co_return a + b;
+}
+
+coro::Task<void> smallTask() {
+  uint64_t sum = 0;
+  for (uint64_t i = 0; i < 100; ++i) {
+    sum += i;
+    doNotOptimizeAway(sum);
+  }
+  co_return;
+}
+
+coro::Task<void> fanOut(Executor::KeepAlive<> ex, size_t numTasks) {
+  std::vector<coro::TaskWithExecutor<void>> tasks;
+  tasks.reserve(numTasks);
+  for (size_t i = 0; i < numTasks; ++i) {
+    tasks.push_back(co_withExecutor(ex, smallTask()));
+  }
+  co_await coro::collectAllRange(std::move(tasks));
+}
+
+} // namespace
+
+void recursiveFib(
+    uint32_t iters, std::unique_ptr<ThreadPoolExecutor> ex, int n) {
+  auto ka = getKeepAliveToken(*ex);
+  while (iters--) {
+    doNotOptimizeAway(coro::blockingWait(co_withExecutor(ka, fib(ka, n))));
+  }
+}
+
+BENCHMARK_NAMED_PARAM(
+    recursiveFib,
+    CPUEx_fib20,
+    std::make_unique<CPUThreadPoolExecutor>(kNumThreads),
+    20)
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    recursiveFib,
+    WSEx_fib20,
+    std::make_unique<WorkStealingThreadPoolExecutor>(kNumThreads),
+    20)
+
+BENCHMARK_DRAW_LINE();
+
+void collectSmallTasks(
+    uint32_t iters, std::unique_ptr<ThreadPoolExecutor> ex, size_t numTasks) {
+  auto ka = getKeepAliveToken(*ex);
+  while (iters--) {
+    coro::blockingWait(co_withExecutor(ka, fanOut(ka, numTasks)));
+  }
+}
+
+BENCHMARK_NAMED_PARAM(
+    collectSmallTasks,
+    CPUEx_10k,
+    std::make_unique<CPUThreadPoolExecutor>(kNumThreads),
+    10000)
+BENCHMARK_RELATIVE_NAMED_PARAM(
+    collectSmallTasks,
+    WSEx_10k,
+    std::make_unique<WorkStealingThreadPoolExecutor>(kNumThreads),
+    10000)
+
+#endif
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/executors/WorkStealingThreadPoolExecutor.h>
+
+#include <atomic>
+#include <chrono>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/Synchronized.h>
+#include <folly/coro/AsyncScope.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/coro/Invoke.h>
+#include <folly/coro/Sleep.h>
+#include <folly/coro/Task.h>
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+
+using namespace folly;
+
+TEST(WorkStealingThreadPoolExecutorTest, ExternalTasksRunInOrder) {
+  WorkStealingThreadPoolExecutor ex(1);
+  Baton<> release;
+  ex.add([&] { release.wait(); });
+  std::vector<int> order;
+  for (int i = 0; i < 10; ++i) {
+    ex.add([&, i] { order.push_back(i); });
+  }
+  release.post();
+  ex.join();
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, LocalTasksRunNewestFirst) {
+  WorkStealingThreadPoolExecutor ex(1);
+  std::vector<int> order;
+  ex.add([&] {
+    for (int i = 0; i < 3; ++i) {
+      ex.add([&, i] { order.push_back(i); });
+    }
+  });
+  ex.join();
+  EXPECT_EQ((std::vector<int>{2, 1, 0}), order);
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, ReschedulingTaskDoesNotStarveOthers) {
+  WorkStealingThreadPoolExecutor ex(1);
+  std::atomic<bool> ran{false};
+  int reschedules = 0;
+  Function<void()> yield = [&] {
+    if (!ran.load() && ++reschedules < 1000) {
+      ex.add([&] { yield(); });
+    }
+  };
+  ex.add([&] {
+    ex.add([&] { ran = true; });
+    ex.add([&] { yield(); });
+  });
+  ex.join();
+  EXPECT_TRUE(ran.load());
+  EXPECT_GT(100, reschedules);
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, IdleWorkersSteal) {
+  WorkStealingThreadPoolExecutor ex(4);
+  Synchronized<std::set<std::thread::id>> threadIds;
+  ex.add([&] {
+    for (int i = 0; i < 100; ++i) {
+      ex.add([&] {
+        threadIds.wlock()->insert(std::this_thread::get_id());
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      });
+    }
+  });
+  ex.join();
+  EXPECT_LT(1u, threadIds.rlock()->size());
+  EXPECT_LT(0u, ex.getNumStolenTasks());
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, StopHandsOverLocalTasks) {
+  WorkStealingThreadPoolExecutor ex(2);
+  Baton<> added;
+  Baton<> ran;
+  ex.add([&] {
+    ex.add([&] { ran.post(); });
+    added.post();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  });
+  added.wait();
+  // Either the worker that added the task stops after its current one and
+  // hands over its queue, or the other worker steals the task.
+  ex.setNumThreads(1);
+  EXPECT_TRUE(ran.try_wait_for(std::chrono::seconds(10)));
+}
+
+#if FOLLY_HAS_COROUTINES
+
+namespace {
+
+coro::Task<uint64_t> fib(Executor::KeepAlive<> ex, int n) {
+  if (n < 2) {
+    co_return n;
+  }
+  auto [a, b] = co_await coro::collectAll(
+      co_withExecutor(ex, fib(ex, n - 1)), co_withExecutor(ex, fib(ex, n - 2)));
+  co_return a + b;
+}
+
+} // namespace
+
+TEST(WorkStealingThreadPoolExecutorTest, CoroForkJoin) {
+  WorkStealingThreadPoolExecutor ex(4);
+  auto ka = getKeepAliveToken(ex);
+  EXPECT_EQ(6765, coro::blockingWait(co_withExecutor(ka, fib(ka, 20))));
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, CoroAsyncScope) {
+  WorkStealingThreadPoolExecutor ex(4);
+  coro::AsyncScope scope;
+  std::atomic<int> done{0};
+  for (int i = 0; i < 1000; ++i) {
+    scope.add(co_withExecutor(&ex, coro::co_invoke([&]() -> coro::Task<void> {
+      co_await coro::co_reschedule_on_current_executor;
+      ++done;
+    })));
+  }
+  coro::blockingWait(scope.joinAsync());
+  EXPECT_EQ(1000, done.load());
+}
+
+TEST(WorkStealingThreadPoolExecutorTest, CoroCancellation) {
+  WorkStealingThreadPoolExecutor ex(4);
+  coro::CancellableAsyncScope scope;
+  std::atomic<int> cancelled{0};
+  for (int i = 0; i < 100; ++i) {
+    scope.add(co_withExecutor(&ex, coro::co_invoke([&]() -> coro::Task<void> {
+      auto result =
+          co_await coro::co_awaitTry(coro::sleep(std::chrono::hours(1)));
+      if (result.hasException<OperationCancelled>()) {
+        ++cancelled;
+      }
+    })));
+  }
+  coro::blockingWait(scope.cancelAndJoinAsync());
+  EXPECT_EQ(100, cancelled.load());
+}
+
+#endif
@@ -0,0 +1,296 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <folly/Function.h>
+#include <folly/fibers/FiberManagerInternal.h>
+#include <folly/fibers/LoopController.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <folly/io/async/HHWheelTimer.h>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * AdaptiveBatchDispatcher batches values like BatchDispatcher, but instead of
+ * dispatching whatever was added within one FiberManager loop turn, it keeps
+ * a batch open for up to Options::maxDelay, or until it holds
+ * Options::maxBatchSize values, whichever comes first. This trades a bounded
+ * amount of latency for larger batches under low load.
+ *
+ * The window is driven by the timer of the FiberManager's LoopController, so
+ * its resolution is the timer's tick interval (for an EventBase, see
+ * EventBase::Options::timerTickInterval). A batch whose deadline has already
+ * passed is also dispatched by the next add() call.
+ *
+ * If Options::targetLatency is set, the dispatcher measures how long the
+ * dispatch function takes and adjusts the batch size limit between
+ * Options::minBatchSize and Options::maxBatchSize: the limit is halved when a
+ * batch takes longer than the target while the smoothed dispatch latency is
+ * above it too, and grown by a quarter when a full batch completes while the
+ * smoothed latency is below it. A single slow batch thus halves the limit
+ * once, rather than on every batch until the average has recovered.
+ *
+ * The dispatch function is run on a fiber of the FiberManager, so it may
+ * block (e.g. on a future or a Baton). Several batches may be in flight at
+ * the same time. add() returns a Future, which fibers can wait on with
+ * get() and coroutines can co_await.
+ *
+ * Example:
+ *
+ *   AdaptiveBatchDispatcher<int, std::string>::Options options;
+ *   options.maxBatchSize = 128;
+ *   options.targetLatency = std::chrono::milliseconds(5);
+ *   AdaptiveBatchDispatcher<int, std::string> dispatcher(
+ *       fm, [](std::vector<int>&& ids) { return fetchAll(ids); }, options);
+ *   ...
+ *   auto value = dispatcher.add(id).get();
+ *
+ * Note:
+ *  - add() has to be called from the thread running the FiberManager.
+ *  - Destroying the dispatcher dispatches the pending batch immediately.
+ */
+template <typename ValueT, typename ResultT>
+class AdaptiveBatchDispatcher {
+ public:
+  using ValueBatchT = std::vector<ValueT>;
+  using ResultBatchT = std::vector<ResultT>;
+  using PromiseBatchT = std::vector<folly::Promise<ResultT>>;
+  using DispatchFunctionT = folly::Function<ResultBatchT(ValueBatchT&&)>;
+  using Clock = std::chrono::steady_clock;
+
+  struct Options {
+    /**
+     * Batches are dispatched as soon as they hold this many values.
+     */
+    size_t maxBatchSize{64};
+
+    /**
+     * Longest time the first value of a batch waits for more values before
+     * the batch is dispatched.
+     */
+    std::chrono::microseconds maxDelay{std::chrono::milliseconds(1)};
+
+    /**
+     * Dispatch latency the batch size limit is tuned for. Zero disables
+     * adaptive sizing, so that batches are always limited by maxBatchSize.
+     */
+    std::chrono::microseconds targetLatency{0};
+
+    /**
+     * Smallest batch size limit adaptive sizing may shrink to.
+     */
+    size_t minBatchSize{1};
+  };
+
+  struct Stats {
+    size_t batchesDispatched{0};
+    size_t valuesDispatched{0};
+    /* Batches dispatched because their window expired before they filled. */
+    size_t batchesTimedOut{0};
+    /* Current batch size limit. */
+    size_t batchSizeLimit{0};
+    /* Exponentially weighted moving average of the dispatch latency. */
+    std::chrono::microseconds dispatchLatency{0};
+  };
+
+  AdaptiveBatchDispatcher(
+      FiberManager& fm, DispatchFunctionT dispatchFunc, Options options = {})
+      : state_(std::make_shared<DispatchState>(
+            fm, std::move(dispatchFunc), std::move(options))) {}
+
+  ~AdaptiveBatchDispatcher() { state_->dispatch(); }
+
+  AdaptiveBatchDispatcher(const AdaptiveBatchDispatcher&) = delete;
+  AdaptiveBatchDispatcher& operator=(const AdaptiveBatchDispatcher&) = delete;
+
+  Future<ResultT> add(ValueT value) {
+    auto& state = *state_;
+    if (state.values.empty()) {
+      state.openWindow();
+    }
+
+    folly::Promise<ResultT> resultPromise;
+    auto resultFuture = resultPromise.getFuture();
+
+    state.values.emplace_back(std::move(value));
+    state.promises.emplace_back(std::move(resultPromise));
+
+    if (state.values.size() >= state.batchSizeLimit ||
+        Clock::now() >= state.deadline) {
+      state.dispatch();
+    }
+
+    return resultFuture;
+  }
+
+  /**
+   * Dispatches the pending batch without waiting for its window to expire.
+   */
+  void flush() { state_->dispatch(); }
+
+  Stats stats() const {
+    Stats stats = state_->stats;
+    stats.batchSizeLimit = state_->batchSizeLimit;
+    stats.dispatchLatency =
+        std::chrono::microseconds(int64_t(state_->dispatchLatencyUs));
+    return stats;
+  }
+
+ private:
+  struct DispatchState;
+
+  struct BatchTask {
+    std::shared_ptr<DispatchState> state;
+    ValueBatchT values;
+    PromiseBatchT promises;
+
+    void operator()() {
+      state->dispatchFunctionWrapper(std::move(values), std::move(promises));
+    }
+  };
+
+  struct DispatchState : private HHWheelTimer::Callback,
+                         public std::enable_shared_from_this<DispatchState> {
+    DispatchState(
+        FiberManager& fiberManager,
+        DispatchFunctionT&& dispatchFunction,
+        Options&& opts)
+        : fm(fiberManager),
+          dispatchFunc(std::move(dispatchFunction)),
+          options(std::move(opts)) {
+      options.maxBatchSize = std::max<size_t>(options.maxBatchSize, 1);
+      options.minBatchSize =
+          std::clamp<size_t>(options.minBatchSize, 1, options.maxBatchSize);
+      batchSizeLimit = options.maxBatchSize;
+    }
+
+    void openWindow() {
+      deadline = Clock::now() + options.maxDelay;
+      if (auto* timer = fm.loopController().timer()) {
+        timer->scheduleTimeout(
+            this,
+            std::chrono::ceil<std::chrono::milliseconds>(options.maxDelay));
+      } else {
+        fm.add([self = this->shared_from_this()] { self->dispatch(); });
+      }
+    }
+
+    void timeoutExpired() noexcept override {
+      if (!values.empty()) {
+        ++stats.batchesTimedOut;
+        dispatch();
+      }
+    }
+
+    void dispatch() {
+      cancelTimeout();
+      if (values.empty()) {
+        return;
+      }
+      ++stats.batchesDispatched;
+      stats.valuesDispatched += values.size();
+      BatchTask task{
+          this->shared_from_this(),
+          std::exchange(values, {}),
+          std::exchange(promises, {})};
+      // dispatch() is called from timeoutExpired() and the destructor, which
+      // must not throw, so a failure to create the fiber fails the batch
+      // instead. The promises are still in task unless it was moved into
+      // the fiber.
+      try {
+        fm.addTask(std::move(task));
+      } catch (...) {
+        failBatch(task.promises, exception_wrapper(current_exception()));
+      }
+    }
+
+    static void failBatch(PromiseBatchT& ps, const exception_wrapper& ew) {
+      for (auto& p : ps) {
+        p.setException(ew);
+      }
+    }
+
+    void dispatchFunctionWrapper(ValueBatchT&& batch, PromiseBatchT&& ps) {
+      auto batchSize = batch.size();
+      auto start = Clock::now();
+      try {
+        auto results = dispatchFunc(std::move(batch));
+        if (results.size() != ps.size()) {
+          throw std::logic_error(
+              "Unexpected number of results returned from dispatch function");
+        }
+
+        for (size_t i = 0; i < ps.size(); i++) {
+          ps[i].setValue(std::move(results[i]));
+        }
+      } catch (...) {
+        failBatch(ps, exception_wrapper(current_exception()));
+      }
+      recordLatency(Clock::now() - start, batchSize);
+    }
+
+    void recordLatency(Clock::duration latency, size_t batchSize) {
+      auto latencyUs =
+          std::chrono::duration<double, std::micro>(latency).count();
+      dispatchLatencyUs = latencyRecorded
+          ? dispatchLatencyUs + (latencyUs - dispatchLatencyUs) / 8
+          : latencyUs;
+      latencyRecorded = true;
+
+      if (options.targetLatency.count() == 0) {
+        return;
+      }
+      auto targetUs = double(options.targetLatency.count());
+      if (dispatchLatencyUs > targetUs) {
+        // The average lags behind: only shrink for batches that are slow
+        // themselves.
+        if (latencyUs > targetUs) {
+          batchSizeLimit = std::max(options.minBatchSize, batchSizeLimit / 2);
+        }
+      } else if (batchSize >= batchSizeLimit) {
+        batchSizeLimit = std::min(
+            options.maxBatchSize,
+            batchSizeLimit + std::max<size_t>(1, batchSizeLimit / 4));
+      }
+    }
+
+    FiberManager& fm;
+    DispatchFunctionT dispatchFunc;
+    Options options;
+    ValueBatchT values;
+    PromiseBatchT promises;
+    Clock::time_point deadline;
+    size_t batchSizeLimit;
+    double dispatchLatencyUs{0};
+    bool latencyRecorded{false};
+    Stats stats;
+  };
+
+  std::shared_ptr<DispatchState> state_;
+};
+
+} // namespace fibers
+} // namespace folly
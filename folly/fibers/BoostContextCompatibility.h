@@ -62,6 +62,12 @@ class FiberImpl {
     DCHECK_EQ(this, reinterpret_cast<FiberImpl*>(context));
   }
 
+  /**
+   * Address where the context of the suspended fiber is saved. Nothing
+   * below it on the fiber stack is in use while the fiber is suspended.
+   */
+  void* getSavedContext() const { return fiberContext_; }
+
   void* getStackPointer() const {
     if (kIsArchAmd64 && kIsLinux) {
       return reinterpret_cast<void**>(fiberContext_)[6];
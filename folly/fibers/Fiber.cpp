@@ -66,7 +66,7 @@ Fiber::Fiber(FiberManager& fiberManager)
     : fiberManager_(fiberManager),
       fiberStackSize_(fiberManager_.options_.stackSize),
       fiberStackHighWatermark_(0),
-      fiberStackLimit_(fiberManager_.stackAllocator_.allocate(fiberStackSize_)),
+      fiberStackLimit_(fiberManager_.allocateStack(fiberStackSize_)),
       fiberImpl_([this] { fiberFunc(); }, fiberStackLimit_, fiberStackSize_) {
   fiberManager_.allFibers_.push_back(*this);
 
@@ -113,7 +113,7 @@ Fiber::~Fiber() {
   __tsan_destroy_fiber(tsanCtx_);
 #endif
 
-  fiberManager_.stackAllocator_.deallocate(fiberStackLimit_, fiberStackSize_);
+  fiberManager_.deallocateStack(fiberStackLimit_, fiberStackSize_);
 }
 
 void Fiber::recordStackPosition() {
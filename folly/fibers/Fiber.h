@@ -141,6 +141,7 @@ class Fiber {
   TaskOptions taskOptions_;
   bool recordStackUsed_{false};
   bool stackFilledWithMagic_{false};
+  bool stackReleased_{false}; /**< unused stack was handed back to the OS */
   FiberManager& fiberManager_; /**< Associated FiberManager */
   size_t fiberStackSize_;
   size_t fiberStackHighWatermark_;
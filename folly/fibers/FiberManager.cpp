@@ -108,6 +108,7 @@ Fiber* FiberManager::getFiber() {
   } else {
     fiber = &fibersPool_.front();
     fibersPool_.pop_front();
+    fiber->stackReleased_ = false;
     auto fibersPoolSize = fibersPoolSize_.load(std::memory_order_relaxed);
     assert(fibersPoolSize > 0);
     fibersPoolSize_.store(fibersPoolSize - 1, std::memory_order_relaxed);
@@ -141,6 +142,56 @@ size_t FiberManager::stackHighWatermark() const {
   return stackHighWatermark_.load(std::memory_order_relaxed);
 }
 
+auto FiberManager::stackMemoryStats() const -> StackMemoryStats {
+  StackMemoryStats stats;
+  stats.stacksAllocated = fibersAllocated();
+  stats.stackBytesAllocated = stats.stacksAllocated * options_.stackSize;
+  if (pooledStackAllocator_) {
+    stats.stackBytesReserved = pooledStackAllocator_->bytesReserved();
+    stats.stackBytesResident = pooledStackAllocator_->bytesResident();
+  }
+  stats.stackBytesReleased = stackBytesReleased_;
+  return stats;
+}
+
+size_t FiberManager::trimStackMemory() {
+  if (!pooledStackAllocator_) {
+    return 0;
+  }
+  size_t released = 0;
+  for (auto& fiber : fibersPool_) {
+    // Stacks filled with magic values for stack usage recording must keep
+    // them.
+    if (fiber.stackReleased_ || fiber.stackFilledWithMagic_) {
+      continue;
+    }
+    auto limit = fiber.fiberStackLimit_;
+    auto context =
+        static_cast<unsigned char*>(fiber.fiberImpl_.getSavedContext());
+    DCHECK(limit <= context && context <= limit + fiber.fiberStackSize_);
+    released += pooledStackAllocator_->release(
+        limit, fiber.fiberStackSize_, size_t(context - limit));
+    fiber.stackReleased_ = true;
+  }
+  stackBytesReleased_ += released;
+  return released;
+}
+
+unsigned char* FiberManager::allocateStack(size_t size) {
+  if (pooledStackAllocator_) {
+    return pooledStackAllocator_->allocate(size);
+  }
+  return stackAllocator_.allocate(size);
+}
+
+void FiberManager::deallocateStack(unsigned char* limit, size_t size) {
+  if (pooledStackAllocator_) {
+    pooledStackAllocator_->deallocate(limit, size);
+  } else {
+    stackAllocator_.deallocate(limit, size);
+  }
+}
+
 void FiberManager::remoteReadyInsert(Fiber* fiber) {
   if (remoteReadyQueue_.insertHead(fiber)) {
     loopController_->scheduleThreadSafe();
@@ -180,6 +231,8 @@ void FiberManager::doFibersPoolResizing() {
   }
 
   maxFibersActiveLastPeriod_ = fibersActive_.load(std::memory_order_relaxed);
+
+  trimStackMemory();
 }
 
 void FiberManager::FibersPoolResizer::run() {
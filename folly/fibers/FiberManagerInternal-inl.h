@@ -616,6 +616,13 @@ FiberManager::FiberManager(
     : loopController_(std::move(loopController__)),
       stackAllocator_(options.guardPagesPerStack),
       options_(preprocessOptions(std::move(options))),
+      pooledStackAllocator_(
+          options_.usePooledStacks
+              ? std::make_unique<PooledStackAllocator>(
+                    options_.stackSize,
+                    options_.guardPagesPerStack,
+                    options_.pooledStacksUseHugePages)
+              : nullptr),
       exceptionCallback_(defaultExceptionCallback),
       fibersPoolResizer_(*this),
       localType_(typeid(LocalT)) {
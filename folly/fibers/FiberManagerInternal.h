@@ -41,6 +41,7 @@
 #include <folly/fibers/Fiber.h>
 #include <folly/fibers/GuardPageAllocator.h>
 #include <folly/fibers/LoopController.h>
+#include <folly/fibers/PooledStackAllocator.h>
 #include <folly/fibers/traits.h>
 
 namespace folly {
@@ -124,6 +125,21 @@ class FiberManager : public ::folly::Executor {
      */
     size_t guardPagesPerStack{1};
 
+    /**
+     * Allocate fiber stacks from a few large pooled regions (see
+     * PooledStackAllocator) instead of mapping each stack separately. This
+     * avoids a VMA per stack for managers running very many fibers. Every
+     * pooled stack gets guardPagesPerStack guard pages, which split the
+     * regions again; set guardPagesPerStack to 0 to keep them whole.
+     */
+    bool usePooledStacks{false};
+
+    /**
+     * With usePooledStacks, back the stack regions with transparent huge
+     * pages. Only effective with guardPagesPerStack = 0.
+     */
+    bool pooledStacksUseHugePages{false};
+
     /**
      * Free unnecessary fibers in the fibers pool every fibersPoolResizePeriodMs
      * milliseconds. If value is 0, periodic resizing of the fibers pool is
@@ -140,6 +156,8 @@ class FiberManager : public ::folly::Executor {
           recordStackEvery,
           maxFibersPoolSize,
           guardPagesPerStack,
+          usePooledStacks,
+          pooledStacksUseHugePages,
           fibersPoolResizePeriodMs);
     }
   };
@@ -398,6 +416,34 @@ class FiberManager : public ::folly::Executor {
    */
   size_t stackHighWatermark() const;
 
+  struct StackMemoryStats {
+    /** Fiber stacks currently allocated, including those of pooled fibers. */
+    size_t stacksAllocated{0};
+    /** Bytes of fiber stacks currently allocated. */
+    size_t stackBytesAllocated{0};
+    /** Address space reserved for pooled stacks. */
+    size_t stackBytesReserved{0};
+    /** Bytes of the reserved address space backed by physical memory. */
+    size_t stackBytesResident{0};
+    /** Total bytes handed back to the OS by trimStackMemory(). */
+    size_t stackBytesReleased{0};
+  };
+
+  /**
+   * @return Fiber stack memory usage of this manager. The reserved and
+   * resident byte counts are only tracked with Options::usePooledStacks.
+   */
+  StackMemoryStats stackMemoryStats() const;
+
+  /**
+   * Hands the unused part of the stacks of fibers in the free pool back to
+   * the OS. Only has an effect with Options::usePooledStacks; it also runs
+   * periodically if Options::fibersPoolResizePeriodMs is set.
+   *
+   * @return Number of bytes released.
+   */
+  size_t trimStackMemory();
+
   /**
    * Yield execution of the currently running fiber. Must only be called from a
    * fiber executing on this FiberManager. The calling fiber will be scheduled
@@ -531,6 +577,19 @@ class FiberManager : public ::folly::Executor {
 
   const Options options_; /**< FiberManager options */
 
+  /**
+   * Allocator used instead of stackAllocator_ if Options::usePooledStacks.
+   */
+  std::unique_ptr<PooledStackAllocator> pooledStackAllocator_;
+
+  /**
+   * Total bytes released by trimStackMemory().
+   */
+  size_t stackBytesReleased_{0};
+
+  unsigned char* allocateStack(size_t size);
+  void deallocateStack(unsigned char* limit, size_t size);
+
   /**
    * Largest observed individual Fiber stack usage in bytes.
    */
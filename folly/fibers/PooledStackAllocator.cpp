@@ -0,0 +1,182 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/fibers/PooledStackAllocator.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+
+#include <glog/logging.h>
+
+#include <folly/portability/SysMman.h>
+#include <folly/portability/Unistd.h>
+
+namespace folly {
+namespace fibers {
+
+namespace {
+
+/**
+ * Size of each region. Large enough for ~2k default-sized stacks, so that
+ * 100k fibers fit into a few dozen mappings.
+ */
+constexpr size_t kRegionSize = size_t(32) << 20;
+
+/**
+ * Alignment of regions backed by transparent huge pages.
+ */
+constexpr size_t kHugePageSize = size_t(2) << 20;
+
+size_t pagesize() {
+  static const auto pagesize = size_t(sysconf(_SC_PAGESIZE));
+  return pagesize;
+}
+
+size_t roundUp(size_t size, size_t alignment) {
+  return (size + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+PooledStackAllocator::PooledStackAllocator(
+    size_t stackSize, size_t guardPagesPerStack, bool useHugePages)
+    : stackSize_(stackSize),
+      guardSize_(guardPagesPerStack * pagesize()),
+      slotSize_(guardSize_ + roundUp(stackSize, pagesize())),
+      useHugePages_(useHugePages) {}
+
+PooledStackAllocator::~PooledStackAllocator() {
+  for (const auto& region : regions_) {
+    PCHECK(0 == ::munmap(region.mapping, region.mappingSize));
+  }
+}
+
+void PooledStackAllocator::addRegion() {
+  auto size = roundUp(std::max(kRegionSize, slotSize_), kHugePageSize);
+  // Over-reserve so that the region can be aligned for huge pages.
+  auto mappingSize = useHugePages_ ? size + kHugePageSize : size;
+  int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_NORESERVE
+  flags |= MAP_NORESERVE;
+#endif
+  auto p = ::mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, flags, -1, 0);
+  PCHECK(p != MAP_FAILED);
+  auto mapping = static_cast<unsigned char*>(p);
+  auto begin = mapping;
+  if (useHugePages_) {
+    begin = reinterpret_cast<unsigned char*>(
+        roundUp(reinterpret_cast<uintptr_t>(mapping), kHugePageSize));
+#ifdef MADV_HUGEPAGE
+    if (::madvise(begin, size, MADV_HUGEPAGE) != 0) {
+      PLOG(WARNING) << "madvise(MADV_HUGEPAGE) failed for fiber stacks";
+    }
+#endif
+  }
+  auto numSlots = size / slotSize_;
+  regions_.push_back(
+      {mapping, mappingSize, begin, begin + numSlots * slotSize_});
+  next_ = begin;
+  bytesReserved_ += numSlots * slotSize_;
+}
+
+bool PooledStackAllocator::owns(unsigned char* p) const {
+  return std::any_of(regions_.begin(), regions_.end(), [&](const auto& r) {
+    return std::less_equal<void*>{}(r.begin, p) &&
+        std::less<void*>{}(p, r.end);
+  });
+}
+
+unsigned char* PooledStackAllocator::allocate(size_t size) {
+  if (size != stackSize_) {
+    return fallbackAllocator_.allocate(size);
+  }
+  unsigned char* slot;
+  if (!freeList_.empty()) {
+    slot = freeList_.back();
+    freeList_.pop_back();
+  } else {
+    if (regions_.empty() || next_ == regions_.back().end) {
+      addRegion();
+    }
+    slot = next_;
+    next_ += slotSize_;
+    // Slots stay protected once used, since freed slots are only reused as
+    // stacks of the same size.
+    if (guardSize_ > 0) {
+      // Every guarded stack splits the region, so this may run into
+      // vm.max_map_count with very many fibers.
+      PCHECK(0 == ::mprotect(slot, guardSize_, PROT_NONE))
+          << "Failed to protect fiber stack guard pages; "
+          << "consider setting guardPagesPerStack to 0";
+    }
+  }
+  /* The stack is aligned at the top of its slot, since it grows down. */
+  return slot + slotSize_ - size;
+}
+
+void PooledStackAllocator::deallocate(unsigned char* limit, size_t size) {
+  if (size != stackSize_ || !owns(limit)) {
+    fallbackAllocator_.deallocate(limit, size);
+    return;
+  }
+  freeList_.push_back(limit + size - slotSize_);
+}
+
+size_t PooledStackAllocator::release(
+    unsigned char* limit, size_t size, size_t unusedBytes) {
+  if (size != stackSize_ || !owns(limit)) {
+    return 0;
+  }
+  auto slot = limit + size - slotSize_ + guardSize_;
+  auto end = reinterpret_cast<unsigned char*>(
+      reinterpret_cast<uintptr_t>(limit + std::min(unusedBytes, size)) /
+      pagesize() * pagesize());
+  if (end <= slot) {
+    return 0;
+  }
+  auto bytes = size_t(end - slot);
+#ifdef MADV_FREE
+  if (::madvise(slot, bytes, MADV_FREE) == 0) {
+    return bytes;
+  }
+#endif
+  PCHECK(0 == ::madvise(slot, bytes, MADV_DONTNEED));
+  return bytes;
+}
+
+size_t PooledStackAllocator::bytesResident() const {
+#ifdef __linux__
+  std::vector<unsigned char> vec;
+  size_t pages = 0;
+  for (const auto& region : regions_) {
+    auto end = &region == &regions_.back() ? next_ : region.end;
+    auto len = size_t(end - region.begin);
+    vec.resize(len / pagesize());
+    if (len == 0 || ::mincore(region.begin, len, vec.data()) != 0) {
+      continue;
+    }
+    pages += std::count_if(
+        vec.begin(), vec.end(), [](unsigned char c) { return c & 1; });
+  }
+  return pages * pagesize();
+#else
+  return bytesReserved_;
+#endif
+}
+
+} // namespace fibers
+} // namespace folly
@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace folly {
+namespace fibers {
+
+/**
+ * Stack allocator that carves fixed-size stacks out of a few large
+ * anonymous mappings instead of mapping every stack separately.
+ *
+ * Regions are reserved with MAP_NORESERVE and only committed as stacks
+ * touch them, so a region costs one VMA regardless of how many stacks it
+ * holds. Optionally, regions are aligned to and advised for transparent
+ * huge pages, which reduces TLB pressure and page faults for managers
+ * running very many fibers.
+ *
+ * Stacks are handed out LIFO so that recently used (and therefore
+ * resident) stacks are reused first. Memory of a stack that is known to be
+ * unused can be handed back to the OS with release().
+ *
+ * The bottom guardPagesPerStack pages of every slot are protected when the
+ * slot is first used, so that a stack overflow faults instead of corrupting
+ * the stack below it. Protecting pages splits the region into separate
+ * mappings again, so managers that need a single mapping per region (or
+ * huge pages, which protected pages would split) must opt out explicitly
+ * with guardPagesPerStack = 0.
+ *
+ * Not thread safe.
+ */
+class PooledStackAllocator {
+ public:
+  /**
+   * @param stackSize           size of every stack allocated from the pool.
+   *                            Other sizes fall back to std::allocator.
+   * @param guardPagesPerStack  number of protected pages below every stack.
+   * @param useHugePages        align regions to, and advise them for,
+   *                            transparent huge pages.
+   */
+  PooledStackAllocator(
+      size_t stackSize, size_t guardPagesPerStack, bool useHugePages);
+  ~PooledStackAllocator();
+
+  PooledStackAllocator(const PooledStackAllocator&) = delete;
+  PooledStackAllocator& operator=(const PooledStackAllocator&) = delete;
+
+  /**
+   * @return pointer to the bottom of the allocated stack of `size' bytes.
+   */
+  unsigned char* allocate(size_t size);
+
+  /**
+   * Deallocates the previous result of an `allocate(size)' call.
+   */
+  void deallocate(unsigned char* limit, size_t size);
+
+  /**
+   * Returns the physical memory backing the whole pages of
+   * [limit, limit + unusedBytes) to the OS, where `limit' is the result of an
+   * `allocate(size)' call. The stack stays allocated, but the contents of
+   * released pages are undefined afterwards.
+   *
+   * @return number of bytes released.
+   */
+  size_t release(unsigned char* limit, size_t size, size_t unusedBytes);
+
+  /**
+   * @return address space reserved for stacks, in bytes.
+   */
+  size_t bytesReserved() const { return bytesReserved_; }
+
+  /**
+   * @return bytes of reserved address space currently backed by physical
+   * memory. This inspects every reserved page and is meant for monitoring.
+   * Only supported on Linux; elsewhere returns bytesReserved().
+   */
+  size_t bytesResident() const;
+
+ private:
+  struct Region {
+    unsigned char* mapping;
+    size_t mappingSize;
+    unsigned char* begin;
+    unsigned char* end;
+  };
+
+  void addRegion();
+  bool owns(unsigned char* p) const;
+
+  const size_t stackSize_;
+  const size_t guardSize_;
+  /* Guard pages followed by the stack, rounded up to whole pages. */
+  const size_t slotSize_;
+  const bool useHugePages_;
+  std::vector<Region> regions_;
+  /* Next never-used slot of the last region; slots past it are untouched. */
+  unsigned char* next_{nullptr};
+  /* LIFO free list of previously used slots. */
+  std::vector<unsigned char*> freeList_;
+  size_t bytesReserved_{0};
+  std::allocator<unsigned char> fallbackAllocator_;
+};
+
+} // namespace fibers
+} // namespace folly
@@ -17,6 +17,8 @@
 #include <queue>
 
 #include <folly/Benchmark.h>
+#include <folly/fibers/AdaptiveBatchDispatcher.h>
+#include <folly/fibers/BatchDispatcher.h>
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/fibers/SimpleLoopController.h>
@@ -161,6 +163,38 @@ BENCHMARK(FiberManagerAllocateLargeChunk, iters) {
   }
 }
 
+void runLargeChunkStacksBenchmark(size_t iters, bool usePooledStacks) {
+  static const size_t kNumAllocations = 100000;
+
+  FiberManager::Options opts;
+  opts.maxFibersPoolSize = 0;
+  opts.usePooledStacks = usePooledStacks;
+
+  FiberManager fiberManager(std::make_unique<SimpleLoopController>(), opts);
+
+  for (size_t iter = 0; iter < iters; ++iter) {
+    size_t fibersRun = 0;
+
+    for (size_t i = 0; i < kNumAllocations; ++i) {
+      fiberManager.addTask([&fibersRun] { ++fibersRun; });
+    }
+
+    fiberManager.loopUntilNoReady();
+
+    DCHECK_EQ(kNumAllocations, fibersRun);
+  }
+}
+
+BENCHMARK(FiberManagerAllocateLargeChunkGuardPageStacks, iters) {
+  runLargeChunkStacksBenchmark(iters, false);
+}
+
+BENCHMARK_RELATIVE(FiberManagerAllocateLargeChunkPooledStacks, iters) {
+  runLargeChunkStacksBenchmark(iters, true);
+}
+
+BENCHMARK_DRAW_LINE();
+
 void runTimeoutsBenchmark(std::vector<size_t> timeouts) {
   constexpr size_t kNumIters = 100000;
   constexpr size_t kNumFibers = 100;
@@ -211,6 +245,129 @@ BENCHMARK(FiberManagerCancelledTimeouts_TenThousand) {
   runTimeoutsBenchmark(std::move(tmos));
 }
 
+// Simulates a downstream call with a fixed per-call overhead and a small
+// per-value cost.
+void simulateDownstream(size_t numValues) {
+  auto deadline = std::chrono::steady_clock::now() +
+      std::chrono::microseconds(20) + std::chrono::nanoseconds(200) * numValues;
+  while (std::chrono::steady_clock::now() < deadline) {
+  }
+}
+
+// Requests arrive at a fixed rate of arrivalsPerTurn per event loop turn and
+// go through the dispatcher created by makeDispatcher. Every iteration sends
+// 10000 requests; the average batch size and request latency are reported
+// next to the throughput.
+template <typename MakeDispatcher>
+void runBatchingBenchmark(
+    folly::UserCounters& counters,
+    size_t iters,
+    size_t arrivalsPerTurn,
+    MakeDispatcher makeDispatcher) {
+  static const size_t kNumRequests = 10000;
+
+  folly::BenchmarkSuspender suspender;
+  folly::EventBase evb(folly::EventBase::Options().setTimerTickInterval(
+      std::chrono::milliseconds(1)));
+  auto& fm = getFiberManager(evb);
+  size_t batches = 0;
+  auto dispatcher = makeDispatcher(fm, [&](std::vector<int>&& values) {
+    ++batches;
+    simulateDownstream(values.size());
+    return std::move(values);
+  });
+  std::chrono::steady_clock::duration totalLatency{};
+  suspender.dismiss();
+
+  auto numRequests = iters * kNumRequests;
+  for (size_t sent = 0; sent < numRequests;) {
+    for (size_t i = 0; i < arrivalsPerTurn && sent < numRequests;
+         ++i, ++sent) {
+      fm.addTask([&, value = int(sent)] {
+        auto start = std::chrono::steady_clock::now();
+        folly::doNotOptimizeAway(dispatcher->add(value).get());
+        totalLatency += std::chrono::steady_clock::now() - start;
+      });
+    }
+    evb.loopOnce(EVLOOP_NONBLOCK);
+  }
+  evb.loop();
+
+  suspender.rehire();
+  dispatcher.reset();
+  counters["batch_size"] = numRequests / std::max<size_t>(batches, 1);
+  counters["latency_us"] =
+      std::chrono::duration_cast<std::chrono::microseconds>(totalLatency)
+          .count() /
+      numRequests;
+}
+
+auto makeBatchDispatcher() {
+  return [](FiberManager& fm, auto dispatchFunc) {
+    return std::make_unique<BatchDispatcher<int, int, FiberManager>>(
+        fm, std::move(dispatchFunc));
+  };
+}
+
+auto makeAdaptiveBatchDispatcher(
+    std::chrono::microseconds maxDelay,
+    std::chrono::microseconds targetLatency = {}) {
+  return [=](FiberManager& fm, auto dispatchFunc) {
+    AdaptiveBatchDispatcher<int, int>::Options options;
+    options.maxBatchSize = 64;
+    options.maxDelay = maxDelay;
+    options.targetLatency = targetLatency;
+    return std::make_unique<AdaptiveBatchDispatcher<int, int>>(
+        fm, std::move(dispatchFunc), options);
+  };
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(BatchDispatcherLowLoad, counters, iters) {
+  runBatchingBenchmark(counters, iters, 1, makeBatchDispatcher());
+}
+
+BENCHMARK_COUNTERS_RELATIVE(AdaptiveBatchDispatcherLowLoad, counters, iters) {
+  runBatchingBenchmark(
+      counters,
+      iters,
+      1,
+      makeAdaptiveBatchDispatcher(std::chrono::milliseconds(1)));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(
+    AdaptiveBatchDispatcherLowLoadTargetLatency, counters, iters) {
+  runBatchingBenchmark(
+      counters,
+      iters,
+      1,
+      makeAdaptiveBatchDispatcher(
+          std::chrono::milliseconds(1), std::chrono::microseconds(25)));
+}
+
+BENCHMARK_COUNTERS(BatchDispatcherHighLoad, counters, iters) {
+  runBatchingBenchmark(counters, iters, 16, makeBatchDispatcher());
+}
+
+BENCHMARK_COUNTERS_RELATIVE(AdaptiveBatchDispatcherHighLoad, counters, iters) {
+  runBatchingBenchmark(
+      counters,
+      iters,
+      16,
+      makeAdaptiveBatchDispatcher(std::chrono::milliseconds(1)));
+}
+
+BENCHMARK_COUNTERS_RELATIVE(
+    AdaptiveBatchDispatcherHighLoadTargetLatency, counters, iters) {
+  runBatchingBenchmark(
+      counters,
+      iters,
+      16,
+      makeAdaptiveBatchDispatcher(
+          std::chrono::milliseconds(1), std::chrono::microseconds(25)));
+}
+
 int main(int argc, char** argv) {
   folly::Init init(&argc, &argv, true);
 
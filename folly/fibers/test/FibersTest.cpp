@@ -28,6 +28,7 @@
 #include <folly/coro/Timeout.h>
 #include <folly/coro/WithCancellation.h>
 #include <folly/executors/CPUThreadPoolExecutor.h>
+#include <folly/fibers/AdaptiveBatchDispatcher.h>
 #include <folly/fibers/AddTasks.h>
 #include <folly/fibers/AtomicBatchDispatcher.h>
 #include <folly/fibers/BatchDispatcher.h>
@@ -37,6 +38,7 @@
 #include <folly/fibers/FiberManager.h>
 #include <folly/fibers/FiberManagerMap.h>
 #include <folly/fibers/GenericBaton.h>
+#include <folly/fibers/PooledStackAllocator.h>
 #include <folly/fibers/Semaphore.h>
 #include <folly/fibers/SimpleLoopController.h>
 #include <folly/fibers/TimedMutex.h>
@@ -1200,6 +1202,142 @@ TEST(FiberManager, fibersPoolOverLimit) {
   EXPECT_EQ(5, manager.fibersPoolSize());
 }
 
+TEST(FiberManager, pooledStacks) {
+  FiberManager::Options opts;
+  opts.usePooledStacks = true;
+  opts.maxFibersPoolSize = 1000;
+
+  FiberManager manager(std::make_unique<SimpleLoopController>(), opts);
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+  const auto stackSize = manager.getOptions().stackSize;
+
+  std::vector<Baton> batons(1000);
+  size_t fibersStarted = 0;
+  size_t fibersRun = 0;
+  for (auto& baton : batons) {
+    manager.addTask([&]() {
+      // Dirty a few pages of the stack so that there is something to trim.
+      std::array<volatile char, 8192> buf;
+      for (size_t i = 0; i < buf.size(); i += 512) {
+        buf[i] = 1;
+      }
+      ++fibersStarted;
+      baton.wait();
+      ++fibersRun;
+    });
+  }
+
+  FiberManager::StackMemoryStats stats;
+  loopController.loop([&]() {
+    if (fibersStarted == 1000 && fibersRun == 0) {
+      stats = manager.stackMemoryStats();
+      for (auto& baton : batons) {
+        baton.post();
+      }
+    }
+    loopController.stop();
+  });
+
+  EXPECT_EQ(1000, stats.stacksAllocated);
+  EXPECT_EQ(1000 * stackSize, stats.stackBytesAllocated);
+  EXPECT_GE(stats.stackBytesReserved, stats.stackBytesAllocated);
+  if (folly::kIsLinux) {
+    EXPECT_GE(stats.stackBytesResident, 1000 * 8192);
+  }
+  EXPECT_EQ(0, stats.stackBytesReleased);
+  EXPECT_EQ(1000, fibersRun);
+  EXPECT_EQ(1000, manager.fibersPoolSize());
+
+  auto released = manager.trimStackMemory();
+  EXPECT_GE(released, 1000 * 4096);
+  EXPECT_EQ(released, manager.stackMemoryStats().stackBytesReleased);
+  // Nothing left to release until the fibers run again.
+  EXPECT_EQ(0, manager.trimStackMemory());
+
+  // Trimmed stacks are reused.
+  for (size_t i = 0; i < 1000; ++i) {
+    manager.addTask([&]() {
+      std::array<volatile char, 8192> buf;
+      buf[0] = 1;
+      ++fibersRun;
+    });
+  }
+  loopController.loop([&]() { loopController.stop(); });
+  EXPECT_EQ(2000, fibersRun);
+  EXPECT_EQ(1000, manager.stackMemoryStats().stacksAllocated);
+}
+
+TEST(FiberManager, guardPageStacksMemoryStats) {
+  FiberManager manager(std::make_unique<SimpleLoopController>());
+  auto& loopController =
+      dynamic_cast<SimpleLoopController&>(manager.loopController());
+
+  manager.addTask([]() {});
+  loopController.loop([&]() { loopController.stop(); });
+
+  auto stats = manager.stackMemoryStats();
+  EXPECT_EQ(1, stats.stacksAllocated);
+  EXPECT_EQ(manager.getOptions().stackSize, stats.stackBytesAllocated);
+  EXPECT_EQ(0, stats.stackBytesReserved);
+  EXPECT_EQ(0, manager.trimStackMemory());
+}
+
+TEST(PooledStackAllocator, reusesStacksLifo) {
+  PooledStackAllocator allocator(
+      16 * 1024, /* guardPagesPerStack= */ 1, /* useHugePages= */ false);
+  auto a = allocator.allocate(16 * 1024);
+  auto b = allocator.allocate(16 * 1024);
+  EXPECT_NE(a, b);
+  allocator.deallocate(a, 16 * 1024);
+  allocator.deallocate(b, 16 * 1024);
+  EXPECT_EQ(b, allocator.allocate(16 * 1024));
+  EXPECT_EQ(a, allocator.allocate(16 * 1024));
+
+  // Other sizes are served from the heap.
+  auto c = allocator.allocate(1000);
+  EXPECT_EQ(0, allocator.release(c, 1000, 1000));
+  allocator.deallocate(c, 1000);
+
+  EXPECT_EQ(16 * 1024, allocator.release(a, 16 * 1024, 16 * 1024));
+  EXPECT_EQ(0, allocator.release(a, 16 * 1024, 100));
+  allocator.deallocate(a, 16 * 1024);
+  allocator.deallocate(b, 16 * 1024);
+}
+
+TEST(PooledStackAllocator, guardPages) {
+  PooledStackAllocator allocator(
+      16 * 1024, /* guardPagesPerStack= */ 1, /* useHugePages= */ false);
+  auto a = allocator.allocate(16 * 1024);
+  auto b = allocator.allocate(16 * 1024);
+  a[0] = 1;
+  a[16 * 1024 - 1] = 1;
+  // The page below every stack is protected, including the one between
+  // adjacent stacks.
+  EXPECT_DEATH(static_cast<volatile unsigned char*>(a)[-1] = 1, "");
+  EXPECT_DEATH(static_cast<volatile unsigned char*>(b)[-1] = 1, "");
+  allocator.deallocate(a, 16 * 1024);
+  allocator.deallocate(b, 16 * 1024);
+}
+
+TEST(PooledStackAllocator, hugePages) {
+  PooledStackAllocator allocator(
+      64 * 1024, /* guardPagesPerStack= */ 0, /* useHugePages= */ true);
+  std::vector<unsigned char*> stacks;
+  for (size_t i = 0; i < 1000; ++i) {
+    auto p = allocator.allocate(64 * 1024);
+    p[0] = 1;
+    p[64 * 1024 - 1] = 1;
+    stacks.push_back(p);
+  }
+  // 1000 64KB stacks fit into two 32MB regions.
+  EXPECT_EQ(2 * (size_t(32) << 20), allocator.bytesReserved());
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(stacks.front()) % (2 << 20));
+  for (auto p : stacks) {
+    allocator.deallocate(p, 64 * 1024);
+  }
+}
+
 TEST(FiberManager, remoteFiberBasic) {
   FiberManager manager(std::make_unique<SimpleLoopController>());
   auto& loopController =
@@ -2297,6 +2435,235 @@ TEST(FiberManager, batchDispatchExceptionHandlingTest) {
   evb.loop();
 }
 
+namespace {
+using AdaptiveDispatcher = AdaptiveBatchDispatcher<int, std::string>;
+
+AdaptiveDispatcher::ResultBatchT toStrings(std::vector<int>&& batch) {
+  std::vector<std::string> results;
+  for (auto& it : batch) {
+    results.push_back(folly::to<std::string>(it));
+  }
+  return results;
+}
+} // namespace
+
+TEST(FiberManager, adaptiveBatchDispatchFullBatch) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxBatchSize = 10;
+  options.maxDelay = std::chrono::seconds(10);
+  std::vector<size_t> batchSizes;
+  AdaptiveDispatcher dispatcher(
+      fm,
+      [&](std::vector<int>&& batch) {
+        batchSizes.push_back(batch.size());
+        return toStrings(std::move(batch));
+      },
+      options);
+
+  for (int i = 0; i < 25; i++) {
+    fm.addTask([&, i] {
+      EXPECT_EQ(folly::to<std::string>(i), dispatcher.add(i).get());
+    });
+  }
+  fm.addTask([&] {
+    // The two full batches are dispatched right away, so only the partial
+    // batch would have to wait for its window to expire.
+    while (batchSizes.size() < 2) {
+      folly::fibers::yield();
+    }
+    dispatcher.flush();
+  });
+  auto start = std::chrono::steady_clock::now();
+  evb.loop();
+
+  EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+  EXPECT_EQ((std::vector<size_t>{10, 10, 5}), batchSizes);
+  auto stats = dispatcher.stats();
+  EXPECT_EQ(3, stats.batchesDispatched);
+  EXPECT_EQ(25, stats.valuesDispatched);
+  EXPECT_EQ(0, stats.batchesTimedOut);
+}
+
+TEST(FiberManager, adaptiveBatchDispatchWindow) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxBatchSize = 100;
+  options.maxDelay = std::chrono::milliseconds(20);
+  std::vector<size_t> batchSizes;
+  AdaptiveDispatcher dispatcher(
+      fm,
+      [&](std::vector<int>&& batch) {
+        batchSizes.push_back(batch.size());
+        return toStrings(std::move(batch));
+      },
+      options);
+
+  // Values added over several loop turns, but within one window, end up in
+  // a single batch.
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < 5; i++) {
+    fm.addTask([&, i] {
+      folly::fibers::Baton baton;
+      baton.try_wait_for(std::chrono::milliseconds(i));
+      EXPECT_EQ(folly::to<std::string>(i), dispatcher.add(i).get());
+    });
+  }
+  evb.loop();
+
+  EXPECT_GE(
+      std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+  EXPECT_EQ((std::vector<size_t>{5}), batchSizes);
+  EXPECT_EQ(1, dispatcher.stats().batchesTimedOut);
+}
+
+TEST(FiberManager, adaptiveBatchDispatchAdaptsToLatency) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxBatchSize = 64;
+  options.minBatchSize = 4;
+  options.maxDelay = std::chrono::milliseconds(1);
+  options.targetLatency = std::chrono::milliseconds(1);
+  std::chrono::microseconds dispatchLatency{2000};
+  AdaptiveDispatcher dispatcher(
+      fm,
+      [&](std::vector<int>&& batch) {
+        /* sleep override */ std::this_thread::sleep_for(dispatchLatency);
+        return toStrings(std::move(batch));
+      },
+      options);
+
+  auto runBatches = [&](size_t numBatches) {
+    for (size_t batch = 0; batch < numBatches; batch++) {
+      fm.addTask([&] {
+        std::vector<folly::Future<std::string>> futures;
+        for (int i = 0; i < 64; i++) {
+          futures.push_back(dispatcher.add(i));
+        }
+        dispatcher.flush();
+        folly::collectAll(futures).get();
+      });
+      evb.loop();
+    }
+  };
+
+  // Dispatch is slower than the target: batches shrink down to the minimum.
+  runBatches(10);
+  EXPECT_EQ(4, dispatcher.stats().batchSizeLimit);
+  EXPECT_GE(dispatcher.stats().dispatchLatency, std::chrono::milliseconds(1));
+
+  // Dispatch is fast again: batches grow back up to the maximum.
+  dispatchLatency = std::chrono::microseconds(0);
+  runBatches(40);
+  EXPECT_EQ(64, dispatcher.stats().batchSizeLimit);
+  EXPECT_LT(dispatcher.stats().dispatchLatency, std::chrono::milliseconds(1));
+}
+
+TEST(FiberManager, adaptiveBatchDispatchLatencySpike) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxBatchSize = 64;
+  options.minBatchSize = 4;
+  options.targetLatency = std::chrono::milliseconds(1);
+  std::chrono::microseconds dispatchLatency{20000};
+  AdaptiveDispatcher dispatcher(
+      fm,
+      [&](std::vector<int>&& batch) {
+        /* sleep override */ std::this_thread::sleep_for(dispatchLatency);
+        dispatchLatency = std::chrono::microseconds(0);
+        return toStrings(std::move(batch));
+      },
+      options);
+
+  // One slow batch, then fast ones while the average is still above the
+  // target: the limit is halved once, and not grown back yet.
+  for (int batch = 0; batch < 5; batch++) {
+    fm.addTask([&] {
+      std::vector<folly::Future<std::string>> futures;
+      for (int i = 0; i < 64; i++) {
+        futures.push_back(dispatcher.add(i));
+      }
+      dispatcher.flush();
+      folly::collectAll(futures).get();
+    });
+    evb.loop();
+  }
+  EXPECT_EQ(32, dispatcher.stats().batchSizeLimit);
+  EXPECT_GT(dispatcher.stats().dispatchLatency, std::chrono::milliseconds(1));
+}
+
+TEST(FiberManager, adaptiveBatchDispatchExceptionHandling) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveBatchDispatcher<int, int> dispatcher(
+      fm, [](std::vector<int>&&) -> std::vector<int> {
+        throw std::runtime_error("Surprise!!");
+      });
+  for (int i = 0; i < 5; i++) {
+    fm.addTask([&, i] {
+      EXPECT_THROW(dispatcher.add(i).get(), std::runtime_error);
+    });
+  }
+  evb.loop();
+}
+
+TEST(FiberManager, adaptiveBatchDispatchFlushOnDestruction) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxDelay = std::chrono::seconds(10);
+  folly::Future<std::string> future = folly::Future<std::string>::makeEmpty();
+  {
+    AdaptiveDispatcher dispatcher(fm, toStrings, options);
+    future = dispatcher.add(42);
+  }
+  evb.loop();
+  EXPECT_EQ("42", std::move(future).get());
+}
+
+#if FOLLY_HAS_COROUTINES
+
+TEST(FiberManager, adaptiveBatchDispatchFromCoroutines) {
+  folly::EventBase evb;
+  auto& fm = getFiberManager(evb);
+
+  AdaptiveDispatcher::Options options;
+  options.maxBatchSize = 8;
+  std::vector<size_t> batchSizes;
+  AdaptiveDispatcher dispatcher(
+      fm,
+      [&](std::vector<int>&& batch) {
+        batchSizes.push_back(batch.size());
+        return toStrings(std::move(batch));
+      },
+      options);
+
+  folly::coro::blockingWait(
+      folly::coro::co_invoke([&]() -> folly::coro::Task<void> {
+        std::vector<folly::Future<std::string>> futures;
+        for (int i = 0; i < 8; i++) {
+          futures.push_back(dispatcher.add(i));
+        }
+        for (int i = 0; i < 8; i++) {
+          EXPECT_EQ(folly::to<std::string>(i), co_await std::move(futures[i]));
+        }
+      }),
+      &evb);
+  EXPECT_EQ((std::vector<size_t>{8}), batchSizes);
+}
+
+#endif
+
 namespace AtomicBatchDispatcherTesting {
 
 using ValueT = size_t;
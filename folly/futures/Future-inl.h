@@ -387,8 +387,67 @@ FutureBase<T>::thenImplementation(
     F&& func, R, futures::detail::InlineContinuation allowInline) {
   static_assert(R::Arg::ArgsSize::value == 2, "Then must take two arguments");
   using B = typename R::ReturnsFuture::Inner;
-  auto fp = FutureBaseHelper::makePromiseContractForThen<B>(
-      this->getCore(), this->getExecutor());
+  auto& core = this->getCore();
+  if (core.hasResultAndNoExecutor()) {
+    // The continuation would be invoked synchronously by setCallback_(), so
+    // invoke it directly, without type-erasing it. If it returns the same
+    // type, store its result in place, so that chains of continuations on a
+    // ready future share one core.
+    using Arg1 = typename R::Arg::ArgList::Tail::FirstArg;
+    auto& t = core.getTry();
+    Try<B> result = !R::Arg::isTry() && t.hasException()
+        ? Try<B>(std::move(t.exception()))
+        : Try<B>(makeTryWith([&] {
+            return static_cast<F&&>(func)(
+                Executor::KeepAlive<>{},
+                std::move(t).template get<R::Arg::isTry(), Arg1>());
+          }));
+    if constexpr (std::is_same<B, T>::value) {
+      t = std::move(result);
+      return Future<B>(std::exchange(this->core_, nullptr));
+    } else {
+      this->detach();
+      return makeFuture<B>(std::move(result));
+    }
+  }
+  auto executor = this->getExecutor();
+  if constexpr (std::is_same<B, T>::value) {
+    if (!core.getDeferredExecutor() &&
+        (!executor || executor == &InlineExecutor::instance()) &&
+        core.hasRoomForContinuation()) {
+      // The continuation would be invoked inline when the result is set, so
+      // have it applied to the result in place, without a new core.
+      typename Core::Continuation continuation =
+          [func = static_cast<F&&>(func),
+           ka = getKeepAliveToken(executor)](Try<T>& t) mutable {
+            if (!R::Arg::isTry() && t.hasException()) {
+              return;
+            }
+            using Arg1 = typename R::Arg::ArgList::Tail::FirstArg;
+            t = makeTryWith([&] {
+              return static_cast<F&&>(func)(
+                  std::move(ka),
+                  std::move(t).template get<R::Arg::isTry(), Arg1>());
+            });
+          };
+      auto context = RequestContext::saveContext();
+      if (core.tryAddContinuation(continuation, context)) {
+        return Future<B>(std::exchange(this->core_, nullptr));
+      }
+      // The result is being set concurrently, attach a callback instead.
+      auto fp = FutureBaseHelper::makePromiseContractForThen<B>(core, executor);
+      this->setCallback_(
+          [continuation = std::move(continuation),
+           promise = std::move(fp.promise)](
+              Executor::KeepAlive<>&& ka, Try<T>&& t) mutable {
+            continuation(t);
+            promise.setTry(std::move(ka), std::move(t));
+          },
+          allowInline);
+      return std::move(fp.future);
+    }
+  }
+  auto fp = FutureBaseHelper::makePromiseContractForThen<B>(core, executor);
   this->setCallback_(
       [state = futures::detail::makeCoreCallbackState(
            std::move(fp.promise), static_cast<F&&>(func))](
@@ -451,8 +510,19 @@ FutureBase<T>::thenImplementation(
           } else {
             auto statePromise = state.stealPromise();
             auto tf3 = chainExecutor(std::move(ka), *std::move(tf2));
-            std::exchange(statePromise.core_, nullptr)
-                ->setProxy(std::exchange(tf3.core_, nullptr));
+            if (statePromise.core_->sealContinuations()) {
+              // Continuations were added to the core of statePromise, which
+              // must then get the result itself rather than proxy to tf3.
+              tf3.setCallback_(
+                  [promise = std::move(statePromise)](
+                      Executor::KeepAlive<>&& ka2, Try<B>&& t) mutable {
+                    promise.setTry(std::move(ka2), std::move(t));
+                  },
+                  futures::detail::InlineContinuation::permit);
+            } else {
+              std::exchange(statePromise.core_, nullptr)
+                  ->setProxy(std::exchange(tf3.core_, nullptr));
+            }
           }
         }
       },
@@ -923,13 +993,13 @@ Future<T> Future<T>::via(Executor::KeepAlive<> executor) & {
   this->throwIfInvalid();
   Promise<T> p;
   auto sf = p.getSemiFuture();
-  auto func =
+  // This future remains valid (and continued), so set the callback directly
+  // rather than through thenImplementation(), which may take over its core.
+  this->setCallback_(
       [p_2 = std::move(p)](Executor::KeepAlive<>&&, Try<T>&& t) mutable {
         p_2.setTry(std::move(t));
-      };
-  using R = futures::detail::tryExecutorCallableResult<T, decltype(func)>;
-  this->thenImplementation(
-      std::move(func), R{}, futures::detail::InlineContinuation::forbid);
+      },
+      futures::detail::InlineContinuation::forbid);
   // Construct future from semifuture manually because this may not have
   // an executor set due to legacy code. This means we can bypass the executor
   // check in SemiFuture::via
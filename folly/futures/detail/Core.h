@@ -17,6 +17,7 @@
 #pragma once
 
 #include <atomic>
+#include <memory>
 #include <mutex>
 #include <stdexcept>
 #include <utility>
@@ -374,6 +375,16 @@ class CoreBase {
   /// Identical to `this->hasResult()`
   bool ready() const noexcept { return hasResult(); }
 
+  /// Call only from consumer thread, before attaching a callback.
+  ///
+  /// True if state is OnlyResult and there is no executor, i.e. if a callback
+  /// would be invoked synchronously within `setCallback()`. The consumer may
+  /// then run the continuation directly instead.
+  bool hasResultAndNoExecutor() const noexcept {
+    return state_.load(std::memory_order_acquire) == State::OnlyResult &&
+        !executor_;
+  }
+
   /// Called by a destructing Future (in the consumer thread, by definition).
   /// Calls `delete this` if there are no more references to `this`
   /// (including if `detachPromise()` is called previously or concurrently).
@@ -574,6 +585,13 @@ class Core final : private ResultHolder<T>, public CoreBase {
  public:
   using Result = Try<T>;
 
+  /// A continuation applied to the result in place, see
+  /// `tryAddContinuation()`.
+  using Continuation = folly::Function<void(Try<T>&)>;
+
+  /// The maximum number of continuations that can be added to a core.
+  static constexpr size_t kMaxContinuations = 4;
+
   /// State will be Start
   static Core* make() { return new Core(); }
 
@@ -638,6 +656,97 @@ class Core final : private ResultHolder<T>, public CoreBase {
     setCallback_(std::move(callback), std::move(context), allowInline);
   }
 
+  /// Call only from consumer thread, before attaching a callback.
+  ///
+  /// True if the state is Start and `tryAddContinuation()` would find room
+  /// for another continuation (unless it races with `setResult()`).
+  bool hasRoomForContinuation() const noexcept {
+    if (state_.load(std::memory_order_acquire) != State::Start) {
+      return false;
+    }
+    auto raw = continuations_.load(std::memory_order_acquire);
+    return raw == 0 ||
+        (raw != kContinuationsSealed &&
+         reinterpret_cast<Continuations*>(raw)->size.load(
+             std::memory_order_relaxed) < kMaxContinuations);
+  }
+
+  /// Call only from consumer thread, before attaching a callback, and only if
+  /// a callback would run inline within `setResult()`, i.e. if there is no
+  /// executor or if it is an inline executor.
+  ///
+  /// Makes the producer thread apply `fn` to the result in place (with
+  /// `context` set) within `setResult()`, before the result is published,
+  /// rather than attaching `fn` as a callback which fulfills a new core. A
+  /// chain of up to kMaxContinuations continuations which don't change the
+  /// type of the result can thus share one core, and they are stored in a
+  /// single allocation. Continuations are applied in the order they were
+  /// added, and must not throw.
+  ///
+  /// Returns false, leaving `fn` and `context` untouched, if the core has no
+  /// room left or if the producer thread has started setting the result. The
+  /// continuation must then be attached as a callback.
+  bool tryAddContinuation(
+      Continuation& fn, std::shared_ptr<folly::RequestContext>& context) {
+    if (state_.load(std::memory_order_acquire) != State::Start) {
+      return false;
+    }
+    auto raw = continuations_.load(std::memory_order_acquire);
+    if (raw == kContinuationsSealed) {
+      return false;
+    }
+    if (raw == 0) {
+      auto continuations = std::make_unique<Continuations>();
+      if (!continuations_.compare_exchange_strong(
+              raw,
+              reinterpret_cast<uintptr_t>(continuations.get()),
+              std::memory_order_release,
+              std::memory_order_acquire)) {
+        return false; // sealed by the producer thread
+      }
+      raw = reinterpret_cast<uintptr_t>(continuations.release());
+    }
+    auto& continuations = *reinterpret_cast<Continuations*>(raw);
+    auto size = continuations.size.load(std::memory_order_relaxed);
+    if (size >= kMaxContinuations) {
+      return false; // full, or sealed by the producer thread
+    }
+    auto& entry = continuations.entries[size];
+    entry.fn = std::move(fn);
+    entry.context = std::move(context);
+    if (continuations.size.compare_exchange_strong(
+            size, size + 1, std::memory_order_release)) {
+      return true;
+    }
+    // Sealed by the producer thread, which won't look at this entry.
+    fn = std::move(entry.fn);
+    context = std::move(entry.context);
+    return false;
+  }
+
+  /// Call only from producer thread, before setting the result or a proxy.
+  ///
+  /// Prevents the consumer thread from adding more continuations, and returns
+  /// true if it added any. Such a core can't be proxied.
+  bool sealContinuations() noexcept {
+    auto raw = continuations_.load(std::memory_order_acquire);
+    if (raw == 0 &&
+        continuations_.compare_exchange_strong(
+            raw,
+            kContinuationsSealed,
+            std::memory_order_acq_rel,
+            std::memory_order_acquire)) {
+      return false;
+    }
+    if (raw == kContinuationsSealed) {
+      return false;
+    }
+    auto& continuations = *reinterpret_cast<Continuations*>(raw);
+    return (continuations.size.fetch_or(
+                Continuations::kSealed, std::memory_order_acq_rel) &
+            ~Continuations::kSealed) != 0;
+  }
+
   /// Call only from producer thread.
   /// Call only once - else undefined behavior.
   ///
@@ -661,6 +770,9 @@ class Core final : private ResultHolder<T>, public CoreBase {
   /// same executor as does executor_).
   void setResult(Executor::KeepAlive<>&& completingKA, Try<T>&& t) {
     ::new (&this->result_) Result(std::move(t));
+    if (sealContinuations()) {
+      applyContinuations();
+    }
     setResult_(std::move(completingKA));
   }
 
@@ -670,7 +782,10 @@ class Core final : private ResultHolder<T>, public CoreBase {
   /// See FSM graph for allowed transitions.
   ///
   /// This can not be called concurrently with setResult().
+  /// The core must not have continuations, see `sealContinuations()`.
   void setProxy(Core* proxy) {
+    bool hasContinuations = sealContinuations();
+    DCHECK(!hasContinuations);
     // NOTE: We could just expose this from the base, but that accepts any
     // CoreBase, while we want to enforce the same Core<T> in the interface.
     setProxy_(proxy);
@@ -691,11 +806,44 @@ class Core final : private ResultHolder<T>, public CoreBase {
   }
 
   ~Core() override {
+    auto raw = continuations_.load(std::memory_order_relaxed);
+    if (raw != 0 && raw != kContinuationsSealed) {
+      delete reinterpret_cast<Continuations*>(raw);
+    }
     if (destroyDerived()) {
       this->result_.~Result();
     }
   }
 
+  struct Continuations {
+    // Set in size by the producer thread; once set, no continuation is added.
+    static constexpr size_t kSealed = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    struct Entry {
+      Continuation fn;
+      std::shared_ptr<folly::RequestContext> context;
+    };
+
+    std::atomic<size_t> size{0};
+    Entry entries[kMaxContinuations];
+  };
+
+  // Value of continuations_ once sealed if no continuation was ever added.
+  static constexpr uintptr_t kContinuationsSealed = 1;
+
+  void applyContinuations() {
+    auto& continuations = *reinterpret_cast<Continuations*>(
+        continuations_.load(std::memory_order_relaxed));
+    auto size = continuations.size.load(std::memory_order_relaxed) &
+        ~Continuations::kSealed;
+    for (size_t i = 0; i < size; ++i) {
+      auto& entry = continuations.entries[i];
+      RequestContextScopeGuard rctx(std::move(entry.context));
+      auto fn = std::move(entry.fn);
+      fn(this->result_);
+    }
+  }
+
   static Try<T>&& setCallbackGetResult(
       CoreBase& coreBase, exception_wrapper* ew) {
     auto& core = static_cast<Core&>(coreBase);
@@ -704,6 +852,9 @@ class Core final : private ResultHolder<T>, public CoreBase {
     }
     return std::move(core.result_);
   }
+
+  // 0, kContinuationsSealed or a Continuations*.
+  std::atomic<uintptr_t> continuations_{0};
 };
 
 inline Executor* CoreBase::getExecutor() const {
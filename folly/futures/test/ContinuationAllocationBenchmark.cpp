@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Measures the time and the number of heap allocations of chains of
+// continuations, on futures that are ready when the chain is built, and on
+// futures that are fulfilled after it is built.
+
+#include <array>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <folly/Benchmark.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <folly/portability/GFlags.h>
+
+namespace {
+
+std::atomic<int64_t> gNumAllocations{0};
+
+} // namespace
+
+void* operator new(std::size_t size) {
+  gNumAllocations.fetch_add(1, std::memory_order_relaxed);
+  if (auto p = std::malloc(size == 0 ? 1 : size)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+using namespace folly;
+
+namespace {
+
+// Large enough not to fit in the inline storage of folly::Function.
+struct BigCapture {
+  std::array<int64_t, 8> data{};
+};
+
+template <bool Big>
+Future<int64_t> thens(Future<int64_t> f, size_t n) {
+  for (size_t i = 0; i < n; ++i) {
+    if constexpr (Big) {
+      f = std::move(f).thenValue(
+          [capture = BigCapture{}](int64_t x) { return x + capture.data[0]; });
+    } else {
+      f = std::move(f).thenValue([](int64_t x) { return x + 1; });
+    }
+  }
+  return f;
+}
+
+template <bool Big>
+void readyChain(UserCounters& counters, size_t iters, size_t n) {
+  auto before = gNumAllocations.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < iters; ++i) {
+    auto f = thens<Big>(makeFuture<int64_t>(0), n);
+    doNotOptimizeAway(f.value());
+  }
+  counters["allocs"] =
+      (gNumAllocations.load(std::memory_order_relaxed) - before) / iters;
+}
+
+template <bool Big>
+void notReadyChain(UserCounters& counters, size_t iters, size_t n) {
+  auto before = gNumAllocations.load(std::memory_order_relaxed);
+  for (size_t i = 0; i < iters; ++i) {
+    Promise<int64_t> p;
+    auto f = thens<Big>(p.getFuture(), n);
+    p.setValue(0);
+    doNotOptimizeAway(f.value());
+  }
+  counters["allocs"] =
+      (gNumAllocations.load(std::memory_order_relaxed) - before) / iters;
+}
+
+} // namespace
+
+BENCHMARK_COUNTERS(ready_1, counters, iters) {
+  readyChain<false>(counters, iters, 1);
+}
+
+BENCHMARK_COUNTERS(ready_3, counters, iters) {
+  readyChain<false>(counters, iters, 3);
+}
+
+BENCHMARK_COUNTERS(ready_10, counters, iters) {
+  readyChain<false>(counters, iters, 10);
+}
+
+BENCHMARK_COUNTERS(readyBigCapture_10, counters, iters) {
+  readyChain<true>(counters, iters, 10);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_COUNTERS(notReady_1, counters, iters) {
+  notReadyChain<false>(counters, iters, 1);
+}
+
+BENCHMARK_COUNTERS(notReady_3, counters, iters) {
+  notReadyChain<false>(counters, iters, 3);
+}
+
+BENCHMARK_COUNTERS(notReady_10, counters, iters) {
+  notReadyChain<false>(counters, iters, 10);
+}
+
+BENCHMARK_COUNTERS(notReadyBigCapture_10, counters, iters) {
+  notReadyChain<true>(counters, iters, 10);
+}
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -797,6 +797,91 @@ TEST(Future, thenValue) {
   EXPECT_THROW(f.value(), eggs_t);
 }
 
+TEST(Future, thenValueChainOnReadyFuture) {
+  // Continuations on a ready future without an executor run directly, and
+  // store their results in place when the type doesn't change.
+  auto f = makeFuture<int>(1);
+  auto g = std::move(f).thenValue([](int i) { return i + 1; });
+  EXPECT_FALSE(f.valid());
+  EXPECT_TRUE(g.isReady());
+  auto h = std::move(g)
+               .thenValue([](int i) { return i * 10; })
+               .thenValue([](int i) { return std::to_string(i); })
+               .thenValue([](std::string s) { return s + "!"; });
+  EXPECT_FALSE(g.valid());
+  EXPECT_EQ("20!", std::move(h).get());
+
+  size_t count = 0;
+  auto e = makeFuture<int>(1)
+               .thenValue([](int) -> int { throw eggs; })
+               .thenValue([&](int i) {
+                 ++count;
+                 return i;
+               })
+               .thenTry([&](Try<int>&& t) {
+                 ++count;
+                 EXPECT_TRUE(t.hasException<eggs_t>());
+                 return 5;
+               });
+  EXPECT_EQ(1, count);
+  EXPECT_EQ(5, std::move(e).get());
+}
+
+TEST(Future, thenValueChainOnNotReadyFuture) {
+  // Continuations of the same type on a future with an inline executor are
+  // applied in place when the result is set, in order and in their context.
+  Promise<int> p;
+  std::vector<int> order;
+  auto f = p.getFuture();
+  for (int i = 0; i < 10; ++i) {
+    folly::RequestContextScopeGuard rctx;
+    f = std::move(f).thenValue([&, i, ctx = RequestContext::get()](int x) {
+      EXPECT_EQ(ctx, RequestContext::get());
+      order.push_back(i);
+      return x + 1;
+    });
+  }
+  auto g = std::move(f)
+               .thenValue([](int) -> int { throw eggs; })
+               .thenValue([&](int i) {
+                 order.push_back(-1);
+                 return i;
+               })
+               .thenTry([&](Try<int>&& t) {
+                 EXPECT_TRUE(t.hasException<eggs_t>());
+                 return std::to_string(order.size());
+               });
+  EXPECT_TRUE(order.empty());
+  EXPECT_FALSE(g.isReady());
+  p.setValue(0);
+  EXPECT_EQ("10", std::move(g).get());
+  EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), order);
+
+  // Continuations after one which returns a future get its result.
+  Promise<int> outer;
+  Promise<int> inner;
+  auto h = outer.getFuture()
+               .thenValue([&](int) { return inner.getFuture(); })
+               .thenValue([](int i) { return i * 2; });
+  outer.setValue(0);
+  EXPECT_FALSE(h.isReady());
+  inner.setValue(21);
+  EXPECT_EQ(42, std::move(h).get());
+}
+
+TEST(Future, thenValueChainRacingWithSetValue) {
+  for (int iter = 0; iter < 1000; ++iter) {
+    Promise<int> p;
+    auto f = p.getFuture();
+    std::thread t([&] { p.setValue(0); });
+    for (int i = 0; i < 10; ++i) {
+      f = std::move(f).thenValue([](int x) { return x + 1; });
+    }
+    t.join();
+    EXPECT_EQ(10, std::move(f).get());
+  }
+}
+
 TEST(Future, ThenValueWithExecutor) {
   ManualExecutor executor;
   auto sf = makeFuture(42).via(&executor).thenExValue(
@@ -594,7 +594,10 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
     resumed = true;
   }
 
+  LoopTraceScopes traceScopes;
+  auto* const outerTraceScopes = std::exchange(loopTraceScopes_, &traceScopes);
   SCOPE_EXIT {
+    loopTraceScopes_ = outerTraceScopes;
     // Consume the stop signal so that the loop can resume on the next call.
     stop_.store(false, std::memory_order_relaxed);
   };
@@ -608,6 +611,7 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
       ++nextLoopCnt_;
 
       // Run the before-loop callbacks
+      TraceRingBufferScope traceScope("EventBase::runBeforeLoopCallbacks");
       LoopCallbackList callbacks;
       callbacks.swap(runBeforeLoopCallbacks_);
       // Before-loop callbacks must by definition all run regardless of
@@ -617,11 +621,14 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
 
     // nobody can add loop callbacks from within this thread if
     // we don't have to handle anything to start with...
+    traceScopes.wait.emplace("EventBase::wait");
     if (blocking && loopCallbacks_.empty()) {
       res = evb_->eb_event_base_loop(EVLOOP_ONCE);
     } else {
       res = evb_->eb_event_base_loop(EVLOOP_ONCE | EVLOOP_NONBLOCK);
     }
+    traceScopes.wait.reset();
+    traceScopes.dispatch.reset();
     if (res == 2) {
       // Only backends with pollable fd support return value 2.
       DCHECK_NE(evb_->getPollableFd(), -1);
@@ -643,10 +650,15 @@ EventBase::LoopStatus EventBase::loopMain(int flags, LoopOptions options) {
       queue_->execute();
     }
 
-    bool ranLoopCallbacks = runLoopCallbacks();
+    bool ranLoopCallbacks;
+    {
+      TraceRingBufferScope traceScope("EventBase::runLoopCallbacks");
+      ranLoopCallbacks = runLoopCallbacks();
+    }
 
     // Run the after-loop callback. Like the before-loop, no deadline.
     {
+      TraceRingBufferScope traceScope("EventBase::runAfterLoopCallbacks");
       LoopCallbackList callbacks;
       callbacks.swap(runAfterLoopCallbacks_);
       runLoopCallbackList(callbacks, LoopCallbacksDeadline{});
@@ -805,6 +817,12 @@ void EventBase::loopForever() {
 }
 
 void EventBase::bumpHandlingTime() {
+  if (loopTraceScopes_ && loopTraceScopes_->wait) {
+    // The backend is done waiting and runs its first handler.
+    loopTraceScopes_->wait.reset();
+    loopTraceScopes_->dispatch.emplace("EventBase::dispatch");
+  }
+
   if (!enableTimeMeasurement_) {
     return;
   }
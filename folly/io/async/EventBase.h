@@ -54,6 +54,7 @@
 #include <folly/io/async/TimeoutManager.h>
 #include <folly/portability/Event.h>
 #include <folly/synchronization/CallOnce.h>
+#include <folly/tracing/TraceRingBuffer.h>
 
 namespace folly {
 class EventBaseBackendBase;
@@ -1122,6 +1123,17 @@ class EventBase
   std::size_t latestLoopCnt_;
   std::chrono::steady_clock::time_point startWork_;
 
+  // Trace the backend loop as a wait for events, which ends when the first
+  // handler runs (see bumpHandlingTime()), followed by their dispatch. Each
+  // loopMain() call has its own scopes, so that a loop nested in a handler
+  // does not end the sections of the outer one.
+  struct LoopTraceScopes {
+    std::optional<TraceRingBufferScope> wait;
+    std::optional<TraceRingBufferScope> dispatch;
+  };
+  // Scopes of the innermost running loopMain() call.
+  LoopTraceScopes* loopTraceScopes_{nullptr};
+
   // Observer to export counters
   std::shared_ptr<EventBaseObserver> observer_;
   uint32_t observerSampleCount_;
@@ -0,0 +1,244 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/io/coro/IoUringOps.h>
+
+#if FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
+
+#include <folly/Exception.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/async/IoUringEventBaseLocal.h>
+
+#include <glog/logging.h>
+
+namespace folly {
+namespace coro {
+
+namespace detail {
+
+namespace {
+
+IoSqeBase::Type sqeType(IoUringOpArgs::Kind kind) {
+  switch (kind) {
+    case IoUringOpArgs::Kind::Recv:
+    case IoUringOpArgs::Kind::Pread:
+      return IoSqeBase::Type::Read;
+    case IoUringOpArgs::Kind::Send:
+    case IoUringOpArgs::Kind::Pwrite:
+      return IoSqeBase::Type::Write;
+    case IoUringOpArgs::Kind::Connect:
+      return IoSqeBase::Type::Connect;
+    case IoUringOpArgs::Kind::Accept:
+      return IoSqeBase::Type::Unknown;
+  }
+  return IoSqeBase::Type::Unknown;
+}
+
+} // namespace
+
+IoUringOp::IoUringOp(
+    IoUringBackend* backend,
+    EventBase* evb,
+    Executor::KeepAlive<> executor,
+    CancellationToken cancelToken,
+    const IoUringOpArgs& args) noexcept
+    : IoSqeBase(sqeType(args.kind)),
+      backend_(backend),
+      evb_(evb),
+      executor_(std::move(executor)),
+      cancelToken_(std::move(cancelToken)),
+      args_(args) {
+  setEventBase(evb_);
+}
+
+IoUringOp::~IoUringOp() {
+  DCHECK(!inFlight());
+}
+
+void IoUringOp::await_suspend(coroutine_handle<> continuation) noexcept {
+  continuation_ = continuation;
+  if (evb_->isInEventBaseThread()) {
+    submit();
+  } else {
+    evb_->runInEventBaseThread([this]() noexcept { submit(); });
+  }
+}
+
+void IoUringOp::submit() noexcept {
+  backend_->submitSoon(*this);
+  if (cancelToken_.canBeCancelled()) {
+    // May invoke requestCancel() inline if cancellation was requested after
+    // await_ready(); the cancel SQE then follows the operation's SQE.
+    cancelCallback_.emplace(cancelToken_, [this]() noexcept {
+      requestCancel();
+    });
+  }
+}
+
+void IoUringOp::requestCancel() noexcept {
+  if (evb_->isInEventBaseThread()) {
+    if (inFlight() && !cancelled()) {
+      backend_->cancel(this);
+    }
+    return;
+  }
+  // The operation may complete on the EventBase thread before the cancel
+  // request gets there, so the request only refers to the operation through
+  // a pointer that complete() clears.
+  auto request = std::make_shared<CancelRequest>(CancelRequest{this});
+  cancelRequest_ = request;
+  evb_->runInEventBaseThread([request = std::move(request)]() noexcept {
+    if (auto* op = request->op; op && op->inFlight() && !op->cancelled()) {
+      op->backend_->cancel(op);
+    }
+  });
+}
+
+void IoUringOp::processSubmit(struct io_uring_sqe* sqe) noexcept {
+  switch (args_.kind) {
+    case IoUringOpArgs::Kind::Recv:
+      ::io_uring_prep_recv(sqe, args_.fd, args_.buf, args_.len, args_.flags);
+      break;
+    case IoUringOpArgs::Kind::Send:
+      ::io_uring_prep_send(sqe, args_.fd, args_.buf, args_.len, args_.flags);
+      break;
+    case IoUringOpArgs::Kind::Pread:
+      ::io_uring_prep_read(
+          sqe, args_.fd, args_.buf, (unsigned int)args_.len, args_.offset);
+      break;
+    case IoUringOpArgs::Kind::Pwrite:
+      ::io_uring_prep_write(
+          sqe, args_.fd, args_.buf, (unsigned int)args_.len, args_.offset);
+      break;
+    case IoUringOpArgs::Kind::Accept:
+      ::io_uring_prep_accept(sqe, args_.fd, nullptr, nullptr, SOCK_CLOEXEC);
+      break;
+    case IoUringOpArgs::Kind::Connect:
+      ::io_uring_prep_connect(
+          sqe,
+          args_.fd,
+          reinterpret_cast<const sockaddr*>(&args_.addr),
+          args_.addrLen);
+      break;
+  }
+}
+
+void IoUringOp::callback(const io_uring_cqe* cqe) noexcept {
+  complete(cqe->res);
+}
+
+void IoUringOp::callbackCancelled(const io_uring_cqe* cqe) noexcept {
+  complete(cqe->res);
+}
+
+void IoUringOp::complete(int res) noexcept {
+  res_ = res;
+  // Waits for a concurrently running requestCancel(), after which
+  // cancelRequest_ can no longer change.
+  cancelCallback_.reset();
+  if (cancelRequest_) {
+    cancelRequest_->op = nullptr;
+  }
+  if (!executor_ || executor_.get() == evb_) {
+    continuation_.resume();
+  } else {
+    executor_->add([continuation = continuation_]() mutable noexcept {
+      continuation.resume();
+    });
+  }
+}
+
+int IoUringOp::result() {
+  if (res_ >= 0) {
+    return res_;
+  }
+  if ((cancelled() || cancelToken_.isCancellationRequested()) &&
+      (res_ == -ECANCELED || res_ == -EINTR)) {
+    throw OperationCancelled{};
+  }
+  throwSystemErrorExplicit(-res_, "io_uring operation failed");
+}
+
+} // namespace detail
+
+IoUringOps::IoUringOps(EventBase* evb) : evb_(evb) {
+  backend_ = IoUringEventBaseLocal::try_get(evb);
+  if (!backend_) {
+    backend_ = dynamic_cast<IoUringBackend*>(evb->getBackend());
+  }
+  if (!backend_) {
+    throw std::runtime_error("need to take a IoUringBackend event base");
+  }
+}
+
+detail::IoUringAwaitable<size_t> IoUringOps::read(
+    NetworkSocket fd, MutableByteRange buf, int flags) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Recv};
+  args.fd = fd.toFd();
+  args.buf = buf.data();
+  args.len = buf.size();
+  args.flags = flags;
+  return {backend_, evb_, args};
+}
+
+detail::IoUringAwaitable<size_t> IoUringOps::write(
+    NetworkSocket fd, ByteRange buf, int flags) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Send};
+  args.fd = fd.toFd();
+  args.buf = const_cast<uint8_t*>(buf.data());
+  args.len = buf.size();
+  args.flags = flags;
+  return {backend_, evb_, args};
+}
+
+detail::IoUringAwaitable<NetworkSocket> IoUringOps::accept(NetworkSocket fd) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Accept};
+  args.fd = fd.toFd();
+  return {backend_, evb_, args};
+}
+
+detail::IoUringAwaitable<void> IoUringOps::connect(
+    NetworkSocket fd, const SocketAddress& address) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Connect};
+  args.fd = fd.toFd();
+  args.addrLen = address.getAddress(&args.addr);
+  return {backend_, evb_, args};
+}
+
+detail::IoUringAwaitable<size_t> IoUringOps::pread(
+    int fd, MutableByteRange buf, off_t offset) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Pread};
+  args.fd = fd;
+  args.buf = buf.data();
+  args.len = buf.size();
+  args.offset = offset;
+  return {backend_, evb_, args};
+}
+
+detail::IoUringAwaitable<size_t> IoUringOps::pwrite(
+    int fd, ByteRange buf, off_t offset) {
+  detail::IoUringOpArgs args{detail::IoUringOpArgs::Kind::Pwrite};
+  args.fd = fd;
+  args.buf = const_cast<uint8_t*>(buf.data());
+  args.len = buf.size();
+  args.offset = offset;
+  return {backend_, evb_, args};
+}
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <optional>
+#include <type_traits>
+
+#include <folly/CancellationToken.h>
+#include <folly/Executor.h>
+#include <folly/Range.h>
+#include <folly/SocketAddress.h>
+#include <folly/coro/Coroutine.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/io/async/IoUringBase.h>
+#include <folly/io/async/Liburing.h>
+#include <folly/net/NetworkSocket.h>
+#include <folly/portability/Sockets.h>
+
+#if FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
+
+namespace folly {
+namespace coro {
+
+namespace detail {
+
+struct IoUringOpArgs {
+  enum class Kind { Recv, Send, Pread, Pwrite, Accept, Connect };
+
+  Kind kind;
+  int fd{-1};
+  void* buf{nullptr};
+  size_t len{0};
+  off_t offset{0};
+  int flags{0};
+  sockaddr_storage addr{};
+  socklen_t addrLen{0};
+};
+
+// The awaiter shared by every IoUringOps operation. It is the IoSqeBase that
+// gets submitted, so it lives in the awaiting coroutine's frame and no
+// allocation is needed per operation. Completions are delivered on the
+// EventBase thread; the awaiting coroutine is resumed inline when its
+// executor is that EventBase and rescheduled onto its executor otherwise.
+class IoUringOp : public IoSqeBase {
+ public:
+  IoUringOp(
+      IoUringBackend* backend,
+      EventBase* evb,
+      Executor::KeepAlive<> executor,
+      CancellationToken cancelToken,
+      const IoUringOpArgs& args) noexcept;
+
+  ~IoUringOp() override;
+
+  bool await_ready() noexcept { return cancelToken_.isCancellationRequested(); }
+  void await_suspend(coroutine_handle<> continuation) noexcept;
+
+ protected:
+  // Returns the non-negative cqe result, or throws OperationCancelled or a
+  // std::system_error carrying the negated errno.
+  int result();
+
+ private:
+  struct CancelRequest {
+    IoUringOp* op;
+  };
+
+  void processSubmit(struct io_uring_sqe* sqe) noexcept override;
+  void callback(const io_uring_cqe* cqe) noexcept override;
+  void callbackCancelled(const io_uring_cqe* cqe) noexcept override;
+
+  void submit() noexcept;
+  void requestCancel() noexcept;
+  void complete(int res) noexcept;
+
+  IoUringBackend* const backend_;
+  EventBase* const evb_;
+  Executor::KeepAlive<> executor_;
+  CancellationToken cancelToken_;
+  IoUringOpArgs args_;
+  coroutine_handle<> continuation_;
+  std::optional<CancellationCallback> cancelCallback_;
+  // Only allocated when cancellation is requested from a thread other than
+  // the EventBase thread. Read and cleared on the EventBase thread once
+  // cancelCallback_ has been destroyed.
+  std::shared_ptr<CancelRequest> cancelRequest_;
+  int res_{-ECANCELED};
+};
+
+template <typename Result>
+class IoUringAwaitable {
+ public:
+  IoUringAwaitable(
+      IoUringBackend* backend, EventBase* evb, IoUringOpArgs args) noexcept
+      : backend_(backend), evb_(evb), args_(args) {}
+
+  class Awaiter : public IoUringOp {
+   public:
+    using IoUringOp::IoUringOp;
+
+    Result await_resume() {
+      auto res = result();
+      if constexpr (std::is_void_v<Result>) {
+        (void)res;
+      } else if constexpr (std::is_same_v<Result, NetworkSocket>) {
+        return NetworkSocket::fromFd(res);
+      } else {
+        return static_cast<Result>(res);
+      }
+    }
+  };
+
+  Awaiter operator co_await() && {
+    return Awaiter{
+        backend_, evb_, std::move(executor_), std::move(cancelToken_), args_};
+  }
+
+  IoUringAwaitable viaIfAsync(Executor::KeepAlive<> executor) && noexcept {
+    executor_ = std::move(executor);
+    return std::move(*this);
+  }
+
+  friend IoUringAwaitable co_withCancellation(
+      CancellationToken cancelToken, IoUringAwaitable&& awaitable) noexcept {
+    if (!awaitable.cancelToken_.canBeCancelled()) {
+      awaitable.cancelToken_ = std::move(cancelToken);
+    }
+    return std::move(awaitable);
+  }
+
+ private:
+  IoUringBackend* backend_;
+  EventBase* evb_;
+  IoUringOpArgs args_;
+  Executor::KeepAlive<> executor_;
+  CancellationToken cancelToken_;
+};
+
+} // namespace detail
+
+// Coroutine-native socket and file I/O that submits io_uring operations
+// directly through the IoUringBackend of an EventBase. Unlike Transport,
+// there is no AsyncSocket, read callback or Baton in between: each
+// operation is a single SQE whose completion resumes the awaiting coroutine.
+//
+// Operations may be awaited from any executor. Awaiting from a task running
+// on the EventBase itself avoids any executor hop on submission and
+// completion. Requesting cancellation of the awaiting task submits an
+// IORING_OP_ASYNC_CANCEL for the in-flight operation, which then completes
+// with OperationCancelled (unless it had already finished, in which case its
+// result is returned).
+//
+// Errors are reported as std::system_error. Buffers must stay valid until
+// the awaited operation completes.
+//
+// Example:
+//
+//   IoUringOps ops(evb);
+//   auto fd = co_await ops.accept(listenFd);
+//   std::array<uint8_t, 4096> buf;
+//   while (auto n = co_await ops.read(fd, range(buf))) {
+//     co_await ops.write(fd, ByteRange(buf.data(), n));
+//   }
+class IoUringOps {
+ public:
+  // Throws std::runtime_error if evb is not backed by an IoUringBackend.
+  explicit IoUringOps(EventBase* evb);
+
+  EventBase* getEventBase() const noexcept { return evb_; }
+  IoUringBackend* getBackend() const noexcept { return backend_; }
+
+  // Socket operations. read() returns 0 on EOF; both read() and write() may
+  // transfer fewer bytes than requested.
+  detail::IoUringAwaitable<size_t> read(
+      NetworkSocket fd, MutableByteRange buf, int flags = 0);
+  detail::IoUringAwaitable<size_t> write(
+      NetworkSocket fd, ByteRange buf, int flags = MSG_NOSIGNAL);
+  detail::IoUringAwaitable<NetworkSocket> accept(NetworkSocket fd);
+  detail::IoUringAwaitable<void> connect(
+      NetworkSocket fd, const SocketAddress& address);
+
+  // File operations at an explicit offset.
+  detail::IoUringAwaitable<size_t> pread(
+      int fd, MutableByteRange buf, off_t offset);
+  detail::IoUringAwaitable<size_t> pwrite(int fd, ByteRange buf, off_t offset);
+
+ private:
+  EventBase* evb_;
+  IoUringBackend* backend_;
+};
+
+} // namespace coro
+} // namespace folly
+
+#endif // FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
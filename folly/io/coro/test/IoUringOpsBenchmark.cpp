@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Benchmark.h>
+#include <folly/Portability.h>
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/io/async/AsyncSocket.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/coro/IoUringOps.h>
+#include <folly/io/coro/Transport.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GFlags.h>
+
+#include <vector>
+
+#if FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
+
+using namespace folly;
+using namespace folly::coro;
+
+// Echo ping-pong over a connected socket pair: the client writes a message,
+// the server reads it in full and writes it back, and the client reads the
+// echo in full before sending the next one. Measures per-round-trip overhead
+// of Transport (AsyncSocket on the default backend) against IoUringOps.
+
+namespace {
+
+void makeSocketPair(NetworkSocket (&fds)[2]) {
+  PCHECK(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+}
+
+template <typename ReadFn>
+Task<void> readFully(ReadFn read, MutableByteRange buf) {
+  while (!buf.empty()) {
+    auto n = co_await read(buf);
+    CHECK_GT(n, 0);
+    buf.advance(n);
+  }
+}
+
+template <typename WriteFn>
+Task<void> writeFully(WriteFn write, ByteRange buf) {
+  while (!buf.empty()) {
+    buf.advance(co_await write(buf));
+  }
+}
+
+} // namespace
+
+void transportEcho(size_t iters, size_t msgSize) {
+  BenchmarkSuspender setup;
+  EventBase evb;
+  NetworkSocket fds[2];
+  makeSocketPair(fds);
+  Transport client(&evb, AsyncSocket::newSocket(&evb, fds[0]));
+  Transport server(&evb, AsyncSocket::newSocket(&evb, fds[1]));
+  std::vector<uint8_t> out(msgSize, 'x');
+  std::vector<uint8_t> in(msgSize);
+  std::vector<uint8_t> echo(msgSize);
+  auto readFrom = [](Transport& t) {
+    return [&t](MutableByteRange buf) -> Task<size_t> {
+      return t.read(buf, std::chrono::milliseconds(0));
+    };
+  };
+  auto writeTo = [](Transport& t) {
+    return [&t](ByteRange buf) -> Task<size_t> {
+      co_await t.write(buf);
+      co_return buf.size();
+    };
+  };
+  setup.dismiss();
+
+  blockingWait(
+      collectAll(
+          [&]() -> Task<void> {
+            for (size_t i = 0; i < iters; ++i) {
+              co_await writeFully(writeTo(client), range(out));
+              co_await readFully(readFrom(client), range(in));
+            }
+          }(),
+          [&]() -> Task<void> {
+            for (size_t i = 0; i < iters; ++i) {
+              co_await readFully(readFrom(server), range(echo));
+              co_await writeFully(writeTo(server), range(echo));
+            }
+          }()),
+      &evb);
+
+  setup.rehire();
+}
+
+void ioUringOpsEcho(size_t iters, size_t msgSize) {
+  BenchmarkSuspender setup;
+  EventBase evb(EventBase::Options{}.setBackendFactory(
+      []() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+      }));
+  IoUringOps ops(&evb);
+  NetworkSocket fds[2];
+  makeSocketPair(fds);
+  std::vector<uint8_t> out(msgSize, 'x');
+  std::vector<uint8_t> in(msgSize);
+  std::vector<uint8_t> echo(msgSize);
+  auto readFrom = [&](NetworkSocket fd) {
+    return [&, fd](MutableByteRange buf) { return ops.read(fd, buf); };
+  };
+  auto writeTo = [&](NetworkSocket fd) {
+    return [&, fd](ByteRange buf) { return ops.write(fd, buf); };
+  };
+  setup.dismiss();
+
+  blockingWait(
+      collectAll(
+          [&]() -> Task<void> {
+            for (size_t i = 0; i < iters; ++i) {
+              co_await writeFully(writeTo(fds[0]), range(out));
+              co_await readFully(readFrom(fds[0]), range(in));
+            }
+          }(),
+          [&]() -> Task<void> {
+            for (size_t i = 0; i < iters; ++i) {
+              co_await readFully(readFrom(fds[1]), range(echo));
+              co_await writeFully(writeTo(fds[1]), range(echo));
+            }
+          }()),
+      &evb);
+
+  setup.rehire();
+  netops::close(fds[0]);
+  netops::close(fds[1]);
+}
+
+BENCHMARK_NAMED_PARAM(transportEcho, 64B, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(ioUringOpsEcho, 64B, 64)
+BENCHMARK_NAMED_PARAM(transportEcho, 4KB, 4096)
+BENCHMARK_RELATIVE_NAMED_PARAM(ioUringOpsEcho, 4KB, 4096)
+BENCHMARK_NAMED_PARAM(transportEcho, 64KB, 65536)
+BENCHMARK_RELATIVE_NAMED_PARAM(ioUringOpsEcho, 64KB, 65536)
+
+#endif
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+#if FOLLY_HAS_LIBURING
+  if (!folly::IoUringBackend::isAvailable()) {
+    LOG(ERROR) << "io_uring is not available";
+    return 1;
+  }
+#endif
+  folly::runBenchmarks();
+  return 0;
+}
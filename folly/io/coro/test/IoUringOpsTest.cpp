@@ -0,0 +1,246 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/Portability.h>
+
+#include <folly/coro/BlockingWait.h>
+#include <folly/coro/Collect.h>
+#include <folly/io/async/IoUringBackend.h>
+#include <folly/io/async/ScopedEventBaseThread.h>
+#include <folly/io/async/test/ScopedBoundPort.h>
+#include <folly/io/coro/IoUringOps.h>
+#include <folly/net/NetOps.h>
+#include <folly/portability/GTest.h>
+#include <folly/testing/TestUtil.h>
+
+#include <array>
+#include <system_error>
+
+#if FOLLY_HAS_COROUTINES && FOLLY_HAS_LIBURING
+
+using namespace folly;
+using namespace folly::coro;
+
+namespace {
+
+EventBase::Options ioUringEbOptions() {
+  return EventBase::Options{}.setBackendFactory(
+      []() -> std::unique_ptr<EventBaseBackendBase> {
+        return std::make_unique<IoUringBackend>(IoUringBackend::Options{});
+      });
+}
+
+class SocketPair {
+ public:
+  SocketPair() {
+    PCHECK(netops::socketpair(AF_UNIX, SOCK_STREAM, 0, fds_) == 0);
+  }
+  ~SocketPair() {
+    for (auto fd : fds_) {
+      if (fd != NetworkSocket()) {
+        netops::close(fd);
+      }
+    }
+  }
+
+  NetworkSocket operator[](size_t i) const { return fds_[i]; }
+  void close(size_t i) {
+    netops::close(fds_[i]);
+    fds_[i] = NetworkSocket();
+  }
+
+ private:
+  NetworkSocket fds_[2];
+};
+
+NetworkSocket listenOnLoopback(SocketAddress& address) {
+  auto fd = netops::socket(AF_INET, SOCK_STREAM, 0);
+  PCHECK(fd != NetworkSocket());
+  SocketAddress bindAddress("127.0.0.1", 0);
+  sockaddr_storage addr;
+  auto len = bindAddress.getAddress(&addr);
+  PCHECK(netops::bind(fd, reinterpret_cast<sockaddr*>(&addr), len) == 0);
+  PCHECK(netops::listen(fd, 16) == 0);
+  address.setFromLocalAddress(fd);
+  return fd;
+}
+
+} // namespace
+
+class IoUringOpsTest : public testing::Test {
+ public:
+  void SetUp() override {
+    try {
+      evb_ = std::make_unique<EventBase>(ioUringEbOptions());
+    } catch (IoUringBackend::NotAvailable const&) {
+      GTEST_SKIP() << "io_uring is not available";
+    }
+    ops_ = std::make_unique<IoUringOps>(evb_.get());
+  }
+
+  template <typename F>
+  void run(F f) {
+    blockingWait(co_invoke(std::move(f)), evb_.get());
+  }
+
+  std::unique_ptr<EventBase> evb_;
+  std::unique_ptr<IoUringOps> ops_;
+  CancellationSource cancelSource_;
+};
+
+TEST(IoUringOps, RequiresIoUringBackend) {
+  EventBase evb;
+  if (dynamic_cast<IoUringBackend*>(evb.getBackend())) {
+    GTEST_SKIP() << "default backend is io_uring";
+  }
+  EXPECT_THROW(IoUringOps{&evb}, std::runtime_error);
+}
+
+TEST_F(IoUringOpsTest, ReadWrite) {
+  run([&]() -> Task<> {
+    SocketPair sp;
+    std::array<uint8_t, 5> out{'h', 'e', 'l', 'l', 'o'};
+    EXPECT_EQ(out.size(), co_await ops_->write(sp[0], range(out)));
+    std::array<uint8_t, 16> in;
+    auto n = co_await ops_->read(sp[1], range(in));
+    EXPECT_EQ(out.size(), n);
+    EXPECT_EQ(ByteRange(range(out)), ByteRange(in.data(), n));
+  });
+}
+
+TEST_F(IoUringOpsTest, ReadEOF) {
+  run([&]() -> Task<> {
+    SocketPair sp;
+    sp.close(0);
+    std::array<uint8_t, 16> in;
+    EXPECT_EQ(0, co_await ops_->read(sp[1], range(in)));
+  });
+}
+
+TEST_F(IoUringOpsTest, WriteError) {
+  run([&]() -> Task<> {
+    SocketPair sp;
+    sp.close(1);
+    std::array<uint8_t, 16> out{};
+    EXPECT_THROW(
+        co_await ops_->write(sp[0], range(out)), std::system_error);
+  });
+}
+
+TEST_F(IoUringOpsTest, AcceptConnect) {
+  run([&]() -> Task<> {
+    SocketAddress address;
+    auto listenFd = listenOnLoopback(address);
+    auto clientFd = netops::socket(AF_INET, SOCK_STREAM, 0);
+    auto [serverFd, unit] = co_await collectAll(
+        ops_->accept(listenFd), ops_->connect(clientFd, address));
+    (void)unit;
+    EXPECT_NE(NetworkSocket(), serverFd);
+
+    std::array<uint8_t, 3> out{'a', 'b', 'c'};
+    EXPECT_EQ(out.size(), co_await ops_->write(clientFd, range(out)));
+    std::array<uint8_t, 3> in;
+    EXPECT_EQ(in.size(), co_await ops_->read(serverFd, range(in)));
+    EXPECT_EQ(out, in);
+
+    netops::close(serverFd);
+    netops::close(clientFd);
+    netops::close(listenFd);
+  });
+}
+
+TEST_F(IoUringOpsTest, ConnectFailure) {
+  run([&]() -> Task<> {
+    ScopedBoundPort ph;
+    auto fd = netops::socket(AF_INET, SOCK_STREAM, 0);
+    EXPECT_THROW(
+        co_await ops_->connect(fd, ph.getAddress()), std::system_error);
+    netops::close(fd);
+  });
+}
+
+TEST_F(IoUringOpsTest, PreadPwrite) {
+  run([&]() -> Task<> {
+    test::TemporaryFile file;
+    std::array<uint8_t, 4> out{'d', 'a', 't', 'a'};
+    EXPECT_EQ(out.size(), co_await ops_->pwrite(file.fd(), range(out), 10));
+    std::array<uint8_t, 4> in;
+    EXPECT_EQ(in.size(), co_await ops_->pread(file.fd(), range(in), 10));
+    EXPECT_EQ(out, in);
+    EXPECT_EQ(0, co_await ops_->pread(file.fd(), range(in), 14));
+  });
+}
+
+TEST_F(IoUringOpsTest, ReadCancelled) {
+  run([&]() -> Task<> {
+    SocketPair sp;
+    std::array<uint8_t, 16> in;
+    co_await collectAll(
+        [&]() -> Task<> {
+          EXPECT_THROW(
+              co_await co_withCancellation(
+                  cancelSource_.getToken(), ops_->read(sp[1], range(in))),
+              OperationCancelled);
+        }(),
+        [&]() -> Task<> {
+          cancelSource_.requestCancellation();
+          co_return;
+        }());
+    // cancelled before the read is submitted
+    EXPECT_THROW(
+        co_await co_withCancellation(
+            cancelSource_.getToken(), ops_->read(sp[1], range(in))),
+        OperationCancelled);
+  });
+}
+
+TEST_F(IoUringOpsTest, AcceptCancelledFromAnotherThread) {
+  SocketAddress address;
+  auto listenFd = listenOnLoopback(address);
+  std::thread canceller([&] {
+    /* sleep override */ std::this_thread::sleep_for(
+        std::chrono::milliseconds(10));
+    cancelSource_.requestCancellation();
+  });
+  run([&]() -> Task<> {
+    EXPECT_THROW(
+        co_await co_withCancellation(
+            cancelSource_.getToken(), ops_->accept(listenFd)),
+        OperationCancelled);
+  });
+  canceller.join();
+  netops::close(listenFd);
+}
+
+TEST(IoUringOps, AwaitFromAnotherExecutor) {
+  if (!IoUringBackend::isAvailable()) {
+    GTEST_SKIP() << "io_uring is not available";
+  }
+  ScopedEventBaseThread evbThread(ioUringEbOptions(), nullptr, "IoUringOps");
+  IoUringOps ops(evbThread.getEventBase());
+  SocketPair sp;
+  blockingWait([&]() -> Task<> {
+    for (uint8_t i = 0; i < 10; ++i) {
+      std::array<uint8_t, 1> out{i};
+      EXPECT_EQ(1, co_await ops.write(sp[0], range(out)));
+      std::array<uint8_t, 1> in;
+      EXPECT_EQ(1, co_await ops.read(sp[1], range(in)));
+      EXPECT_EQ(i, in[0]);
+    }
+  }());
+}
+
+#endif
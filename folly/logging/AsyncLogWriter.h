@@ -99,6 +99,14 @@ class AsyncLogWriter : public LogWriter {
    */
   static void setDiscardCallback(DiscardCallback callback);
 
+  /**
+   * Invoke the discard callback, if one is set.
+   *
+   * This is also used by other asynchronous LogWriter implementations, so
+   * that a single callback observes all discarded messages.
+   */
+  static void invokeDiscardCallback(size_t numDiscarded);
+
  protected:
   /**
    * Drain up the log message queue. Subclasses must call this method in their
@@ -153,8 +161,6 @@ class AsyncLogWriter : public LogWriter {
   virtual void performIO(
       const std::vector<std::string>& logs, size_t numDiscarded) = 0;
 
-  void invokeDiscardCallback(size_t numDiscarded);
-
   void ioThread();
 
   bool preFork();
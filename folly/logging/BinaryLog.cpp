@@ -0,0 +1,621 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/BinaryLog.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <fmt/args.h>
+
+#include <folly/ExceptionString.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/Exception.h>
+#include <folly/logging/LogCategory.h>
+#include <folly/logging/LogMessage.h>
+#include <folly/logging/LogWriter.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/system/ThreadId.h>
+#include <folly/system/ThreadName.h>
+
+namespace folly {
+
+namespace {
+
+constexpr size_t kMinThreadBufferSize = 4096;
+constexpr auto kDrainInterval = std::chrono::milliseconds(10);
+
+std::atomic<BinaryLogger*> binaryLoggerInstance{nullptr};
+
+/**
+ * Calls fn(type, value) for every argument encoded in args, where value is a
+ * ByteRange covering the encoded value.  Returns false if args is malformed.
+ */
+template <typename Fn>
+bool forEachArg(ByteRange args, Fn fn) {
+  using detail::BinaryLogArgType;
+  while (!args.empty()) {
+    auto type = BinaryLogArgType(args[0]);
+    args.advance(1);
+    size_t size;
+    switch (type) {
+      case BinaryLogArgType::Bool:
+        size = sizeof(bool);
+        break;
+      case BinaryLogArgType::Char:
+        size = sizeof(char);
+        break;
+      case BinaryLogArgType::Float:
+        size = sizeof(float);
+        break;
+      case BinaryLogArgType::Int64:
+      case BinaryLogArgType::UInt64:
+      case BinaryLogArgType::Double:
+      case BinaryLogArgType::Pointer:
+        size = sizeof(uint64_t);
+        break;
+      case BinaryLogArgType::String: {
+        uint32_t length;
+        if (args.size() < sizeof(length)) {
+          return false;
+        }
+        std::memcpy(&length, args.data(), sizeof(length));
+        args.advance(sizeof(length));
+        size = length;
+        break;
+      }
+      default:
+        return false;
+    }
+    if (args.size() < size) {
+      return false;
+    }
+    fn(type, args.subpiece(0, size));
+    args.advance(size);
+  }
+  return true;
+}
+
+template <typename T>
+T loadArg(ByteRange value) {
+  T result;
+  std::memcpy(&result, value.data(), sizeof(result));
+  return result;
+}
+
+template <typename Fn>
+void visitArg(detail::BinaryLogArgType type, ByteRange value, Fn&& fn) {
+  using detail::BinaryLogArgType;
+  switch (type) {
+    case BinaryLogArgType::Bool:
+      return fn(loadArg<bool>(value));
+    case BinaryLogArgType::Char:
+      return fn(loadArg<char>(value));
+    case BinaryLogArgType::Int64:
+      return fn(loadArg<int64_t>(value));
+    case BinaryLogArgType::UInt64:
+      return fn(loadArg<uint64_t>(value));
+    case BinaryLogArgType::Float:
+      return fn(loadArg<float>(value));
+    case BinaryLogArgType::Double:
+      return fn(loadArg<double>(value));
+    case BinaryLogArgType::Pointer:
+      return fn(reinterpret_cast<const void*>(
+          static_cast<uintptr_t>(loadArg<uint64_t>(value))));
+    case BinaryLogArgType::String:
+      return fn(fmt::string_view(
+          reinterpret_cast<const char*>(value.data()), value.size()));
+  }
+}
+
+template <typename T>
+void appendValue(std::string& out, T value) {
+  out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void appendString(std::string& out, StringPiece value) {
+  appendValue(out, uint32_t(value.size()));
+  out.append(value.data(), value.size());
+}
+
+/**
+ * Appends a raw output record.  Returns the offset of the record, to be
+ * passed to finishRecord() once its payload has been appended.
+ */
+size_t startRecord(std::string& out, detail::BinaryLogRecordKind kind) {
+  auto offset = out.size();
+  appendValue(out, detail::BinaryLogRecordHeader{0, kind});
+  return offset;
+}
+
+void finishRecord(std::string& out, size_t offset) {
+  auto size = uint32_t(out.size() - offset);
+  std::memcpy(&out[offset], &size, sizeof(size));
+}
+
+/**
+ * Reads values from the payload of a raw output record.
+ */
+class RecordReader {
+ public:
+  explicit RecordReader(ByteRange data) : data_(data) {}
+
+  template <typename T>
+  T read() {
+    check(sizeof(T));
+    auto result = loadArg<T>(data_);
+    data_.advance(sizeof(T));
+    return result;
+  }
+
+  std::string readString() {
+    auto length = read<uint32_t>();
+    check(length);
+    std::string result(reinterpret_cast<const char*>(data_.data()), length);
+    data_.advance(length);
+    return result;
+  }
+
+  ByteRange rest() const { return data_; }
+
+ private:
+  void check(size_t size) const {
+    if (data_.size() < size) {
+      throw_exception<std::runtime_error>("truncated binary log record");
+    }
+  }
+
+  ByteRange data_;
+};
+
+} // namespace
+
+namespace detail {
+
+BinaryLogRing::BinaryLogRing(size_t capacity)
+    : capacity_(nextPowTwo(std::max(capacity, kMinThreadBufferSize))),
+      mask_(capacity_ - 1),
+      data_(new uint8_t[capacity_]) {}
+
+std::string binaryLogFormat(StringPiece format, ByteRange args) {
+  fmt::dynamic_format_arg_store<fmt::format_context> store;
+  bool valid = forEachArg(args, [&](BinaryLogArgType type, ByteRange value) {
+    visitArg(type, value, [&](auto arg) { store.push_back(arg); });
+  });
+  if (!valid) {
+    return fmt::format(
+        "error formatting log message: malformed arguments; "
+        "format string: \"{}\"",
+        format);
+  }
+  return folly::catch_exception<const std::exception&>(
+      [&] {
+        return fmt::vformat(
+            fmt::string_view(format.data(), format.size()), store);
+      },
+      [&](const std::exception& ex) {
+        // Report the bad format string and the arguments rather than
+        // throwing, like XLOGF() does.
+        std::string result;
+        result.append("error formatting log message: ");
+        result.append(exceptionStr(ex).c_str());
+        result.append("; format string: \"");
+        result.append(format.data(), format.size());
+        result.append("\", arguments: ");
+        bool first = true;
+        forEachArg(args, [&](BinaryLogArgType type, ByteRange value) {
+          if (!first) {
+            result.append(", ");
+          }
+          first = false;
+          visitArg(type, value, [&](auto arg) {
+            fmt::format_to(std::back_inserter(result), "{}", arg);
+          });
+        });
+        return result;
+      });
+}
+
+BinaryLogThreadBuffer* binaryLogRegisterThread(BinaryLogThreadBuffer*& slot) {
+  // Messages logged by thread-local destructors that run after ours are
+  // dropped.
+  static thread_local bool exited = false;
+  if (exited) {
+    return nullptr;
+  }
+
+  struct Registration {
+    explicit Registration(BinaryLogThreadBuffer*& s)
+        : slot(s), buffer(BinaryLogger::get().registerThread()) {}
+    ~Registration() {
+      slot = nullptr;
+      exited = true;
+      buffer->orphaned.store(true, std::memory_order_release);
+    }
+
+    BinaryLogThreadBuffer*& slot;
+    std::shared_ptr<BinaryLogThreadBuffer> buffer;
+  };
+  static thread_local Registration registration(slot);
+  slot = registration.buffer.get();
+  return slot;
+}
+
+void binaryLogWakeDrainer() {
+  BinaryLogger::get().wakeDrainer();
+}
+
+} // namespace detail
+
+class BinaryLogger::Impl {
+ public:
+  ~Impl() { stopDrainer(); }
+
+  std::shared_ptr<detail::BinaryLogThreadBuffer> registerThread() {
+    auto buffer = std::make_shared<detail::BinaryLogThreadBuffer>(
+        threadBufferSize.load(std::memory_order_relaxed), getOSThreadID());
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    buffers.push_back(buffer);
+    if (!thread.joinable() && !stopping) {
+      thread = std::thread([this] { drainLoop(); });
+    }
+    return buffer;
+  }
+
+  /*
+   * Stop the drainer thread and wait for it to exit.  It is not restarted,
+   * so the buffers are only drained by flush() afterwards.
+   */
+  void stopDrainer() {
+    std::thread drainer;
+    {
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      stopping = true;
+      drainer = std::move(thread);
+    }
+    wakeup.notify_one();
+    if (!drainer.joinable()) {
+      return;
+    }
+    if (drainer.get_id() == std::this_thread::get_id()) {
+      // Exiting from a handler called by the drainer itself.
+      drainer.detach();
+    } else {
+      drainer.join();
+    }
+  }
+
+  void wakeDrainer() {
+    if (!wakeupPending.exchange(true, std::memory_order_relaxed)) {
+      wakeup.notify_one();
+    }
+  }
+
+  void drainLoop() {
+    setThreadName("BinaryLogger");
+    std::unique_lock<std::mutex> lock(buffersMutex);
+    while (true) {
+      wakeup.wait_for(lock, kDrainInterval, [this] {
+        return stopping || wakeupPending.load(std::memory_order_relaxed);
+      });
+      if (stopping) {
+        return;
+      }
+      wakeupPending.store(false, std::memory_order_relaxed);
+      lock.unlock();
+      drain();
+      lock.lock();
+    }
+  }
+
+  void drain() {
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<std::shared_ptr<detail::BinaryLogThreadBuffer>> snapshot;
+    {
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      snapshot = buffers;
+    }
+
+    std::string raw;
+    if (rawWriter && !rawMagicWritten) {
+      raw.append(kRawMagic.data(), kRawMagic.size());
+      rawMagicWritten = true;
+    }
+    bool removeOrphans = false;
+    for (auto& buffer : snapshot) {
+      // Check before draining, so that everything the thread logged before
+      // exiting is drained before its buffer is removed.
+      bool orphaned = buffer->orphaned.load(std::memory_order_acquire);
+      auto bytes = buffer->ring.consume(
+          [&](detail::BinaryLogRecordKind kind, ByteRange record) {
+            if (kind == detail::BinaryLogRecordKind::Message) {
+              handleMessage(*buffer, record, raw);
+            }
+          });
+      stats.bytes += bytes;
+      if (auto discarded = buffer->ring.takeDiscarded()) {
+        stats.discarded += discarded;
+        handleDiscarded(*buffer, discarded, raw);
+      }
+      removeOrphans |= orphaned;
+    }
+    if (rawWriter && !raw.empty()) {
+      // Dropping a chunk would corrupt the stream, so it must not be
+      // discarded even if the writer is backed up.
+      rawWriter->writeMessage(std::move(raw), LogWriter::NEVER_DISCARD);
+    }
+
+    if (removeOrphans) {
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      buffers.erase(
+          std::remove_if(
+              buffers.begin(),
+              buffers.end(),
+              [](const auto& buffer) {
+                return buffer->orphaned.load(std::memory_order_acquire) &&
+                    buffer->ring.empty();
+              }),
+          buffers.end());
+    }
+  }
+
+  void handleMessage(
+      const detail::BinaryLogThreadBuffer& buffer,
+      ByteRange record,
+      std::string& raw) {
+    ++stats.messages;
+    detail::BinaryLogMessageHeader header;
+    std::memcpy(&header, record.data(), sizeof(header));
+    record.advance(sizeof(header));
+    const auto& site = *header.site;
+
+    if (rawWriter) {
+      if (rawSites.insert(header.site).second) {
+        auto offset = startRecord(raw, detail::BinaryLogRecordKind::Site);
+        appendValue(raw, uint64_t(uintptr_t(header.site)));
+        appendValue(raw, uint32_t(site.level));
+        appendValue(raw, uint32_t(site.lineNumber));
+        appendString(raw, site.filename);
+        appendString(raw, site.functionName);
+        appendString(raw, site.format);
+        appendString(raw, header.category->getName());
+        finishRecord(raw, offset);
+      }
+      auto offset = startRecord(raw, detail::BinaryLogRecordKind::Message);
+      appendValue(raw, uint64_t(uintptr_t(header.site)));
+      appendValue(raw, buffer.threadID);
+      appendValue(raw, header.timestampNs);
+      raw.append(reinterpret_cast<const char*>(record.data()), record.size());
+      finishRecord(raw, offset);
+      return;
+    }
+
+    LogMessage message{
+        header.category,
+        site.level,
+        std::chrono::system_clock::time_point(
+            std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                std::chrono::nanoseconds(header.timestampNs))),
+        buffer.threadID,
+        site.filename,
+        site.lineNumber,
+        site.functionName,
+        detail::binaryLogFormat(site.format, record)};
+    header.category->admitMessage(message);
+  }
+
+  void handleDiscarded(
+      const detail::BinaryLogThreadBuffer& buffer,
+      uint64_t discarded,
+      std::string& raw) {
+    if (rawWriter) {
+      auto offset = startRecord(raw, detail::BinaryLogRecordKind::Discarded);
+      appendValue(raw, buffer.threadID);
+      appendValue(raw, discarded);
+      finishRecord(raw, offset);
+      return;
+    }
+    XLOGF(
+        WARN,
+        "binary log discarded {} messages from thread {}",
+        discarded,
+        buffer.threadID);
+  }
+
+  std::atomic<size_t> threadBufferSize{kDefaultThreadBufferSize};
+
+  std::mutex buffersMutex;
+  std::vector<std::shared_ptr<detail::BinaryLogThreadBuffer>> buffers;
+  std::condition_variable wakeup;
+  std::atomic<bool> wakeupPending{false};
+  /* Protected by buffersMutex. */
+  std::thread thread;
+  bool stopping{false};
+
+  /* Everything below is protected by drainMutex. */
+  mutable std::mutex drainMutex;
+  std::shared_ptr<LogWriter> rawWriter;
+  bool rawMagicWritten{false};
+  std::unordered_set<const detail::BinaryLogSite*> rawSites;
+  Stats stats;
+};
+
+namespace {
+/**
+ * Stops the drainer thread and drains the buffers at exit, so that messages
+ * logged shortly before exiting are not lost, and the thread does not run
+ * during the rest of static destruction.
+ */
+struct BinaryLogFlusher {
+  ~BinaryLogFlusher() {
+    if (auto* logger = binaryLoggerInstance.load(std::memory_order_acquire)) {
+      logger->shutdown();
+    }
+  }
+} binaryLogFlusher;
+} // namespace
+
+BinaryLogger::BinaryLogger() : impl_(new Impl()) {}
+
+BinaryLogger& BinaryLogger::get() {
+  static auto* instance = [] {
+    auto* logger = new BinaryLogger();
+    binaryLoggerInstance.store(logger, std::memory_order_release);
+    return logger;
+  }();
+  return *instance;
+}
+
+void BinaryLogger::setThreadBufferSize(size_t bytes) {
+  impl_->threadBufferSize.store(bytes, std::memory_order_relaxed);
+}
+
+void BinaryLogger::setRawWriter(std::shared_ptr<LogWriter> writer) {
+  impl_->drain();
+  std::lock_guard<std::mutex> lock(impl_->drainMutex);
+  impl_->rawWriter = std::move(writer);
+  impl_->rawMagicWritten = false;
+  impl_->rawSites.clear();
+}
+
+void BinaryLogger::shutdown() {
+  impl_->stopDrainer();
+  flush();
+}
+
+void BinaryLogger::flush() {
+  impl_->drain();
+  std::shared_ptr<LogWriter> writer;
+  {
+    std::lock_guard<std::mutex> lock(impl_->drainMutex);
+    writer = impl_->rawWriter;
+  }
+  if (writer) {
+    writer->flush();
+  } else {
+    LoggerDB::get().flushAllHandlers();
+  }
+}
+
+BinaryLogger::Stats BinaryLogger::getStats() const {
+  std::lock_guard<std::mutex> lock(impl_->drainMutex);
+  return impl_->stats;
+}
+
+std::shared_ptr<detail::BinaryLogThreadBuffer> BinaryLogger::registerThread() {
+  return impl_->registerThread();
+}
+
+void BinaryLogger::wakeDrainer() {
+  impl_->wakeDrainer();
+}
+
+void BinaryLogDecoder::feed(ByteRange data, Callback callback) {
+  pending_.append(reinterpret_cast<const char*>(data.data()), data.size());
+  ByteRange input{StringPiece(pending_)};
+
+  if (!sawMagic_) {
+    if (input.size() < BinaryLogger::kRawMagic.size()) {
+      return;
+    }
+    if (StringPiece(input.subpiece(0, BinaryLogger::kRawMagic.size())) !=
+        BinaryLogger::kRawMagic) {
+      throw_exception<std::runtime_error>("not a binary log");
+    }
+    input.advance(BinaryLogger::kRawMagic.size());
+    sawMagic_ = true;
+  }
+
+  detail::BinaryLogRecordHeader header;
+  while (input.size() >= sizeof(header)) {
+    std::memcpy(&header, input.data(), sizeof(header));
+    if (header.size < sizeof(header)) {
+      throw_exception<std::runtime_error>("invalid binary log record size");
+    }
+    if (input.size() < header.size) {
+      break;
+    }
+    decodeRecord(
+        header.kind,
+        input.subpiece(sizeof(header), header.size - sizeof(header)),
+        callback);
+    input.advance(header.size);
+  }
+  pending_.erase(0, pending_.size() - input.size());
+}
+
+void BinaryLogDecoder::decodeRecord(
+    detail::BinaryLogRecordKind kind, ByteRange payload, Callback callback) {
+  RecordReader reader(payload);
+  switch (kind) {
+    case detail::BinaryLogRecordKind::Site: {
+      auto id = reader.read<uint64_t>();
+      Site site;
+      site.level = LogLevel(reader.read<uint32_t>());
+      site.lineNumber = reader.read<uint32_t>();
+      site.filename = reader.readString();
+      site.functionName = reader.readString();
+      site.format = reader.readString();
+      site.categoryName = reader.readString();
+      sites_[id] = std::move(site);
+      return;
+    }
+    case detail::BinaryLogRecordKind::Message: {
+      auto id = reader.read<uint64_t>();
+      auto it = sites_.find(id);
+      if (it == sites_.end()) {
+        throw_exception<std::runtime_error>(
+            "binary log message refers to an unknown site");
+      }
+      const auto& site = it->second;
+      Message message;
+      message.level = site.level;
+      message.filename = site.filename;
+      message.lineNumber = site.lineNumber;
+      message.functionName = site.functionName;
+      message.categoryName = site.categoryName;
+      message.threadID = reader.read<uint64_t>();
+      message.timestamp = std::chrono::system_clock::time_point(
+          std::chrono::duration_cast<std::chrono::system_clock::duration>(
+              std::chrono::nanoseconds(reader.read<int64_t>())));
+      message.message = detail::binaryLogFormat(site.format, reader.rest());
+      callback(message);
+      return;
+    }
+    case detail::BinaryLogRecordKind::Discarded: {
+      Message message;
+      message.level = LogLevel::WARN;
+      message.lineNumber = 0;
+      message.threadID = reader.read<uint64_t>();
+      message.message = fmt::format(
+          "binary log discarded {} messages from thread {}",
+          reader.read<uint64_t>(),
+          message.threadID);
+      callback(message);
+      return;
+    }
+    case detail::BinaryLogRecordKind::Padding:
+      return;
+  }
+  throw_exception<std::runtime_error>("unknown binary log record kind");
+}
+
+} // namespace folly
@@ -0,0 +1,601 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include <folly/Function.h>
+#include <folly/Likely.h>
+#include <folly/Range.h>
+#include <folly/Traits.h>
+#include <folly/lang/Align.h>
+#include <folly/logging/LogLevel.h>
+#include <folly/logging/xlog.h>
+
+/*
+ * Deferred-formatting ("binary") logging.
+ *
+ * XLOGB() behaves like XLOGF(), except that the message is not formatted by
+ * the logging thread.  Instead, the call site copies a pointer to a static
+ * descriptor of the statement (level, file, line, function and format string)
+ * and the raw argument values into a per-thread lock-free ring buffer.  The
+ * BinaryLogger thread drains these buffers in the background, and either
+ *
+ * - formats the messages and passes them to the LogHandlers of their
+ *   category, exactly like XLOGF() would have (the default), or
+ * - writes the records unformatted to a LogWriter (see
+ *   BinaryLogger::setRawWriter()), to be formatted offline with
+ *   BinaryLogDecoder or the decode_binary_log tool.
+ *
+ * Log levels are checked at the call site like for XLOG(), so disabled
+ * XLOGB() statements cost the same as disabled XLOG() statements.
+ *
+ * Differences from XLOGF() to be aware of:
+ * - The format string must be a string literal.
+ * - Arithmetic, pointer and string arguments are captured as values and
+ *   formatted later.  Arguments of other types are converted with
+ *   fmt::format("{}", arg) at the call site, so format specs apply to the
+ *   resulting string.
+ * - Messages are dropped (and the drops reported) if a thread logs faster
+ *   than its buffer is drained, rather than blocking the caller.
+ * - Messages reach the handlers asynchronously; call BinaryLogger::flush() to
+ *   wait for them.  Request context strings are not captured.
+ * - FATAL and DFATAL messages are not supported; use XLOGF() for those.
+ */
+
+/**
+ * Log a message to this file's default log category using a format string,
+ * with the formatting deferred to the BinaryLogger thread.
+ *
+ *   XLOGB(DBG2, "request {} took {}us", requestId, latencyUs);
+ */
+#define XLOGB(level, fmt, ...) \
+  XLOGB_IMPL(::folly::LogLevel::level, fmt, ##__VA_ARGS__)
+
+/**
+ * Helper macro implementing XLOGB().  Expects a fully qualified LogLevel.
+ */
+#define XLOGB_IMPL(level, fmt, ...)                                      \
+  (!XLOG_IS_ON_IMPL(level))                                              \
+      ? static_cast<void>(0)                                             \
+      : ::folly::detail::binaryLogWrite(                                 \
+            [](const char* folly_detail_binlog_func) {                   \
+              static_assert(                                             \
+                  !::folly::isLogLevelFatal(level),                      \
+                  "XLOGB() does not support fatal log levels");          \
+              static const ::folly::detail::BinaryLogSite                \
+                  folly_detail_binlog_site{(level),                      \
+                                           XLOG_FILENAME,                \
+                                           __LINE__,                     \
+                                           folly_detail_binlog_func,     \
+                                           (fmt)};                       \
+              return &folly_detail_binlog_site;                          \
+            }(__func__),                                                 \
+            ::folly::detail::binaryLogCategory(                          \
+                [] {                                                     \
+                  static ::folly::XlogCategoryInfo<                      \
+                      XLOG_IS_IN_HEADER_FILE>                            \
+                      folly_detail_xlog_category;                        \
+                  return folly_detail_xlog_category.getInfo(             \
+                      &::folly::detail::custom::xlogFileScopeInfo);      \
+                }(),                                                     \
+                [] {                                                     \
+                  constexpr auto* folly_detail_xlog_filename =           \
+                      XLOG_FILENAME;                                     \
+                  return ::folly::detail::custom::getXlogCategoryName(   \
+                      folly_detail_xlog_filename, 0);                    \
+                }(),                                                     \
+                ::folly::detail::custom::isXlogCategoryOverridden(0)),   \
+            ##__VA_ARGS__)
+
+namespace folly {
+
+class LogCategory;
+class LogWriter;
+
+namespace detail {
+
+/**
+ * Static description of an XLOGB() statement.
+ */
+struct BinaryLogSite {
+  LogLevel level;
+  const char* filename;
+  unsigned int lineNumber;
+  const char* functionName;
+  const char* format;
+};
+
+inline LogCategory* binaryLogCategory(
+    XlogCategoryInfo<true>* categoryInfo,
+    StringPiece categoryName,
+    bool isCategoryNameOverridden) {
+  if (!categoryInfo->isInitialized()) {
+    return categoryInfo->init(categoryName, isCategoryNameOverridden);
+  }
+  return categoryInfo->getCategory(nullptr);
+}
+
+inline LogCategory* binaryLogCategory(
+    XlogFileScopeInfo* fileScopeInfo, StringPiece, bool) {
+  // The level check in XLOGB() has already initialized the file scope info.
+  return fileScopeInfo->category;
+}
+
+/**
+ * Type tags of the encoded arguments of a binary log record.
+ */
+enum class BinaryLogArgType : uint8_t {
+  Bool = 1,
+  Char = 2,
+  Int64 = 3,
+  UInt64 = 4,
+  Double = 5,
+  Pointer = 6,
+  String = 7,
+  Float = 8,
+};
+
+/**
+ * Record kinds, shared by the per-thread buffers and the raw output format.
+ */
+enum class BinaryLogRecordKind : uint32_t {
+  Padding = 0,
+  Message = 1,
+  Site = 2,
+  Discarded = 3,
+};
+
+struct BinaryLogRecordHeader {
+  /*
+   * Size of the record, including this header.  In the thread buffers,
+   * records are followed by padding up to a multiple of 8 bytes.
+   */
+  uint32_t size;
+  BinaryLogRecordKind kind;
+};
+
+struct BinaryLogMessageHeader {
+  const BinaryLogSite* site;
+  const LogCategory* category;
+  int64_t timestampNs;
+};
+
+/**
+ * Single-producer single-consumer ring of variable-sized records.
+ *
+ * Records are stored contiguously and 8-byte aligned; a padding record fills
+ * the end of the buffer when a record does not fit before wrapping around.
+ * When the ring is full, allocate() fails and the record is counted as
+ * discarded.
+ */
+class BinaryLogRing {
+ public:
+  /* The capacity is rounded up to a power of two. */
+  explicit BinaryLogRing(size_t capacity);
+
+  BinaryLogRing(const BinaryLogRing&) = delete;
+  BinaryLogRing& operator=(const BinaryLogRing&) = delete;
+
+  size_t capacity() const { return capacity_; }
+
+  /**
+   * Producer: reserve space for a record with a payload of the given size,
+   * and return a pointer to the payload, or nullptr if the ring is full.
+   * The record becomes visible to the consumer with commit().
+   */
+  uint8_t* allocate(size_t payloadSize, BinaryLogRecordKind kind) {
+    auto recordSize = sizeof(BinaryLogRecordHeader) + payloadSize;
+    auto size = alignRecord(recordSize);
+    auto head = head_.load(std::memory_order_relaxed);
+    auto offset = head & mask_;
+    auto toEnd = capacity_ - offset;
+    auto needed = size <= toEnd ? size : size + toEnd;
+    if (FOLLY_UNLIKELY(head + needed - tailCache_ > capacity_)) {
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      if (head + needed - tailCache_ > capacity_) {
+        discarded_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+      }
+    }
+    if (size > toEnd) {
+      writeHeader(offset, toEnd, BinaryLogRecordKind::Padding);
+      head += toEnd;
+      offset = 0;
+    }
+    writeHeader(offset, recordSize, kind);
+    pending_ = head + size;
+    return data_.get() + offset + sizeof(BinaryLogRecordHeader);
+  }
+
+  /**
+   * Producer: publish the record returned by the last allocate() call.
+   * Returns true if the ring is more than half full.
+   */
+  bool commit() {
+    head_.store(pending_, std::memory_order_release);
+    if (FOLLY_UNLIKELY(pending_ - tailCache_ > capacity_ / 2)) {
+      // tailCache_ is only refreshed when the ring looks full, so it may be
+      // stale since the last drain.
+      tailCache_ = tail_.load(std::memory_order_acquire);
+      return pending_ - tailCache_ > capacity_ / 2;
+    }
+    return false;
+  }
+
+  /**
+   * Consumer: invoke fn(kind, payload) on every published record, then
+   * release their space to the producer.  Returns the number of bytes
+   * consumed.
+   */
+  template <typename Fn>
+  size_t consume(Fn&& fn) {
+    auto tail = tail_.load(std::memory_order_relaxed);
+    auto head = head_.load(std::memory_order_acquire);
+    auto begin = tail;
+    while (tail != head) {
+      BinaryLogRecordHeader header;
+      auto* record = data_.get() + (tail & mask_);
+      std::memcpy(&header, record, sizeof(header));
+      if (header.kind != BinaryLogRecordKind::Padding) {
+        fn(header.kind,
+           ByteRange(record + sizeof(header), header.size - sizeof(header)));
+      }
+      tail += alignRecord(header.size);
+    }
+    tail_.store(tail, std::memory_order_release);
+    return size_t(tail - begin);
+  }
+
+  /**
+   * Consumer: return and reset the number of records discarded because the
+   * ring was full.
+   */
+  uint64_t takeDiscarded() {
+    return discarded_.exchange(0, std::memory_order_relaxed);
+  }
+
+  bool empty() const {
+    return head_.load(std::memory_order_acquire) ==
+        tail_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  static constexpr size_t alignRecord(size_t size) { return (size + 7) & ~7; }
+
+  void writeHeader(size_t offset, size_t size, BinaryLogRecordKind kind) {
+    BinaryLogRecordHeader header{uint32_t(size), kind};
+    std::memcpy(data_.get() + offset, &header, sizeof(header));
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  const std::unique_ptr<uint8_t[]> data_;
+  std::atomic<uint64_t> discarded_{0};
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> head_{0};
+  uint64_t tailCache_{0};
+  uint64_t pending_{0};
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint64_t> tail_{0};
+};
+
+/**
+ * The buffer of one logging thread.
+ */
+struct BinaryLogThreadBuffer {
+  BinaryLogThreadBuffer(size_t capacity, uint64_t id)
+      : ring(capacity), threadID(id) {}
+
+  BinaryLogRing ring;
+  const uint64_t threadID;
+  /* Set when the thread exits; the buffer is freed once drained. */
+  std::atomic<bool> orphaned{false};
+};
+
+/**
+ * Register the calling thread with the BinaryLogger, and store its buffer in
+ * slot.  The slot is reset when the thread exits.  Returns nullptr if called
+ * while the thread is exiting.
+ */
+BinaryLogThreadBuffer* binaryLogRegisterThread(BinaryLogThreadBuffer*& slot);
+
+/**
+ * Ask the BinaryLogger thread to drain the buffers now.
+ */
+void binaryLogWakeDrainer();
+
+inline BinaryLogThreadBuffer* binaryLogThreadBuffer() {
+  static thread_local BinaryLogThreadBuffer* buffer = nullptr;
+  if (FOLLY_UNLIKELY(buffer == nullptr)) {
+    return binaryLogRegisterThread(buffer);
+  }
+  return buffer;
+}
+
+/*
+ * Argument encoding.
+ *
+ * Every argument is converted to one of the types below, and stored as a
+ * BinaryLogArgType tag followed by its value.  Strings are stored as a
+ * uint32_t length followed by the bytes.
+ */
+
+template <typename T>
+auto binaryLogNormalize(const T& value) {
+  using U = remove_cvref_t<T>;
+  if constexpr (std::is_same_v<U, bool> || std::is_same_v<U, char>) {
+    return value;
+  } else if constexpr (std::is_integral_v<U> && std::is_signed_v<U>) {
+    return int64_t(value);
+  } else if constexpr (std::is_integral_v<U>) {
+    return uint64_t(value);
+  } else if constexpr (std::is_same_v<U, float>) {
+    // Not widened: fmt formats a float with the shortest representation of
+    // the float, as XLOGF() does, and not of the double.
+    return value;
+  } else if constexpr (std::is_floating_point_v<U>) {
+    return double(value);
+  } else if constexpr (
+      std::is_pointer_v<U> && std::is_convertible_v<const U&, StringPiece>) {
+    return value ? StringPiece(value) : StringPiece("(null)");
+  } else if constexpr (std::is_convertible_v<const U&, StringPiece>) {
+    return StringPiece(value);
+  } else if constexpr (std::is_pointer_v<U>) {
+    return static_cast<const void*>(value);
+  } else {
+    return fmt::format("{}", value);
+  }
+}
+
+template <typename T>
+constexpr size_t binaryLogArgSize(const T&) {
+  return 1 + sizeof(T);
+}
+inline size_t binaryLogArgSize(StringPiece value) {
+  return 1 + sizeof(uint32_t) + value.size();
+}
+inline size_t binaryLogArgSize(const std::string& value) {
+  return binaryLogArgSize(StringPiece(value));
+}
+
+template <typename T>
+uint8_t* binaryLogArgWriteValue(uint8_t* p, BinaryLogArgType type, T value) {
+  *p = uint8_t(type);
+  std::memcpy(p + 1, &value, sizeof(value));
+  return p + 1 + sizeof(value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, bool value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::Bool, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, char value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::Char, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, int64_t value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::Int64, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, uint64_t value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::UInt64, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, float value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::Float, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, double value) {
+  return binaryLogArgWriteValue(p, BinaryLogArgType::Double, value);
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, const void* value) {
+  return binaryLogArgWriteValue(
+      p, BinaryLogArgType::Pointer, uint64_t(uintptr_t(value)));
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, StringPiece value) {
+  p = binaryLogArgWriteValue(
+      p, BinaryLogArgType::String, uint32_t(value.size()));
+  std::memcpy(p, value.data(), value.size());
+  return p + value.size();
+}
+inline uint8_t* binaryLogArgWrite(uint8_t* p, const std::string& value) {
+  return binaryLogArgWrite(p, StringPiece(value));
+}
+
+template <typename... Args>
+void binaryLogWriteNormalized(
+    const BinaryLogSite* site,
+    const LogCategory* category,
+    const Args&... args) {
+  auto* buffer = binaryLogThreadBuffer();
+  auto size = sizeof(BinaryLogMessageHeader) +
+      (size_t(0) + ... + binaryLogArgSize(args));
+  if (FOLLY_UNLIKELY(buffer == nullptr)) {
+    return;
+  }
+  auto* p = buffer->ring.allocate(size, BinaryLogRecordKind::Message);
+  if (FOLLY_UNLIKELY(p == nullptr)) {
+    return;
+  }
+  BinaryLogMessageHeader header{
+      site,
+      category,
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch())
+          .count()};
+  std::memcpy(p, &header, sizeof(header));
+  p += sizeof(header);
+  ((p = binaryLogArgWrite(p, args)), ...);
+  if (FOLLY_UNLIKELY(buffer->ring.commit())) {
+    binaryLogWakeDrainer();
+  }
+}
+
+template <typename... Args>
+void binaryLogWrite(
+    const BinaryLogSite* site,
+    const LogCategory* category,
+    const Args&... args) {
+  binaryLogWriteNormalized(site, category, binaryLogNormalize(args)...);
+}
+
+/**
+ * Format a message from its format string and encoded arguments.  Errors are
+ * reported in the returned string rather than thrown, like XLOGF() does.
+ */
+std::string binaryLogFormat(StringPiece format, ByteRange args);
+
+} // namespace detail
+
+/**
+ * BinaryLogger owns the per-thread buffers of XLOGB() statements, and the
+ * thread that drains them.
+ *
+ * The raw output format, as written to the writer set with setRawWriter(),
+ * is the 8 byte magic "FBINLOG1" followed by records.  Each record starts
+ * with a uint32_t total size and a uint32_t BinaryLogRecordKind:
+ *
+ * - Site: uint64_t site ID, uint32_t level, uint32_t line number, and the
+ *   file name, function name, format string and category name as strings.
+ *   Written before the first message of each call site.
+ * - Message: uint64_t site ID, uint64_t thread ID, int64_t timestamp in
+ *   nanoseconds since the epoch, then the encoded arguments.
+ * - Discarded: uint64_t thread ID and uint64_t number of dropped messages.
+ *
+ * Strings are a uint32_t length followed by the bytes.  All integers use the
+ * host byte order.
+ */
+class BinaryLogger {
+ public:
+  static constexpr size_t kDefaultThreadBufferSize = 256 * 1024;
+  static constexpr StringPiece kRawMagic{"FBINLOG1"};
+
+  struct Stats {
+    /* Messages drained from the thread buffers. */
+    uint64_t messages{0};
+    /* Bytes drained from the thread buffers. */
+    uint64_t bytes{0};
+    /* Messages dropped because a thread buffer was full. */
+    uint64_t discarded{0};
+  };
+
+  /**
+   * Get the process-wide BinaryLogger.  It is never destroyed, but its
+   * thread is stopped and the buffers are drained at exit.
+   */
+  static BinaryLogger& get();
+
+  /**
+   * Set the buffer size of threads that log their first XLOGB() message
+   * after this call.
+   */
+  void setThreadBufferSize(size_t bytes);
+
+  /**
+   * Write records unformatted to writer instead of formatting them and
+   * passing them to the LogHandlers.  A null writer restores the default.
+   */
+  void setRawWriter(std::shared_ptr<LogWriter> writer);
+
+  /**
+   * Drain all messages logged so far, and flush the handlers (or the raw
+   * writer) they were passed to.
+   */
+  void flush();
+
+  /**
+   * Stop the background thread that drains the buffers, then flush().
+   * Called at exit.  Messages logged afterwards are only written by
+   * flush().
+   */
+  void shutdown();
+
+  Stats getStats() const;
+
+  /* Implementation details, called by XLOGB() statements. */
+  std::shared_ptr<detail::BinaryLogThreadBuffer> registerThread();
+  void wakeDrainer();
+
+ private:
+  class Impl;
+
+  BinaryLogger();
+  ~BinaryLogger() = delete;
+
+  Impl* const impl_;
+};
+
+/**
+ * Formats the raw output of BinaryLogger.
+ *
+ * The input may be fed in chunks of any size; incomplete records are kept
+ * until the rest of them is fed.
+ */
+class BinaryLogDecoder {
+ public:
+  struct Message {
+    LogLevel level;
+    StringPiece filename;
+    unsigned int lineNumber;
+    StringPiece functionName;
+    StringPiece categoryName;
+    uint64_t threadID;
+    std::chrono::system_clock::time_point timestamp;
+    std::string message;
+  };
+
+  using Callback = FunctionRef<void(const Message&)>;
+
+  /**
+   * Decode all complete records of data (and of previously fed data) and
+   * invoke callback for each message.  Discarded records are reported as
+   * WARN messages with an empty file name.
+   *
+   * Throws std::runtime_error if the input is not valid.
+   */
+  void feed(ByteRange data, Callback callback);
+
+  /**
+   * Returns true if the input fed so far ends with a complete record.
+   */
+  bool atRecordBoundary() const { return pending_.empty(); }
+
+ private:
+  struct Site {
+    LogLevel level;
+    unsigned int lineNumber;
+    std::string filename;
+    std::string functionName;
+    std::string format;
+    std::string categoryName;
+  };
+
+  void decodeRecord(
+      detail::BinaryLogRecordKind kind, ByteRange payload, Callback callback);
+
+  bool sawMagic_{false};
+  std::string pending_;
+  std::unordered_map<uint64_t, Site> sites_;
+};
+
+} // namespace folly
@@ -20,6 +20,7 @@
 #include <folly/File.h>
 #include <folly/logging/AsyncFileWriter.h>
 #include <folly/logging/ImmediateFileWriter.h>
+#include <folly/logging/ThreadBufferedFileWriter.h>
 
 using std::make_shared;
 using std::string;
@@ -30,6 +31,9 @@ bool FileWriterFactory::processOption(StringPiece name, StringPiece value) {
   if (name == "async") {
     async_ = to<bool>(value);
     return true;
+  } else if (name == "thread_buffered") {
+    threadBuffered_ = to<bool>(value);
+    return true;
   } else if (name == "max_buffer_size") {
     auto size = to<size_t>(value);
     if (size == 0) {
@@ -44,7 +48,13 @@ bool FileWriterFactory::processOption(StringPiece name, StringPiece value) {
 
 std::shared_ptr<LogWriter> FileWriterFactory::createWriter(File file) {
   // Determine whether we should use ImmediateFileWriter or AsyncFileWriter
-  if (async_) {
+  if (async_ && threadBuffered_) {
+    auto writer = make_shared<ThreadBufferedFileWriter>(std::move(file));
+    if (maxBufferSize_.has_value()) {
+      writer->setMaxBufferSize(maxBufferSize_.value());
+    }
+    return writer;
+  } else if (async_) {
     auto asyncWriter = make_shared<AsyncFileWriter>(std::move(file));
     if (maxBufferSize_.has_value()) {
       asyncWriter->setMaxBufferSize(maxBufferSize_.value());
@@ -56,6 +66,11 @@ std::shared_ptr<LogWriter> FileWriterFactory::createWriter(File file) {
           "the \"max_buffer_size\" option is only valid for async file "
           "handlers"));
     }
+    if (threadBuffered_) {
+      throw std::invalid_argument(to<string>(
+          "the \"thread_buffered\" option is only valid for async file "
+          "handlers"));
+    }
     return make_shared<ImmediateFileWriter>(std::move(file));
   }
 }
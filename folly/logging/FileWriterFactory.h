@@ -27,8 +27,8 @@ class File;
 class LogWriter;
 
 /**
- * A helper class for creating an AsyncFileWriter or ImmediateFileWriter based
- * on log handler options settings.
+ * A helper class for creating an AsyncFileWriter, ThreadBufferedFileWriter or
+ * ImmediateFileWriter based on log handler options settings.
  *
  * This is used by StreamHandlerFactory and FileHandlerFactory.
  */
@@ -39,6 +39,7 @@ class FileWriterFactory {
 
  private:
   bool async_{true};
+  bool threadBuffered_{false};
   Optional<size_t> maxBufferSize_;
 };
 
@@ -69,6 +69,28 @@ LogMessage::LogMessage(
   sanitizeMessage();
 }
 
+LogMessage::LogMessage(
+    const LogCategory* category,
+    LogLevel level,
+    system_clock::time_point timestamp,
+    uint64_t threadID,
+    StringPiece filename,
+    unsigned int lineNumber,
+    StringPiece functionName,
+    std::string&& msg)
+    : category_{category},
+      level_{level},
+      threadID_{threadID},
+      timestamp_{timestamp},
+      filename_{filename},
+      lineNumber_{lineNumber},
+      functionName_{functionName},
+      // The context of the thread that logged the message isn't available.
+      contextString_{},
+      rawMessage_{std::move(msg)} {
+  sanitizeMessage();
+}
+
 StringPiece LogMessage::getFileBaseName() const {
 #ifdef _WIN32
   // Windows allows either backwards or forwards slash as path separator
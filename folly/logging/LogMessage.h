@@ -70,6 +70,22 @@ class LogMessage {
       folly::StringPiece functionName,
       std::string&& msg);
 
+  /**
+   * Construct a LogMessage on behalf of another thread, with an explicit
+   * timestamp and thread ID.  This is used to dispatch messages whose
+   * formatting was deferred to a different thread.  The context string is
+   * left empty, since it would be computed on the wrong thread.
+   */
+  LogMessage(
+      const LogCategory* category,
+      LogLevel level,
+      std::chrono::system_clock::time_point timestamp,
+      uint64_t threadID,
+      folly::StringPiece filename,
+      unsigned int lineNumber,
+      folly::StringPiece functionName,
+      std::string&& msg);
+
   const LogCategory* getCategory() const { return category_; }
 
   LogLevel getLevel() const { return level_; }
@@ -0,0 +1,451 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/ThreadBufferedFileWriter.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/FileUtil.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/SafeAssert.h>
+#include <folly/logging/AsyncLogWriter.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/portability/Unistd.h>
+#include <folly/synchronization/AsymmetricThreadFence.h>
+#include <folly/system/AtFork.h>
+#include <folly/system/ThreadName.h>
+
+namespace folly {
+
+namespace {
+// The smallest buffer that we allocate for a thread.
+constexpr size_t kMinBufferSize = 4096;
+// The maximum number of iovecs that we pass to a single writev() call.
+constexpr size_t kNumIovecs = 64;
+
+// Identifies writers in the thread-local buffer lists.  Unlike addresses,
+// IDs are never reused.
+std::atomic<uint64_t> nextWriterId{1};
+} // namespace
+
+struct ThreadBufferedFileWriter::ThreadBufferList {
+  ~ThreadBufferList() {
+    for (const auto& entry : entries) {
+      entry.second->orphaned.store(true, std::memory_order_release);
+    }
+  }
+
+  std::vector<std::pair<uint64_t, std::shared_ptr<ThreadBuffer>>> entries;
+};
+
+ThreadBufferedFileWriter::ThreadBuffer::ThreadBuffer(size_t size)
+    : capacity{folly::nextPowTwo(std::max(size, kMinBufferSize))},
+      data{new char[capacity]} {}
+
+bool ThreadBufferedFileWriter::ThreadBuffer::write(StringPiece message) {
+  auto size = message.size();
+  auto h = head.load(std::memory_order_relaxed);
+  if (h + size - tailCache > capacity) {
+    tailCache = tail.load(std::memory_order_acquire);
+    if (h + size - tailCache > capacity) {
+      return false;
+    }
+  }
+
+  auto offset = h & (capacity - 1);
+  auto first = std::min(size, capacity - offset);
+  std::memcpy(data.get() + offset, message.data(), first);
+  std::memcpy(data.get(), message.data() + first, size - first);
+  head.store(h + size, std::memory_order_release);
+  return true;
+}
+
+ThreadBufferedFileWriter::ThreadBufferedFileWriter(StringPiece path)
+    : ThreadBufferedFileWriter{
+          File{path.str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC}} {}
+
+ThreadBufferedFileWriter::ThreadBufferedFileWriter(folly::File&& file)
+    : id_{nextWriterId.fetch_add(1, std::memory_order_relaxed)},
+      file_{std::move(file)} {
+  folly::AtFork::registerHandler(
+      this,
+      [this] { return preFork(); },
+      [this] { postForkParent(); },
+      [this] { postForkChild(); });
+
+  // Start the I/O thread after registering the atfork handler, as
+  // AsyncLogWriter does.  postForkParent() may already have started it.
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!ioThread_.joinable()) {
+    startIoThread();
+  }
+}
+
+ThreadBufferedFileWriter::~ThreadBufferedFileWriter() {
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    destroying_ = true;
+    stopIoThread(lock);
+  }
+
+  // The I/O thread stops without writing out pending messages, so write
+  // them out here.
+  drain();
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& buffer : buffers_) {
+      buffer->closed.store(true, std::memory_order_relaxed);
+    }
+  }
+
+  // Unregister the atfork handler after stopping the I/O thread.
+  // preFork(), postForkParent(), and postForkChild() calls can run
+  // concurrently with the destructor until unregisterHandler() returns.
+  folly::AtFork::unregisterHandler(this);
+}
+
+bool ThreadBufferedFileWriter::ttyOutput() const {
+  return isatty(file_.fd());
+}
+
+void ThreadBufferedFileWriter::setMaxBufferSize(size_t size) {
+  maxBufferSize_.store(size, std::memory_order_relaxed);
+}
+
+size_t ThreadBufferedFileWriter::getMaxBufferSize() const {
+  return maxBufferSize_.load(std::memory_order_relaxed);
+}
+
+ThreadBufferedFileWriter::ThreadBuffer*
+ThreadBufferedFileWriter::getThreadBuffer() {
+  // A plain thread_local rather than folly::ThreadLocal, so that a thread
+  // logging its first message while another thread forks cannot leave the
+  // ThreadLocal locks held in the child process.  exited is trivially
+  // destructible, so it remains valid while other thread_local objects are
+  // destroyed.
+  static thread_local bool exited = false;
+  struct List : ThreadBufferList {
+    ~List() { exited = true; }
+  };
+  static thread_local List list;
+  if (exited) {
+    return nullptr;
+  }
+
+  for (const auto& entry : list.entries) {
+    if (entry.first == id_) {
+      return entry.second.get();
+    }
+  }
+
+  // Drop the buffers of writers that have been destroyed.
+  auto& entries = list.entries;
+  entries.erase(
+      std::remove_if(
+          entries.begin(),
+          entries.end(),
+          [](const auto& entry) {
+            return entry.second->closed.load(std::memory_order_relaxed);
+          }),
+      entries.end());
+
+  auto buffer = std::make_shared<ThreadBuffer>(getMaxBufferSize());
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.push_back(buffer);
+  }
+  entries.emplace_back(id_, std::move(buffer));
+  return entries.back().second.get();
+}
+
+void ThreadBufferedFileWriter::writeMessage(
+    StringPiece buffer, uint32_t flags) {
+  auto* threadBuffer = getThreadBuffer();
+  if (!threadBuffer) {
+    // The thread is exiting and its buffers may already be gone.
+    writeOverflow(nullptr, buffer, flags);
+  } else if (threadBuffer->write(buffer)) {
+    wakeIoThread();
+  } else if (
+      (flags & NEVER_DISCARD) || buffer.size() > threadBuffer->capacity) {
+    writeOverflow(threadBuffer, buffer, flags);
+  } else {
+    threadBuffer->discarded.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+void ThreadBufferedFileWriter::wakeIoThread() {
+  // Pairs with the heavy fence in ioThread(): either the I/O thread sees the
+  // message that was just written, or we see that pending_ was cleared and
+  // wake it up again.
+  folly::asymmetric_thread_fence_light(std::memory_order_seq_cst);
+  if (pending_.load(std::memory_order_relaxed) ||
+      pending_.exchange(true, std::memory_order_relaxed)) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  messageReady_.notify_one();
+}
+
+void ThreadBufferedFileWriter::writeOverflow(
+    ThreadBuffer* buffer, StringPiece message, uint32_t flags) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (overflowBytes_ >= getMaxBufferSize() && !(flags & NEVER_DISCARD)) {
+    ++overflowDiscarded_;
+    return;
+  }
+  overflowBytes_ += message.size();
+  if (buffer) {
+    // Only the calling thread writes to its buffer, so head is the end of
+    // the messages it logged before this one.
+    buffer->overflow.emplace_back(
+        buffer->head.load(std::memory_order_relaxed), message.str());
+  } else {
+    overflow_.emplace_back(message.str());
+  }
+  pending_.store(true, std::memory_order_relaxed);
+  messageReady_.notify_one();
+}
+
+void ThreadBufferedFileWriter::flush() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto target = ++flushRequested_;
+  messageReady_.notify_one();
+  ioCV_.wait(
+      lock, [&] { return flushCompleted_ >= target || ioThreadStopped_; });
+}
+
+void ThreadBufferedFileWriter::ioThread() {
+  folly::setThreadName("log_writer");
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    messageReady_.wait(lock, [&] {
+      return stop_ || pending_.load(std::memory_order_relaxed) ||
+          flushCompleted_ != flushRequested_;
+    });
+
+    if (stop_) {
+      // As in AsyncLogWriter, exit without writing out pending messages.
+      // They are written by the destructor, or by the parent process after
+      // a fork().
+      ioThreadStopped_ = true;
+      lock.unlock();
+      ioCV_.notify_all();
+      return;
+    }
+
+    auto flushTarget = flushRequested_;
+    lock.unlock();
+
+    pending_.store(false, std::memory_order_relaxed);
+    folly::asymmetric_thread_fence_heavy(std::memory_order_seq_cst);
+    drain();
+
+    lock.lock();
+    flushCompleted_ = flushTarget;
+    ioCV_.notify_all();
+  }
+}
+
+void ThreadBufferedFileWriter::drain() {
+  std::lock_guard<std::mutex> drainLock(drainMutex_);
+
+  struct Snapshot {
+    ThreadBuffer* buffer;
+    uint64_t head;
+    std::vector<std::pair<uint64_t, std::string>> overflow;
+  };
+  // Only drain() removes buffers from buffers_, so the raw pointers remain
+  // valid until we return.
+  std::vector<Snapshot> snapshots;
+  std::vector<std::string> overflow;
+  size_t numDiscarded;
+  {
+    // Load the heads while holding mutex_, so that the buffers contain all
+    // messages logged before the overflow messages we take, and none logged
+    // after the overflow messages we leave for the next drain().
+    std::lock_guard<std::mutex> lock(mutex_);
+    snapshots.reserve(buffers_.size());
+    for (const auto& buffer : buffers_) {
+      snapshots.push_back(
+          {buffer.get(),
+           buffer->head.load(std::memory_order_acquire),
+           std::move(buffer->overflow)});
+      buffer->overflow.clear();
+    }
+    overflow.swap(overflow_);
+    overflowBytes_ = 0;
+    numDiscarded = std::exchange(overflowDiscarded_, 0);
+  }
+
+  std::vector<iovec> iovecs;
+  auto addRange = [&](const ThreadBuffer& buffer, uint64_t from, uint64_t to) {
+    auto size = to - from;
+    if (size == 0) {
+      return;
+    }
+    auto offset = from & (buffer.capacity - 1);
+    auto first = std::min<size_t>(size, buffer.capacity - offset);
+    iovecs.push_back({buffer.data.get() + offset, first});
+    if (first < size) {
+      iovecs.push_back({buffer.data.get(), size - first});
+    }
+  };
+  bool anyOrphaned = false;
+  for (auto& snapshot : snapshots) {
+    auto& buffer = *snapshot.buffer;
+    anyOrphaned |= buffer.orphaned.load(std::memory_order_relaxed);
+    numDiscarded += buffer.discarded.exchange(0, std::memory_order_relaxed);
+
+    // Write the overflow messages of the thread between the messages in its
+    // buffer that were logged before and after them.
+    auto position = buffer.tail.load(std::memory_order_relaxed);
+    for (auto& entry : snapshot.overflow) {
+      FOLLY_SAFE_DCHECK(
+          position <= entry.first && entry.first <= snapshot.head,
+          "overflow message outside of the drained range");
+      addRange(buffer, position, entry.first);
+      iovecs.push_back(
+          {const_cast<char*>(entry.second.data()), entry.second.size()});
+      position = entry.first;
+    }
+    addRange(buffer, position, snapshot.head);
+  }
+  for (auto& message : overflow) {
+    iovecs.push_back({const_cast<char*>(message.data()), message.size()});
+  }
+
+  try {
+    writeData(iovecs, numDiscarded);
+  } catch (const std::exception& ex) {
+    LoggerDB::internalWarning(
+        __FILE__,
+        __LINE__,
+        "error writing to log file ",
+        file_.fd(),
+        " in ThreadBufferedFileWriter: ",
+        folly::exceptionStr(ex));
+  }
+
+  for (const auto& snapshot : snapshots) {
+    snapshot.buffer->tail.store(snapshot.head, std::memory_order_release);
+  }
+  if (numDiscarded > 0) {
+    AsyncLogWriter::invokeDiscardCallback(numDiscarded);
+  }
+
+  if (anyOrphaned) {
+    // Free the buffers of threads that have exited, once they are empty.
+    // orphaned is set after the last message of the thread was written, so
+    // loading it first guarantees that we see that message.
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.erase(
+        std::remove_if(
+            buffers_.begin(),
+            buffers_.end(),
+            [](const std::shared_ptr<ThreadBuffer>& buffer) {
+              return buffer->orphaned.load(std::memory_order_acquire) &&
+                  buffer->head.load(std::memory_order_acquire) ==
+                  buffer->tail.load(std::memory_order_relaxed) &&
+                  buffer->overflow.empty();
+            }),
+        buffers_.end());
+  }
+}
+
+void ThreadBufferedFileWriter::writeData(
+    std::vector<iovec>& iovecs, size_t numDiscarded) {
+  for (size_t idx = 0; idx < iovecs.size(); idx += kNumIovecs) {
+    auto count = std::min(kNumIovecs, iovecs.size() - idx);
+    auto ret = folly::writevFull(file_.fd(), iovecs.data() + idx, count);
+    folly::checkUnixError(ret, "writevFull() failed");
+  }
+
+  if (numDiscarded > 0) {
+    // Use the same message as AsyncFileWriter.
+    auto msg = folly::to<std::string>(
+        numDiscarded,
+        " log messages discarded: logging faster than we can write\n");
+    auto ret = folly::writeFull(file_.fd(), msg.data(), msg.size());
+    // We currently ignore errors from writeFull() here.
+    (void)ret;
+  }
+}
+
+bool ThreadBufferedFileWriter::preFork() {
+  // Stop the I/O thread, and hold mutex_ until after the fork so that the
+  // child does not inherit it in a locked state.  See
+  // AsyncLogWriter::preFork() for why the thread is also restarted in the
+  // parent.
+  forkLock_ = std::unique_lock<std::mutex>(mutex_);
+  if (ioThread_.joinable()) {
+    stopIoThread(forkLock_);
+  }
+  return true;
+}
+
+void ThreadBufferedFileWriter::postForkParent() {
+  auto lock = std::move(forkLock_);
+  if (!destroying_) {
+    startIoThread();
+  }
+}
+
+void ThreadBufferedFileWriter::postForkChild() {
+  auto lock = std::move(forkLock_);
+
+  // Drop any pending messages.  We only want them to be written once, and
+  // we let the parent process handle writing them.
+  for (const auto& buffer : buffers_) {
+    buffer->tail.store(
+        buffer->head.load(std::memory_order_acquire),
+        std::memory_order_release);
+    buffer->discarded.store(0, std::memory_order_relaxed);
+    buffer->overflow.clear();
+  }
+  overflow_.clear();
+  overflowBytes_ = 0;
+  overflowDiscarded_ = 0;
+  pending_.store(false, std::memory_order_relaxed);
+
+  if (!destroying_) {
+    startIoThread();
+  }
+}
+
+void ThreadBufferedFileWriter::startIoThread() {
+  stop_ = false;
+  ioThreadStopped_ = false;
+  ioThread_ = std::thread([this] { ioThread(); });
+}
+
+void ThreadBufferedFileWriter::stopIoThread(
+    std::unique_lock<std::mutex>& lock) {
+  if (!ioThread_.joinable()) {
+    return;
+  }
+  stop_ = true;
+  messageReady_.notify_one();
+  ioCV_.wait(lock, [&] { return ioThreadStopped_; });
+  ioThread_.join();
+}
+
+} // namespace folly
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <folly/File.h>
+#include <folly/Range.h>
+#include <folly/lang/Align.h>
+#include <folly/logging/LogWriter.h>
+#include <folly/portability/SysUio.h>
+
+namespace folly {
+
+/**
+ * An asynchronous LogWriter for files, designed for many threads logging at a
+ * high rate.
+ *
+ * Like AsyncFileWriter, messages are written by a separate I/O thread, and
+ * are discarded rather than blocking the caller when they are generated
+ * faster than they can be written.  Instead of a single locked queue shared
+ * by all threads, every thread appends its messages to its own lock-free
+ * ring buffer, and the I/O thread writes out the contents of all buffers with
+ * writev().  Logging threads never take a lock, except to wake up the idle
+ * I/O thread.
+ *
+ * Messages of each thread are written in order, but messages logged by
+ * different threads at about the same time may be written in a different
+ * order than they were logged.
+ *
+ * Each thread's buffer holds up to getMaxBufferSize() bytes.  Messages that
+ * do not fit are discarded, and the number of discarded messages is written
+ * to the file and passed to the AsyncLogWriter discard callback once the I/O
+ * thread catches up.  Messages logged with NEVER_DISCARD, and messages larger
+ * than a thread buffer, are instead added to an overflow queue, together with
+ * their position in the buffer of the thread so that they are written in
+ * order with its other messages.
+ */
+class ThreadBufferedFileWriter : public LogWriter {
+ public:
+  static constexpr size_t kDefaultMaxBufferSize = 256 * 1024;
+
+  /**
+   * Construct a ThreadBufferedFileWriter that appends to the file at the
+   * specified path.
+   */
+  explicit ThreadBufferedFileWriter(folly::StringPiece path);
+
+  /**
+   * Construct a ThreadBufferedFileWriter that writes to the specified File
+   * object.
+   */
+  explicit ThreadBufferedFileWriter(folly::File&& file);
+
+  ~ThreadBufferedFileWriter() override;
+
+  void writeMessage(folly::StringPiece buffer, uint32_t flags = 0) override;
+
+  /**
+   * Block until the I/O thread has finished writing all messages that
+   * were already written when flush() was called.
+   */
+  void flush() override;
+
+  bool ttyOutput() const override;
+
+  /**
+   * Set the size of the buffers of threads that write their first message
+   * after this call, in bytes.  It is rounded up to a power of two.
+   */
+  void setMaxBufferSize(size_t size);
+
+  size_t getMaxBufferSize() const;
+
+  const folly::File& getFile() const { return file_; }
+
+ private:
+  /**
+   * Single-producer single-consumer byte ring holding the messages of one
+   * thread.  Only complete messages are ever published.
+   */
+  struct ThreadBuffer {
+    explicit ThreadBuffer(size_t capacity);
+
+    bool write(StringPiece message);
+
+    const size_t capacity;
+    const std::unique_ptr<char[]> data;
+    std::atomic<uint64_t> discarded{0};
+    /* Set when the owning thread exits; the buffer is freed once drained. */
+    std::atomic<bool> orphaned{false};
+    /* Set when the writer is destroyed; the thread then drops the buffer. */
+    std::atomic<bool> closed{false};
+    /*
+     * Messages that did not fit, each with the value of head when it was
+     * written.  Protected by the mutex_ of the writer.
+     */
+    std::vector<std::pair<uint64_t, std::string>> overflow;
+
+    alignas(hardware_destructive_interference_size)
+        std::atomic<uint64_t> head{0};
+    uint64_t tailCache{0};
+
+    alignas(hardware_destructive_interference_size)
+        std::atomic<uint64_t> tail{0};
+  };
+
+  /* The buffers of the calling thread for all writers, in thread_local. */
+  struct ThreadBufferList;
+
+  ThreadBuffer* getThreadBuffer();
+  void wakeIoThread();
+  void writeOverflow(
+      ThreadBuffer* buffer, StringPiece message, uint32_t flags);
+
+  void ioThread();
+  void drain();
+  void writeData(std::vector<iovec>& iovecs, size_t numDiscarded);
+
+  bool preFork();
+  void postForkParent();
+  void postForkChild();
+  void startIoThread();
+  void stopIoThread(std::unique_lock<std::mutex>& lock);
+
+  const uint64_t id_;
+  folly::File file_;
+  std::atomic<size_t> maxBufferSize_{kDefaultMaxBufferSize};
+
+  /* Set by writers when there is data for the idle I/O thread. */
+  alignas(hardware_destructive_interference_size)
+      std::atomic<bool> pending_{false};
+
+  std::mutex mutex_;
+  std::condition_variable messageReady_;
+  std::condition_variable ioCV_;
+  /* Everything below is protected by mutex_. */
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers_;
+  /* Overflow messages of threads whose buffers are already gone. */
+  std::vector<std::string> overflow_;
+  size_t overflowBytes_{0};
+  size_t overflowDiscarded_{0};
+  uint64_t flushRequested_{0};
+  uint64_t flushCompleted_{0};
+  bool stop_{false};
+  bool ioThreadStopped_{false};
+  bool destroying_{false};
+  std::thread ioThread_;
+  /* Held between preFork() and postForkParent()/postForkChild(). */
+  std::unique_lock<std::mutex> forkLock_;
+
+  /* Serializes drain(), which runs in the I/O thread and the destructor. */
+  std::mutex drainMutex_;
+};
+
+} // namespace folly
@@ -0,0 +1,120 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/BinaryLog.h>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/logging/Init.h>
+#include <folly/logging/LogHandler.h>
+#include <folly/logging/LogHandlerConfig.h>
+#include <folly/logging/LogHandlerFactory.h>
+#include <folly/logging/LogWriter.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/portability/GFlags.h>
+
+// Per-call cost of XLOGF(), which formats the message and runs the handlers
+// on the logging thread, against XLOGB(), which only copies the arguments
+// into the thread's buffer and leaves the rest to the BinaryLogger thread.
+// The handlers and the raw writer discard everything, so that only logging
+// overhead is measured.  Draining the XLOGB() buffers is not measured.
+
+namespace folly {
+
+namespace {
+class NullHandler : public LogHandler {
+ public:
+  void handleMessage(const LogMessage&, const LogCategory*) override {}
+  void flush() override {}
+  LogHandlerConfig getConfig() const override { return LogHandlerConfig{""}; }
+};
+class NullHandlerFactory : public LogHandlerFactory {
+ public:
+  StringPiece getType() const override { return "null"; }
+  std::shared_ptr<LogHandler> createHandler(const Options&) override {
+    return std::make_shared<NullHandler>();
+  }
+};
+class NullWriter : public LogWriter {
+ public:
+  void writeMessage(StringPiece, uint32_t) override {}
+  void flush() override {}
+  bool ttyOutput() const override { return false; }
+};
+
+const std::string kHost = "host1234.example.com";
+} // namespace
+
+BENCHMARK(xlogf, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    XLOGF(INFO, "request {} from {} took {:.3f}ms", i, kHost, i * 0.001);
+  }
+}
+
+BENCHMARK_RELATIVE(xlogb, iters) {
+  BenchmarkSuspender braces;
+  braces.dismissing([&] {
+    for (size_t i = 0; i < iters; ++i) {
+      XLOGB(INFO, "request {} from {} took {:.3f}ms", i, kHost, i * 0.001);
+    }
+  });
+  BinaryLogger::get().flush();
+}
+
+BENCHMARK_RELATIVE(xlogb_raw, iters) {
+  BenchmarkSuspender braces;
+  BinaryLogger::get().setRawWriter(std::make_shared<NullWriter>());
+  braces.dismissing([&] {
+    for (size_t i = 0; i < iters; ++i) {
+      XLOGB(INFO, "request {} from {} took {:.3f}ms", i, kHost, i * 0.001);
+    }
+  });
+  BinaryLogger::get().flush();
+  BinaryLogger::get().setRawWriter(nullptr);
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(xlogf_disabled, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    XLOGF(DBG1, "request {} from {} took {:.3f}ms", i, kHost, i * 0.001);
+  }
+}
+
+BENCHMARK_RELATIVE(xlogb_disabled, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    XLOGB(DBG1, "request {} from {} took {:.3f}ms", i, kHost, i * 0.001);
+  }
+}
+
+} // namespace folly
+
+FOLLY_INIT_LOGGING_CONFIG(".=INFO:default; default=null");
+
+int main(int argc, char** argv) {
+  folly::LoggerDB::get().registerHandlerFactory(
+      std::make_unique<folly::NullHandlerFactory>(),
+      /* replaceExisting = */ true);
+  folly::Init init(&argc, &argv);
+  // Large enough that the benchmark loops do not outrun the drainer.
+  folly::BinaryLogger::get().setThreadBufferSize(64 << 20);
+  folly::runBenchmarks();
+  auto stats = folly::BinaryLogger::get().getStats();
+  if (stats.discarded != 0) {
+    XLOGF(WARN, "{} XLOGB() messages were discarded", stats.discarded);
+  }
+  return 0;
+}
@@ -0,0 +1,351 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/BinaryLog.h>
+
+#include <mutex>
+#include <thread>
+
+#include <folly/logging/LogConfigParser.h>
+#include <folly/logging/LogMessage.h>
+#include <folly/logging/LogWriter.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/logging/test/TestLogHandler.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <folly/system/ThreadId.h>
+
+using namespace folly;
+using testing::ElementsAre;
+using testing::HasSubstr;
+
+XLOG_SET_CATEGORY_NAME("binary_log_test")
+
+namespace {
+
+struct Point {
+  int x;
+  int y;
+};
+
+class StringLogWriter : public LogWriter {
+ public:
+  void writeMessage(StringPiece buffer, uint32_t /* flags */) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    data_.append(buffer.data(), buffer.size());
+  }
+  void flush() override {}
+  bool ttyOutput() const override { return false; }
+
+  std::string data() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return data_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  std::string data_;
+};
+
+class BinaryLogTest : public testing::Test {
+ public:
+  BinaryLogTest() {
+    // XLOGB() always uses the main LoggerDB singleton, so reset its
+    // configuration before every test.
+    LoggerDB::get().resetConfig(
+        parseLogConfig(".=WARN, binary_log_test=DBG1"));
+    LoggerDB::get().getCategory("binary_log_test")->addHandler(handler_);
+  }
+
+  ~BinaryLogTest() override { BinaryLogger::get().flush(); }
+
+  std::vector<std::string> flushMessages() {
+    BinaryLogger::get().flush();
+    return handler_->getMessageValues();
+  }
+
+  std::shared_ptr<TestLogHandler> handler_{std::make_shared<TestLogHandler>()};
+};
+
+} // namespace
+
+template <>
+struct fmt::formatter<Point> : fmt::formatter<std::string_view> {
+  template <typename Context>
+  auto format(const Point& p, Context& ctx) const {
+    return fmt::format_to(ctx.out(), "({}, {})", p.x, p.y);
+  }
+};
+
+TEST_F(BinaryLogTest, formatsMessages) {
+  int n = 5;
+  std::string str = "string";
+  unsigned int line = __LINE__ + 1;
+  XLOGB(INFO, "{} {} {:.2f} {}", n, uint64_t(1) << 63, 0.125, 'c');
+  XLOGB(DBG1, "{} and {} and {}", "literal", str, StringPiece(str).subpiece(3));
+  XLOGB(INFO, "{:>5}|{:x}|{}", true, 255u, static_cast<int8_t>(-3));
+  XLOGB(WARN, "no arguments");
+
+  EXPECT_THAT(
+      flushMessages(),
+      ElementsAre(
+          "5 9223372036854775808 0.12 c",
+          "literal and string and ing",
+          " true|ff|-3",
+          "no arguments"));
+
+  const auto& message = handler_->getMessages().at(0).first;
+  EXPECT_EQ(LogLevel::INFO, message.getLevel());
+  EXPECT_EQ("binary_log_test", message.getCategory()->getName());
+  EXPECT_EQ("BinaryLogTest.cpp", message.getFileBaseName());
+  EXPECT_EQ(line, message.getLineNumber());
+  EXPECT_EQ("TestBody", message.getFunctionName());
+  EXPECT_EQ(getOSThreadID(), message.getThreadID());
+  EXPECT_EQ("", message.getContextString());
+  EXPECT_LE(message.getTimestamp(), std::chrono::system_clock::now());
+}
+
+TEST_F(BinaryLogTest, levels) {
+  int evaluated = 0;
+  auto arg = [&] { return ++evaluated; };
+  XLOGB(DBG2, "disabled {}", arg());
+  EXPECT_EQ(0, evaluated);
+  EXPECT_FALSE(XLOG_IS_ON(DBG2));
+
+  LoggerDB::get().setLevel("binary_log_test", LogLevel::DBG2);
+  XLOGB(DBG2, "enabled {}", arg());
+  EXPECT_EQ(1, evaluated);
+  EXPECT_THAT(flushMessages(), ElementsAre("enabled 1"));
+}
+
+TEST_F(BinaryLogTest, floatsMatchXlogf) {
+  float f = 0.1f;
+  double d = 0.1;
+  XLOGB(INFO, "{} {} {:.3f}", f, d, 2.5f);
+  XLOGF(INFO, "{} {} {:.3f}", f, d, 2.5f);
+  // The XLOGF() message is delivered first, the XLOGB() one when flushed.
+  EXPECT_THAT(
+      flushMessages(), ElementsAre("0.1 0.1 2.500", "0.1 0.1 2.500"));
+}
+
+TEST_F(BinaryLogTest, otherTypes) {
+  Point p{1, 2};
+  int x = 0;
+  XLOGB(INFO, "point {}", p);
+  XLOGB(INFO, "{}", static_cast<void*>(&x) != nullptr);
+  XLOGB(INFO, "{}", fmt::ptr(&x));
+  XLOGB(INFO, "{} {}", "too few arguments");
+  const char* null = nullptr;
+  XLOGB(INFO, "{}", null);
+  auto messages = flushMessages();
+  ASSERT_EQ(5, messages.size());
+  EXPECT_EQ("point (1, 2)", messages[0]);
+  EXPECT_EQ("true", messages[1]);
+  EXPECT_EQ(fmt::format("{}", fmt::ptr(&x)), messages[2]);
+  EXPECT_THAT(messages[3], HasSubstr("error formatting log message: "));
+  EXPECT_THAT(
+      messages[3],
+      HasSubstr("format string: \"{} {}\", arguments: too few arguments"));
+  EXPECT_EQ("(null)", messages[4]);
+}
+
+TEST_F(BinaryLogTest, multipleThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kMessages = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([t] {
+      for (int i = 0; i < kMessages; ++i) {
+        XLOGB(INFO, "{} {}", t, i);
+        if (i % 64 == 0) {
+          // Give the drainer a chance to keep up.
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto stats = BinaryLogger::get().getStats();
+  auto messages = flushMessages();
+
+  // Messages of each thread arrive in order, unless some were discarded.
+  std::vector<int> next(kThreads, 0);
+  for (const auto& message : messages) {
+    int t;
+    int i;
+    ASSERT_EQ(2, sscanf(message.c_str(), "%d %d", &t, &i)) << message;
+    EXPECT_LE(next[t], i);
+    next[t] = i + 1;
+  }
+  EXPECT_EQ(
+      kThreads * kMessages,
+      messages.size() + BinaryLogger::get().getStats().discarded -
+          stats.discarded);
+}
+
+TEST_F(BinaryLogTest, discarded) {
+  auto rootHandler = std::make_shared<TestLogHandler>();
+  LoggerDB::get().getCategory("")->addHandler(rootHandler);
+
+  BinaryLogger::get().setThreadBufferSize(4096);
+  auto before = BinaryLogger::get().getStats();
+  std::thread([] {
+    std::string big(512, 'x');
+    for (int i = 0; i < 1000; ++i) {
+      XLOGB(INFO, "{}", big);
+    }
+  }).join();
+  BinaryLogger::get().setThreadBufferSize(
+      BinaryLogger::kDefaultThreadBufferSize);
+  flushMessages();
+
+  auto after = BinaryLogger::get().getStats();
+  auto discarded = after.discarded - before.discarded;
+  EXPECT_GT(discarded, 0);
+  EXPECT_EQ(1000, after.messages - before.messages + discarded);
+  bool reported = false;
+  for (const auto& message : rootHandler->getMessageValues()) {
+    reported |= message.find("binary log discarded") != std::string::npos;
+  }
+  EXPECT_TRUE(reported);
+}
+
+TEST_F(BinaryLogTest, rawWriterAndDecoder) {
+  auto writer = std::make_shared<StringLogWriter>();
+  BinaryLogger::get().setRawWriter(writer);
+  for (int i = 0; i < 3; ++i) {
+    XLOGB(INFO, "raw {} {}", i, "message");
+  }
+  XLOGB(DBG1, "{:.1f}", 2.5);
+  BinaryLogger::get().flush();
+  BinaryLogger::get().setRawWriter(nullptr);
+
+  // Nothing was passed to the handlers.
+  EXPECT_TRUE(handler_->getMessages().empty());
+
+  auto data = writer->data();
+  ASSERT_EQ(0, data.find(BinaryLogger::kRawMagic.str()));
+
+  // Feed the decoder one byte at a time to exercise partial records.
+  BinaryLogDecoder decoder;
+  std::vector<BinaryLogDecoder::Message> decoded;
+  for (char c : data) {
+    decoder.feed(
+        ByteRange(StringPiece(&c, 1)),
+        [&](const BinaryLogDecoder::Message& message) {
+          decoded.push_back(message);
+        });
+  }
+  EXPECT_TRUE(decoder.atRecordBoundary());
+  ASSERT_EQ(4, decoded.size());
+  EXPECT_EQ("raw 0 message", decoded[0].message);
+  EXPECT_EQ("raw 2 message", decoded[2].message);
+  EXPECT_EQ("2.5", decoded[3].message);
+  EXPECT_EQ(LogLevel::INFO, decoded[0].level);
+  EXPECT_EQ(LogLevel::DBG1, decoded[3].level);
+  EXPECT_EQ("binary_log_test", decoded[0].categoryName);
+  EXPECT_EQ("TestBody", decoded[0].functionName);
+  EXPECT_THAT(decoded[0].filename.str(), HasSubstr("BinaryLogTest.cpp"));
+  EXPECT_EQ(getOSThreadID(), decoded[0].threadID);
+}
+
+TEST_F(BinaryLogTest, shutdown) {
+  XLOGB(INFO, "before");
+  BinaryLogger::get().shutdown();
+  EXPECT_THAT(handler_->getMessageValues(), ElementsAre("before"));
+
+  // The drainer thread is gone, but flush() still drains the buffers.
+  XLOGB(INFO, "after");
+  EXPECT_THAT(flushMessages(), ElementsAre("before", "after"));
+}
+
+TEST(BinaryLogDecoder, invalidInput) {
+  BinaryLogDecoder decoder;
+  auto ignore = [](const BinaryLogDecoder::Message&) {};
+  EXPECT_THROW(
+      decoder.feed(ByteRange(StringPiece("not a log")), ignore),
+      std::runtime_error);
+
+  // A message record that refers to a site that was never described.
+  std::string data = BinaryLogger::kRawMagic.str();
+  detail::BinaryLogRecordHeader header{
+      sizeof(header) + 24, detail::BinaryLogRecordKind::Message};
+  data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  data.append(24, '\0');
+  BinaryLogDecoder decoder2;
+  EXPECT_THROW(
+      decoder2.feed(ByteRange(StringPiece(data)), ignore), std::runtime_error);
+}
+
+TEST(BinaryLogRing, wrapAround) {
+  detail::BinaryLogRing ring(4096);
+  EXPECT_EQ(4096, ring.capacity());
+
+  uint64_t produced = 0;
+  uint64_t consumed = 0;
+  for (int round = 0; round < 100; ++round) {
+    // Fill the ring with records of varying sizes until it is full.
+    while (true) {
+      auto size = 1 + (produced * 37) % 300;
+      auto* p = ring.allocate(size, detail::BinaryLogRecordKind::Message);
+      if (!p) {
+        break;
+      }
+      std::memset(p, int(produced & 0xff), size);
+      ring.commit();
+      ++produced;
+    }
+    EXPECT_EQ(1, ring.takeDiscarded());
+    ring.consume([&](detail::BinaryLogRecordKind kind, ByteRange record) {
+      EXPECT_EQ(detail::BinaryLogRecordKind::Message, kind);
+      ASSERT_EQ(1 + (consumed * 37) % 300, record.size());
+      for (auto byte : record) {
+        ASSERT_EQ(consumed & 0xff, byte);
+      }
+      ++consumed;
+    });
+    EXPECT_TRUE(ring.empty());
+  }
+  EXPECT_EQ(produced, consumed);
+  EXPECT_EQ(
+      nullptr, ring.allocate(8192, detail::BinaryLogRecordKind::Message));
+}
+
+TEST(BinaryLogRing, noWakeupAfterDrain) {
+  detail::BinaryLogRing ring(4096);
+  auto log = [&] {
+    auto* p = ring.allocate(100, detail::BinaryLogRecordKind::Message);
+    EXPECT_NE(nullptr, p);
+    return ring.commit();
+  };
+
+  // Fill the ring past half: the producer asks for a drain.
+  int records = 0;
+  while (!log()) {
+    ++records;
+  }
+  ring.consume([](detail::BinaryLogRecordKind, ByteRange) {});
+
+  // Once drained, the producer keeps logging without asking for a drain on
+  // every record, and only asks again when the ring is half full again.
+  // One record fewer fits, as the ring now wraps around and pads its end.
+  for (int i = 0; i < records - 1; ++i) {
+    EXPECT_FALSE(log()) << i;
+  }
+  EXPECT_TRUE(log());
+}
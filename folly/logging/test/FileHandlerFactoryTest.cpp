@@ -22,6 +22,7 @@
 #include <folly/logging/ImmediateFileWriter.h>
 #include <folly/logging/StandardLogHandler.h>
 #include <folly/logging/StreamHandlerFactory.h>
+#include <folly/logging/ThreadBufferedFileWriter.h>
 #include <folly/portability/GTest.h>
 #include <folly/test/TestUtils.h>
 #include <folly/testing/TestUtil.h>
@@ -147,6 +148,36 @@ TEST(FileHandlerFactory, pathWithMaxBufferSize) {
       stdHandler->getWriter().get(), tmpFile.path().string().c_str(), 4096000);
 }
 
+TEST(FileHandlerFactory, threadBuffered) {
+  FileHandlerFactory factory;
+
+  TemporaryFile tmpFile{"logging_test"};
+  auto options = LogHandlerFactory::Options{
+      make_pair("path", tmpFile.path().string()),
+      make_pair("thread_buffered", "true"),
+      make_pair("max_buffer_size", "65536"),
+  };
+  auto handler = factory.createHandler(options);
+
+  auto stdHandler = std::dynamic_pointer_cast<StandardLogHandler>(handler);
+  ASSERT_TRUE(stdHandler);
+
+  auto writer = std::dynamic_pointer_cast<ThreadBufferedFileWriter>(
+      stdHandler->getWriter());
+  ASSERT_TRUE(writer)
+      << "handler factory should have created a ThreadBufferedFileWriter";
+  EXPECT_EQ(65536, writer->getMaxBufferSize());
+
+  struct stat expectedStatInfo;
+  checkUnixError(
+      stat(tmpFile.path().string().c_str(), &expectedStatInfo), "stat failed");
+  struct stat actualStatInfo;
+  checkUnixError(
+      fstat(writer->getFile().fd(), &actualStatInfo), "fstat failed");
+  EXPECT_EQ(expectedStatInfo.st_dev, actualStatInfo.st_dev);
+  EXPECT_EQ(expectedStatInfo.st_ino, actualStatInfo.st_ino);
+}
+
 TEST(StreamHandlerFactory, nonAsyncStderr) {
   StreamHandlerFactory factory;
 
@@ -228,6 +259,18 @@ TEST(FileHandlerFactory, errors) {
         "the \"max_buffer_size\" option is only valid for async file handlers");
   }
 
+  {
+    auto options = Options{
+        {"path", tmpFile.path().string()},
+        {"async", "false"},
+        {"thread_buffered", "true"},
+    };
+    EXPECT_THROW_RE(
+        factory.createHandler(options),
+        std::invalid_argument,
+        "the \"thread_buffered\" option is only valid for async file handlers");
+  }
+
   {
     auto options = Options{
         {"path", tmpFile.path().string()},
@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/File.h>
+#include <folly/init/Init.h>
+#include <folly/logging/AsyncFileWriter.h>
+#include <folly/logging/ThreadBufferedFileWriter.h>
+#include <folly/logging/xlog.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/test/Barrier.h>
+
+// Throughput of the asynchronous file writers when many threads log at once.
+// Each benchmark iteration is one message; the messages are split evenly
+// between --num_threads threads, so the reported time per iteration is the
+// inverse of the aggregate throughput, including flushing the writer at the
+// end.  Messages go to /dev/null, but they are still discarded whenever the
+// I/O thread falls behind, which is cheaper than writing them.  The number
+// of discarded messages is printed at the end; compare it along with the
+// timings.  Use a large --bm_min_iters so that starting the threads does
+// not dominate.
+
+DEFINE_uint32(num_threads, 16, "number of threads writing log messages");
+DEFINE_uint32(message_size, 100, "size of each log message, in bytes");
+
+namespace folly {
+
+namespace {
+std::atomic<size_t> numDiscarded{0};
+size_t asyncFileWriterDiscarded = 0;
+size_t threadBufferedFileWriterDiscarded = 0;
+
+void discardCallback(size_t n) {
+  numDiscarded += n;
+}
+
+template <typename Writer>
+size_t runWriters(size_t iters) {
+  BenchmarkSuspender braces;
+  auto numThreads = std::max<size_t>(1, FLAGS_num_threads);
+  std::string message(std::max<size_t>(1, FLAGS_message_size) - 1, 'x');
+  message.push_back('\n');
+  numDiscarded = 0;
+
+  {
+    Writer writer{File{"/dev/null", O_WRONLY | O_CLOEXEC}};
+    test::Barrier barrier{numThreads + 1};
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < numThreads; ++t) {
+      auto count = iters / numThreads + (t < iters % numThreads ? 1 : 0);
+      threads.emplace_back([&, count] {
+        barrier.wait();
+        for (size_t i = 0; i < count; ++i) {
+          writer.writeMessage(message);
+        }
+      });
+    }
+    braces.dismissing([&] {
+      barrier.wait();
+      for (auto& thread : threads) {
+        thread.join();
+      }
+      writer.flush();
+    });
+  }
+  return numDiscarded.load();
+}
+} // namespace
+
+BENCHMARK(async_file_writer, iters) {
+  asyncFileWriterDiscarded += runWriters<AsyncFileWriter>(iters);
+}
+
+BENCHMARK_RELATIVE(thread_buffered_file_writer, iters) {
+  threadBufferedFileWriterDiscarded +=
+      runWriters<ThreadBufferedFileWriter>(iters);
+}
+
+} // namespace folly
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv);
+  folly::AsyncLogWriter::setDiscardCallback(folly::discardCallback);
+  folly::runBenchmarks();
+  XLOGF(
+      INFO,
+      "discarded messages: AsyncFileWriter {}, ThreadBufferedFileWriter {}",
+      folly::asyncFileWriterDiscarded,
+      folly::threadBufferedFileWriterDiscarded);
+  return 0;
+}
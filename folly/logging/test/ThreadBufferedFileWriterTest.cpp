@@ -0,0 +1,386 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/logging/ThreadBufferedFileWriter.h>
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#endif
+
+#include <atomic>
+#include <thread>
+
+#include <folly/Conv.h>
+#include <folly/Exception.h>
+#include <folly/File.h>
+#include <folly/FileUtil.h>
+#include <folly/String.h>
+#include <folly/futures/Future.h>
+#include <folly/futures/Promise.h>
+#include <folly/logging/AsyncLogWriter.h>
+#include <folly/logging/LoggerDB.h>
+#include <folly/portability/Config.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/GMock.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Unistd.h>
+#include <folly/test/TestUtils.h>
+#include <folly/testing/TestUtil.h>
+
+using namespace folly;
+using namespace std::literals::chrono_literals;
+using folly::test::TemporaryFile;
+using testing::ContainsRegex;
+
+namespace {
+std::string readAll(TemporaryFile& tmpFile) {
+  tmpFile.close();
+  std::string data;
+  auto ret = folly::readFile(tmpFile.path().string().c_str(), data);
+  EXPECT_TRUE(ret) << "failed to read log file";
+  return data;
+}
+
+std::atomic<size_t> totalDiscarded;
+void discardCallback(size_t n) {
+  totalDiscarded += n;
+}
+
+size_t fillUpPipe(int fd) {
+  int flags = fcntl(fd, F_GETFL);
+  folly::checkUnixError(flags, "failed get file descriptor flags");
+  auto rc = fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+  folly::checkUnixError(rc, "failed to put pipe in non-blocking mode");
+  std::vector<char> data(4000);
+  size_t totalBytes = 0;
+  size_t bytesToWrite = data.size();
+  while (true) {
+    auto bytesWritten = writeNoInt(fd, data.data(), bytesToWrite);
+    if (bytesWritten < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        throwSystemError("error writing to pipe");
+      }
+      if (bytesToWrite <= 1) {
+        break;
+      }
+      bytesToWrite /= 2;
+    } else {
+      totalBytes += bytesWritten;
+    }
+  }
+  rc = fcntl(fd, F_SETFL, flags & ~O_NONBLOCK);
+  folly::checkUnixError(rc, "failed to put pipe back in blocking mode");
+  return totalBytes;
+}
+} // namespace
+
+TEST(ThreadBufferedFileWriter, noMessages) {
+  TemporaryFile tmpFile{"logging_test"};
+  ThreadBufferedFileWriter writer{folly::File{tmpFile.fd(), false}};
+}
+
+TEST(ThreadBufferedFileWriter, simpleMessages) {
+  TemporaryFile tmpFile{"logging_test"};
+  {
+    ThreadBufferedFileWriter writer{folly::File{tmpFile.fd(), false}};
+    for (int n = 0; n < 10; ++n) {
+      writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+      std::this_thread::yield();
+    }
+  }
+
+  std::string expected;
+  for (int n = 0; n < 10; ++n) {
+    expected += folly::to<std::string>("message ", n, "\n");
+  }
+  EXPECT_EQ(expected, readAll(tmpFile));
+}
+
+TEST(ThreadBufferedFileWriter, multipleThreads) {
+  TemporaryFile tmpFile{"logging_test"};
+  constexpr size_t kThreads = 8;
+  constexpr size_t kMessages = 2000;
+  AsyncLogWriter::setDiscardCallback(discardCallback);
+  totalDiscarded = 0;
+  {
+    ThreadBufferedFileWriter writer{folly::File{tmpFile.fd(), false}};
+    writer.setMaxBufferSize(64 * 1024);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreads; ++t) {
+      threads.emplace_back([&, t] {
+        for (size_t n = 0; n < kMessages; ++n) {
+          writer.writeMessage(folly::to<std::string>(t, " ", n, "\n"));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    // The buffers of the exited threads are still written out.
+    writer.flush();
+  }
+  AsyncLogWriter::setDiscardCallback(nullptr);
+
+  // Messages from each thread are written in order, without being torn.
+  std::vector<StringPiece> lines;
+  auto data = readAll(tmpFile);
+  folly::split('\n', data, lines);
+  ASSERT_EQ("", lines.back().str());
+  lines.pop_back();
+  std::vector<size_t> next(kThreads, 0);
+  size_t numMessages = 0;
+  for (auto line : lines) {
+    if (line.endsWith("logging faster than we can write")) {
+      continue;
+    }
+    size_t t;
+    size_t n;
+    folly::split(' ', line, t, n);
+    ASSERT_LT(t, kThreads);
+    EXPECT_LE(next[t], n) << line;
+    next[t] = n + 1;
+    ++numMessages;
+  }
+  EXPECT_EQ(kThreads * kMessages, numMessages + totalDiscarded);
+}
+
+namespace {
+static std::vector<std::string>* internalWarnings;
+
+void handleLoggingError(
+    StringPiece /* file */, int /* lineNumber */, std::string&& msg) {
+  internalWarnings->emplace_back(std::move(msg));
+}
+} // namespace
+
+TEST(ThreadBufferedFileWriter, ioError) {
+  std::vector<std::string> logErrors;
+  internalWarnings = &logErrors;
+  LoggerDB::setInternalWarningHandler(handleLoggingError);
+
+  // Write to a pipe whose read end is closed.
+  std::array<int, 2> fds;
+  auto rc = fileops::pipe(fds.data());
+  folly::checkUnixError(rc, "failed to create pipe");
+#ifndef _WIN32
+  signal(SIGPIPE, SIG_IGN);
+#endif
+  fileops::close(fds[0]);
+
+  size_t numMessages = 100;
+  {
+    ThreadBufferedFileWriter writer{folly::File{fds[1], true}};
+    for (size_t n = 0; n < numMessages; ++n) {
+      writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+      std::this_thread::yield();
+    }
+  }
+
+  LoggerDB::setInternalWarningHandler(nullptr);
+
+  for (const auto& msg : logErrors) {
+    EXPECT_THAT(
+        msg,
+        ContainsRegex("error writing to log file .* in "
+                      "ThreadBufferedFileWriter: "));
+  }
+  EXPECT_GT(logErrors.size(), 0);
+  EXPECT_LE(logErrors.size(), numMessages);
+}
+
+TEST(ThreadBufferedFileWriter, flush) {
+  // Fill up a pipe, so that the I/O thread blocks until we read from it.
+  std::array<int, 2> fds;
+  auto rc = fileops::pipe(fds.data());
+  folly::checkUnixError(rc, "failed to create pipe");
+  File readPipe{fds[0], true};
+  File writePipe{fds[1], true};
+  auto paddingSize = fillUpPipe(writePipe.fd());
+
+  ThreadBufferedFileWriter writer{std::move(writePipe)};
+  writer.writeMessage("test message: " + std::string(200, 'x'));
+
+  Promise<Unit> promise;
+  auto future = promise.getFuture();
+  auto flushFunction = [&] { writer.flush(); };
+  std::thread flushThread{
+      [&]() { promise.setTry(makeTryWith(flushFunction)); }};
+  flushThread.detach();
+
+  // flush() must not complete before the message could be written.
+  /* sleep override */
+  std::this_thread::sleep_for(10ms);
+  EXPECT_FALSE(future.isReady());
+
+  std::vector<char> buf(paddingSize);
+  auto bytesRead = readFull(readPipe.fd(), buf.data(), buf.size());
+  EXPECT_EQ(bytesRead, paddingSize);
+  std::move(future).get(50ms);
+}
+
+TEST(ThreadBufferedFileWriter, discard) {
+  std::array<int, 2> fds;
+  auto rc = fileops::pipe(fds.data());
+  folly::checkUnixError(rc, "failed to create pipe");
+  File readPipe{fds[0], true};
+  File writePipe{fds[1], true};
+  fillUpPipe(writePipe.fd());
+
+  AsyncLogWriter::setDiscardCallback(discardCallback);
+  totalDiscarded = 0;
+  constexpr size_t kMessages = 1000;
+  const std::string big(10000, 'x');
+  std::string data;
+  std::thread reader;
+  {
+    ThreadBufferedFileWriter writer{std::move(writePipe)};
+    writer.setMaxBufferSize(4096);
+    // The I/O thread is blocked, so only the first few messages fit in the
+    // 4096 byte buffer of this thread.
+    for (size_t n = 0; n < kMessages; ++n) {
+      writer.writeMessage(folly::to<std::string>("message ", n, "\n"));
+    }
+    // Messages that can never fit, and messages that must not be discarded,
+    // are queued separately.
+    writer.writeMessage(big + "\n");
+    writer.writeMessage(
+        std::string("never discard\n"), LogWriter::NEVER_DISCARD);
+
+    // Read everything until the destructor closes the pipe.
+    reader = std::thread([&] {
+      std::vector<char> buf(64 * 1024);
+      while (true) {
+        auto n = readNoInt(readPipe.fd(), buf.data(), buf.size());
+        if (n <= 0) {
+          break;
+        }
+        data.append(buf.data(), n);
+      }
+    });
+  }
+  reader.join();
+  AsyncLogWriter::setDiscardCallback(nullptr);
+
+  // The discarded messages may be reported in more than one batch.
+  EXPECT_GT(totalDiscarded, 0);
+  constexpr StringPiece kDiscardMsg{
+      " log messages discarded: logging faster than we can write\n"};
+  size_t reported = 0;
+  for (auto pos = data.find(kDiscardMsg); pos != std::string::npos;
+       pos = data.find(kDiscardMsg, pos + 1)) {
+    auto start = data.rfind('\n', pos);
+    reported += folly::to<size_t>(data.substr(start + 1, pos - start - 1));
+  }
+  EXPECT_EQ(totalDiscarded, reported);
+  EXPECT_NE(std::string::npos, data.find(big + "\n"));
+  EXPECT_NE(std::string::npos, data.find("never discard\n"));
+  EXPECT_NE(std::string::npos, data.find("message 0\n"));
+  EXPECT_EQ(std::string::npos, data.find("message 999\n"));
+}
+
+TEST(ThreadBufferedFileWriter, overflowOrder) {
+  TemporaryFile tmpFile{"logging_test"};
+  std::string expected;
+  {
+    ThreadBufferedFileWriter writer{folly::File{tmpFile.fd(), false}};
+    writer.setMaxBufferSize(4096);
+    // Messages that are too large for the thread buffer go through the
+    // overflow queue, but are still written in order with the others.
+    for (int n = 0; n < 30; ++n) {
+      auto message = folly::to<std::string>("message ", n);
+      if (n % 3 == 1) {
+        message += std::string(5000, 'x');
+      }
+      message += "\n";
+      writer.writeMessage(message, LogWriter::NEVER_DISCARD);
+      expected += message;
+    }
+  }
+  EXPECT_EQ(expected, readAll(tmpFile));
+}
+
+#ifndef _WIN32
+TEST(ThreadBufferedFileWriter, fork) {
+#if FOLLY_HAVE_PTHREAD_ATFORK
+  SKIP_IF(folly::kIsSanitizeThread) << "Not supported for TSAN";
+
+  TemporaryFile tmpFile{"logging_test"};
+  constexpr size_t numMessages = 10;
+  constexpr size_t numBgThreads = 2;
+
+  {
+    ThreadBufferedFileWriter writer{folly::File{tmpFile.fd(), false}};
+    writer.writeMessage(folly::to<std::string>("parent pid=", getpid(), "\n"));
+
+    // Keep other threads logging while the fork occurs.
+    std::vector<std::thread> bgThreads;
+    std::atomic<bool> stop{false};
+    for (size_t n = 0; n < numBgThreads; ++n) {
+      bgThreads.emplace_back([&] {
+        size_t iter = 0;
+        while (!stop) {
+          writer.writeMessage(
+              folly::to<std::string>("bgthread_", getpid(), "_", iter, "\n"));
+          ++iter;
+        }
+      });
+    }
+
+    for (size_t n = 0; n < numMessages; ++n) {
+      writer.writeMessage(folly::to<std::string>("prefork", n, "\n"));
+    }
+
+    auto pid = fork();
+    folly::checkUnixError(pid, "failed to fork");
+    if (pid == 0) {
+      for (size_t n = 0; n < numMessages; ++n) {
+        writer.writeMessage(folly::to<std::string>("child", n, "\n"));
+      }
+      writer.flush();
+      _exit(0);
+    }
+
+    for (size_t n = 0; n < numMessages; ++n) {
+      writer.writeMessage(folly::to<std::string>("parent", n, "\n"));
+    }
+
+    stop = true;
+    for (auto& t : bgThreads) {
+      t.join();
+    }
+
+    int status;
+    auto waited = waitpid(pid, &status, 0);
+    folly::checkUnixError(waited, "failed to wait on child");
+    ASSERT_EQ(waited, pid);
+  }
+
+  // Every message is written exactly once, by the parent or the child.
+  // The child may write before the parent, so look for complete lines.
+  auto data = "\n" + readAll(tmpFile);
+  for (size_t n = 0; n < numMessages; ++n) {
+    for (auto prefix : {"prefork", "parent", "child"}) {
+      auto msg = folly::to<std::string>("\n", prefix, n, "\n");
+      auto pos = data.find(msg);
+      EXPECT_NE(std::string::npos, pos) << msg;
+      EXPECT_EQ(std::string::npos, data.find(msg, pos + 1)) << msg;
+    }
+  }
+#else
+  SKIP() << "pthread_atfork() is not supported on this platform";
+#endif // FOLLY_HAVE_PTHREAD_ATFORK
+}
+#endif // !_WIN32
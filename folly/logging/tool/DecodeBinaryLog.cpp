@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstdio>
+#include <ctime>
+#include <exception>
+
+#include <fmt/format.h>
+
+#include <folly/logging/BinaryLog.h>
+
+/**
+ * Formats the raw output of folly::BinaryLogger in the glog style.
+ *
+ * Use it like:
+ *   ./decode_binary_log /path/to/binary.log [more.log]...
+ *
+ * Reads stdin if no file is given.
+ */
+
+namespace {
+
+char levelChar(folly::LogLevel level) {
+  if (level >= folly::LogLevel::CRITICAL) {
+    return 'C';
+  } else if (level >= folly::LogLevel::ERR) {
+    return 'E';
+  } else if (level >= folly::LogLevel::WARN) {
+    return 'W';
+  } else if (level >= folly::LogLevel::INFO) {
+    return 'I';
+  }
+  return 'V';
+}
+
+void printMessage(const folly::BinaryLogDecoder::Message& message) {
+  auto usecs = std::chrono::duration_cast<std::chrono::microseconds>(
+                   message.timestamp.time_since_epoch())
+                   .count();
+  time_t secs = usecs / 1000000;
+  struct tm ltime;
+  localtime_r(&secs, &ltime);
+  auto filename = message.filename;
+  auto slash = filename.rfind('/');
+  if (slash != folly::StringPiece::npos) {
+    filename.advance(slash + 1);
+  }
+  fmt::print(
+      "{}{:02d}{:02d} {:02d}:{:02d}:{:02d}.{:06d} {:5d} {}:{}] {}\n",
+      levelChar(message.level),
+      ltime.tm_mon + 1,
+      ltime.tm_mday,
+      ltime.tm_hour,
+      ltime.tm_min,
+      ltime.tm_sec,
+      usecs % 1000000,
+      message.threadID,
+      filename,
+      message.lineNumber,
+      message.message);
+}
+
+bool decodeFile(FILE* file, const char* name) {
+  folly::BinaryLogDecoder decoder;
+  unsigned char buffer[64 * 1024];
+  try {
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+      decoder.feed(folly::ByteRange(buffer, n), printMessage);
+    }
+  } catch (const std::exception& ex) {
+    fmt::print(stderr, "{}: {}\n", name, ex.what());
+    return false;
+  }
+  if (!decoder.atRecordBoundary()) {
+    fmt::print(stderr, "{}: truncated at the end\n", name);
+  }
+  return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    return decodeFile(stdin, "<stdin>") ? 0 : 1;
+  }
+  int ret = 0;
+  for (int i = 1; i < argc; ++i) {
+    FILE* file = fopen(argv[i], "rb");
+    if (!file) {
+      fmt::print(stderr, "{}: cannot open\n", argv[i]);
+      ret = 1;
+      continue;
+    }
+    if (!decodeFile(file, argv[i])) {
+      ret = 1;
+    }
+    fclose(file);
+  }
+  return ret;
+}
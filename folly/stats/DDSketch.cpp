@@ -0,0 +1,347 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/DDSketch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+#include <folly/Varint.h>
+#include <folly/lang/Bits.h>
+
+namespace folly {
+
+namespace {
+
+/*
+ * Serialization format, version 1. Doubles are 8 bytes little-endian, all
+ * other fields are varints:
+ *
+ *   version            1 byte
+ *   relativeAccuracy   double
+ *   sum, min, max      double
+ *   maxBins            varint
+ *   zeroCount          varint
+ *   negative store, positive store:
+ *     numBins          varint
+ *     offset           zigzag varint, only if numBins > 0
+ *     counts           numBins varints, of consecutive bins from offset
+ */
+constexpr uint8_t kSerializationVersion = 1;
+
+// Bounds the bin indices to the range of int32_t.
+constexpr double kMinRelativeAccuracy = 1e-6;
+
+[[noreturn]] void throwInvalidEncoding(const char* what) {
+  throw std::invalid_argument(
+      std::string("invalid DDSketch encoding: ") + what);
+}
+
+void appendVarint(std::string& out, uint64_t value) {
+  uint8_t buf[kMaxVarintLength64];
+  auto size = encodeVarint(value, buf);
+  out.append(reinterpret_cast<const char*>(buf), size);
+}
+
+void appendDouble(std::string& out, double value) {
+  auto bits = Endian::little(bit_cast<uint64_t>(value));
+  out.append(reinterpret_cast<const char*>(&bits), sizeof(bits));
+}
+
+uint64_t readVarint(ByteRange& data) {
+  auto value = tryDecodeVarint(data);
+  if (!value) {
+    throwInvalidEncoding("truncated or malformed varint");
+  }
+  return *value;
+}
+
+double readDouble(ByteRange& data) {
+  uint64_t bits;
+  if (data.size() < sizeof(bits)) {
+    throwInvalidEncoding("truncated double");
+  }
+  std::memcpy(&bits, data.data(), sizeof(bits));
+  data.advance(sizeof(bits));
+  return bit_cast<double>(Endian::little(bits));
+}
+
+} // namespace
+
+DDSketch::DDSketch(size_t maxBins, double relativeAccuracy)
+    : maxBins_(maxBins), relativeAccuracy_(relativeAccuracy) {
+  if (!(relativeAccuracy >= kMinRelativeAccuracy && relativeAccuracy < 1)) {
+    throw std::invalid_argument("DDSketch relative accuracy out of range");
+  }
+  if (maxBins == 0 ||
+      maxBins > static_cast<size_t>(std::numeric_limits<int32_t>::max())) {
+    throw std::invalid_argument("DDSketch maxBins out of range");
+  }
+  gamma_ = (1 + relativeAccuracy) / (1 - relativeAccuracy);
+  multiplier_ = 1 / std::log(gamma_);
+}
+
+int32_t DDSketch::indexOf(double magnitude) const {
+  return static_cast<int32_t>(std::ceil(std::log(magnitude) * multiplier_));
+}
+
+double DDSketch::valueOf(int32_t index) const {
+  // The point of (gamma^(index-1), gamma^index] with equal relative distance
+  // to both bounds.
+  auto value = 2 * std::exp(index / multiplier_) / (1 + gamma_);
+  return std::min(value, std::numeric_limits<double>::max());
+}
+
+int32_t DDSketch::Store::extend(int32_t lo, int32_t hi, size_t maxBins) {
+  auto bins = static_cast<int64_t>(maxBins);
+  if (counts.empty()) {
+    offset = static_cast<int32_t>(std::max<int64_t>(lo, hi - bins + 1));
+    counts.resize(static_cast<size_t>(hi - offset + 1));
+    return offset;
+  }
+  int64_t newLo = std::min(lo, offset);
+  int64_t newHi = std::max(hi, maxIndex());
+  newLo = std::max(newLo, newHi - bins + 1);
+  if (newLo < offset) {
+    counts.insert(counts.begin(), static_cast<size_t>(offset - newLo), 0);
+  } else if (newLo > offset) {
+    // Collapse the lowest bins into the bin at newLo.
+    auto n = static_cast<size_t>(newLo - offset);
+    if (n >= counts.size()) {
+      auto total = std::accumulate(counts.begin(), counts.end(), uint64_t(0));
+      counts.assign(1, total);
+    } else {
+      counts[n] =
+          std::accumulate(counts.begin(), counts.begin() + n, counts[n]);
+      counts.erase(counts.begin(), counts.begin() + n);
+    }
+  }
+  offset = static_cast<int32_t>(newLo);
+  counts.resize(static_cast<size_t>(newHi - newLo + 1));
+  return offset;
+}
+
+void DDSketch::Store::add(int32_t index, uint64_t count, size_t maxBins) {
+  if (counts.empty() || index < offset || index > maxIndex()) {
+    index = std::max(index, extend(index, index, maxBins));
+  }
+  counts[static_cast<size_t>(index - offset)] += count;
+}
+
+void DDSketch::Store::merge(const Store& other, size_t maxBins) {
+  if (other.empty()) {
+    return;
+  }
+  auto lo = extend(other.minIndex(), other.maxIndex(), maxBins);
+  for (size_t i = 0; i < other.counts.size(); ++i) {
+    auto index = std::max(other.offset + static_cast<int32_t>(i), lo);
+    counts[static_cast<size_t>(index - offset)] += other.counts[i];
+  }
+}
+
+void DDSketch::addValue(double value, uint64_t count) {
+  if (!std::isfinite(value) || count == 0) {
+    return;
+  }
+  auto magnitude = std::abs(value);
+  if (magnitude < std::numeric_limits<double>::min()) {
+    zeroCount_ += count;
+  } else if (value > 0) {
+    positive_.add(indexOf(magnitude), count, maxBins_);
+  } else {
+    negative_.add(indexOf(magnitude), count, maxBins_);
+  }
+  if (count_ == 0) {
+    min_ = max_ = value;
+  } else {
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+  }
+  count_ += count;
+  sum_ += value * static_cast<double>(count);
+}
+
+DDSketch DDSketch::merge(Range<const double*> unsortedValues) const {
+  DDSketch result(*this);
+  for (auto value : unsortedValues) {
+    result.addValue(value);
+  }
+  return result;
+}
+
+void DDSketch::merge(const DDSketch& other) {
+  if (other.relativeAccuracy_ != relativeAccuracy_) {
+    throw std::invalid_argument(
+        "cannot merge DDSketches with different relative accuracies");
+  }
+  if (other.empty()) {
+    return;
+  }
+  positive_.merge(other.positive_, maxBins_);
+  negative_.merge(other.negative_, maxBins_);
+  zeroCount_ += other.zeroCount_;
+  if (count_ == 0) {
+    min_ = other.min_;
+    max_ = other.max_;
+  } else {
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+  count_ += other.count_;
+  sum_ += other.sum_;
+}
+
+DDSketch DDSketch::merge(Range<const DDSketch*> sketches) {
+  if (sketches.empty()) {
+    return DDSketch();
+  }
+  DDSketch result(sketches.front());
+  for (const auto& sketch : sketches.subpiece(1)) {
+    result.merge(sketch);
+  }
+  return result;
+}
+
+double DDSketch::estimateQuantile(double q) const {
+  if (empty()) {
+    return 0.0;
+  }
+  if (q <= 0) {
+    return min_;
+  }
+  if (q >= 1) {
+    return max_;
+  }
+
+  auto rank = q * static_cast<double>(count_ - 1);
+  uint64_t seen = 0;
+  auto reaches = [&](uint64_t count) {
+    seen += count;
+    return static_cast<double>(seen) > rank;
+  };
+  auto clamp = [&](double value) {
+    return std::min(std::max(value, min_), max_);
+  };
+
+  for (size_t i = negative_.counts.size(); i-- > 0;) {
+    if (reaches(negative_.counts[i])) {
+      return clamp(-valueOf(negative_.offset + static_cast<int32_t>(i)));
+    }
+  }
+  if (reaches(zeroCount_)) {
+    return clamp(0.0);
+  }
+  for (size_t i = 0; i < positive_.counts.size(); ++i) {
+    if (reaches(positive_.counts[i])) {
+      return clamp(valueOf(positive_.offset + static_cast<int32_t>(i)));
+    }
+  }
+  return max_;
+}
+
+size_t DDSketch::numBins() const {
+  size_t bins = zeroCount_ != 0 ? 1 : 0;
+  for (const auto* store : {&negative_, &positive_}) {
+    bins += store->counts.size() -
+        std::count(store->counts.begin(), store->counts.end(), uint64_t(0));
+  }
+  return bins;
+}
+
+std::string DDSketch::serialize() const {
+  std::string out;
+  out.reserve(
+      1 + 4 * sizeof(double) + 5 * kMaxVarintLength64 +
+      negative_.counts.size() + positive_.counts.size());
+  out.push_back(static_cast<char>(kSerializationVersion));
+  appendDouble(out, relativeAccuracy_);
+  appendDouble(out, sum_);
+  appendDouble(out, min_);
+  appendDouble(out, max_);
+  appendVarint(out, maxBins_);
+  appendVarint(out, zeroCount_);
+  for (const auto* store : {&negative_, &positive_}) {
+    appendVarint(out, store->counts.size());
+    if (!store->empty()) {
+      appendVarint(out, encodeZigZag(store->offset));
+      for (auto count : store->counts) {
+        appendVarint(out, count);
+      }
+    }
+  }
+  return out;
+}
+
+DDSketch DDSketch::deserialize(ByteRange data) {
+  if (data.empty()) {
+    throwInvalidEncoding("empty input");
+  }
+  if (data.front() != kSerializationVersion) {
+    throwInvalidEncoding("unsupported version");
+  }
+  data.advance(1);
+  auto relativeAccuracy = readDouble(data);
+  auto sum = readDouble(data);
+  auto min = readDouble(data);
+  auto max = readDouble(data);
+  auto maxBins = readVarint(data);
+  if (maxBins == 0 ||
+      maxBins > static_cast<uint64_t>(std::numeric_limits<int32_t>::max()) ||
+      !(relativeAccuracy >= kMinRelativeAccuracy && relativeAccuracy < 1)) {
+    throwInvalidEncoding("invalid parameters");
+  }
+
+  DDSketch sketch(static_cast<size_t>(maxBins), relativeAccuracy);
+  sketch.zeroCount_ = readVarint(data);
+  uint64_t count = sketch.zeroCount_;
+  for (auto* store : {&sketch.negative_, &sketch.positive_}) {
+    auto numBins = readVarint(data);
+    if (numBins == 0) {
+      continue;
+    }
+    // Every count takes at least one byte.
+    if (numBins > maxBins || numBins > data.size()) {
+      throwInvalidEncoding("too many bins");
+    }
+    auto offset = decodeZigZag(readVarint(data));
+    if (offset < std::numeric_limits<int32_t>::min() ||
+        offset + static_cast<int64_t>(numBins) - 1 >
+            std::numeric_limits<int32_t>::max()) {
+      throwInvalidEncoding("bin index out of range");
+    }
+    store->offset = static_cast<int32_t>(offset);
+    store->counts.resize(static_cast<size_t>(numBins));
+    for (auto& binCount : store->counts) {
+      binCount = readVarint(data);
+      count += binCount;
+    }
+  }
+  if (!data.empty()) {
+    throwInvalidEncoding("trailing data");
+  }
+  sketch.count_ = count;
+  sketch.sum_ = sum;
+  if (count != 0) {
+    sketch.min_ = min;
+    sketch.max_ = max;
+  }
+  return sketch;
+}
+
+} // namespace folly
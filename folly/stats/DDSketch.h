@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <folly/Range.h>
+
+namespace folly {
+
+/*
+ * DDSketch is a quantile estimator with relative-error guarantees, see
+ * https://arxiv.org/abs/1908.10693. Values are counted in logarithmically
+ * sized bins: the bin with index i holds the values in (gamma^(i-1), gamma^i],
+ * where gamma = (1 + alpha) / (1 - alpha) for a relative accuracy alpha. Any
+ * estimated quantile is then within a factor of (1 +/- alpha) of the true
+ * value, which makes the sketch well suited for heavy-tailed distributions
+ * such as latencies, where TDigest's accuracy in absolute terms is of little
+ * use at the far tail.
+ *
+ * Compared to TDigest:
+ *   - Adding a value is O(1) (one logarithm and an increment), so there is no
+ *     need to buffer values and merge them in batches.
+ *   - Merging two sketches with the same accuracy is exact: it sums the bin
+ *     counts, so the result does not depend on the merge order.
+ *   - serialize() produces a compact, stable binary encoding which can be sent
+ *     to other hosts and merged there.
+ *
+ * The memory is bounded by maxBins bins for each sign. When a distribution
+ * spans more bins than that, the lowest bins (those closest to zero) are
+ * collapsed into one, which only degrades the accuracy of the lowest
+ * quantiles. With the default accuracy of 1%, 2048 bins span values over
+ * about 35 orders of magnitude.
+ *
+ * NaN and infinite values are ignored. Values whose magnitude is smaller than
+ * std::numeric_limits<double>::min() are counted as zero.
+ */
+class DDSketch {
+ public:
+  static constexpr size_t kDefaultMaxBins = 2048;
+  static constexpr double kDefaultRelativeAccuracy = 0.01;
+  // Values are added directly instead of being buffered for DigestBuilder.
+  static constexpr bool kBufferValues = false;
+
+  /*
+   * Throws std::invalid_argument unless 1e-6 <= relativeAccuracy < 1 and
+   * maxBins is positive and fits in an int32_t.
+   */
+  explicit DDSketch(
+      size_t maxBins = kDefaultMaxBins,
+      double relativeAccuracy = kDefaultRelativeAccuracy);
+
+  /*
+   * Adds the given value count times.
+   */
+  void addValue(double value, uint64_t count = 1);
+
+  /*
+   * Returns a new sketch with the values of the current sketch and the given
+   * unsortedValues.
+   */
+  DDSketch merge(Range<const double*> unsortedValues) const;
+
+  /*
+   * Adds the values of other to this sketch. Throws std::invalid_argument if
+   * the sketches do not have the same relative accuracy.
+   */
+  void merge(const DDSketch& other);
+
+  /*
+   * Returns a new sketch with the values of all the given sketches, which
+   * must all have the same relative accuracy. The maximum number of bins of
+   * the result is that of the first sketch.
+   */
+  static DDSketch merge(Range<const DDSketch*> sketches);
+
+  /*
+   * Estimates the value of the given quantile. The estimate is within the
+   * relative accuracy of the value of rank q * (count() - 1), and is always
+   * between min() and max().
+   */
+  double estimateQuantile(double q) const;
+
+  double mean() const { return count_ > 0 ? sum_ / count_ : 0; }
+
+  double sum() const { return sum_; }
+
+  uint64_t count() const { return count_; }
+
+  double min() const { return min_; }
+
+  double max() const { return max_; }
+
+  bool empty() const { return count_ == 0; }
+
+  size_t maxBins() const { return maxBins_; }
+
+  double relativeAccuracy() const { return relativeAccuracy_; }
+
+  /*
+   * Number of non-empty bins, including the one for zero.
+   */
+  size_t numBins() const;
+
+  /*
+   * Calls fn(value, count) for every non-empty bin in increasing order of
+   * value, where value is the representative value of the bin.
+   */
+  template <typename Fn>
+  void forEachBin(Fn&& fn) const;
+
+  /*
+   * Returns a compact binary encoding of the sketch, which is stable across
+   * platforms and versions of this class.
+   */
+  std::string serialize() const;
+
+  /*
+   * Decodes the output of serialize(). Throws std::invalid_argument if the
+   * data is not a valid encoding.
+   */
+  static DDSketch deserialize(ByteRange data);
+  static DDSketch deserialize(StringPiece data) {
+    return deserialize(ByteRange(data));
+  }
+
+ private:
+  /*
+   * Dense counts of contiguous bins, counts[i] is the count of bin
+   * offset + i.
+   */
+  struct Store {
+    std::vector<uint64_t> counts;
+    int32_t offset = 0;
+
+    bool empty() const { return counts.empty(); }
+    int32_t minIndex() const { return offset; }
+    int32_t maxIndex() const {
+      return offset + static_cast<int32_t>(counts.size()) - 1;
+    }
+
+    void add(int32_t index, uint64_t count, size_t maxBins);
+    void merge(const Store& other, size_t maxBins);
+    // Makes room for the bins in [lo, hi], returns the lowest index that can
+    // be used after collapsing the lowest bins.
+    int32_t extend(int32_t lo, int32_t hi, size_t maxBins);
+  };
+
+  int32_t indexOf(double magnitude) const;
+  double valueOf(int32_t index) const;
+
+  size_t maxBins_;
+  double relativeAccuracy_;
+  double gamma_;
+  double multiplier_; // 1 / log(gamma)
+  Store positive_;
+  Store negative_;
+  uint64_t zeroCount_ = 0;
+  uint64_t count_ = 0;
+  double sum_ = 0.0;
+  double max_ = std::numeric_limits<double>::quiet_NaN();
+  double min_ = std::numeric_limits<double>::quiet_NaN();
+};
+
+template <typename Fn>
+void DDSketch::forEachBin(Fn&& fn) const {
+  for (size_t i = negative_.counts.size(); i-- > 0;) {
+    if (negative_.counts[i] != 0) {
+      fn(-valueOf(negative_.offset + static_cast<int32_t>(i)),
+         negative_.counts[i]);
+    }
+  }
+  if (zeroCount_ != 0) {
+    fn(0.0, zeroCount_);
+  }
+  for (size_t i = 0; i < positive_.counts.size(); ++i) {
+    if (positive_.counts[i] != 0) {
+      fn(valueOf(positive_.offset + static_cast<int32_t>(i)),
+         positive_.counts[i]);
+    }
+  }
+}
+
+} // namespace folly
@@ -50,10 +50,13 @@ DigestT DigestBuilder<DigestT>::build() {
     auto g = std::unique_lock(cpuLocalBuffer.mutex);
     bool hasDigest =
         cpuLocalBuffer.digest != nullptr && !cpuLocalBuffer.digest->empty();
-    // If at least one merge happened, bufferSize_ was reached.
-    size_t capacity = hasDigest
-        ? bufferSize_
-        : std::min(nextPowTwo(cpuLocalBuffer.buffer.size()), bufferSize_);
+    size_t capacity = 0;
+    if (detail::digestBuffersValues<DigestT>) {
+      // If at least one merge happened, bufferSize_ was reached.
+      capacity = hasDigest
+          ? bufferSize_
+          : std::min(nextPowTwo(cpuLocalBuffer.buffer.size()), bufferSize_);
+    }
     if (capacity > 0 || hasDigest) {
       g.unlock();
       newBuffer.reserve(capacity);
@@ -108,13 +111,20 @@ void DigestBuilder<DigestT>::append(double value) {
     g = std::unique_lock(cpuLocalBuf->mutex);
   }
 
-  cpuLocalBuf->buffer.push_back(value);
-  if (FOLLY_UNLIKELY(cpuLocalBuf->buffer.size() == bufferSize_)) {
+  if constexpr (!detail::digestBuffersValues<DigestT>) {
     if (!cpuLocalBuf->digest) {
       cpuLocalBuf->digest = std::make_unique<DigestT>(digestSize_);
     }
-    *cpuLocalBuf->digest = cpuLocalBuf->digest->merge(cpuLocalBuf->buffer);
-    cpuLocalBuf->buffer.clear();
+    cpuLocalBuf->digest->addValue(value);
+  } else {
+    cpuLocalBuf->buffer.push_back(value);
+    if (FOLLY_UNLIKELY(cpuLocalBuf->buffer.size() == bufferSize_)) {
+      if (!cpuLocalBuf->digest) {
+        cpuLocalBuf->digest = std::make_unique<DigestT>(digestSize_);
+      }
+      *cpuLocalBuf->digest = cpuLocalBuf->digest->merge(cpuLocalBuf->buffer);
+      cpuLocalBuf->buffer.clear();
+    }
   }
 }
 
@@ -17,6 +17,7 @@
 #pragma once
 
 #include <memory>
+#include <type_traits>
 #include <vector>
 
 #include <folly/Memory.h>
@@ -24,6 +25,15 @@
 
 namespace folly {
 
+namespace detail {
+template <typename DigestT, typename = void>
+constexpr bool digestBuffersValues = true;
+template <typename DigestT>
+constexpr bool digestBuffersValues<
+    DigestT,
+    std::enable_if_t<!DigestT::kBufferValues>> = false;
+} // namespace detail
+
 /*
  * Stat digests, such as TDigest, can be expensive to merge. It is faster to
  * buffer writes and merge them in larger chunks. DigestBuilder buffers writes
@@ -36,6 +46,11 @@ namespace folly {
  * for multiple threads to call build simultaneously. A typical usage is to
  * buffer writes for a period of time, and then have one thread call build to
  * merge the buffer into some other DigestT instance.
+ *
+ * Digests that are cheap to update, such as DDSketch, can opt out of buffering
+ * by defining a static constexpr bool kBufferValues = false member. Values are
+ * then added directly to the cpu-local digest with DigestT::addValue(), and
+ * bufferSize is ignored.
  */
 template <typename DigestT>
 class DigestBuilder {
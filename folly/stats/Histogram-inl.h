@@ -16,6 +16,10 @@
 
 #pragma once
 
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
 #include <glog/logging.h>
 
 #include <folly/Conv.h>
@@ -58,6 +62,66 @@ size_t HistogramBuckets<T, BucketType>::getBucketIdx(ValueType value) const {
   }
 }
 
+template <typename T, typename BucketType>
+void HistogramBuckets<T, BucketType>::getBucketIdxs(
+    Range<const ValueType*> values, size_t* idxs) const {
+  // Copies, since the stores to idxs could alias the members.
+  const ValueType min = min_;
+  const ValueType max = max_;
+  const size_t last = buckets_.size() - 1;
+  // Uses masks rather than conditionals, so that the compiler does not emit
+  // branches, which would be mispredicted for values on both sides of the
+  // range.
+  const auto select = [&](ValueType value, size_t idx) {
+    const auto belowMax = size_t(0) - size_t(value < max);
+    const auto aboveMin = size_t(0) - size_t(!(value < min));
+    return ((idx & belowMax) | (last & ~belowMax)) & aboveMin;
+  };
+  if constexpr (
+      std::is_integral_v<ValueType> && !std::is_same_v<ValueType, bool> &&
+      sizeof(ValueType) <= sizeof(uint64_t)) {
+    // Offsets from min_ are computed as unsigned, which is well defined for
+    // the values below min_ as well; those are then discarded by the select.
+    using U = std::make_unsigned_t<ValueType>;
+    const uint64_t divisor = U(bucketSize_);
+    const uint64_t range = U(U(max_) - U(min_));
+#if FOLLY_HAVE_INT128_T
+    // For x, d < 2^32, floor(x / d) == (x * ceil(2^64 / d)) >> 64, see
+    // "Faster Remainder by Direct Computation" (Lemire, Kaser, Kurz).
+    if (divisor > 1 && range <= (uint64_t(1) << 32)) {
+      const uint64_t magic = std::numeric_limits<uint64_t>::max() / divisor + 1;
+      for (size_t i = 0; i < values.size(); ++i) {
+        const auto value = values[i];
+        const uint64_t offset = U(U(value) - U(min));
+        const auto quotient = size_t(
+            static_cast<unsigned __int128>(offset & 0xffffffff) * magic >> 64);
+        idxs[i] = select(value, quotient + 1);
+      }
+      return;
+    }
+#endif
+    (void)range;
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto value = values[i];
+      const uint64_t offset = U(U(value) - U(min));
+      idxs[i] = select(value, size_t(offset / divisor) + 1);
+    }
+  } else if constexpr (std::is_floating_point_v<ValueType>) {
+    for (size_t i = 0; i < values.size(); ++i) {
+      const auto value = values[i];
+      // Clamp before converting, out of range conversions are undefined. The
+      // conversion to a signed integer is a single instruction.
+      const auto clamped = std::max(min, std::min(value, max));
+      const auto idx = int64_t((clamped - min) / bucketSize_ + 1);
+      idxs[i] = select(value, size_t(idx));
+    }
+  } else {
+    for (size_t i = 0; i < values.size(); ++i) {
+      idxs[i] = getBucketIdx(values[i]);
+    }
+  }
+}
+
 template <typename T, typename BucketType>
 template <typename CountFn>
 uint64_t HistogramBuckets<T, BucketType>::computeTotalCount(
@@ -27,6 +27,8 @@
 #include <vector>
 
 #include <folly/CPortability.h>
+#include <folly/Portability.h>
+#include <folly/Range.h>
 #include <folly/Traits.h>
 #include <folly/lang/Exception.h>
 #include <folly/stats/detail/Bucket.h>
@@ -84,6 +86,17 @@ class HistogramBuckets {
   /* Returns the bucket index into which the given value would fall. */
   size_t getBucketIdx(ValueType value) const;
 
+  /*
+   * Stores the bucket index of each of the given values into idxs, which must
+   * have room for values.size() entries.
+   *
+   * This is equivalent to calling getBucketIdx() for every value, but it has
+   * no data-dependent branches, and for integer types whose [min, max) range
+   * fits in 32 bits the division is replaced by a multiplication, so the loop
+   * can be pipelined or vectorized by the compiler.
+   */
+  void getBucketIdxs(Range<const ValueType*> values, size_t* idxs) const;
+
   /* Returns the bucket for the specified value */
   BucketType& getByValue(ValueType value) {
     return buckets_[getBucketIdx(value)];
@@ -247,6 +260,30 @@ class Histogram {
     bucket.count += 1;
   }
 
+  /*
+   * Add a batch of data points to the histogram.
+   *
+   * This has the same effect as calling addValue() for each value, but is
+   * several times faster for large batches, as bucket indexes are computed for
+   * blocks of values at a time.
+   */
+  void addValues(Range<const ValueType*> values) {
+    constexpr size_t kBlockSize = 128;
+    size_t idxs[kBlockSize];
+    while (!values.empty()) {
+      auto block = values.subpiece(0, kBlockSize);
+      values.advance(block.size());
+      buckets_.getBucketIdxs(block, idxs);
+      for (size_t i = 0; i < block.size(); ++i) {
+        Bucket& bucket = buckets_.getByIndex(idxs[i]);
+        // Overflow is handled the same way as in addValue().
+        auto const addend = to_unsigned(block[i]);
+        bucket.sum = static_cast<ValueType>(to_unsigned(bucket.sum) + addend);
+        bucket.count += 1;
+      }
+    }
+  }
+
   /* Add multiple same data points to the histogram */
   void addRepeatedValue(ValueType value, uint64_t nSamples) {
     Bucket& bucket = buckets_.getByValue(value);
@@ -358,6 +395,20 @@ class Histogram {
     return buckets_.getByIndex(idx);
   }
 
+  /* Returns the index of the bucket that the specified value falls into */
+  size_t getBucketIdx(ValueType value) const {
+    return buckets_.getBucketIdx(value);
+  }
+
+  /*
+   * Add nSamples data points whose values add up to sum to the bucket at the
+   * given index.  This allows merging in data that was bucketed elsewhere
+   * using getBucketIdx().
+   */
+  void addToBucket(size_t idx, ValueType sum, uint64_t nSamples) {
+    buckets_.getByIndex(idx).add(sum, nSamples);
+  }
+
   /*
    * Returns the minimum threshold for the bucket at the given index.
    *
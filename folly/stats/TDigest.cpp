@@ -22,7 +22,6 @@
 
 #include <glog/logging.h>
 
-#include <folly/Overload.h>
 #include <folly/Utility.h>
 #include <folly/algorithm/BinaryHeap.h>
 #include <folly/memory/Malloc.h>
@@ -107,6 +106,22 @@ class Buffer : NonCopyableNonMovable {
   size_t size_;
 };
 
+// Uses independent accumulators, so that the additions can be pipelined or
+// vectorized.
+double sumValues(const double* values, size_t n) {
+  double sums[4] = {0, 0, 0, 0};
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    for (size_t j = 0; j < 4; ++j) {
+      sums[j] += values[i + j];
+    }
+  }
+  for (; i < n; ++i) {
+    sums[0] += values[i];
+  }
+  return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
 double clamp(double v, double lo, double hi) {
   if (v > hi) {
     return hi;
@@ -156,6 +171,33 @@ class TDigest::CentroidMerger {
     }
   }
 
+  /*
+   * Appends sorted values of weight 1. Runs of values that all fit in the
+   * current centroid are summed in bulk, so the limit of the scale function
+   * is only checked once per run rather than once per value.
+   */
+  void appendValues(const double* first, const double* last) {
+    while (first != last) {
+      size_t n = 0;
+      if (cur_) {
+        n = static_cast<size_t>(last - first);
+        if (k_limit_ <= maxSize_) {
+          // Value i (0-based) is merged iff weightSoFar_ + i + 1 <= limit.
+          double room = q_limit_times_count_ - weightSoFar_;
+          n = room < 1 ? 0 : std::min(n, static_cast<size_t>(room));
+        }
+      }
+      if (n == 0) {
+        append(Centroid{*first++, 1.0});
+        continue;
+      }
+      sumsToMerge_ += sumValues(first, n);
+      weightsToMerge_ += static_cast<double>(n);
+      weightSoFar_ += static_cast<double>(n);
+      first += n;
+    }
+  }
+
   std::pair<std::vector<Centroid>, double> finalize() && {
     if (!cur_) {
       return {}; // No centroids, no sum.
@@ -287,13 +329,16 @@ void TDigest::mergeValues(
 
   CentroidMerger merger(std::move(workingBuffer), maxSize_, newCount);
 
-  merge2Containers(
-      centroids_,
-      sortedValues,
-      [](const Centroid& c, double val) { return c.mean() < val; },
-      overload(
-          [&](const Centroid& c) { merger.append(c); },
-          [&](double val) { merger.append(Centroid{val, 1.0}); }));
+  // Interleave the centroids with the runs of values that precede them. In
+  // case of ties, values take priority.
+  auto first = sortedValues.begin();
+  for (const auto& centroid : centroids_) {
+    auto last = std::upper_bound(first, sortedValues.end(), centroid.mean());
+    merger.appendValues(first, last);
+    merger.append(centroid);
+    first = last;
+  }
+  merger.appendValues(first, sortedValues.end());
 
   workingBuffer = std::move(dst.centroids_);
   std::tie(dst.centroids_, dst.sum_) = std::move(merger).finalize();
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <mutex>
+
+#include <folly/Likely.h>
+#include <folly/ThreadLocal.h>
+#include <folly/stats/Histogram.h>
+
+namespace folly {
+
+/*
+ * ThreadCachedHistogram is a Histogram, plus the total count, sum, minimum
+ * and maximum of the values added, that many threads can add values to
+ * without sharing a lock or a cache line.
+ *
+ * Each thread records into its own shard: an array with a count and a sum
+ * per bucket that only the owning thread writes.  Nothing is aggregated
+ * until snapshot() is called, which walks all shards (like
+ * ThreadCachedInt::readFull()) and merges them into a regular
+ * folly::Histogram.  The shard of an exiting thread is folded into a shared
+ * accumulator first, so no values are lost.
+ *
+ * addValue() therefore costs about as much as Histogram::addValue(), while
+ * snapshot() costs O(threads * buckets) and holds the ThreadLocal lock for
+ * the Tag.  This suits statistics that are updated on every request and
+ * exported every few seconds.  Use a distinct Tag for instances that are
+ * read frequently.
+ *
+ * A snapshot is not atomic with respect to concurrent addValue() calls: a
+ * value that is being added may be reflected in the count of its bucket
+ * but not yet in the sum.
+ */
+template <typename T, typename Tag = Histogram<T>>
+class ThreadCachedHistogram {
+ public:
+  typedef T ValueType;
+
+  struct Snapshot {
+    Histogram<T> histogram;
+    uint64_t count;
+    ValueType sum;
+    // The smallest and largest values added; meaningless if count is 0.
+    ValueType min;
+    ValueType max;
+  };
+
+  ThreadCachedHistogram(ValueType bucketSize, ValueType min, ValueType max)
+      : dead_{
+            Histogram<T>(bucketSize, min, max),
+            0,
+            ValueType(),
+            std::numeric_limits<ValueType>::max(),
+            std::numeric_limits<ValueType>::lowest()} {}
+
+  ThreadCachedHistogram(const ThreadCachedHistogram&) = delete;
+  ThreadCachedHistogram& operator=(const ThreadCachedHistogram&) = delete;
+
+  /* Add a data point to the histogram */
+  void addValue(ValueType value) {
+    auto shard = shards_.get();
+    if (FOLLY_UNLIKELY(shard == nullptr)) {
+      shard = new Shard(*this);
+      shards_.reset(shard);
+    }
+    // The bucket geometry of dead_ is immutable, so it can be read without
+    // holding mutex_.
+    shard->addValue(value, dead_.histogram.getBucketIdx(value));
+  }
+
+  /* Merge the values added by all threads so far */
+  Snapshot snapshot() const {
+    // Lock out exiting threads before mutex_, in the same order as
+    // ThreadLocal does when it destroys a shard.
+    const auto accessor = shards_.accessAllThreads();
+    std::lock_guard<std::mutex> g(mutex_);
+    Snapshot result = dead_;
+    for (const auto& shard : accessor) {
+      shard.mergeInto(result);
+    }
+    return result;
+  }
+
+  ValueType getBucketSize() const { return dead_.histogram.getBucketSize(); }
+  ValueType getMin() const { return dead_.histogram.getMin(); }
+  ValueType getMax() const { return dead_.histogram.getMax(); }
+  size_t getNumBuckets() const { return dead_.histogram.getNumBuckets(); }
+
+ private:
+  class Shard {
+   public:
+    explicit Shard(ThreadCachedHistogram& parent)
+        : parent_(parent), cells_(new Cell[parent.getNumBuckets()]) {}
+
+    ~Shard() {
+      std::lock_guard<std::mutex> g(parent_.mutex_);
+      mergeInto(parent_.dead_);
+    }
+
+    void addValue(ValueType value, size_t idx) {
+      // Only the owning thread writes to the shard, so the updates don't
+      // need to be atomic read-modify-writes.
+      Cell& cell = cells_[idx];
+      cell.count.store(
+          cell.count.load(std::memory_order_relaxed) + 1,
+          std::memory_order_relaxed);
+      cell.sum.store(
+          cell.sum.load(std::memory_order_relaxed) + value,
+          std::memory_order_relaxed);
+      if (value < min_.load(std::memory_order_relaxed)) {
+        min_.store(value, std::memory_order_relaxed);
+      }
+      if (value > max_.load(std::memory_order_relaxed)) {
+        max_.store(value, std::memory_order_relaxed);
+      }
+    }
+
+    void mergeInto(Snapshot& result) const {
+      for (size_t i = 0; i < result.histogram.getNumBuckets(); ++i) {
+        uint64_t count = cells_[i].count.load(std::memory_order_relaxed);
+        if (count == 0) {
+          continue;
+        }
+        ValueType sum = cells_[i].sum.load(std::memory_order_relaxed);
+        result.histogram.addToBucket(i, sum, count);
+        result.count += count;
+        result.sum += sum;
+      }
+      result.min = std::min(result.min, min_.load(std::memory_order_relaxed));
+      result.max = std::max(result.max, max_.load(std::memory_order_relaxed));
+    }
+
+   private:
+    struct Cell {
+      std::atomic<uint64_t> count{0};
+      std::atomic<ValueType> sum{ValueType()};
+    };
+
+    ThreadCachedHistogram& parent_;
+    std::unique_ptr<Cell[]> cells_;
+    std::atomic<ValueType> min_{std::numeric_limits<ValueType>::max()};
+    std::atomic<ValueType> max_{std::numeric_limits<ValueType>::lowest()};
+  };
+
+  mutable std::mutex mutex_;
+  Snapshot dead_; // values added by threads that have exited
+  ThreadLocalPtr<Shard, Tag, AccessModeStrict>
+      shards_; // Must be last for dtor ordering
+};
+
+} // namespace folly
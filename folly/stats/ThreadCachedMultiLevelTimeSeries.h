@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <vector>
+
+#include <folly/ConstexprMath.h>
+#include <folly/Likely.h>
+#include <folly/Range.h>
+#include <folly/ThreadLocal.h>
+#include <folly/stats/MultiLevelTimeSeries.h>
+
+namespace folly {
+
+/*
+ * ThreadCachedMultiLevelTimeSeries is a MultiLevelTimeSeries that many
+ * threads can add values to without sharing a lock or a cache line.
+ *
+ * Each thread records into its own shard: a small ring of (time, sum, count)
+ * entries, one per distinct time point passed to addValue(), that only the
+ * owning thread writes.  Nothing is aggregated until the time series is
+ * read: update(), flush(), snapshot() and the query methods walk all shards
+ * (like ThreadCachedHistogram::snapshot()), add the entries recorded since
+ * the previous read to an underlying MultiLevelTimeSeries in time order, and
+ * then answer the query from it.  The shard of an exiting thread is merged
+ * first, so no values are lost.
+ *
+ * A thread only takes the lock itself when its ring is full, that is after
+ * it has added values at kNumPendingTimes distinct time points since the
+ * time series was last read.  With the default clock, which has a
+ * granularity of one second, this happens at most once every
+ * kNumPendingTimes seconds per thread.  Clocks with a finer granularity
+ * work, but threads then fall back to the lock much more often.
+ *
+ * Reads cost O(threads * kNumPendingTimes) and hold the ThreadLocal lock for
+ * the Tag, so this suits statistics that are updated on every request and
+ * read every few seconds.  Use a distinct Tag for instances that are read
+ * frequently.
+ *
+ * Queries have the same semantics as the MultiLevelTimeSeries ones, and the
+ * same caveat applies: call update() with the current time first, or you
+ * may be reading stale data.  A read is not atomic with respect to
+ * concurrent addValue() calls: a value that is being added may be reflected
+ * in the count but not yet in the sum, until the next read.
+ */
+template <
+    typename VT,
+    typename CT = LegacyStatsClock<std::chrono::seconds>,
+    typename Tag = MultiLevelTimeSeries<VT, CT>>
+class ThreadCachedMultiLevelTimeSeries {
+ public:
+  using ValueType = VT;
+  using Clock = CT;
+  using Duration = typename Clock::duration;
+  using TimePoint = typename Clock::time_point;
+  using Series = MultiLevelTimeSeries<ValueType, Clock>;
+
+  /*
+   * The number of distinct time points a thread can add values at between
+   * two reads without taking the lock.
+   */
+  static constexpr size_t kNumPendingTimes = 16;
+
+  /*
+   * Create a new time series with the same levels as
+   * MultiLevelTimeSeries(numBuckets, durations).
+   */
+  ThreadCachedMultiLevelTimeSeries(
+      size_t numBuckets, std::initializer_list<Duration> durations)
+      : series_(numBuckets, durations) {}
+
+  ThreadCachedMultiLevelTimeSeries(
+      size_t numBuckets, folly::Range<const Duration*> durations)
+      : series_(numBuckets, durations) {}
+
+  ThreadCachedMultiLevelTimeSeries(const ThreadCachedMultiLevelTimeSeries&) =
+      delete;
+  ThreadCachedMultiLevelTimeSeries& operator=(
+      const ThreadCachedMultiLevelTimeSeries&) = delete;
+
+  size_t numBuckets() const { return series_.numBuckets(); }
+  size_t numLevels() const { return series_.numLevels(); }
+
+  /*
+   * Adds the value 'val' at time 'now' to all levels.
+   *
+   * As with MultiLevelTimeSeries, time is expected to move forwards.
+   */
+  void addValue(TimePoint now, const ValueType& val) {
+    addValueAggregated(now, val, 1);
+  }
+
+  void addValue(TimePoint now, const ValueType& val, uint64_t times) {
+    addValueAggregated(now, val * ValueType(times), times);
+  }
+
+  /*
+   * Adds the value 'total' at time 'now' to all levels as the sum of
+   * 'nsamples' samples.
+   */
+  void addValueAggregated(
+      TimePoint now, const ValueType& total, uint64_t nsamples) {
+    auto shard = shards_.get();
+    if (FOLLY_UNLIKELY(shard == nullptr)) {
+      shard = new Shard(*this);
+      shards_.reset(shard);
+    }
+    shard->addValueAggregated(now, total, nsamples);
+  }
+
+  /*
+   * Merge the values added by all threads so far, then update all the levels
+   * to the specified time.
+   */
+  void update(TimePoint now) {
+    read([&](Series& series) { series.update(now); });
+  }
+
+  /* Merge the values added by all threads so far */
+  void flush() {
+    read([](Series&) {});
+  }
+
+  /*
+   * Reset the time series to an empty state, discarding the values added by
+   * all threads so far.
+   */
+  void clear() {
+    read([](Series& series) { series.clear(); });
+  }
+
+  /*
+   * Merge the values added by all threads so far and return a copy of the
+   * resulting MultiLevelTimeSeries, which supports every query of
+   * MultiLevelTimeSeries, including the ones over arbitrary time ranges.
+   */
+  Series snapshot() const {
+    return read([](const Series& series) { return series; });
+  }
+
+  ValueType sum(size_t level) const {
+    return read([&](const Series& series) { return series.sum(level); });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType avg(size_t level) const {
+    return read([&](const Series& series) {
+      return series.template avg<ReturnType>(level);
+    });
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType rate(size_t level) const {
+    return read([&](const Series& series) {
+      return series.template rate<ReturnType, Interval>(level);
+    });
+  }
+
+  uint64_t count(size_t level) const {
+    return read([&](const Series& series) { return series.count(level); });
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType countRate(size_t level) const {
+    return read([&](const Series& series) {
+      return series.template countRate<ReturnType, Interval>(level);
+    });
+  }
+
+  ValueType sum(Duration duration) const {
+    return read([&](const Series& series) { return series.sum(duration); });
+  }
+
+  template <typename ReturnType = double>
+  ReturnType avg(Duration duration) const {
+    return read([&](const Series& series) {
+      return series.template avg<ReturnType>(duration);
+    });
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType rate(Duration duration) const {
+    return read([&](const Series& series) {
+      return series.template rate<ReturnType, Interval>(duration);
+    });
+  }
+
+  uint64_t count(Duration duration) const {
+    return read([&](const Series& series) { return series.count(duration); });
+  }
+
+  template <typename ReturnType = double, typename Interval = Duration>
+  ReturnType countRate(Duration duration) const {
+    return read([&](const Series& series) {
+      return series.template countRate<ReturnType, Interval>(duration);
+    });
+  }
+
+ private:
+  // The values a shard recorded at one time point since the previous read.
+  struct Pending {
+    TimePoint time;
+    ValueType sum;
+    uint64_t count;
+  };
+
+  class Shard {
+   public:
+    explicit Shard(ThreadCachedMultiLevelTimeSeries& parent)
+        : parent_(parent) {}
+
+    ~Shard() {
+      std::lock_guard<std::mutex> g(parent_.mutex_);
+      collect(parent_.pending_);
+      parent_.applyPendingLocked();
+    }
+
+    void addValueAggregated(
+        TimePoint now, const ValueType& total, uint64_t nsamples) {
+      // Only the owning thread writes the entries and latest_, so the
+      // updates don't need to be atomic read-modify-writes.
+      const auto time = now.time_since_epoch().count();
+      const uint64_t latest = latest_.load(std::memory_order_relaxed);
+      Entry& entry = entries_[latest % kNumPendingTimes];
+      if (FOLLY_LIKELY(entry.time.load(std::memory_order_relaxed) == time)) {
+        // Clamp like MultiLevelTimeSeries does.
+        entry.sum.store(
+            constexpr_add_overflow_clamped(
+                entry.sum.load(std::memory_order_relaxed), total),
+            std::memory_order_relaxed);
+        entry.count.store(
+            constexpr_add_overflow_clamped(
+                entry.count.load(std::memory_order_relaxed), nsamples),
+            std::memory_order_relaxed);
+        return;
+      }
+
+      // Entries that have not been collected yet may not be overwritten.
+      // When the ring is full, collect them here instead of waiting for the
+      // next read.
+      if (FOLLY_UNLIKELY(
+              latest + 1 - collected_.load(std::memory_order_acquire) >=
+              kNumPendingTimes)) {
+        std::lock_guard<std::mutex> g(parent_.mutex_);
+        collect(parent_.pending_);
+        parent_.applyPendingLocked();
+      }
+
+      Entry& next = entries_[(latest + 1) % kNumPendingTimes];
+      next.time.store(time, std::memory_order_relaxed);
+      next.sum.store(total, std::memory_order_relaxed);
+      next.count.store(nsamples, std::memory_order_relaxed);
+      latest_.store(latest + 1, std::memory_order_release);
+    }
+
+    // Append the values recorded since the previous call to out.  Requires
+    // parent_.mutex_.
+    void collect(std::vector<Pending>& out) {
+      const uint64_t latest = latest_.load(std::memory_order_acquire);
+      for (uint64_t i = collected_.load(std::memory_order_relaxed);
+           i <= latest;
+           ++i) {
+        const Entry& entry = entries_[i % kNumPendingTimes];
+        // Entries before latest are no longer written to, but the one at
+        // latest may still grow; remember how much of it was collected.
+        const ValueType sum = entry.sum.load(std::memory_order_relaxed);
+        const uint64_t count = entry.count.load(std::memory_order_relaxed);
+        Pending pending{
+            TimePoint(Duration(entry.time.load(std::memory_order_relaxed))),
+            sum - collectedSum_,
+            count - collectedCount_};
+        collectedSum_ = ValueType();
+        collectedCount_ = 0;
+        if (i == latest) {
+          collectedSum_ = sum;
+          collectedCount_ = count;
+        }
+        if (pending.count != 0 || pending.sum != ValueType()) {
+          out.push_back(pending);
+        }
+      }
+      collected_.store(latest, std::memory_order_release);
+    }
+
+   private:
+    struct Entry {
+      std::atomic<typename Duration::rep> time{0};
+      std::atomic<ValueType> sum{ValueType()};
+      std::atomic<uint64_t> count{0};
+    };
+
+    ThreadCachedMultiLevelTimeSeries& parent_;
+    std::array<Entry, kNumPendingTimes> entries_;
+    // The position of the entry for the most recent time point.
+    std::atomic<uint64_t> latest_{0};
+    // The position of the first entry that was not fully collected yet,
+    // and how much of it was.  Only written with parent_.mutex_ held.
+    std::atomic<uint64_t> collected_{0};
+    ValueType collectedSum_{};
+    uint64_t collectedCount_{0};
+  };
+
+  // Add the collected values to series_, oldest first.  Requires mutex_.
+  void applyPendingLocked() const {
+    std::stable_sort(
+        pending_.begin(),
+        pending_.end(),
+        [](const Pending& a, const Pending& b) { return a.time < b.time; });
+    for (const auto& pending : pending_) {
+      series_.addValueAggregated(pending.time, pending.sum, pending.count);
+    }
+    series_.flush();
+    pending_.clear();
+  }
+
+  template <typename Fn>
+  auto read(Fn fn) const {
+    // Lock out exiting threads before mutex_, in the same order as
+    // ThreadLocal does when it destroys a shard.
+    auto accessor = shards_.accessAllThreads();
+    std::lock_guard<std::mutex> g(mutex_);
+    for (auto& shard : accessor) {
+      shard.collect(pending_);
+    }
+    applyPendingLocked();
+    return fn(series_);
+  }
+
+  mutable std::mutex mutex_;
+  // Everything below is protected by mutex_.
+  mutable Series series_;
+  mutable std::vector<Pending> pending_;
+  ThreadLocalPtr<Shard, Tag, AccessModeStrict>
+      shards_; // Must be last for dtor ordering
+};
+
+} // namespace folly
@@ -0,0 +1,46 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+
+#include <folly/stats/DDSketch.h>
+#include <folly/stats/TimeseriesHistogram.h>
+
+namespace folly {
+
+/*
+ * Add all of the values counted in the specified sketch to the histogram,
+ * with timestamp 'now'.  Each bin of the sketch is added as its
+ * representative value, so the values are only known within the relative
+ * accuracy of the sketch.
+ *
+ * This allows per-host sketches received from other processes to be
+ * aggregated into the buckets of a TimeseriesHistogram.  It lives in its own
+ * header so that TimeseriesHistogram users don't depend on DDSketch.
+ */
+template <typename T, typename CT, typename C>
+void addSketchValues(
+    TimeseriesHistogram<T, CT, C>& histogram,
+    typename TimeseriesHistogram<T, CT, C>::TimePoint now,
+    const DDSketch& sketch) {
+  sketch.forEachBin([&](double value, uint64_t count) {
+    histogram.addValue(now, static_cast<T>(value), count);
+  });
+}
+
+} // namespace folly
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/DDSketch.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include <folly/Benchmark.h>
+#include <folly/portability/GFlags.h>
+#include <folly/stats/DigestBuilder.h>
+#include <folly/stats/TDigest.h>
+
+using folly::DDSketch;
+using folly::TDigest;
+
+// Compares DDSketch with TDigest on heavy-tailed (Pareto, shape 1.1) data.
+// After the benchmarks, the relative error of both at several quantiles is
+// printed, along with the size of the DDSketch encoding.
+
+namespace {
+
+std::vector<double> paretoValues(size_t n, uint32_t seed) {
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  std::vector<double> values;
+  values.reserve(n);
+  for (size_t i = 0; i < n; ++i) {
+    values.push_back(std::pow(1 - uniform(generator), -1 / 1.1));
+  }
+  return values;
+}
+
+// Adds iters values through DigestBuilder, as a stat would.
+template <typename DigestT>
+void appendMultithreaded(unsigned int iters, size_t nThreads) {
+  constexpr size_t kDigestSize = std::is_same_v<DigestT, TDigest>
+      ? TDigest::kDefaultMaxSize
+      : DDSketch::kDefaultMaxBins;
+  folly::DigestBuilder<DigestT> digestBuilder(
+      /*bufferSize=*/1000, /*digestSize=*/kDigestSize);
+
+  constexpr size_t kNumValues = 512;
+  std::vector<std::vector<double>> valuesPerThread;
+  BENCHMARK_SUSPEND {
+    for (size_t t = 0; t < nThreads; ++t) {
+      valuesPerThread.push_back(paretoValues(kNumValues, t));
+    }
+  }
+
+  std::atomic<int> remainingBatches{static_cast<int>(iters / kNumValues)};
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < nThreads; ++t) {
+    threads.emplace_back([&, t] {
+      while (remainingBatches.fetch_sub(1, std::memory_order_acq_rel) > 0) {
+        for (auto v : valuesPerThread[t]) {
+          digestBuilder.append(v);
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  folly::doNotOptimizeAway(digestBuilder.build());
+}
+
+void tdigestAdd(unsigned int iters, size_t bufSize) {
+  std::vector<double> values;
+  BENCHMARK_SUSPEND {
+    values = paretoValues(iters, 0);
+  }
+  TDigest digest;
+  for (size_t i = 0; i < values.size(); i += bufSize) {
+    auto end = std::min(values.size(), i + bufSize);
+    digest =
+        digest.merge(folly::Range<const double*>(&values[i], &values[end]));
+  }
+  folly::doNotOptimizeAway(digest);
+}
+
+void ddsketchAdd(unsigned int iters, size_t) {
+  std::vector<double> values;
+  BENCHMARK_SUSPEND {
+    values = paretoValues(iters, 0);
+  }
+  DDSketch sketch;
+  for (auto value : values) {
+    sketch.addValue(value);
+  }
+  folly::doNotOptimizeAway(sketch);
+}
+
+template <typename DigestT>
+std::vector<DigestT> makeDigests(size_t nDigests, size_t valuesPerDigest) {
+  std::vector<DigestT> digests;
+  for (size_t i = 0; i < nDigests; ++i) {
+    digests.push_back(DigestT().merge(paretoValues(valuesPerDigest, i)));
+  }
+  return digests;
+}
+
+template <typename DigestT>
+void mergeDigests(unsigned int iters, size_t nDigests) {
+  std::vector<DigestT> digests;
+  BENCHMARK_SUSPEND {
+    digests = makeDigests<DigestT>(nDigests, 10000);
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(DigestT::merge(digests));
+  }
+}
+
+void serialize(unsigned int iters, size_t nValues) {
+  DDSketch sketch;
+  BENCHMARK_SUSPEND {
+    sketch = sketch.merge(paretoValues(nValues, 0));
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(sketch.serialize());
+  }
+}
+
+void deserialize(unsigned int iters, size_t nValues) {
+  std::string data;
+  BENCHMARK_SUSPEND {
+    data = DDSketch().merge(paretoValues(nValues, 0)).serialize();
+  }
+  for (size_t i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(DDSketch::deserialize(data));
+  }
+}
+
+void appendTDigest(unsigned int iters, size_t nThreads) {
+  appendMultithreaded<TDigest>(iters, nThreads);
+}
+
+void appendDDSketch(unsigned int iters, size_t nThreads) {
+  appendMultithreaded<DDSketch>(iters, nThreads);
+}
+
+void mergeTDigests(unsigned int iters, size_t nDigests) {
+  mergeDigests<TDigest>(iters, nDigests);
+}
+
+void mergeDDSketches(unsigned int iters, size_t nDigests) {
+  mergeDigests<DDSketch>(iters, nDigests);
+}
+
+void printAccuracy() {
+  constexpr size_t kNumHosts = 60;
+  constexpr size_t kValuesPerHost = 20000;
+  // Per-host digests merged centrally, as for cross-host aggregation.
+  auto tdigest =
+      TDigest::merge(makeDigests<TDigest>(kNumHosts, kValuesPerHost));
+  auto sketches = makeDigests<DDSketch>(kNumHosts, kValuesPerHost);
+  auto sketch = DDSketch::merge(sketches);
+  std::vector<double> values;
+  for (size_t i = 0; i < kNumHosts; ++i) {
+    auto hostValues = paretoValues(kValuesPerHost, i);
+    values.insert(values.end(), hostValues.begin(), hostValues.end());
+  }
+  std::sort(values.begin(), values.end());
+
+  std::printf(
+      "Relative error on Pareto(1.1) data, %zu hosts x %zu values:\n",
+      kNumHosts,
+      kValuesPerHost);
+  std::printf(
+      "%10s %14s %10s %10s\n", "quantile", "exact", "TDigest", "DDSketch");
+  for (double q : {0.5, 0.9, 0.99, 0.999, 0.9999}) {
+    auto exact = values[static_cast<size_t>(q * (values.size() - 1))];
+    std::printf(
+        "%10g %14.3f %9.3f%% %9.3f%%\n",
+        q,
+        exact,
+        100 * std::abs(tdigest.estimateQuantile(q) - exact) / exact,
+        100 * std::abs(sketch.estimateQuantile(q) - exact) / exact);
+  }
+  std::printf(
+      "DDSketch: %zu bins, %zu bytes serialized per host on average\n",
+      sketch.numBins(),
+      [&] {
+        size_t bytes = 0;
+        for (const auto& s : sketches) {
+          bytes += s.serialize().size();
+        }
+        return bytes / sketches.size();
+      }());
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(tdigestAdd, buffer1000, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(ddsketchAdd, direct, 0)
+
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(appendTDigest, 1, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(appendDDSketch, 1, 1)
+BENCHMARK_NAMED_PARAM(appendTDigest, 8, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(appendDDSketch, 8, 8)
+
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mergeTDigests, 60, 60)
+BENCHMARK_RELATIVE_NAMED_PARAM(mergeDDSketches, 60, 60)
+
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(serialize, 10k, 10000)
+BENCHMARK_NAMED_PARAM(deserialize, 10k, 10000)
+
+#if 0
+============================================================================
+[...]folly/stats/test/DDSketchBenchmark.cpp     relative  time/iter   iters/s
+============================================================================
+tdigestAdd(buffer1000)                                     28.08ns    35.61M
+ddsketchAdd(direct)                             228.50%    12.29ns    81.37M
+----------------------------------------------------------------------------
+appendTDigest(1)                                           42.70ns    23.42M
+appendDDSketch(1)                               175.16%    24.38ns    41.02M
+----------------------------------------------------------------------------
+mergeTDigests(60)                                         409.98us     2.44K
+mergeDDSketches(60)                             1165.7%    35.17us    28.43K
+----------------------------------------------------------------------------
+serialize(10k)                                              1.61us   621.31K
+deserialize(10k)                                            1.32us   757.84K
+============================================================================
+Relative error on Pareto(1.1) data, 60 hosts x 20000 values:
+  quantile          exact    TDigest   DDSketch
+       0.5          1.879     0.024%     0.062%
+       0.9          8.093     0.049%     0.103%
+      0.99         65.589     0.124%     0.671%
+     0.999        543.040    12.076%     0.700%
+    0.9999       4318.194   394.764%     0.036%
+DDSketch: 496 bins, 578 bytes serialized per host on average
+#endif
+
+int main(int argc, char* argv[]) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  printAccuracy();
+  return 0;
+}
@@ -0,0 +1,350 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/DDSketch.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+#include <folly/portability/GTest.h>
+#include <folly/stats/DigestBuilder.h>
+#include <folly/stats/TimeseriesHistogramDDSketch.h>
+
+using namespace folly;
+
+namespace {
+
+const int32_t kNumSamples = 20000;
+const int32_t kSeed = 0;
+
+// Checks every percentile of values against the true value of the same rank.
+void expectRelativeAccuracy(
+    const DDSketch& sketch, std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  auto alpha = sketch.relativeAccuracy();
+  for (int p = 0; p <= 1000; ++p) {
+    double q = p / 1000.0;
+    auto expected = values[static_cast<size_t>(q * (values.size() - 1))];
+    auto estimate = sketch.estimateQuantile(q);
+    EXPECT_LE(std::abs(estimate - expected), alpha * std::abs(expected) + 1e-12)
+        << "q=" << q;
+  }
+}
+
+std::vector<std::pair<double, uint64_t>> getBins(const DDSketch& sketch) {
+  std::vector<std::pair<double, uint64_t>> bins;
+  sketch.forEachBin([&](double value, uint64_t count) {
+    bins.emplace_back(value, count);
+  });
+  return bins;
+}
+
+} // namespace
+
+TEST(DDSketch, Basic) {
+  DDSketch sketch;
+  EXPECT_TRUE(sketch.empty());
+  EXPECT_EQ(0, sketch.estimateQuantile(0.5));
+
+  for (int i = 1; i <= 100; ++i) {
+    sketch.addValue(i);
+  }
+
+  EXPECT_FALSE(sketch.empty());
+  EXPECT_EQ(100, sketch.count());
+  EXPECT_EQ(5050, sketch.sum());
+  EXPECT_EQ(50.5, sketch.mean());
+  EXPECT_EQ(1, sketch.min());
+  EXPECT_EQ(100, sketch.max());
+
+  EXPECT_EQ(1, sketch.estimateQuantile(0));
+  EXPECT_EQ(100, sketch.estimateQuantile(1));
+  EXPECT_NEAR(50, sketch.estimateQuantile(0.5), 0.5);
+  EXPECT_NEAR(99, sketch.estimateQuantile(0.99), 0.99);
+}
+
+TEST(DDSketch, AddValueWithCount) {
+  DDSketch a;
+  DDSketch b;
+  for (int i = 0; i < 10; ++i) {
+    a.addValue(42.0);
+  }
+  b.addValue(42.0, 10);
+  b.addValue(7.0, 0);
+  EXPECT_EQ(a.count(), b.count());
+  EXPECT_EQ(a.sum(), b.sum());
+  EXPECT_EQ(a.serialize(), b.serialize());
+}
+
+TEST(DDSketch, IgnoresNonFinite) {
+  DDSketch sketch;
+  sketch.addValue(std::numeric_limits<double>::quiet_NaN());
+  sketch.addValue(std::numeric_limits<double>::infinity());
+  sketch.addValue(-std::numeric_limits<double>::infinity());
+  EXPECT_TRUE(sketch.empty());
+}
+
+TEST(DDSketch, NegativeAndZero) {
+  DDSketch sketch;
+  std::vector<double> values;
+  for (int i = -500; i <= 500; ++i) {
+    values.push_back(i * 0.25);
+    sketch.addValue(i * 0.25);
+  }
+  EXPECT_EQ(-125, sketch.min());
+  EXPECT_EQ(125, sketch.max());
+  EXPECT_EQ(0, sketch.estimateQuantile(0.5));
+  expectRelativeAccuracy(sketch, values);
+
+  auto bins = getBins(sketch);
+  EXPECT_EQ(sketch.numBins(), bins.size());
+  EXPECT_TRUE(std::is_sorted(bins.begin(), bins.end()));
+  uint64_t total = 0;
+  for (const auto& bin : bins) {
+    total += bin.second;
+  }
+  EXPECT_EQ(sketch.count(), total);
+}
+
+TEST(DDSketch, LognormalAccuracy) {
+  std::mt19937 gen(kSeed);
+  std::lognormal_distribution<double> dist(0.0, 2.0);
+  DDSketch sketch;
+  std::vector<double> values;
+  for (int i = 0; i < kNumSamples; ++i) {
+    values.push_back(dist(gen));
+    sketch.addValue(values.back());
+  }
+  expectRelativeAccuracy(sketch, values);
+}
+
+TEST(DDSketch, ParetoAccuracy) {
+  std::mt19937 gen(kSeed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+  for (double accuracy : {0.005, 0.01, 0.05}) {
+    DDSketch sketch(DDSketch::kDefaultMaxBins, accuracy);
+    std::vector<double> values;
+    for (int i = 0; i < kNumSamples; ++i) {
+      // Pareto with shape 1.1, so the tail spans many orders of magnitude.
+      values.push_back(std::pow(1 - uniform(gen), -1 / 1.1));
+      sketch.addValue(values.back());
+    }
+    expectRelativeAccuracy(sketch, values);
+  }
+}
+
+TEST(DDSketch, Merge) {
+  std::mt19937 gen(kSeed);
+  std::lognormal_distribution<double> dist(0.0, 2.0);
+  DDSketch whole;
+  std::vector<DDSketch> parts(7);
+  std::vector<double> values;
+  for (int i = 0; i < kNumSamples; ++i) {
+    double value = i % 3 == 0 ? -dist(gen) : dist(gen);
+    values.push_back(value);
+    whole.addValue(value);
+    parts[i % parts.size()].addValue(value);
+  }
+
+  auto merged = DDSketch::merge(parts);
+  EXPECT_EQ(whole.count(), merged.count());
+  EXPECT_NEAR(whole.sum(), merged.sum(), 1e-9 * std::abs(whole.sum()));
+  EXPECT_EQ(whole.min(), merged.min());
+  EXPECT_EQ(whole.max(), merged.max());
+  // Merging is exact, so the bins are the same regardless of the order.
+  for (int p = 0; p <= 100; ++p) {
+    EXPECT_EQ(
+        whole.estimateQuantile(p / 100.0), merged.estimateQuantile(p / 100.0));
+  }
+  expectRelativeAccuracy(merged, values);
+
+  DDSketch incremental;
+  for (auto it = parts.rbegin(); it != parts.rend(); ++it) {
+    incremental.merge(*it);
+  }
+  EXPECT_EQ(getBins(merged), getBins(incremental));
+
+  auto fromValues = DDSketch().merge(values);
+  EXPECT_EQ(getBins(whole), getBins(fromValues));
+
+  EXPECT_TRUE(DDSketch::merge(std::vector<DDSketch>{}).empty());
+}
+
+TEST(DDSketch, MergeMismatchedAccuracy) {
+  DDSketch a(DDSketch::kDefaultMaxBins, 0.01);
+  DDSketch b(DDSketch::kDefaultMaxBins, 0.02);
+  b.addValue(1.0);
+  EXPECT_THROW(a.merge(b), std::invalid_argument);
+}
+
+TEST(DDSketch, InvalidParameters) {
+  EXPECT_THROW(DDSketch(0), std::invalid_argument);
+  EXPECT_THROW(DDSketch(100, 0.0), std::invalid_argument);
+  EXPECT_THROW(DDSketch(100, 1.0), std::invalid_argument);
+  EXPECT_THROW(
+      DDSketch(100, std::numeric_limits<double>::quiet_NaN()),
+      std::invalid_argument);
+}
+
+TEST(DDSketch, Collapse) {
+  // 1% accuracy needs ~230 bins per order of magnitude, so 64 bins cannot
+  // hold 1..1e6; the lowest bins are collapsed and only the highest
+  // quantiles remain accurate.
+  DDSketch sketch(64);
+  std::vector<double> values;
+  for (int i = 0; i <= 60; ++i) {
+    values.push_back(std::pow(10, i / 10.0));
+  }
+  std::shuffle(values.begin(), values.end(), std::mt19937(kSeed));
+  for (auto value : values) {
+    sketch.addValue(value);
+  }
+  std::sort(values.begin(), values.end());
+  EXPECT_LE(sketch.numBins(), 64);
+  EXPECT_EQ(values.size(), sketch.count());
+  EXPECT_EQ(1, sketch.min());
+  EXPECT_EQ(1e6, sketch.max());
+  for (double q : {0.96, 0.98, 1.0}) {
+    auto expected = values[static_cast<size_t>(q * (values.size() - 1))];
+    EXPECT_NEAR(expected, sketch.estimateQuantile(q), 0.01 * expected);
+  }
+  // The collapsed quantiles are overestimated, but not beyond max.
+  EXPECT_GT(sketch.estimateQuantile(0.1), values[6]);
+
+  DDSketch other(64);
+  other.addValue(1e-3);
+  other.merge(sketch);
+  EXPECT_LE(other.numBins(), 64);
+  EXPECT_EQ(1e-3, other.min());
+  EXPECT_EQ(sketch.count() + 1, other.count());
+}
+
+TEST(DDSketch, Serialize) {
+  std::mt19937 gen(kSeed);
+  std::lognormal_distribution<double> dist(0.0, 2.0);
+  DDSketch sketch(1000, 0.02);
+  for (int i = 0; i < kNumSamples; ++i) {
+    sketch.addValue(i % 5 == 0 ? -dist(gen) : dist(gen));
+  }
+  sketch.addValue(0, 3);
+
+  auto data = sketch.serialize();
+  // The encoding is a few bytes per non-empty bin.
+  EXPECT_LT(data.size(), 64 + 3 * sketch.numBins());
+
+  auto decoded = DDSketch::deserialize(data);
+  EXPECT_EQ(sketch.count(), decoded.count());
+  EXPECT_EQ(sketch.sum(), decoded.sum());
+  EXPECT_EQ(sketch.min(), decoded.min());
+  EXPECT_EQ(sketch.max(), decoded.max());
+  EXPECT_EQ(sketch.maxBins(), decoded.maxBins());
+  EXPECT_EQ(sketch.relativeAccuracy(), decoded.relativeAccuracy());
+  for (int p = 0; p <= 100; ++p) {
+    EXPECT_EQ(
+        sketch.estimateQuantile(p / 100.0),
+        decoded.estimateQuantile(p / 100.0));
+  }
+  EXPECT_EQ(data, decoded.serialize());
+
+  auto empty = DDSketch::deserialize(DDSketch().serialize());
+  EXPECT_TRUE(empty.empty());
+  EXPECT_TRUE(std::isnan(empty.min()));
+}
+
+TEST(DDSketch, DeserializeInvalid) {
+  DDSketch sketch;
+  for (int i = 1; i <= 100; ++i) {
+    sketch.addValue(i);
+  }
+  auto data = sketch.serialize();
+
+  EXPECT_THROW(DDSketch::deserialize(StringPiece()), std::invalid_argument);
+  // Every truncation is detected.
+  for (size_t size = 1; size < data.size(); ++size) {
+    EXPECT_THROW(
+        DDSketch::deserialize(StringPiece(data.data(), size)),
+        std::invalid_argument)
+        << size;
+  }
+  EXPECT_THROW(DDSketch::deserialize(data + "x"), std::invalid_argument);
+
+  auto badVersion = data;
+  badVersion[0] = 2;
+  EXPECT_THROW(DDSketch::deserialize(badVersion), std::invalid_argument);
+
+  auto badAccuracy = data;
+  std::fill(badAccuracy.begin() + 1, badAccuracy.begin() + 9, '\0');
+  EXPECT_THROW(DDSketch::deserialize(badAccuracy), std::invalid_argument);
+
+  // A huge bin count must be rejected before allocating.
+  auto header = data.substr(0, 1 + 4 * sizeof(double));
+  header += std::string("\x80\x10", 2); // maxBins
+  header += std::string("\x00", 1); // zeroCount
+  header += std::string("\xff\xff\xff\xff\x07", 5); // numBins
+  EXPECT_THROW(DDSketch::deserialize(header), std::invalid_argument);
+}
+
+TEST(DDSketch, DigestBuilder) {
+  DigestBuilder<DDSketch> builder(/*bufferSize=*/100, /*digestSize=*/512);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 1; i <= 1000; ++i) {
+        builder.append(t * 1000 + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto sketch = builder.build();
+  EXPECT_EQ(512, sketch.maxBins());
+  EXPECT_EQ(4000, sketch.count());
+  EXPECT_EQ(1, sketch.min());
+  EXPECT_EQ(4000, sketch.max());
+  EXPECT_NEAR(2000, sketch.estimateQuantile(0.5), 20);
+
+  EXPECT_TRUE(builder.build().empty());
+  builder.append(5);
+  EXPECT_EQ(1, builder.build().count());
+}
+
+TEST(DDSketch, TimeseriesHistogram) {
+  TimeseriesHistogram<int64_t> hist(
+      10,
+      0,
+      1000,
+      MultiLevelTimeSeries<int64_t>(60, {std::chrono::seconds(60)}));
+
+  DDSketch sketch;
+  for (int i = 0; i < 900; ++i) {
+    sketch.addValue(i);
+  }
+  sketch.addValue(5000);
+  auto now = TimeseriesHistogram<int64_t>::TimePoint(std::chrono::seconds(10));
+  addSketchValues(hist, now, sketch);
+  hist.update(now);
+
+  EXPECT_EQ(sketch.count(), hist.count(0));
+  // Bins are added as their representative values.
+  EXPECT_NEAR(sketch.sum(), hist.sum(0), 0.02 * sketch.sum());
+  EXPECT_EQ(1, hist.getBucket(hist.getNumBuckets() - 1).count(0));
+  EXPECT_NEAR(450, hist.getPercentileEstimate(50, 0), 20);
+}
@@ -16,6 +16,10 @@
 
 #include <folly/stats/Histogram.h>
 
+#include <algorithm>
+#include <random>
+#include <vector>
+
 #include <folly/Benchmark.h>
 #include <folly/container/Foreach.h>
 #include <folly/portability/GFlags.h>
@@ -34,10 +38,81 @@ void addValue(unsigned int n, int64_t bucketSize, int64_t min, int64_t max) {
   }
 }
 
+// Per-sample cost of adding random values to a histogram with 100 buckets in
+// batches of batchSize, one value at a time or with addValues().  The batches
+// are taken from a large pool of values, so that the branches on the values
+// cannot be predicted.
+template <typename T>
+const std::vector<T>& getPool() {
+  static const auto pool = [] {
+    std::vector<T> values;
+    std::mt19937 gen(0);
+    std::uniform_real_distribution<double> dist(-1000, 11000);
+    for (size_t i = 0; i < (1 << 20); ++i) {
+      values.push_back(T(dist(gen)));
+    }
+    return values;
+  }();
+  return pool;
+}
+
+template <typename T>
+void addBatch(unsigned int n, size_t batchSize, bool bulk) {
+  Histogram<T> hist(T(100), T(0), T(10000));
+  const auto& pool = getPool<T>();
+  size_t offset = 0;
+  for (size_t done = 0; done < n;) {
+    auto size = std::min<size_t>(batchSize, n - done);
+    if (offset + size > pool.size()) {
+      offset = 0;
+    }
+    folly::Range<const T*> values(pool.data() + offset, size);
+    if (bulk) {
+      hist.addValues(values);
+    } else {
+      for (auto value : values) {
+        hist.addValue(value);
+      }
+    }
+    offset += size;
+    done += size;
+  }
+  folly::doNotOptimizeAway(hist);
+}
+
+void addValueInt(unsigned int n, size_t batchSize) {
+  addBatch<int64_t>(n, batchSize, false);
+}
+void addValuesInt(unsigned int n, size_t batchSize) {
+  addBatch<int64_t>(n, batchSize, true);
+}
+void addValueDouble(unsigned int n, size_t batchSize) {
+  addBatch<double>(n, batchSize, false);
+}
+void addValuesDouble(unsigned int n, size_t batchSize) {
+  addBatch<double>(n, batchSize, true);
+}
+
 BENCHMARK_NAMED_PARAM(addValue, 0_to_100, 1, 0, 100)
 BENCHMARK_NAMED_PARAM(addValue, 0_to_1000, 10, 0, 1000)
 BENCHMARK_NAMED_PARAM(addValue, 5k_to_20k, 250, 5000, 20000)
 
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(addValueInt, 64, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesInt, 64, 64)
+BENCHMARK_NAMED_PARAM(addValueInt, 4k, 4096)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesInt, 4k, 4096)
+BENCHMARK_NAMED_PARAM(addValueInt, 1m, 1 << 20)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesInt, 1m, 1 << 20)
+
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(addValueDouble, 64, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesDouble, 64, 64)
+BENCHMARK_NAMED_PARAM(addValueDouble, 4k, 4096)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesDouble, 4k, 4096)
+BENCHMARK_NAMED_PARAM(addValueDouble, 1m, 1 << 20)
+BENCHMARK_RELATIVE_NAMED_PARAM(addValuesDouble, 1m, 1 << 20)
+
 int main(int argc, char* argv[]) {
   folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::runBenchmarks();
@@ -16,6 +16,11 @@
 
 #include <folly/stats/Histogram.h>
 
+#include <limits>
+#include <random>
+#include <tuple>
+#include <vector>
+
 #include <folly/portability/GTest.h>
 
 using folly::Histogram;
@@ -221,3 +226,80 @@ TEST(Histogram, Counts) {
   }
   EXPECT_EQ(110, h.computeTotalCount());
 }
+
+namespace {
+// Checks that addValues() puts every value in the same bucket as addValue().
+template <typename T>
+void checkAddValues(T bucketSize, T min, T max, const std::vector<T>& values) {
+  Histogram<T> expected(bucketSize, min, max);
+  for (auto value : values) {
+    expected.addValue(value);
+  }
+  Histogram<T> actual(bucketSize, min, max);
+  actual.addValues(values);
+  ASSERT_EQ(expected.getNumBuckets(), actual.getNumBuckets());
+  for (size_t i = 0; i < expected.getNumBuckets(); ++i) {
+    EXPECT_EQ(
+        expected.getBucketByIndex(i).count, actual.getBucketByIndex(i).count)
+        << i;
+    EXPECT_EQ(expected.getBucketByIndex(i).sum, actual.getBucketByIndex(i).sum)
+        << i;
+  }
+}
+} // namespace
+
+TEST(Histogram, AddValues) {
+  std::mt19937_64 gen(0);
+  for (auto [bucketSize, min, max] :
+       {std::tuple<int64_t, int64_t, int64_t>{1, 0, 100},
+        {7, -100, 1000},
+        {250, 5000, 20000},
+        {3, -3000, 0},
+        {1 << 20,
+         std::numeric_limits<int32_t>::min(),
+         std::numeric_limits<int32_t>::max()},
+        {12345, 0, int64_t(1) << 32},
+        {1 << 20, 0, int64_t(1) << 40},
+        {int64_t(1) << 32, -(int64_t(1) << 32), int64_t(1) << 32}}) {
+    std::vector<int64_t> values;
+    auto range = max - min;
+    std::uniform_int_distribution<int64_t> dist(
+        min - range / 4, max + range / 4);
+    for (int i = 0; i < 10000; ++i) {
+      values.push_back(dist(gen));
+    }
+    // Bucket boundaries and the extremes of the type.
+    for (int64_t v = min; v <= max && v - min < 20 * bucketSize;
+         v += bucketSize) {
+      values.push_back(v - 1);
+      values.push_back(v);
+    }
+    values.push_back(std::numeric_limits<int64_t>::min());
+    values.push_back(std::numeric_limits<int64_t>::max());
+    checkAddValues<int64_t>(bucketSize, min, max, values);
+  }
+
+  std::vector<uint32_t> unsignedValues;
+  for (uint32_t i = 0; i < 5000; ++i) {
+    unsignedValues.push_back(i * 999983u);
+  }
+  checkAddValues<uint32_t>(10, 100, 100000, unsignedValues);
+
+  std::vector<int16_t> shortValues;
+  for (int i = -32768; i < 32768; i += 7) {
+    shortValues.push_back(int16_t(i));
+  }
+  checkAddValues<int16_t>(13, -1000, 1000, shortValues);
+
+  std::vector<double> doubleValues;
+  std::uniform_real_distribution<double> dist(-10.0, 60.0);
+  for (int i = 0; i < 10000; ++i) {
+    doubleValues.push_back(dist(gen));
+  }
+  for (int i = 0; i <= 500; ++i) {
+    doubleValues.push_back(i * 0.1);
+  }
+  doubleValues.push_back(std::numeric_limits<double>::infinity());
+  doubleValues.push_back(-std::numeric_limits<double>::infinity());
+  checkAddValues<double>(0.1, 0.0, 49.7, doubleValues);
+}
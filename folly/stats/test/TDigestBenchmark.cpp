@@ -150,6 +150,33 @@ void estimateQuantile(unsigned int iters, size_t maxSize, double quantile) {
   }
 }
 
+// Per-sample cost of merging batches of batchSize unsorted values into a
+// digest, as done by DigestBuilder.
+void mergeBatch(unsigned int iters, size_t maxSize, size_t batchSize) {
+  static const auto pool = [] {
+    std::vector<double> values;
+    std::default_random_engine generator;
+    std::lognormal_distribution<double> distribution(0.0, 1.0);
+    for (size_t i = 0; i < (1 << 20); ++i) {
+      values.push_back(distribution(generator));
+    }
+    return values;
+  }();
+
+  TDigest digest(maxSize);
+  size_t offset = 0;
+  for (size_t done = 0; done < iters;) {
+    auto size = std::min<size_t>(batchSize, iters - done);
+    if (offset + size > pool.size()) {
+      offset = 0;
+    }
+    digest = digest.merge(folly::Range<const double*>(&pool[offset], size));
+    offset += size;
+    done += size;
+  }
+  folly::doNotOptimizeAway(digest);
+}
+
 BENCHMARK_NAMED_PARAM(addValueMultithreaded, 1, 1)
 BENCHMARK_NAMED_PARAM(addValueMultithreaded, 2, 2)
 BENCHMARK_NAMED_PARAM(addValueMultithreaded, 4, 4)
@@ -165,6 +192,12 @@ BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x1, 1000, 1000)
 BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x5, 1000, 5000)
 BENCHMARK_RELATIVE_NAMED_PARAM(merge, 1000x10, 1000, 10000)
 
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mergeBatch, 100x64, 100, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(mergeBatch, 100x1k, 100, 1000)
+BENCHMARK_RELATIVE_NAMED_PARAM(mergeBatch, 100x16k, 100, 16 << 10)
+BENCHMARK_RELATIVE_NAMED_PARAM(mergeBatch, 100x1m, 100, 1 << 20)
+
 BENCHMARK_DRAW_LINE();
 BENCHMARK_NAMED_PARAM(mergeDigests, 100x10, 100, 10)
 BENCHMARK_RELATIVE_NAMED_PARAM(mergeDigests, 100x30, 100, 30)
@@ -16,6 +16,7 @@
 
 #include <folly/stats/TDigest.h>
 
+#include <algorithm>
 #include <chrono>
 #include <random>
 
@@ -125,6 +126,41 @@ TEST(TDigest, MergeLarge) {
   EXPECT_EQ(999.5, digest.estimateQuantile(0.999));
 }
 
+// Values equal to the means of existing centroids, and long runs of values
+// between two centroids.
+TEST(TDigest, MergeValuesAroundCentroids) {
+  TDigest digest(100);
+
+  std::vector<double> values;
+  for (int i = 1; i <= 50; ++i) {
+    values.push_back(i * 20);
+  }
+  digest = digest.merge(values);
+
+  values.clear();
+  for (int i = 1; i <= 1000; ++i) {
+    values.push_back(i);
+  }
+  digest = digest.merge(values);
+
+  EXPECT_EQ(1050, digest.count());
+  EXPECT_EQ(500500 + 25500, digest.sum());
+  EXPECT_EQ(1, digest.min());
+  EXPECT_EQ(1000, digest.max());
+  EXPECT_LE(digest.getCentroids().size(), 100);
+  EXPECT_TRUE(std::is_sorted(
+      digest.getCentroids().begin(), digest.getCentroids().end()));
+  double weight = 0;
+  for (const auto& centroid : digest.getCentroids()) {
+    weight += centroid.weight();
+  }
+  EXPECT_EQ(1050, weight);
+
+  EXPECT_NEAR(10, digest.estimateQuantile(0.01), 1);
+  EXPECT_NEAR(500, digest.estimateQuantile(0.5), 5);
+  EXPECT_NEAR(990, digest.estimateQuantile(0.99), 2);
+}
+
 TEST(TDigest, MergeLargeAsDigests) {
   std::vector<TDigest> digests;
   TDigest digest(100);
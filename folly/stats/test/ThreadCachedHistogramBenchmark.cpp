@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ThreadCachedHistogram.h>
+
+#include <atomic>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Synchronized.h>
+#include <folly/portability/GFlags.h>
+#include <folly/stats/QuantileHistogram.h>
+
+/*
+ * Cost of recording a latency sample from nThreads threads into a shared
+ * histogram.  Each iteration is one addValue() on one thread.
+ */
+
+namespace {
+
+constexpr size_t kNumValues = 512;
+
+std::vector<double> makeValues(size_t seed) {
+  std::default_random_engine generator(seed);
+  std::lognormal_distribution<double> dist(3.0, 1.0);
+  std::vector<double> values;
+  values.reserve(kNumValues);
+  for (size_t i = 0; i < kNumValues; i++) {
+    values.push_back(dist(generator));
+  }
+  return values;
+}
+
+template <typename AddFn>
+void runThreads(unsigned int iters, size_t nThreads, const AddFn& addFn) {
+  std::vector<std::vector<double>> valuesPerThread;
+  BENCHMARK_SUSPEND {
+    for (size_t t = 0; t < nThreads; t++) {
+      valuesPerThread.push_back(makeValues(t));
+    }
+  }
+
+  std::atomic<int> remainingBatches{static_cast<int>(iters / kNumValues)};
+  std::vector<std::thread> threads(nThreads);
+  for (size_t threadIndex = 0; threadIndex < nThreads; threadIndex++) {
+    threads[threadIndex] = std::thread(
+        [&](size_t index) {
+          while (remainingBatches.fetch_sub(1, std::memory_order_acq_rel) > 0) {
+            for (const auto v : valuesPerThread[index]) {
+              addFn(v);
+            }
+          }
+        },
+        threadIndex);
+  }
+
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+void mutexHistogram(unsigned int iters, size_t nThreads) {
+  folly::Synchronized<folly::Histogram<double>, std::mutex> hist(
+      std::in_place, 10.0, 0.0, 1000.0);
+  runThreads(iters, nThreads, [&](double v) { hist.lock()->addValue(v); });
+  folly::doNotOptimizeAway(hist.lock()->computeTotalCount());
+}
+
+void threadCachedHistogram(unsigned int iters, size_t nThreads) {
+  folly::ThreadCachedHistogram<double> hist(10.0, 0.0, 1000.0);
+  runThreads(iters, nThreads, [&](double v) { hist.addValue(v); });
+  folly::doNotOptimizeAway(hist.snapshot().count);
+}
+
+void cpuShardedQuantileHistogram(unsigned int iters, size_t nThreads) {
+  folly::CPUShardedQuantileHistogram<> hist;
+  runThreads(iters, nThreads, [&](double v) { hist.addValue(v); });
+  folly::doNotOptimizeAway(hist.count());
+}
+
+// Cost of aggregating the shards of nThreads live threads.
+void snapshot(unsigned int iters, size_t nThreads) {
+  folly::ThreadCachedHistogram<double> hist(10.0, 0.0, 1000.0);
+  std::atomic<size_t> ready{0};
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  BENCHMARK_SUSPEND {
+    for (size_t t = 0; t < nThreads; t++) {
+      threads.emplace_back([&] {
+        for (const auto v : makeValues(0)) {
+          hist.addValue(v);
+        }
+        ready.fetch_add(1);
+        while (!stop.load()) {
+          std::this_thread::yield();
+        }
+      });
+    }
+    while (ready.load() < nThreads) {
+      std::this_thread::yield();
+    }
+  }
+
+  for (unsigned int i = 0; i < iters; ++i) {
+    folly::doNotOptimizeAway(hist.snapshot().count);
+  }
+
+  BENCHMARK_SUSPEND {
+    stop.store(true);
+    for (auto& th : threads) {
+      th.join();
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(mutexHistogram, 1thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedHistogram, 1thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(cpuShardedQuantileHistogram, 1thread, 1)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexHistogram, 4threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedHistogram, 4threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(cpuShardedQuantileHistogram, 4threads, 4)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexHistogram, 16threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedHistogram, 16threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(cpuShardedQuantileHistogram, 16threads, 16)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexHistogram, 32threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedHistogram, 32threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(cpuShardedQuantileHistogram, 32threads, 32)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(snapshot, 1thread, 1)
+BENCHMARK_NAMED_PARAM(snapshot, 16threads, 16)
+BENCHMARK_NAMED_PARAM(snapshot, 64threads, 64)
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ThreadCachedHistogram.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::Histogram;
+using folly::ThreadCachedHistogram;
+
+TEST(ThreadCachedHistogram, MatchesHistogram) {
+  ThreadCachedHistogram<int64_t> tch(10, 0, 100);
+  Histogram<int64_t> h(10, 0, 100);
+  for (int64_t i = -20; i < 130; i += 3) {
+    tch.addValue(i);
+    h.addValue(i);
+  }
+
+  auto snap = tch.snapshot();
+  ASSERT_EQ(h.getNumBuckets(), snap.histogram.getNumBuckets());
+  int64_t sum = 0;
+  for (size_t i = 0; i < h.getNumBuckets(); ++i) {
+    const auto& bucket = snap.histogram.getBucketByIndex(i);
+    EXPECT_EQ(h.getBucketByIndex(i).count, bucket.count);
+    EXPECT_EQ(h.getBucketByIndex(i).sum, bucket.sum);
+    sum += h.getBucketByIndex(i).sum;
+  }
+  EXPECT_EQ(h.computeTotalCount(), snap.count);
+  EXPECT_EQ(sum, snap.sum);
+  EXPECT_EQ(-20, snap.min);
+  EXPECT_EQ(127, snap.max);
+  EXPECT_EQ(
+      h.getPercentileEstimate(0.5), snap.histogram.getPercentileEstimate(0.5));
+}
+
+TEST(ThreadCachedHistogram, Empty) {
+  ThreadCachedHistogram<double> tch(1.0, 0.0, 10.0);
+  auto snap = tch.snapshot();
+  EXPECT_EQ(0u, snap.count);
+  EXPECT_EQ(0.0, snap.sum);
+  EXPECT_EQ(0u, snap.histogram.computeTotalCount());
+}
+
+TEST(ThreadCachedHistogram, ExitedThreadsAreKept) {
+  ThreadCachedHistogram<double> tch(1.0, 0.0, 10.0);
+  constexpr int kThreads = 8;
+  constexpr int kPerThread = 1000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        tch.addValue(t + 0.5);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  tch.addValue(-1.0);
+
+  auto snap = tch.snapshot();
+  EXPECT_EQ(uint64_t(kThreads * kPerThread + 1), snap.count);
+  EXPECT_EQ(-1.0, snap.min);
+  EXPECT_EQ(kThreads - 0.5, snap.max);
+  for (int t = 0; t < kThreads; ++t) {
+    // bucket 0 holds values below the minimum
+    auto& bucket = snap.histogram.getBucketByIndex(t + 1);
+    EXPECT_EQ(uint64_t(kPerThread), bucket.count);
+    EXPECT_DOUBLE_EQ(kPerThread * (t + 0.5), bucket.sum);
+  }
+}
+
+TEST(ThreadCachedHistogram, ConcurrentSnapshots) {
+  ThreadCachedHistogram<int64_t> tch(1, 0, 16);
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 100000;
+  std::atomic<int> done{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        tch.addValue(t);
+      }
+      done.fetch_add(1);
+    });
+  }
+  uint64_t last = 0;
+  while (done.load() < kThreads) {
+    auto snap = tch.snapshot();
+    // Counts only ever grow, whether threads are running or have exited.
+    EXPECT_LE(last, snap.count);
+    last = snap.count;
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto snap = tch.snapshot();
+  EXPECT_EQ(uint64_t(kThreads * kPerThread), snap.count);
+  EXPECT_EQ(int64_t(kPerThread) * (0 + 1 + 2 + 3), snap.sum);
+}
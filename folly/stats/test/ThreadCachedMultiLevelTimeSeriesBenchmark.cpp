@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ThreadCachedMultiLevelTimeSeries.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Synchronized.h>
+#include <folly/portability/GFlags.h>
+
+/*
+ * Cost of adding a value to a shared minute/hour/all-time series from
+ * nThreads threads.  Each iteration is one addValue() on one thread.  Time
+ * advances by one second every kValuesPerSecond values of a thread.
+ */
+
+namespace {
+
+using TimeSeries = folly::MultiLevelTimeSeries<int64_t>;
+using ThreadCachedTimeSeries = folly::ThreadCachedMultiLevelTimeSeries<int64_t>;
+using TimePoint = TimeSeries::TimePoint;
+
+constexpr int kValuesPerSecond = 512;
+
+const std::initializer_list<TimeSeries::Duration> kDurations = {
+    std::chrono::minutes(1), std::chrono::hours(1), std::chrono::seconds(0)};
+
+template <typename AddFn>
+void runThreads(unsigned int iters, size_t nThreads, const AddFn& addFn) {
+  std::atomic<int> remainingBatches{static_cast<int>(iters / kValuesPerSecond)};
+  std::vector<std::thread> threads(nThreads);
+  for (size_t threadIndex = 0; threadIndex < nThreads; threadIndex++) {
+    threads[threadIndex] = std::thread([&] {
+      int64_t second = 0;
+      while (remainingBatches.fetch_sub(1, std::memory_order_acq_rel) > 0) {
+        const TimePoint now{std::chrono::seconds(second++)};
+        for (int64_t i = 0; i < kValuesPerSecond; i++) {
+          addFn(now, i);
+        }
+      }
+    });
+  }
+
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+void mutexTimeSeries(unsigned int iters, size_t nThreads) {
+  folly::Synchronized<TimeSeries, std::mutex> series(
+      std::in_place, 60, kDurations);
+  runThreads(iters, nThreads, [&](TimePoint now, int64_t v) {
+    series.lock()->addValue(now, v);
+  });
+  folly::doNotOptimizeAway(series.lock()->count(2));
+}
+
+void threadCachedTimeSeries(unsigned int iters, size_t nThreads) {
+  ThreadCachedTimeSeries series(60, kDurations);
+  runThreads(iters, nThreads, [&](TimePoint now, int64_t v) {
+    series.addValue(now, v);
+  });
+  folly::doNotOptimizeAway(series.count(2));
+}
+
+// Cost of reading a level while nThreads live threads hold unread values.
+// Before every read, each thread adds a new value to its shard.
+void readLevel(unsigned int iters, size_t nThreads) {
+  ThreadCachedTimeSeries series(60, kDurations);
+  std::atomic<size_t> round{0};
+  std::atomic<size_t> added{0};
+  std::atomic<bool> stop{false};
+  std::vector<std::thread> threads;
+  BENCHMARK_SUSPEND {
+    for (size_t t = 0; t < nThreads; t++) {
+      threads.emplace_back([&] {
+        size_t seen = 0;
+        while (true) {
+          size_t current;
+          while ((current = round.load()) == seen && !stop.load()) {
+            std::this_thread::yield();
+          }
+          if (stop.load()) {
+            break;
+          }
+          seen = current;
+          series.addValue(TimePoint(), 1);
+          added.fetch_add(1);
+        }
+      });
+    }
+  }
+
+  for (unsigned int i = 0; i < iters; ++i) {
+    BENCHMARK_SUSPEND {
+      round.fetch_add(1);
+      while (added.load() < nThreads * (i + 1)) {
+        std::this_thread::yield();
+      }
+    }
+    folly::doNotOptimizeAway(series.count(size_t(0)));
+  }
+
+  BENCHMARK_SUSPEND {
+    stop.store(true);
+    for (auto& th : threads) {
+      th.join();
+    }
+  }
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 1thread, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 1thread, 1)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 4threads, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 4threads, 4)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 16threads, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 16threads, 16)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 32threads, 32)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 32threads, 32)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 64threads, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 64threads, 64)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mutexTimeSeries, 128threads, 128)
+BENCHMARK_RELATIVE_NAMED_PARAM(threadCachedTimeSeries, 128threads, 128)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(readLevel, 1thread, 1)
+BENCHMARK_NAMED_PARAM(readLevel, 16threads, 16)
+BENCHMARK_NAMED_PARAM(readLevel, 128threads, 128)
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
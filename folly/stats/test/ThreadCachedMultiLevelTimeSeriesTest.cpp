@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/stats/ThreadCachedMultiLevelTimeSeries.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+
+using folly::MultiLevelTimeSeries;
+using folly::ThreadCachedMultiLevelTimeSeries;
+using std::chrono::hours;
+using std::chrono::minutes;
+using std::chrono::seconds;
+
+using TimeSeries = ThreadCachedMultiLevelTimeSeries<int64_t>;
+using TimePoint = TimeSeries::TimePoint;
+
+namespace {
+TimePoint at(int64_t s) {
+  return TimePoint(seconds(s));
+}
+
+void expectSameLevels(
+    const MultiLevelTimeSeries<int64_t>& expected, const TimeSeries& actual) {
+  ASSERT_EQ(expected.numLevels(), actual.numLevels());
+  for (size_t level = 0; level < expected.numLevels(); ++level) {
+    EXPECT_EQ(expected.sum(level), actual.sum(level)) << level;
+    EXPECT_EQ(expected.count(level), actual.count(level)) << level;
+    EXPECT_EQ(expected.rate(level), actual.rate(level)) << level;
+  }
+}
+} // namespace
+
+TEST(ThreadCachedMultiLevelTimeSeries, MatchesMultiLevelTimeSeries) {
+  TimeSeries tcts(60, {minutes(1), hours(1), seconds(0)});
+  MultiLevelTimeSeries<int64_t> mlts(60, {minutes(1), hours(1), seconds(0)});
+  // Read at irregular intervals, sometimes after more distinct time points
+  // than fit in a shard.
+  int64_t value = 0;
+  for (int64_t t = 0; t < 7200; t += 7) {
+    for (int i = 0; i < 3; ++i) {
+      tcts.addValue(at(t), ++value);
+      mlts.addValue(at(t), value);
+    }
+    tcts.addValue(at(t), 5, 4);
+    mlts.addValue(at(t), 5, 4);
+    tcts.addValueAggregated(at(t), 100, 10);
+    mlts.addValueAggregated(at(t), 100, 10);
+    if (t % 13 == 0 || t % 250 == 0) {
+      tcts.update(at(t));
+      mlts.update(at(t));
+      expectSameLevels(mlts, tcts);
+    }
+  }
+  tcts.update(at(7300));
+  mlts.update(at(7300));
+  expectSameLevels(mlts, tcts);
+  EXPECT_EQ(mlts.sum(minutes(1)), tcts.sum(minutes(1)));
+  EXPECT_EQ(mlts.count(hours(1)), tcts.count(hours(1)));
+  EXPECT_EQ(mlts.avg(hours(1)), tcts.avg(hours(1)));
+
+  auto snap = tcts.snapshot();
+  EXPECT_EQ(mlts.sum(at(7000), at(7300)), snap.sum(at(7000), at(7300)));
+  EXPECT_EQ(mlts.getLevel(0).getLatestTime(), snap.getLevel(0).getLatestTime());
+}
+
+TEST(ThreadCachedMultiLevelTimeSeries, Empty) {
+  TimeSeries tcts(60, {minutes(1), seconds(0)});
+  tcts.update(at(100));
+  EXPECT_EQ(0, tcts.sum(size_t(0)));
+  EXPECT_EQ(0u, tcts.count(size_t(1)));
+  EXPECT_EQ(0.0, tcts.avg(seconds(0)));
+}
+
+TEST(ThreadCachedMultiLevelTimeSeries, Clear) {
+  TimeSeries tcts(60, {minutes(1), seconds(0)});
+  tcts.addValue(at(1), 10);
+  tcts.flush();
+  tcts.addValue(at(2), 20);
+  tcts.clear();
+  tcts.update(at(3));
+  EXPECT_EQ(0, tcts.sum(seconds(0)));
+  EXPECT_EQ(0u, tcts.count(seconds(0)));
+
+  tcts.addValue(at(4), 30);
+  tcts.update(at(4));
+  EXPECT_EQ(30, tcts.sum(seconds(0)));
+  EXPECT_EQ(1u, tcts.count(seconds(0)));
+}
+
+TEST(ThreadCachedMultiLevelTimeSeries, ExitedThreadsAreKept) {
+  TimeSeries tcts(60, {minutes(1), hours(1), seconds(0)});
+  constexpr int kThreads = 8;
+  // More distinct time points than fit in a shard.
+  constexpr int kSeconds = 5 * TimeSeries::kNumPendingTimes;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int s = 0; s < kSeconds; ++s) {
+        tcts.addValue(at(s), t, 10);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  MultiLevelTimeSeries<int64_t> mlts(60, {minutes(1), hours(1), seconds(0)});
+  for (int s = 0; s < kSeconds; ++s) {
+    for (int t = 0; t < kThreads; ++t) {
+      mlts.addValue(at(s), t, 10);
+    }
+  }
+  tcts.update(at(kSeconds - 1));
+  mlts.update(at(kSeconds - 1));
+  expectSameLevels(mlts, tcts);
+  EXPECT_EQ(uint64_t(kThreads * kSeconds * 10), tcts.count(seconds(0)));
+  // The minute level only has the last 60 seconds.
+  EXPECT_GT(tcts.count(seconds(0)), tcts.count(minutes(1)));
+}
+
+TEST(ThreadCachedMultiLevelTimeSeries, ConcurrentReads) {
+  TimeSeries tcts(60, {minutes(1), seconds(0)});
+  constexpr int kThreads = 4;
+  constexpr int kPerThread = 100000;
+  std::atomic<int> done{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kPerThread; ++i) {
+        // Advance time every 1000 values.
+        tcts.addValue(at(i / 1000), t);
+      }
+      done.fetch_add(1);
+    });
+  }
+  uint64_t last = 0;
+  while (done.load() < kThreads) {
+    // The all-time count only ever grows.
+    auto count = tcts.count(seconds(0));
+    EXPECT_LE(last, count);
+    last = count;
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  tcts.update(at(kPerThread / 1000));
+  EXPECT_EQ(uint64_t(kThreads * kPerThread), tcts.count(seconds(0)));
+  EXPECT_EQ(int64_t(kPerThread) * (0 + 1 + 2 + 3), tcts.sum(seconds(0)));
+  EXPECT_EQ(uint64_t(kThreads * 59 * 1000), tcts.count(minutes(1)));
+}
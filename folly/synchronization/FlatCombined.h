@@ -0,0 +1,462 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+
+#include <folly/Portability.h>
+#include <folly/Traits.h>
+#include <folly/Try.h>
+#include <folly/Unit.h>
+#include <folly/concurrency/CacheLocality.h>
+#include <folly/functional/Invoke.h>
+#include <folly/portability/Asm.h>
+#include <folly/synchronization/ParkingLot.h>
+
+namespace folly {
+
+/// FlatCombined<T> makes an arbitrary sequential data structure T
+/// thread-safe using flat combining (see FlatCombining.h for background),
+/// without requiring the user to write request records or a combining
+/// loop.
+///
+/// Operations are submitted as callables that receive a T&:
+///
+///   folly::FlatCombined<std::map<int, int>> map;
+///   map.apply([&](auto& m) { m[key] = value; });
+///   auto found = map.apply([&](auto& m) { return m.count(key) != 0; });
+///
+/// If the lock is free the operation runs immediately on the calling
+/// thread. Otherwise it is published on a lock-free list and the thread
+/// currently holding the lock (the combiner) runs it on the caller's
+/// behalf, so that a burst of operations is executed back to back by one
+/// thread while T stays hot in its cache. Results and exceptions are
+/// transferred back to the caller, which waits for its operation to
+/// complete: first by spinning for an adaptively chosen period and then by
+/// parking on a ParkingLot. A waiting thread that finds the lock free
+/// becomes the combiner itself.
+///
+/// Operations of the same kind can additionally be coalesced into a single
+/// call with applyBatched(). A Batcher is a default-constructible callable
+/// with nested arg_type and result_type types that is invoked by the
+/// combiner with all pending applyBatched<Batcher>() calls at once, e.g. to
+/// replace many push() calls with one bulk insertion:
+///
+///   struct PushAll {
+///     using arg_type = int;
+///     using result_type = void;
+///     template <typename Batch>
+///     void operator()(std::vector<int>& v, Batch& batch) const {
+///       v.reserve(v.size() + batch.size());
+///       for (auto& item : batch) {
+///         v.push_back(item.arg());
+///       }
+///     }
+///   };
+///   vec.applyBatched<PushAll>(42);
+///
+/// For a non-void result_type, the batcher must call item.setResult() for
+/// each item. If the batcher throws, the exception is rethrown by every
+/// applyBatched() call in the batch.
+///
+/// All operations that are pending at the same time are concurrent, so the
+/// combiner may reorder them, e.g. to group them by kind. Operations
+/// submitted by the same thread are never reordered. Callables and batchers
+/// run on an arbitrary thread and must not rely on thread-local state.
+template <typename T, typename Mutex = std::mutex>
+class FlatCombined {
+  struct Request;
+
+ public:
+  template <typename Batcher>
+  class Batch;
+
+  FlatCombined() = default;
+
+  template <typename... Args>
+  explicit FlatCombined(std::in_place_t, Args&&... args)
+      : data_(std::forward<Args>(args)...) {}
+
+  FlatCombined(const FlatCombined&) = delete;
+  FlatCombined& operator=(const FlatCombined&) = delete;
+
+  /// Runs func(T&) with exclusive access to the data structure and returns
+  /// its result, or rethrows the exception it threw. func may run on
+  /// another thread.
+  template <typename Func>
+  invoke_result_t<Func&, T&> apply(Func&& func) {
+    using Result = invoke_result_t<Func&, T&>;
+    static_assert(
+        !std::is_reference<Result>::value,
+        "FlatCombined::apply() cannot return a reference into the data "
+        "structure");
+    SimpleOp<std::remove_reference_t<Func>> op{func, {}};
+    Request req{&executeSimple<std::remove_reference_t<Func>>, &op};
+    submit(req);
+    return std::move(op.result).value();
+  }
+
+  /// Submits arg to be processed by a call of Batcher together with the
+  /// arguments of other pending applyBatched<Batcher>() calls, and returns
+  /// the result that the batcher set for it.
+  template <typename Batcher>
+  typename Batcher::result_type applyBatched(
+      typename Batcher::arg_type arg) {
+    typename Batch<Batcher>::Item item(std::move(arg));
+    Request req{&executeBatch<Batcher>, &item};
+    submit(req);
+    return std::move(item.result_).value();
+  }
+
+  /// Returns the number of operations executed by a combiner on behalf of
+  /// other threads so far.
+  uint64_t getNumCombined() const {
+    return numCombined_.load(std::memory_order_relaxed);
+  }
+
+  /// Returns the number of batches, i.e. groups of operations of the same
+  /// kind executed together, run by combiners so far.
+  uint64_t getNumBatches() const {
+    return numBatches_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  enum : uint32_t {
+    kWaiting, // published, owner spinning
+    kParked, // published, owner (about to be) parked
+    kCombine, // owner was asked to take the lock and combine
+    kDone, // completed; result available
+  };
+
+  // Max operations combined before the lock is handed to a waiter.
+  static constexpr uint64_t kMaxOpsPerSession = 256;
+  // Bounds of the adaptive spin phase, in pause iterations.
+  static constexpr uint32_t kMinSpins = 16;
+  static constexpr uint32_t kMaxSpins = 4096;
+  // How often a spinning waiter tries to become the combiner.
+  static constexpr uint32_t kTryLockInterval = 64;
+
+  struct Request {
+    // Runs the chain of requests starting at this one, linked by next,
+    // which all have the same execute function.
+    void (*execute)(T&, Request*);
+    void* op;
+    Request* next = nullptr;
+    std::atomic<uint32_t> state{kWaiting};
+
+    Request(void (*fn)(T&, Request*), void* p) : execute(fn), op(p) {}
+  };
+
+  template <typename Func>
+  struct SimpleOp {
+    Func& func;
+    Try<invoke_result_t<Func&, T&>> result;
+  };
+
+  template <typename Func>
+  static void executeSimple(T& data, Request* chain) {
+    for (auto req = chain; req != nullptr; req = req->next) {
+      auto& op = *static_cast<SimpleOp<Func>*>(req->op);
+      op.result = makeTryWith([&] { return op.func(data); });
+    }
+  }
+
+  template <typename Batcher>
+  static void executeBatch(T& data, Request* chain) {
+    Batch<Batcher> batch(chain);
+    try {
+      Batcher{}(data, batch);
+    } catch (...) {
+      auto ew = exception_wrapper(std::current_exception());
+      for (auto& item : batch) {
+        item.result_.emplaceException(ew);
+      }
+    }
+  }
+
+  void submit(Request& req) {
+    if (m_.try_lock()) {
+      // Uncontended: run the operation right away.
+      req.execute(data_, &req);
+      combineAndUnlock();
+      return;
+    }
+    auto head = pending_.load(std::memory_order_relaxed);
+    do {
+      req.next = head;
+    } while (!pending_.compare_exchange_weak(
+        head, &req, std::memory_order_release, std::memory_order_relaxed));
+    // Order the publication before checking the lock below, against the
+    // unlock-then-check-pending_ order in combineAndUnlock().
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    await(req);
+  }
+
+  void await(Request& req) {
+    const uint32_t estimate = spins_.load(std::memory_order_relaxed);
+    const uint32_t limit = std::min(kMaxSpins, 2 * estimate + kMinSpins);
+    for (uint32_t i = 0; i < limit; ++i) {
+      auto state = req.state.load(std::memory_order_acquire);
+      if (state == kDone) {
+        // Spin for about twice as long as recent waits that completed while
+        // spinning.
+        spins_.store(
+            uint32_t(int32_t(estimate) + (int32_t(i) - int32_t(estimate)) / 8),
+            std::memory_order_relaxed);
+        return;
+      }
+      if (state == kCombine) {
+        combine(req, false);
+        return;
+      }
+      if (i % kTryLockInterval == 0 && m_.try_lock()) {
+        combine(req, true);
+        return;
+      }
+      asm_volatile_pause();
+    }
+    // Waits are longer than spinning is worth; spin less next time.
+    spins_.store(estimate - estimate / 8, std::memory_order_relaxed);
+
+    while (true) {
+      auto state = req.state.load(std::memory_order_acquire);
+      if (state == kDone) {
+        return;
+      }
+      if (state == kCombine) {
+        combine(req, false);
+        return;
+      }
+      if (state == kWaiting) {
+        req.state.compare_exchange_strong(
+            state, kParked, std::memory_order_relaxed);
+        continue;
+      }
+      lot_.park(
+          &req,
+          Unit{},
+          [&] { return req.state.load(std::memory_order_acquire) == kParked; },
+          [] {});
+    }
+  }
+
+  // Combine on behalf of the waiting request req, which is either already
+  // done or pending and hence picked up by the first combining pass.
+  void combine(Request& req, bool locked) {
+    if (!locked) {
+      m_.lock();
+    }
+    combineAndUnlock();
+    assert(req.state.load(std::memory_order_acquire) == kDone);
+  }
+
+  // Runs pending requests, then releases the lock. Must be called with the
+  // lock held.
+  void combineAndUnlock() {
+    while (true) {
+      uint64_t ops = 0;
+      while (ops < kMaxOpsPerSession) {
+        auto list = pending_.exchange(nullptr, std::memory_order_acquire);
+        if (list == nullptr) {
+          break;
+        }
+        ops += combiningPass(list);
+      }
+      if (ops >= kMaxOpsPerSession) {
+        if (auto head = pending_.load(std::memory_order_acquire)) {
+          // Don't keep combining indefinitely; pass the lock on to the
+          // owner of a pending request. It stays pending until the new
+          // combiner's first pass, so its owner can't leave in between.
+          wake(*head, kCombine);
+          m_.unlock();
+          return;
+        }
+      }
+      m_.unlock();
+      // A request published after the exchange above, whose owner saw the
+      // lock held, must be picked up by someone.
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (pending_.load(std::memory_order_relaxed) == nullptr ||
+          !m_.try_lock()) {
+        return;
+      }
+    }
+  }
+
+  uint64_t combiningPass(Request* list) {
+    // The list is LIFO; reverse it to run requests in arrival order.
+    Request* queue = nullptr;
+    uint64_t count = 0;
+    while (list != nullptr) {
+      auto next = list->next;
+      list->next = queue;
+      queue = list;
+      list = next;
+      ++count;
+    }
+    uint64_t batches = 0;
+    while (queue != nullptr) {
+      // Split off all requests of the same kind as the first one.
+      auto execute = queue->execute;
+      Request* batch = nullptr;
+      Request** batchTail = &batch;
+      Request* rest = nullptr;
+      Request** restTail = &rest;
+      for (auto req = queue; req != nullptr; req = req->next) {
+        if (req->execute == execute) {
+          *batchTail = req;
+          batchTail = &req->next;
+        } else {
+          *restTail = req;
+          restTail = &req->next;
+        }
+      }
+      *batchTail = nullptr;
+      *restTail = nullptr;
+
+      execute(data_, batch);
+      ++batches;
+      while (batch != nullptr) {
+        // The owner may return as soon as the request is done.
+        auto next = batch->next;
+        wake(*batch, kDone);
+        batch = next;
+      }
+      queue = rest;
+    }
+    numCombined_.store(
+        numCombined_.load(std::memory_order_relaxed) + count,
+        std::memory_order_relaxed);
+    numBatches_.store(
+        numBatches_.load(std::memory_order_relaxed) + batches,
+        std::memory_order_relaxed);
+    return count;
+  }
+
+  void wake(Request& req, uint32_t state) {
+    if (req.state.exchange(state, std::memory_order_acq_rel) == kParked) {
+      lot_.unpark(&req, [](Unit) { return UnparkControl::RemoveBreak; });
+    }
+  }
+
+  alignas(hardware_destructive_interference_size) Mutex m_;
+  T data_;
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<Request*> pending_{nullptr};
+
+  alignas(hardware_destructive_interference_size)
+      std::atomic<uint32_t> spins_{0};
+  // Written only while holding m_.
+  std::atomic<uint64_t> numCombined_{0};
+  std::atomic<uint64_t> numBatches_{0};
+  ParkingLot<> lot_;
+};
+
+/// The view of pending applyBatched<Batcher>() calls passed to Batcher.
+template <typename T, typename Mutex>
+template <typename Batcher>
+class FlatCombined<T, Mutex>::Batch {
+ public:
+  using arg_type = typename Batcher::arg_type;
+  using result_type = typename Batcher::result_type;
+
+  class Item {
+   public:
+    arg_type& arg() { return arg_; }
+
+    template <typename... Args>
+    void setResult(Args&&... args) {
+      result_.emplace(std::forward<Args>(args)...);
+    }
+
+   private:
+    friend class FlatCombined;
+
+    explicit Item(arg_type&& arg) : arg_(std::move(arg)) {}
+
+    arg_type arg_;
+    Try<result_type> result_;
+  };
+
+  class iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = Item;
+    using difference_type = std::ptrdiff_t;
+    using pointer = Item*;
+    using reference = Item&;
+
+    iterator() = default;
+
+    Item& operator*() const { return *static_cast<Item*>(req_->op); }
+    Item* operator->() const { return static_cast<Item*>(req_->op); }
+
+    iterator& operator++() {
+      req_ = req_->next;
+      return *this;
+    }
+
+    iterator operator++(int) {
+      auto prev = *this;
+      ++*this;
+      return prev;
+    }
+
+    friend bool operator==(const iterator& a, const iterator& b) {
+      return a.req_ == b.req_;
+    }
+    friend bool operator!=(const iterator& a, const iterator& b) {
+      return a.req_ != b.req_;
+    }
+
+   private:
+    friend class Batch;
+
+    explicit iterator(Request* req) : req_(req) {}
+
+    Request* req_ = nullptr;
+  };
+
+  iterator begin() const { return iterator(head_); }
+  iterator end() const { return iterator(); }
+
+  /// Number of calls in the batch, at least 1.
+  size_t size() const { return size_; }
+
+ private:
+  friend class FlatCombined;
+
+  explicit Batch(Request* head) : head_(head) {
+    for (auto req = head; req != nullptr; req = req->next) {
+      ++size_;
+    }
+  }
+
+  Request* head_;
+  size_t size_ = 0;
+};
+
+} // namespace folly
@@ -0,0 +1,175 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/FlatCombined.h>
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/Synchronized.h>
+#include <folly/container/F14Map.h>
+#include <folly/portability/GFlags.h>
+#include <folly/synchronization/DistributedMutex.h>
+
+DEFINE_int32(keys, 1 << 16, "number of distinct keys");
+
+/*
+ * Each iteration is one operation on a shared map by one of nThreads
+ * threads: half of them increment the counter of a random key, the other
+ * half look one up.
+ */
+
+namespace {
+
+using StdMap = std::map<uint64_t, uint64_t>;
+using F14Map = folly::F14FastMap<uint64_t, uint64_t>;
+
+template <typename OpFn>
+void runThreads(unsigned int iters, size_t nThreads, const OpFn& opFn) {
+  std::atomic<int64_t> remaining{static_cast<int64_t>(iters)};
+  std::vector<std::thread> threads(nThreads);
+  for (size_t t = 0; t < nThreads; t++) {
+    threads[t] = std::thread([&, t] {
+      std::minstd_rand rng(t);
+      constexpr int64_t kBatch = 64;
+      while (remaining.fetch_sub(kBatch, std::memory_order_relaxed) > 0) {
+        for (int64_t i = 0; i < kBatch; i++) {
+          auto r = rng();
+          opFn(r % FLAGS_keys, r & 1);
+        }
+      }
+    });
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+}
+
+template <typename Map>
+uint64_t lookup(const Map& m, uint64_t key) {
+  auto it = m.find(key);
+  return it == m.end() ? 0 : it->second;
+}
+
+template <typename Map>
+void synchronizedMutex(unsigned int iters, size_t nThreads, folly::tag_t<Map>) {
+  folly::Synchronized<Map, std::mutex> map;
+  runThreads(iters, nThreads, [&](uint64_t key, bool write) {
+    auto locked = map.lock();
+    if (write) {
+      ++(*locked)[key];
+    } else {
+      folly::doNotOptimizeAway(lookup(*locked, key));
+    }
+  });
+}
+
+template <typename Map>
+void distributedMutex(unsigned int iters, size_t nThreads, folly::tag_t<Map>) {
+  folly::DistributedMutex mutex;
+  Map map;
+  runThreads(iters, nThreads, [&](uint64_t key, bool write) {
+    if (write) {
+      mutex.lock_combine([&] { ++map[key]; });
+    } else {
+      folly::doNotOptimizeAway(
+          mutex.lock_combine([&] { return lookup(map, key); }));
+    }
+  });
+}
+
+template <typename Map>
+void flatCombined(unsigned int iters, size_t nThreads, folly::tag_t<Map>) {
+  folly::FlatCombined<Map> map;
+  runThreads(iters, nThreads, [&](uint64_t key, bool write) {
+    if (write) {
+      map.apply([&](Map& m) { ++m[key]; });
+    } else {
+      folly::doNotOptimizeAway(
+          map.apply([&](const Map& m) { return lookup(m, key); }));
+    }
+  });
+}
+
+template <typename Map>
+struct IncrementAll {
+  using arg_type = uint64_t;
+  using result_type = void;
+
+  template <typename Batch>
+  void operator()(Map& m, Batch& batch) const {
+    for (auto& item : batch) {
+      ++m[item.arg()];
+    }
+  }
+};
+
+template <typename Map>
+struct LookupAll {
+  using arg_type = uint64_t;
+  using result_type = uint64_t;
+
+  template <typename Batch>
+  void operator()(Map& m, Batch& batch) const {
+    for (auto& item : batch) {
+      item.setResult(lookup(m, item.arg()));
+    }
+  }
+};
+
+template <typename Map>
+void flatCombinedBatched(
+    unsigned int iters, size_t nThreads, folly::tag_t<Map>) {
+  folly::FlatCombined<Map> map;
+  runThreads(iters, nThreads, [&](uint64_t key, bool write) {
+    if (write) {
+      map.template applyBatched<IncrementAll<Map>>(key);
+    } else {
+      folly::doNotOptimizeAway(
+          map.template applyBatched<LookupAll<Map>>(key));
+    }
+  });
+}
+
+} // namespace
+
+#define BENCH_MAP(map, name, n)                                             \
+  BENCHMARK_NAMED_PARAM(synchronizedMutex, name, n, folly::tag<map>)        \
+  BENCHMARK_RELATIVE_NAMED_PARAM(distributedMutex, name, n, folly::tag<map>) \
+  BENCHMARK_RELATIVE_NAMED_PARAM(flatCombined, name, n, folly::tag<map>)     \
+  BENCHMARK_RELATIVE_NAMED_PARAM(                                           \
+      flatCombinedBatched, name, n, folly::tag<map>)                        \
+  BENCHMARK_DRAW_LINE();
+
+BENCH_MAP(StdMap, std_map_1thread, 1)
+BENCH_MAP(StdMap, std_map_4threads, 4)
+BENCH_MAP(StdMap, std_map_16threads, 16)
+BENCH_MAP(StdMap, std_map_32threads, 32)
+BENCH_MAP(F14Map, f14_map_1thread, 1)
+BENCH_MAP(F14Map, f14_map_4threads, 4)
+BENCH_MAP(F14Map, f14_map_16threads, 16)
+BENCH_MAP(F14Map, f14_map_32threads, 32)
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
@@ -0,0 +1,187 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/synchronization/FlatCombined.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <folly/portability/GTest.h>
+#include <folly/synchronization/Baton.h>
+
+using folly::FlatCombined;
+
+namespace {
+
+struct PushAll {
+  using arg_type = int;
+  using result_type = size_t; // the size of the vector after the push
+
+  static std::atomic<size_t> maxBatchSize;
+
+  template <typename Batch>
+  void operator()(std::vector<int>& v, Batch& batch) const {
+    size_t size = batch.size();
+    size_t prev = maxBatchSize.load();
+    while (prev < size && !maxBatchSize.compare_exchange_weak(prev, size)) {
+    }
+    v.reserve(v.size() + size);
+    for (auto& item : batch) {
+      v.push_back(item.arg());
+      item.setResult(v.size());
+    }
+  }
+};
+
+std::atomic<size_t> PushAll::maxBatchSize{0};
+
+struct Throwing {
+  using arg_type = int;
+  using result_type = void;
+
+  template <typename Batch>
+  void operator()(std::vector<int>&, Batch&) const {
+    throw std::runtime_error("batch");
+  }
+};
+
+} // namespace
+
+TEST(FlatCombined, Apply) {
+  FlatCombined<std::map<int, int>> map;
+  map.apply([](auto& m) { m[1] = 10; });
+  EXPECT_EQ(10, map.apply([](auto& m) { return m.at(1); }));
+  EXPECT_THROW(map.apply([](auto& m) { return m.at(2); }), std::out_of_range);
+  EXPECT_EQ(1u, map.apply([](const auto& m) { return m.size(); }));
+}
+
+TEST(FlatCombined, InPlace) {
+  FlatCombined<std::vector<int>> vec(std::in_place, 3, 7);
+  EXPECT_EQ(21, vec.apply([](auto& v) {
+    int sum = 0;
+    for (auto x : v) {
+      sum += x;
+    }
+    return sum;
+  }));
+}
+
+TEST(FlatCombined, ApplyBatched) {
+  FlatCombined<std::vector<int>> vec;
+  EXPECT_EQ(1u, vec.applyBatched<PushAll>(5));
+  EXPECT_EQ(2u, vec.applyBatched<PushAll>(6));
+  EXPECT_THROW(vec.applyBatched<Throwing>(7), std::runtime_error);
+  EXPECT_EQ(2u, vec.apply([](auto& v) { return v.size(); }));
+}
+
+TEST(FlatCombined, ConcurrentApply) {
+  FlatCombined<std::map<int, int>> map;
+  constexpr int kThreads = 8;
+  constexpr int kOps = 20000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      for (int i = 0; i < kOps; ++i) {
+        // Each thread sees its own updates in order.
+        int prev = map.apply([&](auto& m) { return m[t]++; });
+        ASSERT_EQ(i, prev);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  map.apply([&](auto& m) {
+    for (int t = 0; t < kThreads; ++t) {
+      EXPECT_EQ(kOps, m[t]);
+    }
+  });
+}
+
+TEST(FlatCombined, OperationsAreBatched) {
+  FlatCombined<std::vector<int>> vec;
+  constexpr int kThreads = 8;
+  PushAll::maxBatchSize = 0;
+  folly::Baton<> release;
+  std::atomic<bool> locked{false};
+  std::atomic<int> started{0};
+  std::thread holder([&] {
+    // Keep the lock until all other threads have published their pushes.
+    vec.apply([&](auto&) {
+      locked.store(true);
+      release.wait();
+    });
+  });
+  while (!locked.load()) {
+    std::this_thread::yield();
+  }
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&, t] {
+      started.fetch_add(1);
+      vec.applyBatched<PushAll>(t);
+    });
+  }
+  while (started.load() < kThreads) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  release.post();
+  holder.join();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  auto v = vec.apply([](auto& v) { return v; });
+  ASSERT_EQ(size_t(kThreads), v.size());
+  std::sort(v.begin(), v.end());
+  for (int t = 0; t < kThreads; ++t) {
+    EXPECT_EQ(t, v[t]);
+  }
+  EXPECT_GT(PushAll::maxBatchSize.load(), 1u);
+  EXPECT_LT(vec.getNumBatches(), vec.getNumCombined());
+}
+
+TEST(FlatCombined, ConcurrentApplyBatched) {
+  FlatCombined<std::vector<int>> vec;
+  constexpr int kThreads = 8;
+  constexpr int kOps = 10000;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kThreads; ++t) {
+    threads.emplace_back([&] {
+      size_t prev = 0;
+      for (int i = 0; i < kOps; ++i) {
+        if (i % 2) {
+          size_t size = vec.applyBatched<PushAll>(i);
+          EXPECT_LT(prev, size);
+          prev = size;
+        } else {
+          vec.apply([](auto& v) { v.push_back(-1); });
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(
+      size_t(kThreads * kOps), vec.apply([](auto& v) { return v.size(); }));
+}
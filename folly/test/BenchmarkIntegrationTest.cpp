@@ -17,6 +17,7 @@
 #include <folly/Benchmark.h>
 
 #include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <numeric>
 #include <random>
@@ -375,6 +376,24 @@ BENCHMARK(BenchmarkSuspender_dismissing_value, iter) {
   }
 }
 
+BENCHMARK_DRAW_LINE();
+
+std::atomic<uint64_t> sharedCounter;
+
+BENCHMARK_THREADS(threadsSharedCounter, 4, iter, thread) {
+  while (iter--) {
+    sharedCounter.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+BENCHMARK_THREADS(threadsIndependentWork, 4, iter, thread) {
+  uint64_t sum = thread.index;
+  while (iter--) {
+    sum = sum * 3 + 1;
+  }
+  doNotOptimizeAway(sum);
+}
+
 int main(int argc, char** argv) {
   folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
   folly::addBenchmark("-", std::string("string_name"), [] { return 0; });
@@ -15,7 +15,9 @@
  */
 
 #include <folly/Benchmark.h>
+#include <folly/detail/PerfCounters.h>
 #include <folly/detail/PerfScoped.h>
+#include <folly/json/dynamic.h>
 #include <folly/portability/GFlags.h>
 #include <folly/portability/GMock.h>
 #include <folly/portability/GTest.h>
@@ -23,6 +25,9 @@
 
 #include <algorithm>
 #include <filesystem>
+#include <map>
+#include <mutex>
+#include <set>
 
 namespace folly {
 namespace detail {
@@ -193,6 +198,163 @@ TEST_F(BenchmarkingStateTest, DiscardLines) {
   EXPECT_EQ(expected, state.runBenchmarksWithResults());
 }
 
+TEST_F(BenchmarkingStateTest, Threads) {
+  folly::gflags::SetCommandLineOption("bm_max_trials", "3");
+
+  std::mutex mutex;
+  std::map<size_t, std::set<size_t>> indices;
+  state.addBenchmarkThreads(
+      __FILE__, "2ns", 4, [&](unsigned int iters, const BenchmarkThread& t) {
+        std::lock_guard lock(mutex);
+        indices[t.numThreads].insert(t.index);
+        // The threads take turns, so there is no speedup.
+        TestClock::advance(std::chrono::nanoseconds(2 * iters));
+      });
+
+  const auto results = state.runBenchmarksWithResults();
+  ASSERT_EQ(3, results.size());
+  const std::vector<std::pair<std::string, int64_t>> expected{
+      {"2ns(1thread)", 1}, {"%2ns(2threads)", 2}, {"%2ns(4threads)", 4}};
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto& result = results[i];
+    const auto numThreads = expected[i].second;
+    EXPECT_EQ(expected[i].first, result.name);
+    // The baseline is 1ns, and suspending adds a small constant.
+    EXPECT_NEAR(1, result.timeInNs, 0.01);
+    EXPECT_EQ(UserMetric(numThreads), result.counters.at("threads"));
+    EXPECT_EQ(
+        UserMetric(100 / numThreads), result.counters.at("efficiency%"));
+    EXPECT_EQ(
+        UserMetric::Type::METRIC, result.counters.at("ops/s/thread").type);
+
+    std::set<size_t> all;
+    for (int64_t j = 0; j < numThreads; ++j) {
+      all.insert(j);
+    }
+    EXPECT_EQ(all, indices[numThreads]);
+  }
+}
+
+TEST_F(BenchmarkingStateTest, PerfCounters) {
+  folly::gflags::SetCommandLineOption("bm_perf_counters", "true");
+  folly::gflags::SetCommandLineOption("bm_max_trials", "3");
+
+  state.addBenchmark(__FILE__, "a", [&] {
+    doBaseline();
+    {
+      doSuspenderBaseline();
+      BenchmarkSuspender<TestClock> suspender;
+      TestClock::advance(std::chrono::microseconds(1));
+    }
+
+    TestClock::advance(std::chrono::nanoseconds(1));
+    return 1;
+  });
+  state.addBenchmarkThreads(
+      __FILE__, "b", 1, [&](unsigned int iters, const BenchmarkThread&) {
+        TestClock::advance(std::chrono::nanoseconds(2 * iters));
+      });
+
+  const auto results = state.runBenchmarksWithResults();
+  ASSERT_EQ(2, results.size());
+  EXPECT_NEAR(1, results[0].timeInNs, 0.01);
+  // The benchmarking thread doesn't run the body of BENCHMARK_THREADS.
+  EXPECT_FALSE(results[1].perfCounters.any());
+
+  PerfCounters perf;
+  SKIP_IF(!perf.available()) << perf.error();
+  EXPECT_TRUE(results[0].perfCounters.any());
+}
+
+TEST(LatencyDistributionTest, FromSamples) {
+  EXPECT_EQ(0, LatencyDistribution::fromSamples({}).samples);
+
+  std::vector<double> samples;
+  for (int i = 1000; i > 0; --i) {
+    samples.push_back(i);
+  }
+  auto latency = LatencyDistribution::fromSamples(std::move(samples));
+  EXPECT_EQ(1000, latency.samples);
+  EXPECT_EQ(500, latency.p50);
+  EXPECT_EQ(900, latency.p90);
+  EXPECT_EQ(990, latency.p99);
+  EXPECT_EQ(999, latency.p999);
+  EXPECT_EQ(1000, latency.max);
+  // About 1.96 * sqrt(1000) / 2 = 31 ranks around the median.
+  EXPECT_EQ(470, latency.p50Low);
+  EXPECT_EQ(532, latency.p50High);
+
+  latency = LatencyDistribution::fromSamples({7});
+  EXPECT_EQ(7, latency.p50Low);
+  EXPECT_EQ(7, latency.p50);
+  EXPECT_EQ(7, latency.p50High);
+  EXPECT_EQ(7, latency.max);
+}
+
+TEST(BenchmarkResultsTest, LatencyToDynamic) {
+  BenchmarkResult result{__FILE__, "a", 2, {}};
+  result.latency = LatencyDistribution::fromSamples({1, 2, 3, 4});
+
+  dynamic d;
+  benchmarkResultsToDynamic({result}, d);
+  ASSERT_EQ(6, d[0].size());
+  EXPECT_EQ(dynamic(dynamic::object), d[0][3]);
+  EXPECT_EQ(dynamic(dynamic::object), d[0][4]);
+  EXPECT_EQ(4, d[0][5]["samples"].asInt());
+  EXPECT_EQ(2, d[0][5]["p50"].asDouble());
+
+  std::vector<BenchmarkResult> parsed;
+  benchmarkResultsFromDynamic(d, parsed);
+  EXPECT_EQ(std::vector<BenchmarkResult>{result}, parsed);
+}
+
+TEST(BenchmarkResultsTest, PerfCountersToDynamic) {
+  BenchmarkResult result{__FILE__, "a", 2, {}};
+  result.perfCounters.cycles = 4;
+  result.perfCounters.instructions = 10;
+
+  dynamic d;
+  benchmarkResultsToDynamic({result}, d);
+  ASSERT_EQ(5, d[0].size());
+  EXPECT_EQ(dynamic(dynamic::object), d[0][3]);
+  EXPECT_EQ(
+      dynamic(dynamic::object("cycles", 4.0)("instructions", 10.0)), d[0][4]);
+
+  std::vector<BenchmarkResult> parsed;
+  benchmarkResultsFromDynamic(d, parsed);
+  EXPECT_EQ(std::vector<BenchmarkResult>{result}, parsed);
+
+  // Without hardware performance counters, results are unchanged.
+  benchmarkResultsToDynamic({{__FILE__, "a", 2, {}}}, d);
+  EXPECT_EQ(3, d[0].size());
+}
+
+TEST_F(BenchmarkingStateTest, Latency) {
+  folly::gflags::SetCommandLineOption("bm_latency", "true");
+  folly::gflags::SetCommandLineOption("bm_latency_samples", "1000");
+
+  // Calls take 1ns to 100ns, in turn.
+  unsigned int calls = 0;
+  state.addBenchmark(__FILE__, "a", [&] {
+    doBaseline();
+    TestClock::advance(std::chrono::nanoseconds(calls++ % 100 + 1));
+    return 1;
+  });
+
+  const auto results = state.runBenchmarksWithResults();
+  ASSERT_EQ(1, results.size());
+  const auto& latency = results[0].latency;
+  EXPECT_EQ(1000, latency.samples);
+  EXPECT_EQ(50, latency.p50);
+  EXPECT_EQ(90, latency.p90);
+  EXPECT_EQ(99, latency.p99);
+  EXPECT_EQ(100, latency.p999);
+  EXPECT_EQ(100, latency.max);
+  EXPECT_LT(latency.p50Low, 50);
+  EXPECT_GT(latency.p50High, 50);
+  EXPECT_NEAR(50.5, results[0].timeInNs, 0.01);
+}
+
 TEST_F(BenchmarkingStateTest, PerfBasic) {
   int setUpPerfCalled = 0;
   std::vector<std::string> expectedArgs;
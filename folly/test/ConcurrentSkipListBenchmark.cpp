@@ -305,6 +305,38 @@ void BM_AddSkipList(int iters, int size) {
   }
 }
 
+// Adds `iters` consecutive keys in sorted batches of `size`, which is how
+// time-indexed data typically arrives.
+void BM_AddSkipListSortedBatch(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto skipList = SkipListType::create(kInitHeadHeight);
+  susp.dismiss();
+
+  for (int i = 0; i < iters; i += size) {
+    for (int j = i; j < std::min(i + size, iters); ++j) {
+      skipList.add(j);
+    }
+  }
+}
+
+void BM_InsertSortedSkipList(int iters, int size) {
+  BenchmarkSuspender susp;
+  auto skipList = SkipListType::create(kInitHeadHeight);
+  std::vector<ValueType> batch;
+  batch.reserve(size);
+  susp.dismiss();
+
+  for (int i = 0; i < iters; i += size) {
+    BENCHMARK_SUSPEND {
+      batch.clear();
+      for (int j = i; j < std::min(i + size, iters); ++j) {
+        batch.push_back(j);
+      }
+    }
+    skipList.insertSorted(batch.begin(), batch.end());
+  }
+}
+
 BENCHMARK(Accessor, iters) {
   BenchmarkSuspender susp;
   auto skiplist = SkipListType::createInstance(kInitHeadHeight);
@@ -571,6 +603,14 @@ BENCHMARK_PARAM(BM_AddSet, 1000000)
 BENCHMARK_PARAM(BM_AddSkipList, 1000000)
 BENCHMARK_DRAW_LINE();
 
+BENCHMARK_PARAM(BM_AddSkipListSortedBatch, 1000)
+BENCHMARK_RELATIVE_PARAM(BM_InsertSortedSkipList, 1000)
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK_PARAM(BM_AddSkipListSortedBatch, 100000)
+BENCHMARK_RELATIVE_PARAM(BM_InsertSortedSkipList, 100000)
+BENCHMARK_DRAW_LINE();
+
 BENCHMARK_PARAM(BM_SetMerge, 1000)
 BENCHMARK_PARAM(BM_CSLMergeIntersection, 1000)
 BENCHMARK_PARAM(BM_CSLMergeLookup, 1000)
@@ -16,9 +16,11 @@
 
 #include <folly/ConcurrentSkipList.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <set>
+#include <string>
 #include <system_error>
 #include <thread>
 #include <vector>
@@ -325,6 +327,115 @@ TEST(ConcurrentSkipList, ConcurrentAdd) {
   verifyEqual(skipList, all);
 }
 
+TEST(ConcurrentSkipList, InsertSorted) {
+  auto skipList = SkipListType::create(kHeadHeight);
+  SetType verifier;
+
+  vector<ValueType> batch;
+  for (int i = 0; i < 10000; i += 2) {
+    batch.push_back(i);
+  }
+  EXPECT_EQ(batch.size(), skipList.insertSorted(batch.begin(), batch.end()));
+  verifier.insert(batch.begin(), batch.end());
+  verifyEqual(skipList, verifier);
+
+  // Interleave with the existing keys, including duplicates within the
+  // batch and keys that are already present
+  batch.clear();
+  for (int i = 0; i < 12000; i += 3) {
+    batch.push_back(i);
+    batch.push_back(i);
+  }
+  size_t expected = 0;
+  for (auto v : batch) {
+    expected += verifier.insert(v).second;
+  }
+  EXPECT_EQ(expected, skipList.insertSorted(batch.begin(), batch.end()));
+  verifyEqual(skipList, verifier);
+
+  // Unsorted input is still inserted correctly
+  batch = {20001, 20000, 15000, 20005, 19999, 3};
+  expected = 0;
+  for (auto v : batch) {
+    expected += verifier.insert(v).second;
+  }
+  EXPECT_EQ(expected, skipList.insertSorted(batch.begin(), batch.end()));
+  verifyEqual(skipList, verifier);
+  EXPECT_EQ(0, skipList.insertSorted(batch.begin(), batch.begin()));
+}
+
+TEST(ConcurrentSkipList, InsertSortedMovable) {
+  auto skipList = ConcurrentSkipList<std::string>::create(kHeadHeight);
+  vector<std::string> batch = {"a", "b", "c"};
+  EXPECT_EQ(
+      3,
+      skipList.insertSorted(
+          std::make_move_iterator(batch.begin()),
+          std::make_move_iterator(batch.end())));
+  EXPECT_TRUE(skipList.contains("b"));
+  EXPECT_EQ(3, skipList.size());
+}
+
+TEST(ConcurrentSkipList, UpperBound) {
+  auto skipList = SkipListType::create(kHeadHeight);
+  for (int i = 0; i < 100; i += 10) {
+    skipList.add(i);
+  }
+  EXPECT_EQ(10, *skipList.upper_bound(0));
+  EXPECT_EQ(10, *skipList.upper_bound(5));
+  EXPECT_EQ(0, *skipList.upper_bound(-1));
+  EXPECT_TRUE(skipList.upper_bound(90) == skipList.end());
+  skipList.remove(10);
+  EXPECT_EQ(20, *skipList.upper_bound(0));
+
+  vector<ValueType> scanned;
+  for (auto it = skipList.lower_bound(15), end = skipList.upper_bound(50);
+       it != end;
+       ++it) {
+    scanned.push_back(*it);
+  }
+  EXPECT_EQ((vector<ValueType>{20, 30, 40, 50}), scanned);
+}
+
+TEST(ConcurrentSkipList, ConcurrentInsertSorted) {
+  const int numThreads = 16;
+  const int batchSize = 2000;
+  auto skipList = SkipListType::create(kHeadHeight);
+
+  // Overlapping sorted batches from many threads, racing with removals
+  vector<std::thread> threads;
+  vector<SetType> removed(numThreads);
+  for (int t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t] {
+      vector<ValueType> batch;
+      for (int i = 0; i < batchSize; ++i) {
+        batch.push_back((t % 4) * batchSize / 2 + i);
+      }
+      skipList.insertSorted(batch.begin(), batch.end());
+      for (int i = 0; i < 100; ++i) {
+        int r = rand() % (batchSize * 3);
+        removed[t].insert(r);
+        skipList.remove(r);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  EXPECT_TRUE(std::is_sorted(skipList.begin(), skipList.end()));
+  EXPECT_EQ(std::distance(skipList.begin(), skipList.end()), skipList.size());
+  for (int i = 0; i < batchSize * 5 / 2; ++i) {
+    bool mayBeRemoved = false;
+    for (auto& r : removed) {
+      mayBeRemoved |= r.count(i) > 0;
+    }
+    if (!mayBeRemoved) {
+      EXPECT_TRUE(skipList.contains(i)) << i;
+    }
+  }
+}
+
 void testConcurrentRemoval(int numThreads, int maxValue) {
   auto skipList = SkipListType::create(kHeadHeight);
   for (int i = 0; i < maxValue; ++i) {
@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/MPMCQueue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <folly/Benchmark.h>
+#include <folly/concurrency/UnboundedQueue.h>
+#include <folly/portability/GFlags.h>
+
+/**
+ * Throughput of handing off `iters` elements from P producers to P
+ * consumers, one element per ticket vs. a batch of elements per ticket
+ * reservation.  Each iteration is one element.
+ */
+
+DEFINE_uint64(capacity, 4096, "MPMCQueue capacity");
+
+namespace {
+
+using folly::BenchmarkSuspender;
+
+template <typename ProdFn, typename ConsFn>
+void runProdCons(
+    size_t iters, int threads, const ProdFn& prodFn, const ConsFn& consFn) {
+  BenchmarkSuspender braces;
+  std::atomic<int> ready{0};
+  std::atomic<bool> go{false};
+  const size_t perThread = iters / threads;
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; ++t) {
+    workers.emplace_back([&] {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      prodFn(perThread);
+    });
+    workers.emplace_back([&] {
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire)) {
+      }
+      consFn(perThread);
+    });
+  }
+  while (ready.load() < 2 * threads) {
+  }
+  braces.dismissing([&] {
+    go.store(true, std::memory_order_release);
+    for (auto& w : workers) {
+      w.join();
+    }
+  });
+}
+
+void mpmcSingle(size_t iters, int threads) {
+  folly::MPMCQueue<uint64_t> q(FLAGS_capacity);
+  runProdCons(
+      iters,
+      threads,
+      [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+          q.blockingWrite(i);
+        }
+      },
+      [&](size_t n) {
+        uint64_t v;
+        for (size_t i = 0; i < n; ++i) {
+          q.blockingRead(v);
+          folly::doNotOptimizeAway(v);
+        }
+      });
+}
+
+void mpmcBatch(size_t iters, int threads, size_t batch) {
+  folly::MPMCQueue<uint64_t> q(FLAGS_capacity);
+  runProdCons(
+      iters,
+      threads,
+      [&](size_t n) {
+        std::vector<uint64_t> src(batch);
+        for (size_t i = 0; i < n; i += batch) {
+          q.blockingWriteBatch(src.begin(), std::min(batch, n - i));
+        }
+      },
+      [&](size_t n) {
+        std::vector<uint64_t> dst(batch);
+        for (size_t i = 0; i < n; i += batch) {
+          q.blockingReadBatch(dst.data(), std::min(batch, n - i));
+          folly::doNotOptimizeAway(dst[0]);
+        }
+      });
+}
+
+void umpmcSingle(size_t iters, int threads) {
+  folly::UMPMCQueue<uint64_t, false> q;
+  runProdCons(
+      iters,
+      threads,
+      [&](size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+          q.enqueue(i);
+        }
+      },
+      [&](size_t n) {
+        uint64_t v;
+        for (size_t i = 0; i < n; ++i) {
+          while (!q.try_dequeue(v)) {
+          }
+          folly::doNotOptimizeAway(v);
+        }
+      });
+}
+
+void umpmcBatch(size_t iters, int threads, size_t batch) {
+  folly::UMPMCQueue<uint64_t, false> q;
+  runProdCons(
+      iters,
+      threads,
+      [&](size_t n) {
+        std::vector<uint64_t> src(batch);
+        for (size_t i = 0; i < n; i += batch) {
+          q.enqueue_batch(src.begin(), std::min(batch, n - i));
+        }
+      },
+      [&](size_t n) {
+        std::vector<uint64_t> dst(batch);
+        for (size_t i = 0; i < n;) {
+          i += q.try_dequeue_batch(dst.data(), std::min(batch, n - i));
+          folly::doNotOptimizeAway(dst[0]);
+        }
+      });
+}
+
+} // namespace
+
+BENCHMARK_NAMED_PARAM(mpmcSingle, 1t, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 1t_8b, 1, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 1t_64b, 1, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 1t_512b, 1, 512)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mpmcSingle, 4t, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 4t_8b, 4, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 4t_64b, 4, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 4t_512b, 4, 512)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(mpmcSingle, 16t, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 16t_8b, 16, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 16t_64b, 16, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(mpmcBatch, 16t_128b, 16, 128)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(umpmcSingle, 1t, 1)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 1t_8b, 1, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 1t_64b, 1, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 1t_512b, 1, 512)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(umpmcSingle, 4t, 4)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 4t_8b, 4, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 4t_64b, 4, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 4t_512b, 4, 512)
+BENCHMARK_DRAW_LINE();
+BENCHMARK_NAMED_PARAM(umpmcSingle, 16t, 16)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 16t_8b, 16, 8)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 16t_64b, 16, 64)
+BENCHMARK_RELATIVE_NAMED_PARAM(umpmcBatch, 16t_512b, 16, 512)
+
+int main(int argc, char** argv) {
+  folly::gflags::ParseCommandLineFlags(&argc, &argv, true);
+  folly::runBenchmarks();
+  return 0;
+}
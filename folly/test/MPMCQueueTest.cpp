@@ -18,6 +18,7 @@
 
 #include <functional>
 #include <memory>
+#include <numeric>
 #include <string>
 #include <thread>
 #include <utility>
@@ -239,6 +240,181 @@ TEST(MPMCQueue, enqCapacityTest) {
   }
 }
 
+TEST(MPMCQueue, singleThreadBatch) {
+  MPMCQueue<int> cq(10);
+
+  std::vector<int> src(15);
+  std::iota(src.begin(), src.end(), 0);
+  EXPECT_EQ(0, cq.tryWriteBatch(src.begin(), 0));
+  EXPECT_EQ(4, cq.tryWriteBatch(src.begin(), 4));
+  EXPECT_EQ(6, cq.tryWriteBatch(src.begin() + 4, 11));
+  EXPECT_EQ(0, cq.tryWriteBatch(src.begin() + 10, 5));
+  EXPECT_EQ(cq.size(), 10);
+
+  int dest[16];
+  EXPECT_EQ(3, cq.tryReadBatch(dest, 3));
+  EXPECT_EQ(7, cq.tryReadBatch(dest + 3, 13));
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_EQ(dest[i], i);
+  }
+  EXPECT_EQ(0, cq.tryReadBatch(dest, 16));
+  EXPECT_TRUE(cq.isEmpty());
+
+  // Wraps around the slot array, mixing batch and single operations
+  for (int pass = 0; pass < 10; ++pass) {
+    cq.blockingWriteBatch(src.begin(), 7);
+    EXPECT_TRUE(cq.write(7));
+    int x = -1;
+    EXPECT_TRUE(cq.read(x));
+    EXPECT_EQ(x, 0);
+    cq.blockingReadBatch(dest, 7);
+    for (int i = 0; i < 7; ++i) {
+      EXPECT_EQ(dest[i], i + 1);
+    }
+    EXPECT_TRUE(cq.isEmpty());
+  }
+}
+
+TEST(MPMCQueue, batchMoveOnly) {
+  MPMCQueue<std::unique_ptr<int>> cq(4);
+  std::vector<std::unique_ptr<int>> src;
+  for (int i = 0; i < 4; ++i) {
+    src.push_back(std::make_unique<int>(i));
+  }
+  EXPECT_EQ(4, cq.tryWriteBatch(std::make_move_iterator(src.begin()), 4));
+  std::unique_ptr<int> dest[4];
+  EXPECT_EQ(4, cq.tryReadBatch(dest, 4));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(src[i], nullptr);
+    EXPECT_EQ(*dest[i], i);
+  }
+}
+
+template <template <typename> class Atom>
+void runBatchEnqDeqTest(int numThreads, int numOps, size_t batch) {
+  MPMCQueue<int, Atom> cq(numThreads * batch);
+
+  std::atomic<uint64_t> sum(0);
+  vector<std::thread> threads(numThreads);
+  const int n = numOps / numThreads;
+  for (int t = 0; t < numThreads; ++t) {
+    threads[t] = DSched::thread([&, t] {
+      std::vector<int> src(batch);
+      std::vector<int> dst(batch);
+      uint64_t threadSum = 0;
+      int sent = 0;
+      int received = 0;
+      while (sent < n || received < n) {
+        if (sent < n) {
+          size_t k = std::min<size_t>(batch, n - sent);
+          for (size_t i = 0; i < k; ++i) {
+            src[i] = t * n + sent + int(i);
+          }
+          sent += int(cq.tryWriteBatch(src.begin(), k));
+        }
+        if (received < n) {
+          size_t k = std::min<size_t>(batch, n - received);
+          k = cq.tryReadBatch(dst.data(), k);
+          for (size_t i = 0; i < k; ++i) {
+            threadSum += dst[i];
+          }
+          received += int(k);
+        }
+      }
+      sum += threadSum;
+    });
+  }
+  for (auto& t : threads) {
+    DSched::join(t);
+  }
+  EXPECT_TRUE(cq.isEmpty());
+  uint64_t total = uint64_t(n) * numThreads;
+  EXPECT_EQ(total * (total - 1) / 2, sum.load());
+}
+
+template <template <typename> class Atom>
+void runBlockingBatchProdConsTest(int numProducers, int numConsumers) {
+  // Every producer and consumer handles the same number of batches, so
+  // that blocking reads always have a matching write
+  const int batch = 8;
+  const int perThread = batch * numConsumers * 100;
+  const int perConsumer = perThread * numProducers / numConsumers;
+  MPMCQueue<int, Atom> cq(batch * 2);
+
+  std::atomic<uint64_t> sum(0);
+  vector<std::thread> threads;
+  for (int t = 0; t < numProducers; ++t) {
+    threads.push_back(DSched::thread([&, t] {
+      std::vector<int> src(batch);
+      for (int sent = 0; sent < perThread; sent += batch) {
+        std::iota(src.begin(), src.end(), t * perThread + sent);
+        cq.blockingWriteBatch(src.begin(), batch);
+      }
+    }));
+  }
+  for (int t = 0; t < numConsumers; ++t) {
+    threads.push_back(DSched::thread([&] {
+      int dst[batch];
+      uint64_t threadSum = 0;
+      for (int received = 0; received < perConsumer; received += batch) {
+        cq.blockingReadBatch(dst, batch);
+        for (int i = 0; i < batch; ++i) {
+          threadSum += dst[i];
+        }
+        if (numProducers == 1 && numConsumers == 1) {
+          // a single producer's batches are dequeued in order
+          EXPECT_EQ(dst[0], received);
+          EXPECT_EQ(dst[batch - 1], received + batch - 1);
+        }
+      }
+      sum += threadSum;
+    }));
+  }
+  for (auto& t : threads) {
+    DSched::join(t);
+  }
+  EXPECT_TRUE(cq.isEmpty());
+  uint64_t total = uint64_t(perThread) * numProducers;
+  EXPECT_EQ(total * (total - 1) / 2, sum.load());
+}
+
+TEST(MPMCQueue, mtBatchEnqDeq) {
+  for (int nt : {1, 3, 16}) {
+    for (size_t batch : {1, 7, 64}) {
+      runBatchEnqDeqTest<std::atomic>(nt, 100000, batch);
+    }
+  }
+}
+
+TEST(MPMCQueue, mtBatchEnqDeqEmulatedFutex) {
+  for (int nt : {1, 3, 16}) {
+    for (size_t batch : {1, 7, 64}) {
+      runBatchEnqDeqTest<EmulatedFutexAtomic>(nt, 100000, batch);
+    }
+  }
+}
+
+TEST(MPMCQueue, mtBatchEnqDeqDeterministic) {
+  long seed = 0;
+  LOG(INFO) << "using seed " << seed;
+  for (int nt : {3, 10}) {
+    DSched sched(DSched::uniform(seed));
+    runBatchEnqDeqTest<DeterministicAtomic>(nt, 1000, 5);
+  }
+}
+
+TEST(MPMCQueue, mtBlockingBatchProdCons) {
+  runBlockingBatchProdConsTest<std::atomic>(1, 1);
+  runBlockingBatchProdConsTest<std::atomic>(4, 1);
+  runBlockingBatchProdConsTest<std::atomic>(1, 4);
+  runBlockingBatchProdConsTest<std::atomic>(8, 8);
+}
+
+TEST(MPMCQueue, mtBlockingBatchProdConsEmulatedFutex) {
+  runBlockingBatchProdConsTest<EmulatedFutexAtomic>(1, 1);
+  runBlockingBatchProdConsTest<EmulatedFutexAtomic>(4, 4);
+}
+
 template <template <typename> class Atom, bool Dynamic = false>
 void runTryEnqDeqThread(
     int numThreads,
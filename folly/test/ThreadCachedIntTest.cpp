@@ -198,6 +198,24 @@ TEST(ThreadCachedInt, SingleThreadedCached) {
   EXPECT_EQ(0, val.readFast());
 }
 
+TEST(ThreadCachedInt, FloatingPoint) {
+  ThreadCachedInt<double> val(0.0, 4);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        val.increment(0.5);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  EXPECT_EQ(2000.0, val.readFast());
+  val.increment(0.25);
+  EXPECT_EQ(2000.25, val.readFull());
+}
+
 ThreadCachedInt<int32_t> globalInt32(0, 11);
 ThreadCachedInt<int64_t> globalInt64(0, 11);
 int kNumInserts = 100000;
@@ -18,7 +18,9 @@
  * This macro enables FbSystrace usage in production for fb4a. When
  * FOLLY_SCOPED_TRACE_SECTION_HEADER is defined then a trace section is started
  * and later automatically terminated at the close of the scope it is called in.
- * In all other cases no action is taken.
+ * In all other cases the section is recorded in the TraceRingBuffer, if it is
+ * enabled. Only the pointer to the name is recorded, so arg must then be a
+ * string literal; anything else fails to compile.
  */
 
 #pragma once
@@ -26,7 +28,12 @@
 #if defined(FOLLY_SCOPED_TRACE_SECTION_HEADER)
 #include FOLLY_SCOPED_TRACE_SECTION_HEADER
 #else
-#define FOLLY_SCOPED_TRACE_SECTION(arg, ...) \
-  do {                                       \
-  } while (0)
+#include <folly/Preprocessor.h>
+#include <folly/tracing/TraceRingBuffer.h>
+
+// Concatenating with "" rejects anything but a string literal, which outlives
+// the recorded event.
+#define FOLLY_SCOPED_TRACE_SECTION(arg, ...)                              \
+  ::folly::TraceRingBufferScope FB_ANONYMOUS_VARIABLE(follyTraceSection)( \
+      "" arg "")
 #endif
@@ -0,0 +1,407 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/TraceRingBuffer.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <utility>
+
+#include <fmt/core.h>
+#include <folly/FileUtil.h>
+#include <folly/Indestructible.h>
+#include <folly/Synchronized.h>
+#include <folly/chrono/Hardware.h>
+#include <folly/lang/Bits.h>
+#include <folly/lang/Exception.h>
+#include <folly/portability/Fcntl.h>
+#include <folly/portability/Unistd.h>
+#include <folly/system/ThreadId.h>
+#include <folly/system/ThreadName.h>
+
+namespace folly {
+
+namespace {
+
+// Timestamps keep 62 bits; the other 2 hold the event type, so that an event
+// fits in 16 bytes.  2^62 TSC ticks are decades of uptime.
+constexpr unsigned kTypeShift = 62;
+constexpr uint64_t kTimestampMask = (uint64_t(1) << kTypeShift) - 1;
+
+// Buffers of exited threads that are kept for snapshot().
+constexpr size_t kMaxRetiredBuffers = 64;
+
+struct ThreadBuffer {
+  explicit ThreadBuffer(size_t cap)
+      : capacity(cap),
+        slots(new Slot[cap]),
+        osThreadId(getOSThreadID()),
+        threadName(getCurrentThreadName().value_or("")) {}
+
+  struct Slot {
+    std::atomic<uint64_t> timestampAndType{0};
+    std::atomic<const char*> name{nullptr};
+  };
+
+  const size_t capacity;
+  const std::unique_ptr<Slot[]> slots;
+  const uint64_t osThreadId;
+  const std::string threadName;
+  std::atomic<bool> retired{false};
+
+  // Written only by the owning thread.  claimed is incremented before an
+  // event is written and committed after, so that snapshot() can tell which
+  // of the events it copied may have been overwritten meanwhile.
+  std::atomic<uint64_t> claimed{0};
+  std::atomic<uint64_t> committed{0};
+};
+
+struct Calibration {
+  uint64_t timestamp;
+  std::chrono::steady_clock::time_point time;
+};
+
+struct Registry {
+  Synchronized<std::vector<std::shared_ptr<ThreadBuffer>>> buffers;
+  std::atomic<size_t> capacity{TraceRingBuffer::kDefaultCapacity};
+  // Taken when the first buffer is created, and again by snapshot() to
+  // convert timestamps.
+  const Calibration start{
+      hardware_timestamp() & kTimestampMask, std::chrono::steady_clock::now()};
+};
+
+Registry& registry() {
+  static Indestructible<Registry> instance;
+  return *instance;
+}
+
+thread_local ThreadBuffer* threadBuffer = nullptr;
+thread_local bool threadExited = false;
+
+struct ThreadBufferHolder {
+  std::shared_ptr<ThreadBuffer> buffer;
+
+  ~ThreadBufferHolder() {
+    threadBuffer = nullptr;
+    threadExited = true;
+    buffer->retired.store(true, std::memory_order_relaxed);
+    registry().buffers.withWLock([](auto& buffers) {
+      auto numRetired = std::count_if(
+          buffers.begin(), buffers.end(), [](const auto& b) {
+            return b->retired.load(std::memory_order_relaxed);
+          });
+      for (auto it = buffers.begin();
+           numRetired > static_cast<ptrdiff_t>(kMaxRetiredBuffers);) {
+        if ((*it)->retired.load(std::memory_order_relaxed)) {
+          it = buffers.erase(it);
+          --numRetired;
+        } else {
+          ++it;
+        }
+      }
+    });
+  }
+};
+
+FOLLY_NOINLINE ThreadBuffer* createThreadBuffer() {
+  if (threadExited) {
+    return nullptr;
+  }
+  auto& reg = registry();
+  std::shared_ptr<ThreadBuffer> buffer;
+  try {
+    buffer = std::make_shared<ThreadBuffer>(
+        reg.capacity.load(std::memory_order_relaxed));
+    reg.buffers.wlock()->push_back(buffer);
+  } catch (...) {
+    return nullptr;
+  }
+  static thread_local ThreadBufferHolder holder;
+  holder.buffer = std::move(buffer);
+  threadBuffer = holder.buffer.get();
+  return threadBuffer;
+}
+
+void appendJsonString(std::string& out, const char* str) {
+  out.push_back('"');
+  for (; *str != '\0'; ++str) {
+    auto c = static_cast<unsigned char>(*str);
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(static_cast<char>(c));
+    } else if (c < 0x20) {
+      fmt::format_to(std::back_inserter(out), "\\u{:04x}", c);
+    } else {
+      out.push_back(static_cast<char>(c));
+    }
+  }
+  out.push_back('"');
+}
+
+} // namespace
+
+std::atomic<bool> TraceRingBuffer::enabled_{true};
+
+void TraceRingBuffer::setCapacity(size_t capacity) {
+  registry().capacity.store(
+      nextPowTwo(std::max<size_t>(capacity, 2)), std::memory_order_relaxed);
+}
+
+size_t TraceRingBuffer::getCapacity() {
+  return registry().capacity.load(std::memory_order_relaxed);
+}
+
+void TraceRingBuffer::record(EventType type, const char* name) noexcept {
+  auto buffer = threadBuffer;
+  if (FOLLY_UNLIKELY(!buffer)) {
+    buffer = createThreadBuffer();
+    if (!buffer) {
+      return;
+    }
+  }
+  auto const pos = buffer->claimed.load(std::memory_order_relaxed);
+  buffer->claimed.store(pos + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  auto& slot = buffer->slots[pos & (buffer->capacity - 1)];
+  slot.timestampAndType.store(
+      (hardware_timestamp() & kTimestampMask) |
+          (static_cast<uint64_t>(type) << kTypeShift),
+      std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_relaxed);
+  buffer->committed.store(pos + 1, std::memory_order_release);
+}
+
+std::vector<TraceRingBuffer::ThreadEvents> TraceRingBuffer::snapshot() {
+  auto& reg = registry();
+  auto buffers = *reg.buffers.rlock();
+
+  struct RawEvent {
+    uint64_t timestampAndType;
+    const char* name;
+  };
+  std::vector<ThreadEvents> result;
+  std::vector<std::vector<RawEvent>> rawEvents;
+  for (auto& buffer : buffers) {
+    auto const end = buffer->committed.load(std::memory_order_acquire);
+    auto const begin = end > buffer->capacity ? end - buffer->capacity : 0;
+    std::vector<RawEvent> raw;
+    raw.reserve(end - begin);
+    for (auto pos = begin; pos < end; ++pos) {
+      auto& slot = buffer->slots[pos & (buffer->capacity - 1)];
+      raw.push_back(
+          {slot.timestampAndType.load(std::memory_order_relaxed),
+           slot.name.load(std::memory_order_relaxed)});
+    }
+    // Drop the events that the owning thread may have started to overwrite
+    // while they were copied.
+    std::atomic_thread_fence(std::memory_order_acquire);
+    auto const claimed = buffer->claimed.load(std::memory_order_relaxed);
+    auto const firstValid =
+        claimed > buffer->capacity ? claimed - buffer->capacity : 0;
+    if (firstValid > begin) {
+      raw.erase(
+          raw.begin(),
+          raw.begin() + std::min<size_t>(firstValid - begin, raw.size()));
+    }
+    result.push_back({buffer->osThreadId, buffer->threadName, {}});
+    rawEvents.push_back(std::move(raw));
+  }
+
+  // Convert timestamps with the ratio of elapsed ticks to elapsed time since
+  // the registry was created.  Wait a little if that was too recent for the
+  // ratio to be accurate.
+  auto const& start = reg.start;
+  if (std::chrono::steady_clock::now() - start.time <
+      std::chrono::milliseconds(10)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto const nowTime = std::chrono::steady_clock::now();
+  auto const nowTimestamp = hardware_timestamp() & kTimestampMask;
+  auto const ticksPerNs = double(nowTimestamp - start.timestamp) /
+      double(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 nowTime - start.time)
+                 .count());
+
+  for (size_t i = 0; i < result.size(); ++i) {
+    auto& events = result[i].events;
+    events.reserve(rawEvents[i].size());
+    for (auto& raw : rawEvents[i]) {
+      auto const timestamp = raw.timestampAndType & kTimestampMask;
+      auto const elapsedNs =
+          (double(timestamp) - double(start.timestamp)) / ticksPerNs;
+      events.push_back(
+          {start.time +
+               std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                   std::chrono::duration<double, std::nano>(elapsedNs)),
+           raw.name,
+           static_cast<EventType>(raw.timestampAndType >> kTypeShift)});
+    }
+  }
+  return result;
+}
+
+std::string TraceRingBuffer::toChromeTraceJson() {
+  return toChromeTraceJson(snapshot());
+}
+
+std::string TraceRingBuffer::toChromeTraceJson(
+    const std::vector<ThreadEvents>& threads) {
+  auto const pid = static_cast<uint64_t>(getpid());
+  std::string out = R"({"displayTimeUnit":"ns","traceEvents":[)";
+  bool first = true;
+  auto separator = [&] {
+    if (!std::exchange(first, false)) {
+      out.push_back(',');
+    }
+    out.push_back('\n');
+  };
+  for (auto& thread : threads) {
+    if (!thread.threadName.empty()) {
+      separator();
+      fmt::format_to(
+          std::back_inserter(out),
+          R"({{"name":"thread_name","ph":"M","pid":{},"tid":{},)"
+          R"("args":{{"name":)",
+          pid,
+          thread.osThreadId);
+      appendJsonString(out, thread.threadName.c_str());
+      out += "}}";
+    }
+    for (auto& event : thread.events) {
+      separator();
+      auto const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          event.time.time_since_epoch())
+                          .count();
+      out += R"({"name":)";
+      appendJsonString(out, event.name ? event.name : "");
+      char const* phase = event.type == EventType::Begin ? "B"
+          : event.type == EventType::End                 ? "E"
+                                                         : "i";
+      fmt::format_to(
+          std::back_inserter(out),
+          R"(,"ph":"{}","ts":{}.{:03},"pid":{},"tid":{})",
+          phase,
+          ns / 1000,
+          ns % 1000,
+          pid,
+          thread.osThreadId);
+      if (event.type == EventType::Instant) {
+        out += R"(,"s":"t")";
+      }
+      out.push_back('}');
+    }
+  }
+  out += "\n]}\n";
+  return out;
+}
+
+bool TraceRingBuffer::writeChromeTrace(const std::string& path) {
+  return writeFile(toChromeTraceJson(), path.c_str());
+}
+
+#ifndef _WIN32
+
+namespace {
+
+int dumpSignalPipe[2] = {-1, -1};
+
+void dumpSignalHandler(int) {
+  auto const savedErrno = errno;
+  char c = 0;
+  // The write end is non-blocking: if the pipe is full (EAGAIN), a dump is
+  // already pending.
+  [[maybe_unused]] auto rc = ::write(dumpSignalPipe[1], &c, 1);
+  errno = savedErrno;
+}
+
+void closeDumpSignalPipe() {
+  for (auto& fd : dumpSignalPipe) {
+    if (fd != -1) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+}
+
+} // namespace
+
+void TraceRingBuffer::installDumpSignalHandler(int signo, std::string path) {
+  static std::atomic<bool> installed{false};
+  if (installed.exchange(true)) {
+    throw_exception<std::logic_error>(
+        "TraceRingBuffer::installDumpSignalHandler called twice");
+  }
+  // Undo everything if a step fails, so that the call can be retried.
+  auto fail = [](const char* what) {
+    auto const savedErrno = errno;
+    closeDumpSignalPipe();
+    installed.store(false);
+    throw_exception<std::system_error>(
+        savedErrno, std::generic_category(), what);
+  };
+
+  if (::pipe(dumpSignalPipe) != 0) {
+    fail("pipe() failed");
+  }
+  // The signal handler must never block, and the pipe must not be inherited
+  // by child processes.
+  if (::fcntl(dumpSignalPipe[0], F_SETFD, FD_CLOEXEC) != 0 ||
+      ::fcntl(dumpSignalPipe[1], F_SETFD, FD_CLOEXEC) != 0 ||
+      ::fcntl(dumpSignalPipe[1], F_SETFL, O_NONBLOCK) != 0) {
+    fail("fcntl() failed");
+  }
+
+  // Install the handler before starting the thread, which can't be stopped.
+  struct sigaction action = {};
+  action.sa_handler = dumpSignalHandler;
+  action.sa_flags = SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  if (::sigaction(signo, &action, nullptr) != 0) {
+    fail("sigaction() failed");
+  }
+
+  std::thread([fd = dumpSignalPipe[0], path = std::move(path)] {
+    setThreadName("TraceRingDump");
+    // Signals received while a dump is written are coalesced into the next
+    // dump.
+    char buf[4096];
+    for (;;) {
+      auto rc = ::read(fd, buf, sizeof(buf));
+      if (rc > 0) {
+        writeChromeTrace(path);
+      } else if (rc == 0 || errno != EINTR) {
+        return;
+      }
+    }
+  }).detach();
+}
+
+#else // _WIN32
+
+void TraceRingBuffer::installDumpSignalHandler(int, std::string) {
+  throw_exception<std::logic_error>(
+      "TraceRingBuffer::installDumpSignalHandler is not supported on Windows");
+}
+
+#endif // _WIN32
+
+} // namespace folly
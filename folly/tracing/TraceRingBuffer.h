@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <folly/CPortability.h>
+
+namespace folly {
+
+// An always-available, low-overhead in-process trace recorder.
+//
+// Each thread that records an event gets its own fixed-size
+// ring buffer of begin, end and instant events, timestamped with
+// hardware_timestamp() (the TSC on x86).  Recording an event takes no lock
+// and does not allocate, except for the first event of a thread.  When a
+// buffer is full the oldest events are overwritten, so the buffers always
+// hold the most recent history of each thread, which can be dumped on demand
+// or from a signal as Chrome trace JSON (chrome://tracing, Perfetto) to see
+// what the process was doing around a latency spike.
+//
+// EventBase loop phases, ThreadPoolExecutor tasks and
+// FOLLY_SCOPED_TRACE_SECTION record into it.  Recording is enabled by
+// default, so that the history is there when a spike has already happened;
+// setEnabled(false) turns it off, after which each event costs a relaxed
+// atomic load.
+//
+// Event names must be strings with static storage duration, such as string
+// literals: only the pointer is recorded.
+class TraceRingBuffer {
+ public:
+  static constexpr size_t kDefaultCapacity = 4096;
+
+  enum class EventType : uint8_t {
+    Begin,
+    End,
+    Instant,
+  };
+
+  struct Event {
+    std::chrono::steady_clock::time_point time;
+    const char* name;
+    EventType type;
+  };
+
+  struct ThreadEvents {
+    uint64_t osThreadId;
+    std::string threadName;
+    // Oldest first.
+    std::vector<Event> events;
+  };
+
+  static void setEnabled(bool enabled) noexcept {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+
+  static bool isEnabled() noexcept {
+    return enabled_.load(std::memory_order_relaxed);
+  }
+
+  // Set the number of events kept per thread, rounded up to a power of two.
+  // Only applies to threads that record their first event after the call.
+  static void setCapacity(size_t capacity);
+  static size_t getCapacity();
+
+  static void begin(const char* name) noexcept {
+    if (isEnabled()) {
+      record(EventType::Begin, name);
+    }
+  }
+
+  static void end(const char* name) noexcept {
+    if (isEnabled()) {
+      record(EventType::End, name);
+    }
+  }
+
+  static void instant(const char* name) noexcept {
+    if (isEnabled()) {
+      record(EventType::Instant, name);
+    }
+  }
+
+  // Return the events currently held by the buffers of all threads.  The
+  // buffers of exited threads are kept until a number of newer threads have
+  // exited too.  Events recorded concurrently may or may not be included.
+  static std::vector<ThreadEvents> snapshot();
+
+  // Format the result of snapshot() in the Chrome trace event format.
+  static std::string toChromeTraceJson();
+  static std::string toChromeTraceJson(
+      const std::vector<ThreadEvents>& threads);
+
+  // Write toChromeTraceJson() to the file at @path, replacing it.  Returns
+  // false on error.
+  static bool writeChromeTrace(const std::string& path);
+
+  // Write toChromeTraceJson() to @path whenever the process receives
+  // @signo, from a background thread started by this call.  The signal
+  // handler only wakes up that thread, and never blocks.  May only be
+  // called once, unless it throws.
+  static void installDumpSignalHandler(int signo, std::string path);
+
+ private:
+  friend class TraceRingBufferScope;
+
+  static void record(EventType type, const char* name) noexcept;
+
+  static std::atomic<bool> enabled_;
+};
+
+// Records a begin event on construction and an end event on destruction.
+// The end event is recorded if and only if the begin event was, even if
+// recording is enabled or disabled in between, so that they always match.
+class TraceRingBufferScope {
+ public:
+  explicit TraceRingBufferScope(const char* name) noexcept
+      : name_(name), recorded_(TraceRingBuffer::isEnabled()) {
+    if (recorded_) {
+      TraceRingBuffer::record(TraceRingBuffer::EventType::Begin, name_);
+    }
+  }
+
+  ~TraceRingBufferScope() {
+    if (recorded_) {
+      TraceRingBuffer::record(TraceRingBuffer::EventType::End, name_);
+    }
+  }
+
+  TraceRingBufferScope(const TraceRingBufferScope&) = delete;
+  TraceRingBufferScope& operator=(const TraceRingBufferScope&) = delete;
+
+ private:
+  const char* const name_;
+  const bool recorded_;
+};
+
+} // namespace folly
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/TraceRingBuffer.h>
+
+#include <folly/Benchmark.h>
+#include <folly/init/Init.h>
+#include <folly/tracing/ScopedTraceSection.h>
+
+// Cost of recording trace events.  Each iteration records one event, except
+// for the scope benchmarks, which record a begin and an end event.
+
+using namespace folly;
+
+BENCHMARK(disabled, iters) {
+  TraceRingBuffer::setEnabled(false);
+  for (size_t i = 0; i < iters; ++i) {
+    TraceRingBuffer::instant("disabled");
+  }
+  TraceRingBuffer::setEnabled(true);
+}
+
+BENCHMARK_RELATIVE(instant, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    TraceRingBuffer::instant("instant");
+  }
+}
+
+BENCHMARK_DRAW_LINE();
+
+BENCHMARK(scope, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    TraceRingBufferScope scope("scope");
+  }
+}
+
+BENCHMARK_RELATIVE(scoped_trace_section, iters) {
+  for (size_t i = 0; i < iters; ++i) {
+    FOLLY_SCOPED_TRACE_SECTION("scoped_trace_section");
+  }
+}
+
+int main(int argc, char** argv) {
+  folly::Init init(&argc, &argv);
+  folly::runBenchmarks();
+  return 0;
+}
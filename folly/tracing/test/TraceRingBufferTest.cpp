@@ -0,0 +1,307 @@
+/*
+ * Copyright (c) Meta Platforms, Inc. and affiliates.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <folly/tracing/TraceRingBuffer.h>
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <folly/FileUtil.h>
+#include <folly/io/async/EventBase.h>
+#include <folly/json/json.h>
+#include <folly/portability/GTest.h>
+#include <folly/portability/Unistd.h>
+#include <folly/system/ThreadId.h>
+#include <folly/system/ThreadName.h>
+#include <folly/testing/TestUtil.h>
+#include <folly/tracing/ScopedTraceSection.h>
+
+using namespace folly;
+
+namespace {
+
+using EventType = TraceRingBuffer::EventType;
+
+class TraceRingBufferTest : public ::testing::Test {
+ protected:
+  void TearDown() override {
+    TraceRingBuffer::setEnabled(true);
+    TraceRingBuffer::setCapacity(TraceRingBuffer::kDefaultCapacity);
+  }
+};
+
+// Events of the thread with the given OS thread id, or of the current one.
+std::vector<TraceRingBuffer::Event> threadEvents(
+    uint64_t osThreadId = getOSThreadID()) {
+  std::vector<TraceRingBuffer::Event> events;
+  for (auto& thread : TraceRingBuffer::snapshot()) {
+    if (thread.osThreadId == osThreadId) {
+      events.insert(events.end(), thread.events.begin(), thread.events.end());
+    }
+  }
+  return events;
+}
+
+} // namespace
+
+TEST_F(TraceRingBufferTest, EnabledByDefault) {
+  EXPECT_TRUE(TraceRingBuffer::isEnabled());
+}
+
+TEST_F(TraceRingBufferTest, Record) {
+  auto before = std::chrono::steady_clock::now();
+  TraceRingBuffer::begin("outer");
+  TraceRingBuffer::instant("mark");
+  TraceRingBuffer::end("outer");
+  auto after = std::chrono::steady_clock::now();
+
+  auto events = threadEvents();
+  ASSERT_GE(events.size(), 3);
+  events.erase(events.begin(), events.end() - 3);
+  EXPECT_STREQ("outer", events[0].name);
+  EXPECT_EQ(EventType::Begin, events[0].type);
+  EXPECT_STREQ("mark", events[1].name);
+  EXPECT_EQ(EventType::Instant, events[1].type);
+  EXPECT_STREQ("outer", events[2].name);
+  EXPECT_EQ(EventType::End, events[2].type);
+
+  // Timestamps are converted with a calibrated TSC rate; allow some error.
+  auto slack = std::chrono::milliseconds(5);
+  EXPECT_LE(events[0].time, events[1].time);
+  EXPECT_LE(events[1].time, events[2].time);
+  EXPECT_GE(events[0].time, before - slack);
+  EXPECT_LE(events[2].time, after + slack);
+}
+
+TEST_F(TraceRingBufferTest, Disabled) {
+  TraceRingBuffer::instant("before");
+  auto numEvents = threadEvents().size();
+  TraceRingBuffer::setEnabled(false);
+  TraceRingBuffer::instant("disabled");
+  {
+    TraceRingBufferScope scope("disabled");
+  }
+  EXPECT_EQ(numEvents, threadEvents().size());
+}
+
+TEST_F(TraceRingBufferTest, Scope) {
+  {
+    TraceRingBufferScope scope("scope");
+    FOLLY_SCOPED_TRACE_SECTION("section");
+  }
+  auto events = threadEvents();
+  ASSERT_GE(events.size(), 4);
+  events.erase(events.begin(), events.end() - 4);
+  std::vector<std::pair<std::string, EventType>> actual;
+  for (auto& event : events) {
+    actual.emplace_back(event.name, event.type);
+  }
+  std::vector<std::pair<std::string, EventType>> expected{
+      {"scope", EventType::Begin},
+      {"section", EventType::Begin},
+      {"section", EventType::End},
+      {"scope", EventType::End},
+  };
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(TraceRingBufferTest, ScopeToggled) {
+  TraceRingBuffer::instant("before");
+  {
+    // Disabled when it begins: no end event either.
+    TraceRingBuffer::setEnabled(false);
+    TraceRingBufferScope scope("disabled");
+    TraceRingBuffer::setEnabled(true);
+  }
+  {
+    // Enabled when it begins: the end event is recorded anyway.
+    TraceRingBufferScope scope("enabled");
+    TraceRingBuffer::setEnabled(false);
+  }
+
+  auto events = threadEvents();
+  ASSERT_GE(events.size(), 3);
+  events.erase(events.begin(), events.end() - 3);
+  std::vector<std::pair<std::string, EventType>> actual;
+  for (auto& event : events) {
+    actual.emplace_back(event.name, event.type);
+  }
+  std::vector<std::pair<std::string, EventType>> expected{
+      {"before", EventType::Instant},
+      {"enabled", EventType::Begin},
+      {"enabled", EventType::End},
+  };
+  EXPECT_EQ(expected, actual);
+}
+
+TEST_F(TraceRingBufferTest, EventBaseNestedLoop) {
+  // Without time measurement, a nested loop doesn't need the loop state that
+  // it shares with the outer one.
+  EventBase evb(EventBase::Options().setSkipTimeMeasurement(true));
+  evb.runAfterDelay(
+      [&] {
+        evb.loopPoll();
+        TraceRingBuffer::instant("afterNestedLoop");
+      },
+      1);
+  TraceRingBuffer::instant("beforeLoop");
+  evb.loop();
+
+  // The nested loop doesn't end the dispatch section of the outer one.
+  int openDispatches = 0;
+  bool started = false;
+  bool found = false;
+  for (auto& event : threadEvents()) {
+    if (std::strcmp(event.name, "beforeLoop") == 0) {
+      started = true;
+    } else if (!started) {
+      continue;
+    } else if (std::strcmp(event.name, "afterNestedLoop") == 0) {
+      found = true;
+      break;
+    } else if (std::strcmp(event.name, "EventBase::dispatch") == 0) {
+      openDispatches += event.type == EventType::Begin ? 1 : -1;
+    }
+  }
+  EXPECT_TRUE(found);
+  EXPECT_EQ(1, openDispatches);
+}
+
+TEST_F(TraceRingBufferTest, Wraparound) {
+  static const char* const kNames[] = {
+      "e0", "e1", "e2", "e3", "e4", "e5", "e6", "e7", "e8", "e9"};
+  TraceRingBuffer::setCapacity(3);
+  EXPECT_EQ(4, TraceRingBuffer::getCapacity());
+
+  uint64_t osThreadId = 0;
+  std::thread([&] {
+    setThreadName("wraparound");
+    osThreadId = getOSThreadID();
+    for (auto name : kNames) {
+      TraceRingBuffer::instant(name);
+    }
+  }).join();
+
+  // The buffer outlives its thread.
+  auto events = threadEvents(osThreadId);
+  ASSERT_EQ(4, events.size());
+  for (size_t i = 0; i < 4; ++i) {
+    EXPECT_STREQ(kNames[6 + i], events[i].name);
+  }
+  bool foundName = false;
+  for (auto& thread : TraceRingBuffer::snapshot()) {
+    if (thread.osThreadId == osThreadId) {
+      foundName = thread.threadName == "wraparound";
+    }
+  }
+  EXPECT_TRUE(foundName);
+}
+
+TEST_F(TraceRingBufferTest, ConcurrentSnapshot) {
+  static const char* const kNames[] = {"a", "b", "c", "d"};
+  TraceRingBuffer::setCapacity(64);
+  std::atomic<bool> stop{false};
+  std::atomic<uint64_t> osThreadId{0};
+  std::thread writer([&] {
+    osThreadId = getOSThreadID();
+    for (size_t i = 0; !stop.load(std::memory_order_relaxed); ++i) {
+      TraceRingBuffer::instant(kNames[i % 4]);
+    }
+  });
+  while (osThreadId.load() == 0) {
+    std::this_thread::yield();
+  }
+  for (int round = 0; round < 100; ++round) {
+    auto events = threadEvents(osThreadId.load());
+    ASSERT_LE(events.size(), 64);
+    // Events are never torn: they are consecutive and in order.
+    for (size_t i = 1; i < events.size(); ++i) {
+      ASSERT_NE(nullptr, events[i].name);
+      auto prev = events[i - 1].name[0] - 'a';
+      EXPECT_EQ((prev + 1) % 4, events[i].name[0] - 'a');
+      EXPECT_LE(events[i - 1].time, events[i].time);
+    }
+  }
+  stop = true;
+  writer.join();
+}
+
+TEST_F(TraceRingBufferTest, ChromeTraceJson) {
+  TraceRingBuffer::setCapacity(8);
+  uint64_t osThreadId = 0;
+  std::thread([&] {
+    setThreadName("json");
+    osThreadId = getOSThreadID();
+    TraceRingBufferScope scope("with \"quotes\"");
+    TraceRingBuffer::instant("instant");
+  }).join();
+
+  auto json = parseJson(TraceRingBuffer::toChromeTraceJson());
+  std::vector<dynamic> events;
+  for (auto& event : json["traceEvents"]) {
+    if (event["tid"].asInt() == static_cast<int64_t>(osThreadId)) {
+      events.push_back(event);
+    }
+  }
+  ASSERT_EQ(4, events.size());
+  EXPECT_EQ("M", events[0]["ph"]);
+  EXPECT_EQ("json", events[0]["args"]["name"]);
+  EXPECT_EQ("with \"quotes\"", events[1]["name"]);
+  EXPECT_EQ("B", events[1]["ph"]);
+  EXPECT_EQ("instant", events[2]["name"]);
+  EXPECT_EQ("i", events[2]["ph"]);
+  EXPECT_EQ("t", events[2]["s"]);
+  EXPECT_EQ("E", events[3]["ph"]);
+  for (size_t i = 1; i < 4; ++i) {
+    EXPECT_TRUE(events[i]["ts"].isDouble());
+    EXPECT_EQ(getpid(), events[i]["pid"].asInt());
+  }
+  EXPECT_LE(events[1]["ts"].asDouble(), events[3]["ts"].asDouble());
+}
+
+#ifndef _WIN32
+
+TEST_F(TraceRingBufferTest, DumpSignalHandler) {
+  test::TemporaryDirectory dir;
+  auto path = (dir.path() / "trace.json").string();
+  TraceRingBuffer::installDumpSignalHandler(SIGUSR2, path);
+  EXPECT_THROW(
+      TraceRingBuffer::installDumpSignalHandler(SIGUSR2, path),
+      std::logic_error);
+
+  TraceRingBuffer::instant("dumped");
+  // More signals than the pipe can hold: the handler must not block when the
+  // dump thread falls behind.
+  for (int i = 0; i < 100000; ++i) {
+    ::raise(SIGUSR2);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  std::string contents;
+  while ((!readFile(path.c_str(), contents) ||
+          contents.find("\"dumped\"") == std::string::npos) &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  EXPECT_NE(std::string::npos, contents.find("\"dumped\""));
+}
+
+#endif // _WIN32